@@ -0,0 +1,249 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "bench.hpp"
+
+#include "allocator.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+
+// Allocation counters (the benchmarks are single threaded).
+uint64_t s_allocation_count;
+uint64_t s_allocated_bytes;
+
+const char* s_filter = NULL;
+int64_t s_min_time_ns = 200000000;
+int s_failures = 0;
+
+const void* volatile s_sink;
+
+void* counted_alloc(const std::size_t size) {
+  ++s_allocation_count;
+  s_allocated_bytes += size;
+  void* ptr = std::malloc(size > 0 ? size : 1);
+  if (ptr == NULL) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+// Count the allocations that the library makes with its allocation hooks too.
+void* counted_malloc(const std::size_t size, void*) {
+  ++s_allocation_count;
+  s_allocated_bytes += size;
+  return std::malloc(size > 0 ? size : 1);
+}
+
+void* counted_realloc(void* ptr, const std::size_t size, void*) {
+  ++s_allocation_count;
+  s_allocated_bytes += size;
+  return std::realloc(ptr, size > 0 ? size : 1);
+}
+
+void counted_free(void* ptr, void*) {
+  std::free(ptr);
+}
+
+struct allocator_hooks_installer_t {
+  allocator_hooks_installer_t() {
+    us3::allocator_hooks_t hooks;
+    hooks.malloc_fn = counted_malloc;
+    hooks.realloc_fn = counted_realloc;
+    hooks.free_fn = counted_free;
+    hooks.user_data = NULL;
+    us3::set_allocator_hooks(hooks);
+  }
+};
+
+const allocator_hooks_installer_t s_allocator_hooks_installer;
+
+}  // namespace
+
+// Dynamic exception specifications were removed in C++17.
+#if __cplusplus >= 201103L
+#define US3_BENCH_THROW_BAD_ALLOC
+#define US3_BENCH_NO_THROW noexcept
+#else
+#define US3_BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define US3_BENCH_NO_THROW throw()
+#endif
+
+// Count all C++ heap allocations of the process.
+void* operator new(std::size_t size) US3_BENCH_THROW_BAD_ALLOC {
+  return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size) US3_BENCH_THROW_BAD_ALLOC {
+  return counted_alloc(size);
+}
+
+void operator delete(void* ptr) US3_BENCH_NO_THROW {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) US3_BENCH_NO_THROW {
+  std::free(ptr);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* ptr, std::size_t) US3_BENCH_NO_THROW {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) US3_BENCH_NO_THROW {
+  std::free(ptr);
+}
+#endif
+
+namespace us3 {
+namespace bench {
+
+state_t::state_t()
+    : m_elapsed_ns(0),
+      m_allocations(0),
+      m_allocated_bytes(0),
+      m_start_ns(0),
+      m_start_allocations(0),
+      m_start_allocated_bytes(0),
+      m_failure(NULL) {
+}
+
+void state_t::pause() {
+  m_elapsed_ns += get_time_ns() - m_start_ns;
+  m_allocations += s_allocation_count - m_start_allocations;
+  m_allocated_bytes += s_allocated_bytes - m_start_allocated_bytes;
+}
+
+void state_t::resume() {
+  m_start_allocations = s_allocation_count;
+  m_start_allocated_bytes = s_allocated_bytes;
+  m_start_ns = get_time_ns();
+}
+
+void state_t::fail(const char* reason) {
+  if (m_failure == NULL) {
+    m_failure = reason;
+  }
+}
+
+void state_t::start() {
+  m_elapsed_ns = 0;
+  m_allocations = 0;
+  m_allocated_bytes = 0;
+  resume();
+}
+
+void state_t::stop() {
+  pause();
+}
+
+bool init(const int argc, const char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      s_min_time_ns = static_cast<int64_t>(std::atol(argv[++i])) * 1000000;
+    } else if (argv[i][0] != '-' && s_filter == NULL) {
+      s_filter = argv[i];
+    } else {
+      std::fprintf(stderr, "Usage: %s [--min-time MS] [FILTER]\n", argv[0]);
+      return false;
+    }
+  }
+  std::printf("%-52s %12s %12s %12s\n", "benchmark", "ns/op", "allocs/op", "bytes/op");
+  return true;
+}
+
+void run(const char* name, const benchmark_fun_t fun, void* arg) {
+  if (s_filter != NULL && std::strstr(name, s_filter) == NULL) {
+    return;
+  }
+
+  // Double the number of iterations until the measurement takes long enough. The first rounds
+  // also serve as warm-up.
+  state_t state;
+  uint64_t iterations = 1;
+  while (true) {
+    state.start();
+    for (uint64_t i = 0; i < iterations && state.failure() == NULL; ++i) {
+      fun(state, arg);
+    }
+    state.stop();
+    if (state.failure() != NULL || state.elapsed_ns() >= s_min_time_ns ||
+        iterations >= (static_cast<uint64_t>(1) << 40)) {
+      break;
+    }
+    iterations *= 2;
+  }
+
+  if (state.failure() != NULL) {
+    std::printf("%-52s FAILED: %s\n", name, state.failure());
+    ++s_failures;
+    return;
+  }
+  const double n = static_cast<double>(iterations);
+  std::printf("%-52s %12.1f %12.2f %12.1f\n",
+              name,
+              static_cast<double>(state.elapsed_ns()) / n,
+              static_cast<double>(state.allocations()) / n,
+              static_cast<double>(state.allocated_bytes()) / n);
+  std::fflush(stdout);
+}
+
+int finish() {
+  return (s_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int64_t get_time_ns() {
+#if defined(_WIN32)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return static_cast<int64_t>(static_cast<double>(counter.QuadPart) * 1e9 /
+                              static_cast<double>(frequency.QuadPart));
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + static_cast<int64_t>(ts.tv_nsec);
+#endif
+}
+
+uint64_t get_allocation_count() {
+  return s_allocation_count;
+}
+
+uint64_t get_allocated_bytes() {
+  return s_allocated_bytes;
+}
+
+void do_not_optimize(const void* ptr) {
+  s_sink = ptr;
+}
+
+}  // namespace bench
+}  // namespace us3
@@ -0,0 +1,114 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_BENCH_HPP_
+#define US3_BENCH_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace us3 {
+namespace bench {
+
+/// @brief The state of a running benchmark.
+///
+/// The benchmark function is called once per iteration. Work that should not be measured (e.g.
+/// setting up or tearing down a connection) can be excluded with pause() and resume(). Note that
+/// each pause/resume pair adds a few tens of nanoseconds of clock overhead.
+class state_t {
+public:
+  state_t();
+
+  /// @brief Stop measuring time and allocations.
+  void pause();
+
+  /// @brief Resume measuring time and allocations.
+  void resume();
+
+  /// @brief Mark the current iteration as failed (the benchmark is reported as failed).
+  void fail(const char* reason);
+
+  /// @brief Start a measurement.
+  void start();
+
+  /// @brief Stop a measurement.
+  void stop();
+
+  int64_t elapsed_ns() const {
+    return m_elapsed_ns;
+  }
+
+  uint64_t allocations() const {
+    return m_allocations;
+  }
+
+  uint64_t allocated_bytes() const {
+    return m_allocated_bytes;
+  }
+
+  const char* failure() const {
+    return m_failure;
+  }
+
+private:
+  int64_t m_elapsed_ns;
+  uint64_t m_allocations;
+  uint64_t m_allocated_bytes;
+  int64_t m_start_ns;
+  uint64_t m_start_allocations;
+  uint64_t m_start_allocated_bytes;
+  const char* m_failure;
+};
+
+/// @brief A benchmark function (runs one iteration).
+typedef void (*benchmark_fun_t)(state_t& state, void* arg);
+
+/// @brief Parse the command line arguments of a benchmark program.
+///
+/// The arguments are an optional name filter (only benchmarks whose names contain the filter are
+/// run) and --min-time MS (the minimum measurement time per benchmark, default 200 ms).
+/// @returns false if the arguments are invalid (the usage has then been printed).
+bool init(int argc, const char** argv);
+
+/// @brief Run a benchmark and print the result (ns/op, allocations/op and bytes allocated/op).
+/// @param name The name of the benchmark.
+/// @param fun The benchmark function.
+/// @param arg The argument that is passed to the benchmark function.
+void run(const char* name, benchmark_fun_t fun, void* arg);
+
+/// @brief Finish the benchmark program.
+/// @returns the process exit code (non-zero if any benchmark failed).
+int finish();
+
+/// @brief Get a high resolution monotonic time stamp in nanoseconds.
+int64_t get_time_ns();
+
+/// @brief Get the number of heap allocations (operator new) made so far in the process.
+uint64_t get_allocation_count();
+
+/// @brief Get the number of bytes allocated (operator new) so far in the process.
+uint64_t get_allocated_bytes();
+
+/// @brief Keep the compiler from optimizing away a computed value.
+void do_not_optimize(const void* ptr);
+
+}  // namespace bench
+}  // namespace us3
+
+#endif  // US3_BENCH_HPP_
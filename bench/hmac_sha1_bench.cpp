@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+// Benchmarks of the HMAC-SHA1 backend that this program is linked with (the backend name is given
+// by US3_BENCH_HMAC_SHA1_BACKEND).
+
+#include "bench.hpp"
+#include "hmac_sha1.hpp"
+#include <cstring>
+
+#ifndef US3_BENCH_HMAC_SHA1_BACKEND
+#define US3_BENCH_HMAC_SHA1_BACKEND "unknown"
+#endif
+
+namespace {
+
+using us3::bench::state_t;
+
+const char* const SECRET_KEY = "wJalrXUtnFEMI/K7MDENG/bPxRfiCYEXAMPLEKEY";
+
+// A typical SigV2 string to sign for a GET request.
+const char* const STRING_TO_SIGN =
+    "GET\n"
+    "\n"
+    "\n"
+    "Tue, 27 Mar 2007 19:36:42 +0000\n"
+    "/my-bucket/some/prefix/photos/puppy-0001.jpg";
+
+// A typical SigV2 string to sign for a PUT request with a Content-MD5 and metadata.
+const char* const LONG_STRING_TO_SIGN =
+    "PUT\n"
+    "4gJE4saaMU4BqNR0kLY+lw==\n"
+    "application/octet-stream\n"
+    "Tue, 27 Mar 2007 21:06:08 +0000\n"
+    "x-amz-acl:public-read\n"
+    "x-amz-meta-checksumalgorithm:crc32\n"
+    "x-amz-meta-reviewedby:joe@example.com,jane@example.com\n"
+    "x-amz-server-side-encryption:AES256\n"
+    "/my-bucket/some/prefix/documents/quarterly-report-2007-q1-final-v2.pdf";
+
+void bench_hmac_sha1(state_t& state, void* arg) {
+  const us3::result_t<us3::hmac_sha1_t> digest =
+      us3::hmac_sha1(SECRET_KEY, static_cast<const char*>(arg));
+  if (digest.is_error()) {
+    state.fail("hmac_sha1() failed");
+  }
+  us3::bench::do_not_optimize(digest->c_str());
+}
+
+void bench_hmac_sha1_base64(state_t&, void* arg) {
+  const unsigned char(&raw_digest)[20] = *static_cast<const unsigned char(*)[20]>(arg);
+  const us3::hmac_sha1_t digest(raw_digest);
+  us3::bench::do_not_optimize(digest.c_str());
+}
+
+}  // namespace
+
+int main(const int argc, const char** argv) {
+  if (!us3::bench::init(argc, argv)) {
+    return 1;
+  }
+
+  us3::bench::run("hmac_sha1(), GET string to sign (" US3_BENCH_HMAC_SHA1_BACKEND ")",
+                  bench_hmac_sha1,
+                  const_cast<char*>(STRING_TO_SIGN));
+  us3::bench::run("hmac_sha1(), PUT string to sign (" US3_BENCH_HMAC_SHA1_BACKEND ")",
+                  bench_hmac_sha1,
+                  const_cast<char*>(LONG_STRING_TO_SIGN));
+
+  unsigned char raw_digest[20];
+  for (size_t i = 0; i < sizeof(raw_digest); ++i) {
+    raw_digest[i] = static_cast<unsigned char>(i * 37 + 11);
+  }
+  us3::bench::run("hmac_sha1_t base64 construction", bench_hmac_sha1_base64, &raw_digest);
+
+  return us3::bench::finish();
+}
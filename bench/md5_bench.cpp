@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+// Benchmarks of the MD5 hashing of multipart upload parts: one part at a time, or a batch of parts
+// in parallel (see md5_update_multi()). The parts are hashed in file buffer sized blocks, like the
+// multipart upload does.
+
+#include "bench.hpp"
+#include "md5.hpp"
+#include <vector>
+
+namespace {
+
+using us3::bench::state_t;
+
+// The number of parts, and their sizes.
+const size_t NUM_PARTS = 8;
+const size_t PART_SIZE = 1024 * 1024;
+
+// The block size that the parts are read in.
+const size_t BLOCK_SIZE = 65536;
+
+struct parts_fixture_t {
+  parts_fixture_t() : data(NUM_PARTS * PART_SIZE) {
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<char>((i * 7U + (i >> 12)) & 0xFFU);
+    }
+  }
+
+  const char* part(const size_t index) const {
+    return &data[index * PART_SIZE];
+  }
+
+  std::vector<char> data;
+};
+
+void bench_md5_one_at_a_time(state_t&, void* arg) {
+  const parts_fixture_t& fixture = *static_cast<const parts_fixture_t*>(arg);
+  for (size_t i = 0; i < NUM_PARTS; ++i) {
+    us3::md5_t hash;
+    for (size_t pos = 0; pos < PART_SIZE; pos += BLOCK_SIZE) {
+      hash.update(fixture.part(i) + pos, BLOCK_SIZE);
+    }
+    unsigned char digest[us3::md5_t::MD5_RAW_SIZE];
+    hash.finalize(digest);
+    us3::bench::do_not_optimize(&digest[0]);
+  }
+}
+
+void bench_md5_batch(state_t&, void* arg) {
+  const parts_fixture_t& fixture = *static_cast<const parts_fixture_t*>(arg);
+  us3::md5_t hashes[NUM_PARTS];
+  us3::md5_t* hash_ptrs[NUM_PARTS];
+  size_t sizes[NUM_PARTS];
+  for (size_t i = 0; i < NUM_PARTS; ++i) {
+    hash_ptrs[i] = &hashes[i];
+    sizes[i] = BLOCK_SIZE;
+  }
+  for (size_t pos = 0; pos < PART_SIZE; pos += BLOCK_SIZE) {
+    const void* data[NUM_PARTS];
+    for (size_t i = 0; i < NUM_PARTS; ++i) {
+      data[i] = fixture.part(i) + pos;
+    }
+    us3::md5_update_multi(&hash_ptrs[0], &data[0], &sizes[0], NUM_PARTS);
+  }
+  for (size_t i = 0; i < NUM_PARTS; ++i) {
+    unsigned char digest[us3::md5_t::MD5_RAW_SIZE];
+    hashes[i].finalize(digest);
+    us3::bench::do_not_optimize(&digest[0]);
+  }
+}
+
+}  // namespace
+
+int main(const int argc, const char** argv) {
+  if (!us3::bench::init(argc, argv)) {
+    return 1;
+  }
+
+  parts_fixture_t fixture;
+  us3::bench::run("MD5 of 8 x 1 MiB parts, one at a time", bench_md5_one_at_a_time, &fixture);
+  us3::bench::run("MD5 of 8 x 1 MiB parts, md5_update_multi()", bench_md5_batch, &fixture);
+
+  return us3::bench::finish();
+}
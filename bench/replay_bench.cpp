@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+// Benchmarks of the read path, replaying recorded traffic (see us3_options_t::record_path) as
+// fast as possible. Each recorded GET request is replayed with the same response segmentation,
+// so the results only depend on the recording. The default recording was captured against the
+// mock S3 server; use --recording FILE to replay another one.
+
+#include "bench.hpp"
+#include "connection.hpp"
+#include "recording.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using us3::bench::state_t;
+using us3::connection_t;
+
+// A recorded GET request to replay.
+struct replay_fixture_t {
+  us3::net::replay_t* replay;
+  size_t connection_index;
+  std::string path;
+  connection_t::options_t options;
+  connection_t connection;
+};
+
+// Measures a complete replayed GET request: open(READ), read() of the body, and close().
+void bench_replay_get(state_t& state, void* arg) {
+  replay_fixture_t& fixture = *static_cast<replay_fixture_t*>(arg);
+  static char buffer[16384];
+  fixture.replay->seek(fixture.connection_index);
+  const us3::net::replay_t::connection_t& recorded =
+      fixture.replay->connections()[fixture.connection_index];
+  if (fixture.connection
+          .open(recorded.host.c_str(),
+                recorded.port,
+                fixture.path.c_str(),
+                "access-key",
+                "secret-key",
+                connection_t::READ,
+                0,
+                fixture.options)
+          .is_error()) {
+    state.fail("open() failed");
+    return;
+  }
+  while (true) {
+    const us3::result_t<size_t> result = fixture.connection.read(buffer, sizeof(buffer));
+    if (result.is_error()) {
+      state.fail("read() failed");
+      break;
+    }
+    if (*result == 0) {
+      break;
+    }
+  }
+  fixture.connection.close();
+}
+
+// Get the path of a recorded GET request, or an empty string for other requests.
+std::string get_request_path(const us3::net::replay_t::connection_t& connection) {
+  const std::string request = connection.sent_data();
+  if (request.compare(0, 4, "GET ") != 0) {
+    return std::string();
+  }
+  const std::string::size_type end = request.find(' ', 4);
+  return (end != std::string::npos) ? request.substr(4, end - 4) : std::string();
+}
+
+}  // namespace
+
+int main(const int argc, const char** argv) {
+  // Pick out the recording argument, and pass the rest on to the benchmark framework.
+  const char* recording_path = US3_BENCH_DEFAULT_RECORDING;
+  std::vector<const char*> args;
+  for (int i = 0; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--recording") == 0 && i + 1 < argc) {
+      recording_path = argv[++i];
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (!us3::bench::init(static_cast<int>(args.size()), &args[0])) {
+    std::fprintf(stderr, "       %s [--recording FILE] ...\n", argv[0]);
+    return 1;
+  }
+
+  us3::net::replay_t replay;
+  if (replay.load(recording_path).is_error()) {
+    std::fprintf(stderr, "Unable to load the recording %s\n", recording_path);
+    return 1;
+  }
+
+  // One benchmark per recorded GET request that was not resumed or hedged (those are replayed as
+  // part of the request that made them).
+  const std::vector<us3::net::replay_t::connection_t>& connections = replay.connections();
+  for (size_t i = 0; i < connections.size(); ++i) {
+    replay_fixture_t fixture;
+    fixture.replay = &replay;
+    fixture.connection_index = i;
+    fixture.path = get_request_path(connections[i]);
+    if (fixture.path.empty() || connections[i].status != us3::status_t::SUCCESS) {
+      continue;
+    }
+    fixture.options.transport = &us3::net::replay_t::transport();
+    fixture.options.transport_data = &replay;
+
+    size_t received_bytes = 0;
+    size_t segments = 0;
+    for (size_t j = 0; j < connections[i].events.size(); ++j) {
+      if (connections[i].events[j].type == us3::net::replay_t::event_t::RECV) {
+        received_bytes += connections[i].events[j].data.size();
+        ++segments;
+      }
+    }
+    char name[256];
+    std::snprintf(name,
+                  sizeof(name),
+                  "replay #%lu GET, %lu B in %lu segments",
+                  static_cast<unsigned long>(i),
+                  static_cast<unsigned long>(received_bytes),
+                  static_cast<unsigned long>(segments));
+    us3::bench::run(name, bench_replay_get, &fixture);
+  }
+
+  return us3::bench::finish();
+}
@@ -61,14 +61,32 @@
  *
  * @li us3_status_str() - Convert a status code to a string.
  *
+ * @li us3_init_options() - Initialize an options struct with default values.
  * @li us3_open() - Open an S3 stream.
+ * @li us3_open_with_options() - Open an S3 stream with extended options.
+ * @li us3_open_inplace() - Open an S3 stream in caller provided memory.
+ * @li us3_handle_storage_size() - Get the minimum storage size for us3_open_inplace().
+ * @li us3_handle_storage_alignment() - Get the storage alignment for us3_open_inplace().
  * @li us3_close() - Close an S3 stream.
  * @li us3_read() - Read data from an S3 stream.
  * @li us3_write() - Write data to an S3 stream.
+ * @li us3_put_buffer() - Upload an object from a memory buffer.
+ * @li us3_upload_file() - Upload a file as a resumable multipart upload.
  *
  * @li us3_get_status_line() - Get the HTTP response status line.
  * @li us3_get_response_field() - Get a HTTP response field value.
  * @li us3_get_content_length() - Get the S3 stream content length (in bytes)
+ * @li us3_get_checksum() - Get the checksum of the transferred data.
+ * @li us3_get_stats() - Get the timing and I/O statistics of a stream.
+ *
+ * @li us3_configure_dns_cache() - Configure the process wide DNS cache.
+ * @li us3_flush_dns_cache() - Remove all entries from the DNS cache.
+ * @li us3_flush_redirect_cache() - Remove all entries from the bucket redirect cache.
+ *
+ * @li us3_set_allocator() - Set the memory allocation functions of the library.
+ * @li us3_set_global_hooks() - Set the process wide tracing hooks.
+ * @li us3_get_hedge_stats() - Get the process wide hedged read counters.
+ * @li us3_metrics_dump() - Export the process wide request metrics (Prometheus text format).
  *
  * @section types_sec About API types
  *
@@ -77,22 +95,24 @@
 
 /** @brief Return value for μS3 functions. */
 typedef int us3_status_t;
-#define US3_SUCCESS 0           /**< No error occurred. */
-#define US3_ERROR 1             /**< An unspecified error occurred. */
-#define US3_INVALID_ARGUMENT 2  /**< An invalid argument was passed to a function. */
-#define US3_INVALID_HANDLE 3    /**< An invalid stream handle was passed to a function. */
-#define US3_INVALID_OPERATION 4 /**< An invalid operation was requested. */
-#define US3_INVALID_URL 5       /**< An invalid URL was passed to a function. */
-#define US3_NO_HOST 6           /**< No such host was found. */
-#define US3_DENIED 7            /**< Access denied. */
-#define US3_REFUSED 8           /**< The connection was refused. */
-#define US3_UNREACHABLE 9       /**< The network is unreachable. */
-#define US3_CONNECTION_RESET 10 /**< The connection was reset by the peer. */
-#define US3_TIMEOUT 11          /**< The operation timed out. */
-#define US3_UNSUPPORTED 12      /**< An unsupported protocol function was encountered. */
-#define US3_NO_SUCH_FIELD 13    /**< The requested field was not found. */
-#define US3_FORBIDDEN 14        /**< The server refused to authorize the request. */
-#define US3_NOT_FOUND 15        /**< The object was not found. */
+#define US3_SUCCESS 0            /**< No error occurred. */
+#define US3_ERROR 1              /**< An unspecified error occurred. */
+#define US3_INVALID_ARGUMENT 2   /**< An invalid argument was passed to a function. */
+#define US3_INVALID_HANDLE 3     /**< An invalid stream handle was passed to a function. */
+#define US3_INVALID_OPERATION 4  /**< An invalid operation was requested. */
+#define US3_INVALID_URL 5        /**< An invalid URL was passed to a function. */
+#define US3_NO_HOST 6            /**< No such host was found. */
+#define US3_DENIED 7             /**< Access denied. */
+#define US3_REFUSED 8            /**< The connection was refused. */
+#define US3_UNREACHABLE 9        /**< The network is unreachable. */
+#define US3_CONNECTION_RESET 10  /**< The connection was reset by the peer. */
+#define US3_TIMEOUT 11           /**< The operation timed out. */
+#define US3_UNSUPPORTED 12       /**< An unsupported protocol function was encountered. */
+#define US3_NO_SUCH_FIELD 13     /**< The requested field was not found. */
+#define US3_FORBIDDEN 14         /**< The server refused to authorize the request. */
+#define US3_NOT_FOUND 15         /**< The object was not found. */
+#define US3_CHECKSUM_MISMATCH 16 /**< The checksum of the transferred data did not match. */
+#define US3_SERVER_ERROR 17      /**< The server failed or was overloaded (HTTP 5xx). */
 
 /** @brief Stream mode. */
 typedef int us3_mode_t;
@@ -103,12 +123,328 @@ typedef int us3_mode_t;
 typedef struct us3_handle_struct_t* us3_handle_t;
 struct us3_handle_struct_t;
 
+/**
+ * @brief The recommended storage size for us3_open_inplace(), in bytes.
+ *
+ * This is a compile-time constant, so that the storage can be allocated statically (or on the
+ * stack). It fits the stream state on all supported platforms, and leaves at least 4 KiB for the
+ * HTTP response header (see us3_open_inplace() for how much of it is used per header line). The
+ * exact minimum is given by us3_handle_storage_size().
+ */
+#define US3_HANDLE_STORAGE_SIZE 8192
+
+/** @brief The required alignment of the storage for us3_open_inplace(), in bytes. */
+#define US3_HANDLE_STORAGE_ALIGNMENT 16
+
 /** @brief A timeout value, in microseconds (μs). */
 typedef long us3_microseconds_t;
 
 /** @brief A value that requests an infinite timeout. */
 #define US3_NO_TIMEOUT 0
 
+/** @brief Request signature version. */
+typedef int us3_signature_t;
+#define US3_SIGNATURE_V2 0 /**< AWS signature version 2 (HMAC-SHA1). */
+#define US3_SIGNATURE_V4 1 /**< AWS signature version 4 (HMAC-SHA256). */
+
+/** @brief Data integrity checksum algorithm. */
+typedef int us3_checksum_t;
+#define US3_CHECKSUM_NONE 0      /**< No checksum. */
+#define US3_CHECKSUM_CRC32C 1    /**< CRC32C (x-amz-checksum-crc32c). */
+#define US3_CHECKSUM_CRC64NVME 2 /**< CRC64NVME (x-amz-checksum-crc64nvme). */
+
+/** @brief Stream transport (how the library talks to the server). */
+typedef int us3_transport_t;
+#define US3_TRANSPORT_TCP 0      /**< TCP (default). */
+#define US3_TRANSPORT_UNIX 1     /**< A Unix domain socket (POSIX only). */
+#define US3_TRANSPORT_LOOPBACK 2 /**< In-memory canned responses (for testing and benchmarks). */
+
+/** @brief A socket buffer size that is calculated from the bandwidth-delay product. */
+#define US3_AUTO_BUFFER_SIZE -1
+
+/**
+ * @brief Socket tuning options.
+ *
+ * The options are applied on a best effort basis: options that are not supported by the platform
+ * (or that the process lacks the privileges for) are silently ignored.
+ */
+typedef struct us3_socket_options_struct_t {
+  /**
+   * Non-zero to disable Nagle's algorithm (TCP_NODELAY) (default: 1). This avoids stalls when
+   * small writes (such as request headers) are followed by waiting for the peer.
+   */
+  int tcp_nodelay;
+
+  /**
+   * The socket send buffer size (SO_SNDBUF) in bytes, 0 for the system default (default), or
+   * US3_AUTO_BUFFER_SIZE to size the buffer from the bandwidth-delay product. In the latter case,
+   * the time for establishing the connection is used as the round trip time, and the buffer is
+   * never made smaller than the system default.
+   */
+  int send_buffer_size;
+
+  /** The socket receive buffer size (SO_RCVBUF), with the same semantics as send_buffer_size. */
+  int recv_buffer_size;
+
+  /**
+   * The expected link bandwidth in bytes per second, used for US3_AUTO_BUFFER_SIZE, or 0 to assume
+   * 1 Gbit/s (default: 0).
+   */
+  long link_bandwidth;
+
+  /**
+   * Non-zero to acknowledge received data immediately instead of using delayed ACKs
+   * (TCP_QUICKACK, Linux only) (default: 0).
+   */
+  int tcp_quickack;
+
+  /**
+   * The time in microseconds to busy poll the network device when waiting for data
+   * (SO_BUSY_POLL, Linux only), or 0 to disable busy polling (default: 0). This trades CPU time
+   * for lower latency.
+   */
+  int busy_poll;
+
+  /**
+   * The minimum number of bytes that a receive waits for (SO_RCVLOWAT), or 0 for the system
+   * default (default: 0). Note that a receive then waits until at least this many bytes are
+   * available, the peer closes the connection or the socket timeout expires.
+   */
+  int recv_lowat;
+} us3_socket_options_t;
+
+/** @brief Classes of failures that can be retried (see us3_retry_policy_t). */
+#define US3_RETRY_CONNECTION 1   /**< Refused, unreachable and reset connections. */
+#define US3_RETRY_TIMEOUT 2      /**< Timed out operations. */
+#define US3_RETRY_SERVER_ERROR 4 /**< HTTP 500, 502, 503 (e.g. SlowDown) and 504 responses. */
+
+/**
+ * @brief A policy for retrying failed requests.
+ *
+ * Retries are delayed with exponential backoff and full jitter: the delay before retry n (counting
+ * from zero) is uniformly random in [0, min(max_delay, base_delay * 2^n)].
+ *
+ * Opening a stream is retried until the request succeeds, or the failure is not retryable, or the
+ * maximum number of attempts has been made. For US3_READ streams, a download that fails later
+ * (e.g. due to a connection reset) is transparently resumed by us3_read() with a Range request
+ * from the current offset (with If-Match, so that the object must not have changed). The attempts
+ * are counted from the last successful receive. US3_WRITE streams can not be retried once the data
+ * transfer has started.
+ */
+typedef struct us3_retry_policy_struct_t {
+  /** The maximum number of attempts, including the first one (default: 1, i.e. no retries). */
+  int max_attempts;
+
+  /** The delay before the first retry (before jitter), in microseconds (default: 100 ms). */
+  us3_microseconds_t base_delay;
+
+  /** The maximum delay before a retry, in microseconds (default: 20 s). */
+  us3_microseconds_t max_delay;
+
+  /** The classes of failures to retry, as a bit mask of US3_RETRY_* (default: all). */
+  unsigned int retry_on;
+} us3_retry_policy_t;
+
+/** @brief A hedge delay that is estimated from recent response latencies. */
+#define US3_ADAPTIVE_HEDGE_DELAY -1
+
+/** @brief Stream lifecycle event type (see us3_hooks_t). */
+typedef int us3_event_type_t;
+#define US3_EVENT_OPEN_START 0   /**< The stream is being opened. */
+#define US3_EVENT_HEADERS_SENT 1 /**< The request headers were sent (bytes: header size). */
+#define US3_EVENT_RESPONSE 2     /**< The response headers were received (bytes: content length). */
+#define US3_EVENT_OPEN_END 3     /**< Opening the stream finished (status: the result). */
+#define US3_EVENT_READ 4         /**< us3_read() returned (bytes: bytes read). */
+#define US3_EVENT_WRITE 5        /**< us3_write() returned (bytes: bytes written). */
+#define US3_EVENT_CLOSE 6        /**< The stream was closed (bytes: total bytes sent + received). */
+
+/**
+ * @brief A stream lifecycle event.
+ *
+ * The strings are only valid during the hook call.
+ */
+typedef struct us3_event_struct_t {
+  us3_event_type_t type;   /**< The event type (US3_EVENT_*). */
+  const void* stream;      /**< Identifies the stream (the same for all events of a stream). */
+  us3_microseconds_t time; /**< The time since the stream was opened, in microseconds. */
+  const char* host;        /**< The host of the request. */
+  int status_code;         /**< The HTTP status code, or 0 if no response was received (yet). */
+  size_t bytes;            /**< A byte count (see the event types). */
+  us3_status_t status;     /**< The result of the operation. */
+} us3_event_t;
+
+/**
+ * @brief Tracing hooks.
+ *
+ * The hooks are called synchronously from the thread that uses the stream, at key points of the
+ * stream lifecycle. Requests that are retried, resumed, hedged or redirected produce several
+ * US3_EVENT_HEADERS_SENT and US3_EVENT_RESPONSE events. When no hooks are installed, the cost is
+ * a single branch per lifecycle point.
+ */
+typedef struct us3_hooks_struct_t {
+  /** Called for each event, or NULL. */
+  void (*on_event)(const us3_event_t* event, void* user_data);
+
+  /**
+   * Called before each request is sent, or NULL. Returns extra HTTP header lines to add to the
+   * request (e.g. a trace context, such as "traceparent: 00-..."), separated by CRLF and without a
+   * trailing CRLF, or NULL for none. The headers are not signed, so they must not be x-amz-*
+   * headers.
+   */
+  const char* (*get_request_headers)(const void* stream, void* user_data);
+
+  /** User data that is passed to the hooks. */
+  void* user_data;
+} us3_hooks_t;
+
+/**
+ * @brief Extended stream options.
+ *
+ * Always initialize the options with us3_init_options() before changing individual fields.
+ */
+typedef struct us3_options_struct_t {
+  /**
+   * Connection timeout in microseconds, or US3_NO_TIMEOUT for no timeout. This bounds the time for
+   * establishing the TCP connection (not including the host name lookup).
+   */
+  us3_microseconds_t connect_timeout;
+
+  /**
+   * Socket timeout in microseconds, or US3_NO_TIMEOUT for no timeout. This bounds the time that a
+   * single send or receive operation may wait for the peer. US3_TIMEOUT is returned when a timeout
+   * expires.
+   */
+  us3_microseconds_t socket_timeout;
+
+  /** Request signature version (default: US3_SIGNATURE_V2). */
+  us3_signature_t signature;
+
+  /** The AWS region for US3_SIGNATURE_V4, or NULL to derive it from the host name. */
+  const char* region;
+
+  /**
+   * The chunk size for US3_SIGNATURE_V4 uploads, or 0 for the default size (64 KiB). Uploads are
+   * signed chunk by chunk (STREAMING-AWS4-HMAC-SHA256-PAYLOAD), and one chunk is buffered at a
+   * time. The minimum chunk size is 8 KiB.
+   */
+  size_t chunk_size;
+
+  /**
+   * Checksum to calculate while transferring data (default: US3_CHECKSUM_NONE). Downloads are
+   * verified against the checksum reported by the server (if any), and US3_CHECKSUM_MISMATCH is
+   * returned by the us3_read() call that reaches the end of the stream if the checksums differ. For
+   * US3_SIGNATURE_V4 uploads, the checksum is sent as a signed trailer so that the server can
+   * verify the data. The calculated checksum can be queried with us3_get_checksum().
+   */
+  us3_checksum_t checksum;
+
+  /**
+   * Non-zero to verify downloads against the ETag of the object (default: 0). This only applies to
+   * objects that were uploaded in a single part, where the ETag is the MD5 of the object data. A
+   * mismatch is reported in the same way as for checksum.
+   */
+  int verify_etag;
+
+  /** Socket tuning options. */
+  us3_socket_options_t socket;
+
+  /**
+   * Hedge delay for US3_READ streams in microseconds, 0 to disable hedging (default), or
+   * US3_ADAPTIVE_HEDGE_DELAY. If the response has not started to arrive within the hedge delay, a
+   * duplicate request is sent on a second connection, the response that arrives first is used and
+   * the other request is cancelled. The adaptive delay is the 95th percentile of the response
+   * times of recent hedged reads in the process (no hedge requests are sent until enough response
+   * times have been collected). See us3_get_hedge_stats().
+   */
+  us3_microseconds_t hedge_delay;
+
+  /** The policy for retrying failed requests. */
+  us3_retry_policy_t retry;
+
+  /**
+   * Tracing hooks for the stream, or NULL to use the global hooks (default: NULL). The hooks must
+   * stay valid until the stream has been closed. See us3_set_global_hooks().
+   */
+  const us3_hooks_t* hooks;
+
+  /**
+   * The transport (default: US3_TRANSPORT_TCP). The host and port of the URL are used in the HTTP
+   * request (and for signing) regardless of the transport.
+   */
+  us3_transport_t transport;
+
+  /**
+   * The path of the socket for US3_TRANSPORT_UNIX (e.g. a local caching sidecar). The path must
+   * stay valid until the stream has been closed.
+   */
+  const char* unix_socket_path;
+
+  /**
+   * The response for US3_TRANSPORT_LOOPBACK. Every connection receives the complete response
+   * (HTTP headers and body), and the data that is sent is discarded. The response must stay valid
+   * until the stream has been closed.
+   */
+  const char* loopback_response;
+
+  /** The size of loopback_response, in bytes. */
+  size_t loopback_response_size;
+
+  /**
+   * The maximum number of bytes that US3_TRANSPORT_LOOPBACK returns per receive call, or 0 for no
+   * limit (default: 0). This can be used to simulate the segmentation of network traffic.
+   */
+  size_t loopback_segment_size;
+
+  /**
+   * A file to record the traffic of the stream to, or NULL for no recording (default: NULL). The
+   * exact bytes that are sent and received by each connection, with their timing, are appended to
+   * the file when the connection is closed. This can be used for capturing real traffic and
+   * replaying it in benchmarks. The values of the Authorization and x-amz-security-token headers
+   * are redacted. The path must stay valid until the stream has been closed.
+   */
+  const char* record_path;
+
+  /**
+   * Memory for the per-request data of the stream (e.g. the HTTP response headers), or NULL to
+   * let the stream allocate it (default: NULL). Once the stream has been opened, reading and
+   * writing do not allocate heap memory, except when a download is resumed after a failure (see
+   * us3_options_t::retry), which sends a new signed request, and when an upload gets a redirect
+   * response. The memory must stay valid until the stream has been closed. If it runs out, the
+   * stream allocates more memory.
+   */
+  void* arena;
+
+  /** The size of arena, in bytes. */
+  size_t arena_size;
+} us3_options_t;
+
+/**
+ * @brief Per-request timing and I/O statistics (see us3_get_stats()).
+ *
+ * The times of the request phases are relative to when the stream was opened, in microseconds,
+ * or -1 if the phase has not been reached (yet). For requests that were retried, resumed or
+ * redirected, the times are those of the latest attempt, while the counters are totals.
+ */
+typedef struct us3_stats_struct_t {
+  us3_microseconds_t resolve_time;        /**< The host name was resolved. */
+  us3_microseconds_t connect_time;        /**< The TCP connection was established. */
+  us3_microseconds_t headers_sent_time;   /**< The signed HTTP request headers were sent. */
+  us3_microseconds_t first_byte_time;     /**< The first byte of the response was received. */
+  us3_microseconds_t headers_parsed_time; /**< The HTTP response headers were parsed. */
+  us3_microseconds_t body_complete_time;  /**< All data was received (read) or sent (write). */
+  size_t bytes_sent;                      /**< Bytes sent, including the HTTP headers. */
+  size_t bytes_received;                  /**< Bytes received, including the HTTP headers. */
+  unsigned long send_calls;               /**< The number of send system calls. */
+  unsigned long recv_calls;               /**< The number of receive system calls. */
+} us3_stats_t;
+
+/** @brief Process wide hedged read counters (see us3_options_t::hedge_delay). */
+typedef struct us3_hedge_stats_struct_t {
+  unsigned long requests; /**< The number of reads that were opened with hedging enabled. */
+  unsigned long fired;    /**< The number of reads for which a hedge request was sent. */
+  unsigned long won;      /**< The number of hedge requests that responded first. */
+} us3_hedge_stats_t;
+
 /**
  * @brief Convert a status code to a string.
  * @param status The status code.
@@ -137,6 +473,79 @@ US3_API us3_status_t us3_open(const char* url,
                               us3_microseconds_t socket_timeout,
                               us3_handle_t* handle);
 
+/**
+ * @brief Initialize an options struct with default values.
+ * @param[out] options The options struct to initialize.
+ */
+US3_API void us3_init_options(us3_options_t* options);
+
+/**
+ * @brief Open an S3 stream with extended options.
+ * @param url Complete S3 URL.
+ * @param access_key The S3 access key.
+ * @param secret_key The S3 secret key.
+ * @param mode Open mode.
+ * @param size Number of bytes to write (ignored when mode is not WRITE).
+ * @param options Extended options, or NULL to use the default options.
+ * @param[out] handle The resulting handle.
+ * @returns US3_SUCCESS on success, otherwise an error code.
+ */
+US3_API us3_status_t us3_open_with_options(const char* url,
+                                           const char* access_key,
+                                           const char* secret_key,
+                                           us3_mode_t mode,
+                                           size_t size,
+                                           const us3_options_t* options,
+                                           us3_handle_t* handle);
+
+/**
+ * @brief Open an S3 stream in caller provided memory.
+ *
+ * The stream state is constructed in the storage instead of being allocated on the heap, and the
+ * rest of the storage holds the HTTP response header. That leaves storage_size -
+ * us3_handle_storage_size() + 992 bytes, rounded down to a multiple of 16, for the header (at
+ * least 4 KiB with US3_HANDLE_STORAGE_SIZE). Each line of the header (the status line, every
+ * header field and the final blank line) takes its length including the CRLF plus up to 48
+ * bytes, regardless of how the response is split into network reads. A response header that does
+ * not fit fails with US3_ERROR (the arena option is ignored). The storage must stay valid until
+ * the stream has been closed with us3_close(), and can then be reused.
+ *
+ * @param storage The storage, aligned to US3_HANDLE_STORAGE_ALIGNMENT bytes.
+ * @param storage_size The size of the storage, in bytes (e.g. US3_HANDLE_STORAGE_SIZE). It must be
+ * at least us3_handle_storage_size().
+ * @param url Complete S3 URL.
+ * @param access_key The S3 access key.
+ * @param secret_key The S3 secret key.
+ * @param mode Open mode.
+ * @param size Number of bytes to write (ignored when mode is not WRITE).
+ * @param options Extended options, or NULL to use the default options.
+ * @param[out] handle The resulting handle.
+ * @returns US3_SUCCESS on success, otherwise an error code.
+ * @note Request signing and the socket layer may still use the heap (see US3_STATIC_SOCKETS in
+ * the build options).
+ */
+US3_API us3_status_t us3_open_inplace(void* storage,
+                                      size_t storage_size,
+                                      const char* url,
+                                      const char* access_key,
+                                      const char* secret_key,
+                                      us3_mode_t mode,
+                                      size_t size,
+                                      const us3_options_t* options,
+                                      us3_handle_t* handle);
+
+/**
+ * @brief Get the minimum storage size for us3_open_inplace().
+ * @returns the size of the stream state plus a minimal (1 KiB) response area, in bytes.
+ */
+US3_API size_t us3_handle_storage_size(void);
+
+/**
+ * @brief Get the required alignment of the storage for us3_open_inplace().
+ * @returns the alignment, in bytes (US3_HANDLE_STORAGE_ALIGNMENT).
+ */
+US3_API size_t us3_handle_storage_alignment(void);
+
 /**
  * @brief Close an S3 stream.
  * @param handle The stream handle to close.
@@ -167,6 +576,64 @@ US3_API us3_status_t us3_write(us3_handle_t handle,
                                size_t count,
                                size_t* actual_count);
 
+/**
+ * @brief Upload an object from a memory buffer.
+ *
+ * Unlike a streaming upload (us3_open() + us3_write()), the whole object is available up front, so
+ * the MD5 of the data is calculated before the request is sent and passed in the Content-MD5 HTTP
+ * header. This lets the server verify the integrity of the object (some S3 compatible services
+ * require Content-MD5 for all uploads).
+ * @param url Complete S3 URL.
+ * @param access_key The S3 access key.
+ * @param secret_key The S3 secret key.
+ * @param buf The object data (may be NULL if size is zero).
+ * @param size The number of bytes to upload (zero for an empty object).
+ * @param options Extended options, or NULL to use the default options.
+ * @returns US3_SUCCESS on success, otherwise an error code.
+ */
+US3_API us3_status_t us3_put_buffer(const char* url,
+                                    const char* access_key,
+                                    const char* secret_key,
+                                    const void* buf,
+                                    size_t size,
+                                    const us3_options_t* options);
+
+/**
+ * @brief Upload a file as a resumable multipart upload.
+ *
+ * The file is uploaded in parts, and the upload ID and the ETags of the completed parts are
+ * recorded in a journal file. If the upload is interrupted (e.g. by a network failure or a crash),
+ * calling this function again with the same arguments resumes the upload: The parts that the
+ * server already has (according to ListParts) are not uploaded again, so at most one part worth
+ * of data is lost. If the journal does not match the file (size or part size) or the upload no
+ * longer exists, a new upload is started. The journal file is removed when the upload completes.
+ *
+ * Each part is sent with Content-MD5, and failed requests are retried according to the retry
+ * policy of the options. If options->checksum is set, each part is also sent with its checksum,
+ * and the server verifies the completed object against a full object checksum (combined from the
+ * part checksums, without reading the file again). US3_CHECKSUM_MISMATCH is returned if the
+ * checksum that the server reports for the object differs. Note that an interrupted upload is not
+ * aborted, since it may be resumed later. Use a lifecycle rule on the bucket to clean up abandoned
+ * uploads.
+ * @param url Complete S3 URL.
+ * @param access_key The S3 access key.
+ * @param secret_key The S3 secret key.
+ * @param file_path The file to upload (must not be empty).
+ * @param journal_path The path to the journal file (e.g. the file path + ".us3journal").
+ * @param part_size The part size, or 0 for the default size (8 MiB). The part size is doubled
+ * until the file fits in 10000 parts. Note that S3 requires at least 5 MiB per part (except for
+ * the last part).
+ * @param options Extended options, or NULL to use the default options.
+ * @returns US3_SUCCESS on success, otherwise an error code.
+ */
+US3_API us3_status_t us3_upload_file(const char* url,
+                                     const char* access_key,
+                                     const char* secret_key,
+                                     const char* file_path,
+                                     const char* journal_path,
+                                     size_t part_size,
+                                     const us3_options_t* options);
+
 /**
  * @brief Get the HTTP response status line.
  * @param handle The stream handle to query.
@@ -196,4 +663,112 @@ US3_API us3_status_t us3_get_response_field(us3_handle_t handle,
  */
 US3_API us3_status_t us3_get_content_length(us3_handle_t handle, size_t* content_length);
 
+/**
+ * @brief Get the checksum of the transferred data.
+ * @param handle The stream handle to query.
+ * @param[out] checksum The base64 encoded checksum (as used in x-amz-checksum-* headers) of the
+ * data that has been read or written so far.
+ * @returns US3_SUCCESS on success, otherwise an error code. If the stream was not opened with a
+ * checksum algorithm, US3_INVALID_OPERATION is returned (and *checksum is set to NULL).
+ */
+US3_API us3_status_t us3_get_checksum(us3_handle_t handle, const char** checksum);
+
+/**
+ * @brief Get the timing and I/O statistics of a stream.
+ *
+ * The statistics are always collected, at the cost of a few counters and clock reads per request,
+ * and can be read at any time while the stream is open (e.g. just before closing it).
+ * @param handle The stream handle to query.
+ * @param[out] stats The statistics.
+ * @returns US3_SUCCESS on success, otherwise an error code.
+ */
+US3_API us3_status_t us3_get_stats(us3_handle_t handle, us3_stats_t* stats);
+
+/**
+ * @brief Configure the process wide DNS cache.
+ *
+ * The DNS cache is shared by all streams (and threads). Host names that are used after 75% of
+ * their TTL has passed are refreshed in a background thread, so that name lookups of frequently
+ * used hosts do not add latency to requests. The cache is disabled by default.
+ * @param ttl The time that resolved addresses are cached, in microseconds, or US3_NO_TIMEOUT to
+ * disable the cache.
+ * @param negative_ttl The time that failed lookups (no such host) are cached, in microseconds, or
+ * US3_NO_TIMEOUT to not cache failed lookups.
+ * @note Changing the configuration flushes the cache.
+ */
+US3_API void us3_configure_dns_cache(us3_microseconds_t ttl, us3_microseconds_t negative_ttl);
+
+/**
+ * @brief Remove all entries from the DNS cache.
+ */
+US3_API void us3_flush_dns_cache(void);
+
+/**
+ * @brief Remove all entries from the bucket redirect cache.
+ *
+ * Redirects of read requests are followed, and permanent redirects of a bucket to another
+ * endpoint (e.g. when the bucket lives in another region) are remembered in a process wide cache,
+ * so that later requests for the bucket go straight to the right endpoint.
+ */
+US3_API void us3_flush_redirect_cache(void);
+
+/**
+ * @brief Set the memory allocation functions of the library.
+ *
+ * The functions are used for the memory of the streams: the stream handles, the socket state, the
+ * per-request data (e.g. the HTTP response), the strings and buffers that a stream keeps while it
+ * is open, the temporary data that is used while building and signing a request, and the
+ * HMAC-SHA1 message buffers. They are called with the given user data, e.g. for accounting or for
+ * allocating from a per-thread arena. The process wide state that outlives the streams (the DNS
+ * cache, the bucket redirect cache and the metrics) uses them too. Traffic recording and the
+ * HMAC-SHA1 backends of the operating system (e.g. OpenSSL) still use their own allocators.
+ *
+ * @param malloc_fn Allocate memory (like malloc()), or NULL for the default functions.
+ * @param realloc_fn Resize memory (like realloc()), or NULL for the default functions.
+ * @param free_fn Free memory (like free()), or NULL for the default functions.
+ * @param user_data User data that is passed to the functions.
+ * @note Memory is freed with the functions that are set at that time, so the functions must be
+ * set before any stream is opened and must not be changed while streams are open.
+ */
+US3_API void us3_set_allocator(void* (*malloc_fn)(size_t size, void* user_data),
+                               void* (*realloc_fn)(void* ptr, size_t size, void* user_data),
+                               void (*free_fn)(void* ptr, void* user_data),
+                               void* user_data);
+
+/**
+ * @brief Set the process wide tracing hooks.
+ *
+ * The global hooks are used by streams that are opened without hooks of their own (see
+ * us3_options_t::hooks). The hooks are copied, and streams pick them up when they are opened, so
+ * the global hooks can be changed at any time: Streams that are already open keep using the hooks
+ * that were set when they were opened. A small copy of each distinct set of hooks is kept for the
+ * lifetime of the process.
+ * @param hooks The hooks, or NULL to remove the global hooks.
+ */
+US3_API void us3_set_global_hooks(const us3_hooks_t* hooks);
+
+/**
+ * @brief Get the process wide hedged read counters.
+ * @param[out] stats The counters.
+ * @returns US3_SUCCESS on success, otherwise an error code.
+ */
+US3_API us3_status_t us3_get_hedge_stats(us3_hedge_stats_t* stats);
+
+/**
+ * @brief Export the process wide request metrics in the Prometheus text format.
+ *
+ * Every closed stream is recorded in latency and throughput histograms, split by HTTP method,
+ * status class (e.g. "2xx", or "error" if no response was received) and host. The histograms are
+ * exported as summaries (with the 0.5, 0.9, 0.99 and 0.999 quantiles), together with counters of
+ * the bytes that were sent and received.
+ *
+ * Like snprintf(), the output is truncated to fit the buffer (and always zero-terminated unless
+ * @c size is zero), and the full length of the output is returned, so that the required buffer
+ * size can be queried by passing a NULL buffer.
+ * @param[out] buf The buffer to write the metrics to (may be NULL if @c size is zero).
+ * @param size The size of the buffer (in bytes).
+ * @returns the length of the metrics text (in bytes, excluding the zero terminator).
+ */
+US3_API size_t us3_metrics_dump(char* buf, size_t size);
+
 #endif /* US3_US3_H_ */
@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "allocator.hpp"
+
+#include <cstdlib>
+
+namespace us3 {
+
+namespace {
+
+void* default_malloc(const size_t size, void*) {
+  return std::malloc(size > 0 ? size : 1);
+}
+
+void* default_realloc(void* ptr, const size_t size, void*) {
+  return std::realloc(ptr, size > 0 ? size : 1);
+}
+
+void default_free(void* ptr, void*) {
+  std::free(ptr);
+}
+
+// The hooks are plain data with constant initialization, so they can be used at any time
+// (including during static initialization).
+struct hooks_t {
+  void* (*malloc_fn)(size_t size, void* user_data);
+  void* (*realloc_fn)(void* ptr, size_t size, void* user_data);
+  void (*free_fn)(void* ptr, void* user_data);
+  void* user_data;
+};
+
+hooks_t s_hooks = {default_malloc, default_realloc, default_free, NULL};
+
+}  // namespace
+
+void set_allocator_hooks(const allocator_hooks_t& hooks) {
+  if (hooks.malloc_fn != NULL && hooks.realloc_fn != NULL && hooks.free_fn != NULL) {
+    s_hooks.malloc_fn = hooks.malloc_fn;
+    s_hooks.realloc_fn = hooks.realloc_fn;
+    s_hooks.free_fn = hooks.free_fn;
+    s_hooks.user_data = hooks.user_data;
+  } else {
+    s_hooks.malloc_fn = default_malloc;
+    s_hooks.realloc_fn = default_realloc;
+    s_hooks.free_fn = default_free;
+    s_hooks.user_data = NULL;
+  }
+}
+
+void* heap_alloc(const size_t size) {
+  return s_hooks.malloc_fn(size, s_hooks.user_data);
+}
+
+void* heap_realloc(void* ptr, const size_t size) {
+  return s_hooks.realloc_fn(ptr, size, s_hooks.user_data);
+}
+
+void heap_free(void* ptr) {
+  if (ptr != NULL) {
+    s_hooks.free_fn(ptr, s_hooks.user_data);
+  }
+}
+
+}  // namespace us3
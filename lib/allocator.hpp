@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_ALLOCATOR_HPP_
+#define US3_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+namespace us3 {
+
+/// @brief Memory allocation hooks (malloc(), realloc() and free() by default).
+struct allocator_hooks_t {
+  allocator_hooks_t() : malloc_fn(NULL), realloc_fn(NULL), free_fn(NULL), user_data(NULL) {
+  }
+
+  void* (*malloc_fn)(size_t size, void* user_data);             ///< Allocate memory.
+  void* (*realloc_fn)(void* ptr, size_t size, void* user_data);  ///< Resize memory.
+  void (*free_fn)(void* ptr, void* user_data);                   ///< Free memory.
+  void* user_data;  ///< User data that is passed to the hooks.
+};
+
+/// @brief Set the process wide allocation hooks.
+/// @param hooks The hooks. If any of the functions is NULL, the default hooks are used.
+/// @note Memory must be freed with the hooks that allocated it, so the hooks should be set before
+/// the library is used.
+void set_allocator_hooks(const allocator_hooks_t& hooks);
+
+/// @brief Allocate memory with the allocation hooks.
+/// @returns the memory, or NULL if it could not be allocated.
+void* heap_alloc(size_t size);
+
+/// @brief Resize memory that was allocated with heap_alloc() (or NULL).
+/// @returns the memory, or NULL if it could not be allocated (the old memory is then intact).
+void* heap_realloc(void* ptr, size_t size);
+
+/// @brief Free memory that was allocated with heap_alloc() or heap_realloc() (or NULL).
+void heap_free(void* ptr);
+
+/// @brief Construct a (value initialized) object in memory from the allocation hooks.
+/// @returns the object, or NULL if the memory could not be allocated.
+template <typename T>
+T* heap_new() {
+  void* ptr = heap_alloc(sizeof(T));
+  return (ptr != NULL) ? new (ptr) T() : NULL;
+}
+
+/// @brief Destroy an object that was created with heap_new() (or NULL).
+template <typename T>
+void heap_delete(T* ptr) {
+  if (ptr != NULL) {
+    ptr->~T();
+    heap_free(ptr);
+  }
+}
+
+/// @brief A standard library allocator that uses the allocation hooks.
+template <typename T>
+class std_allocator_t {
+public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef std_allocator_t<U> other;
+  };
+
+  std_allocator_t() {
+  }
+
+  template <typename U>
+  std_allocator_t(const std_allocator_t<U>&) {
+  }
+
+  pointer address(reference x) const {
+    return &x;
+  }
+
+  const_pointer address(const_reference x) const {
+    return &x;
+  }
+
+  pointer allocate(const size_type n, const void* = NULL) {
+    void* ptr = (n <= max_size()) ? heap_alloc(n * sizeof(T)) : NULL;
+    if (ptr == NULL) {
+      throw std::bad_alloc();
+    }
+    return static_cast<pointer>(ptr);
+  }
+
+  void deallocate(pointer ptr, size_type) {
+    heap_free(ptr);
+  }
+
+  size_type max_size() const {
+    return static_cast<size_type>(-1) / sizeof(T);
+  }
+
+  void construct(pointer ptr, const_reference value) {
+    new (static_cast<void*>(ptr)) T(value);
+  }
+
+  void destroy(pointer ptr) {
+    ptr->~T();
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const std_allocator_t<T>&, const std_allocator_t<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const std_allocator_t<T>&, const std_allocator_t<U>&) {
+  return false;
+}
+
+/// @brief A string that is allocated with the allocation hooks.
+typedef std::basic_string<char, std::char_traits<char>, std_allocator_t<char> > string_t;
+
+}  // namespace us3
+
+#endif  // US3_ALLOCATOR_HPP_
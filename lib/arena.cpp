@@ -0,0 +1,186 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "arena.hpp"
+
+#include "allocator.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace us3 {
+
+namespace {
+
+size_t align_size(const size_t size) {
+  return (size + (arena_t::ALIGNMENT - 1)) & ~(arena_t::ALIGNMENT - 1);
+}
+
+}  // namespace
+
+arena_t::arena_t(const size_t block_size)
+    : m_block_size(block_size),
+      m_first(NULL),
+      m_current(NULL),
+      m_current_used(0),
+      m_is_fixed(false) {
+}
+
+arena_t::~arena_t() {
+  block_t* block = m_first;
+  while (block != NULL) {
+    block_t* next = block->next;
+    if (block->is_owned) {
+      heap_free(block);
+    }
+    block = next;
+  }
+}
+
+void arena_t::use_buffer(void* buffer, const size_t size, const bool is_fixed) {
+  // Drop the previous caller supplied buffer (if any).
+  if (m_first != NULL && !m_first->is_owned) {
+    m_first = m_first->next;
+  }
+
+  // The block header is stored at the (aligned) start of the buffer.
+  if (buffer != NULL) {
+    const size_t offset =
+        align_size(reinterpret_cast<size_t>(buffer)) - reinterpret_cast<size_t>(buffer);
+    const size_t header_size = align_size(sizeof(block_t));
+    if (size >= offset + header_size + ALIGNMENT) {
+      block_t* block = reinterpret_cast<block_t*>(reinterpret_cast<char*>(buffer) + offset);
+      block->next = m_first;
+      block->size = (size - offset - header_size) & ~(ALIGNMENT - 1);
+      block->is_owned = false;
+      m_first = block;
+    }
+  }
+
+  m_is_fixed = is_fixed;
+  reset();
+}
+
+void* arena_t::allocate(const size_t size) {
+  const size_t aligned_size = align_size(size);
+
+  // Use the first block (starting with the current one) that has room for the allocation.
+  while (m_current != NULL) {
+    if (m_current->size - m_current_used >= aligned_size) {
+      char* result = block_data(m_current) + m_current_used;
+      m_current_used += aligned_size;
+      return result;
+    }
+    if (m_current->next == NULL) {
+      break;
+    }
+    m_current = m_current->next;
+    m_current_used = 0;
+  }
+
+  if (m_is_fixed) {
+    return NULL;
+  }
+
+  // Append a new block. Blocks grow with the arena, so that it only needs a few blocks.
+  const size_t block_size = std::max(aligned_size, std::max(m_block_size, capacity()));
+  block_t* block = static_cast<block_t*>(heap_alloc(align_size(sizeof(block_t)) + block_size));
+  if (block == NULL) {
+    return NULL;
+  }
+  block->next = NULL;
+  block->size = block_size;
+  block->is_owned = true;
+  if (m_current != NULL) {
+    m_current->next = block;
+  } else {
+    m_first = block;
+  }
+  m_current = block;
+  m_current_used = aligned_size;
+  return block_data(block);
+}
+
+void* arena_t::grow(void* ptr, const size_t size, const size_t new_size) {
+  // Extend the most recent allocation in place if its block has room for it.
+  if (ptr != NULL && m_current != NULL) {
+    char* block_start = block_data(m_current);
+    const size_t aligned_size = align_size(size);
+    if (aligned_size <= m_current_used &&
+        static_cast<char*>(ptr) == block_start + (m_current_used - aligned_size)) {
+      const size_t start = m_current_used - aligned_size;
+      if (m_current->size - start >= align_size(new_size)) {
+        m_current_used = start + align_size(new_size);
+        return ptr;
+      }
+    }
+  }
+
+  // Otherwise move it to a new allocation.
+  void* result = allocate(new_size);
+  if (result != NULL && size > 0) {
+    std::memcpy(result, ptr, std::min(size, new_size));
+  }
+  return result;
+}
+
+char* arena_t::copy_string(const char* str, const size_t size) {
+  char* result = static_cast<char*>(allocate(size + 1));
+  if (result == NULL) {
+    return NULL;
+  }
+  std::memcpy(result, str, size);
+  result[size] = 0;
+  return result;
+}
+
+void arena_t::reset() {
+  m_current = m_first;
+  m_current_used = 0;
+}
+
+arena_t::mark_t arena_t::mark() const {
+  mark_t result;
+  result.block = m_current;
+  result.used = m_current_used;
+  return result;
+}
+
+void arena_t::release(const mark_t& mark) {
+  // An arena without blocks has nothing to release.
+  if (mark.block == NULL) {
+    reset();
+    return;
+  }
+  m_current = mark.block;
+  m_current_used = mark.used;
+}
+
+size_t arena_t::capacity() const {
+  size_t result = 0;
+  for (const block_t* block = m_first; block != NULL; block = block->next) {
+    result += block->size;
+  }
+  return result;
+}
+
+char* arena_t::block_data(block_t* block) {
+  return reinterpret_cast<char*>(block) + align_size(sizeof(block_t));
+}
+
+}  // namespace us3
@@ -0,0 +1,124 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_ARENA_HPP_
+#define US3_ARENA_HPP_
+
+#include <cstddef>
+
+namespace us3 {
+
+/// @brief A region (bump) allocator for per-request data.
+///
+/// Memory is handed out from a list of blocks and is released all at once with reset(). The
+/// blocks are kept when the arena is reset, so an arena that is reused for similar work stops
+/// allocating heap memory once it has grown to its working size. The first block can be supplied
+/// by the caller (see use_buffer()), in which case the heap is only used when it overflows (or
+/// never, for a fixed size arena). Heap memory is allocated with the allocation hooks (see
+/// allocator.hpp).
+class arena_t {
+  struct block_t;
+
+public:
+  /// @brief A position in the arena (see mark() and release()).
+  struct mark_t {
+    block_t* block;
+    size_t used;
+  };
+
+  /// @brief All allocations are aligned to this many bytes.
+  static const size_t ALIGNMENT = 16;
+
+  /// @brief The default size of heap allocated blocks.
+  static const size_t DEFAULT_BLOCK_SIZE = 4096;
+
+  /// @brief Construct an empty arena.
+  /// @param block_size The (minimum) size of heap allocated blocks.
+  explicit arena_t(size_t block_size = DEFAULT_BLOCK_SIZE);
+  ~arena_t();
+
+  /// @brief Use a caller supplied buffer as the first block of the arena.
+  /// @param buffer The buffer, or NULL to stop using a previously supplied buffer.
+  /// @param size The size of the buffer, in bytes.
+  /// @param is_fixed If true, the arena never allocates heap memory, and allocations fail when the
+  /// buffer is full.
+  /// @note The buffer must stay valid until the arena is destroyed or use_buffer() is called
+  /// again. This resets the arena.
+  void use_buffer(void* buffer, size_t size, bool is_fixed = false);
+
+  /// @brief Allocate memory.
+  /// @param size The number of bytes to allocate.
+  /// @returns a pointer to the memory, which is valid until the arena is reset, or NULL if a fixed
+  /// size arena is full (or if the heap is exhausted).
+  void* allocate(size_t size);
+
+  /// @brief Grow an allocation.
+  /// @param ptr The allocation to grow, or NULL to make a new allocation.
+  /// @param size The current size of the allocation (0 if ptr is NULL).
+  /// @param new_size The requested size of the allocation.
+  /// @returns a pointer to the grown allocation (with the first size bytes preserved), or NULL if a
+  /// fixed size arena is full (or if the heap is exhausted).
+  /// @note The most recent allocation is grown in place while its block has room for it, so that
+  /// data that arrives piece by piece is only stored once. Other allocations are copied.
+  void* grow(void* ptr, size_t size, size_t new_size);
+
+  /// @brief Copy a string into the arena.
+  /// @param str The string to copy (need not be zero terminated).
+  /// @param size The length of the string.
+  /// @returns a zero terminated copy of the string, or NULL if a fixed size arena is full.
+  char* copy_string(const char* str, size_t size);
+
+  /// @brief Release all allocations (but keep the memory for later allocations).
+  void reset();
+
+  /// @brief Get the current position of the arena.
+  /// @returns a mark that can be passed to release().
+  mark_t mark() const;
+
+  /// @brief Release the allocations that were made after a mark was taken.
+  /// @param mark The position to go back to, as returned by mark().
+  /// @note The mark must have been taken after the last reset() of the arena.
+  void release(const mark_t& mark);
+
+  /// @brief Get the total size of the blocks of the arena, in bytes.
+  size_t capacity() const;
+
+private:
+  struct block_t {
+    block_t* next;
+    size_t size;
+    bool is_owned;
+  };
+
+  // Not copyable.
+  arena_t(const arena_t&);
+  arena_t& operator=(const arena_t&);
+
+  static char* block_data(block_t* block);
+
+  const size_t m_block_size;
+  block_t* m_first;
+  block_t* m_current;
+  size_t m_current_used;
+  bool m_is_fixed;
+};
+
+}  // namespace us3
+
+#endif  // US3_ARENA_HPP_
@@ -0,0 +1,183 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "arena.hpp"
+
+#include <doctest.h>
+
+#include <cstring>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+bool is_aligned(const void* ptr) {
+  return reinterpret_cast<size_t>(ptr) % us3::arena_t::ALIGNMENT == 0;
+}
+
+}  // namespace
+
+TEST_CASE("Arena allocations") {
+  // GIVEN
+  us3::arena_t arena(256);
+
+  // WHEN
+  char* a = static_cast<char*>(arena.allocate(10));
+  char* b = static_cast<char*>(arena.allocate(1));
+  char* c = arena.copy_string("Hello world!", 5);
+
+  // THEN
+  CHECK(is_aligned(a));
+  CHECK(is_aligned(b));
+  CHECK(is_aligned(c));
+  CHECK(b >= a + 10);
+  CHECK(std::strcmp(c, "Hello") == 0);
+  CHECK(arena.capacity() == 256);
+
+  SUBCASE("Large allocations get their own block") {
+    // WHEN
+    char* big = static_cast<char*>(arena.allocate(1000));
+    std::memset(big, 1, 1000);
+
+    // THEN
+    CHECK(is_aligned(big));
+    CHECK(arena.capacity() >= 1256);
+    CHECK(std::strcmp(c, "Hello") == 0);
+  }
+
+  SUBCASE("Memory is reused after a reset") {
+    // WHEN
+    for (int i = 0; i < 10; ++i) {
+      arena.allocate(200);
+    }
+    const size_t capacity = arena.capacity();
+    arena.reset();
+    for (int i = 0; i < 10; ++i) {
+      arena.allocate(200);
+    }
+
+    // THEN
+    CHECK(arena.capacity() == capacity);
+    CHECK(arena.allocate(10) != static_cast<void*>(NULL));
+  }
+
+  SUBCASE("The most recent allocation grows in place") {
+    // WHEN (one byte at a time, as for a response line that arrives in small segments)
+    char* d = arena.copy_string("x", 1);
+    char* grown = d;
+    for (size_t size = 2; size <= 200 && grown == d; ++size) {
+      grown = static_cast<char*>(arena.grow(d, size, size + 1));
+      grown[size - 1] = 'x';
+      grown[size] = 0;
+    }
+
+    // THEN
+    CHECK(grown == d);
+    CHECK(std::strlen(d) == 200);
+    CHECK(arena.capacity() == 256);
+  }
+
+  SUBCASE("Other allocations are moved when grown") {
+    // WHEN
+    arena.allocate(1);
+    char* d = static_cast<char*>(arena.grow(c, 6, 100));
+
+    // THEN
+    CHECK(d != c);
+    CHECK(is_aligned(d));
+    CHECK(std::strcmp(d, "Hello") == 0);
+  }
+
+  SUBCASE("Memory after a mark is reused after a release") {
+    // WHEN
+    const us3::arena_t::mark_t mark = arena.mark();
+    char* d = static_cast<char*>(arena.allocate(100));
+    for (int i = 0; i < 10; ++i) {
+      arena.release(mark);
+      arena.allocate(100);
+      arena.allocate(200);
+    }
+    const size_t capacity = arena.capacity();
+    arena.release(mark);
+
+    // THEN (earlier allocations are kept)
+    CHECK(arena.allocate(100) == static_cast<void*>(d));
+    CHECK(arena.capacity() == capacity);
+    CHECK(std::strcmp(c, "Hello") == 0);
+  }
+}
+
+TEST_CASE("Arena with a caller supplied buffer") {
+  // GIVEN
+  char buffer[1024];
+  us3::arena_t arena(256);
+
+  // WHEN
+  arena.use_buffer(&buffer[1], sizeof(buffer) - 1);
+  char* a = static_cast<char*>(arena.allocate(100));
+
+  // THEN (the buffer is used before any heap memory)
+  CHECK(is_aligned(a));
+  CHECK(a > &buffer[0]);
+  CHECK(a + 100 <= &buffer[sizeof(buffer)]);
+  CHECK(arena.capacity() <= sizeof(buffer));
+
+  SUBCASE("Overflow goes to the heap") {
+    // WHEN
+    char* b = static_cast<char*>(arena.allocate(2000));
+
+    // THEN
+    CHECK((b < &buffer[0] || b >= &buffer[sizeof(buffer)]));
+    CHECK(arena.capacity() > sizeof(buffer));
+  }
+
+  SUBCASE("The buffer can be dropped") {
+    // WHEN
+    arena.use_buffer(NULL, 0);
+    char* b = static_cast<char*>(arena.allocate(100));
+
+    // THEN
+    CHECK(arena.capacity() == 256);
+    CHECK((b < &buffer[0] || b >= &buffer[sizeof(buffer)]));
+  }
+
+  SUBCASE("A fixed size arena never uses the heap") {
+    // WHEN
+    arena.use_buffer(&buffer[0], sizeof(buffer), true);
+    char* b = static_cast<char*>(arena.allocate(500));
+    char* c = static_cast<char*>(arena.allocate(600));
+
+    // THEN
+    CHECK(b >= &buffer[0]);
+    CHECK(b + 500 <= &buffer[sizeof(buffer)]);
+    CHECK(c == static_cast<char*>(NULL));
+    CHECK(arena.copy_string("too long", 600) == static_cast<char*>(NULL));
+    CHECK(arena.capacity() <= sizeof(buffer));
+  }
+
+  SUBCASE("A too small buffer is ignored") {
+    // WHEN
+    arena.use_buffer(&buffer[0], 8);
+
+    // THEN
+    CHECK(arena.capacity() == 0);
+  }
+}
@@ -0,0 +1,56 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "base64.hpp"
+
+namespace us3 {
+
+void base64_encode(const unsigned char* data, const size_t size, char* base64) {
+  static const char* const BASE64_CHARS =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  // Emit four encoded chars for every three input bytes.
+  size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    const unsigned long v = (static_cast<unsigned long>(data[i]) << 16) |
+                            (static_cast<unsigned long>(data[i + 1]) << 8) |
+                            static_cast<unsigned long>(data[i + 2]);
+    *base64++ = BASE64_CHARS[(v >> 18) & 0x3F];
+    *base64++ = BASE64_CHARS[(v >> 12) & 0x3F];
+    *base64++ = BASE64_CHARS[(v >> 6) & 0x3F];
+    *base64++ = BASE64_CHARS[v & 0x3F];
+  }
+
+  // Emit the remaining one or two bytes as a padded group of four chars.
+  const size_t remaining = size - i;
+  if (remaining > 0) {
+    unsigned long v = static_cast<unsigned long>(data[i]) << 16;
+    if (remaining > 1) {
+      v |= static_cast<unsigned long>(data[i + 1]) << 8;
+    }
+    *base64++ = BASE64_CHARS[(v >> 18) & 0x3F];
+    *base64++ = BASE64_CHARS[(v >> 12) & 0x3F];
+    *base64++ = (remaining > 1) ? BASE64_CHARS[(v >> 6) & 0x3F] : '=';
+    *base64++ = '=';
+  }
+
+  *base64 = '\0';
+}
+
+}  // namespace us3
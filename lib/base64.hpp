@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_BASE64_HPP_
+#define US3_BASE64_HPP_
+
+#include <cstddef>
+
+namespace us3 {
+
+/// @brief Get the size of the base64 encoding of some data (excluding the zero termination).
+inline size_t base64_size(const size_t size) {
+  return ((size + 2) / 3) * 4;
+}
+
+/// @brief Base64 encode binary data.
+/// @param data The data to encode.
+/// @param size The number of bytes to encode.
+/// @param[out] base64 The target buffer (must hold at least base64_size(size) + 1 chars).
+void base64_encode(const unsigned char* data, size_t size, char* base64);
+
+}  // namespace us3
+
+#endif  // US3_BASE64_HPP_
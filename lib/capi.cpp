@@ -19,17 +19,59 @@
 
 #include <us3/us3.h>
 
+#include "allocator.hpp"
 #include "connection.hpp"
+#include "hedging.hpp"
+#include "md5.hpp"
+#include "metrics.hpp"
+#include "multipart.hpp"
 #include "network_socket.hpp"
+#include "platform.hpp"
+#include "recording.hpp"
+#include "redirect_cache.hpp"
+#include "resolver.hpp"
 #include "return_value.hpp"
+#include "tracing.hpp"
+#include "transport.hpp"
 #include "url_parser.hpp"
+#include <algorithm>
 #include <cstring>
+#include <new>
 
 struct us3_handle_struct_t {
+  us3_handle_struct_t() : is_inplace(false) {
+  }
+
   us3::connection_t connection;
+  us3::net::loopback_config_t loopback;
+  us3::net::recording_config_t recording;
+  bool is_inplace;  ///< The handle lives in caller provided storage (see us3_open_inplace()).
 };
 
 namespace {
+// The size of the stream state in the storage of us3_open_inplace(). The rest of the storage is
+// the arena for the HTTP response.
+const size_t HANDLE_SIZE = (sizeof(us3_handle_struct_t) + (US3_HANDLE_STORAGE_ALIGNMENT - 1)) &
+                           ~static_cast<size_t>(US3_HANDLE_STORAGE_ALIGNMENT - 1);
+
+// The smallest response arena that us3_open_inplace() accepts.
+const size_t MIN_INPLACE_ARENA_SIZE = 1024;
+
+// The arena bookkeeping (block header) at the start of the in-place response arena.
+const size_t INPLACE_ARENA_OVERHEAD = 32;
+
+// Compile-time check: The recommended storage must leave room for 4 KiB of response headers.
+typedef char handle_storage_size_check_t
+    [(HANDLE_SIZE + INPLACE_ARENA_OVERHEAD + 4096 <= US3_HANDLE_STORAGE_SIZE) ? 1 : -1];
+
+void destroy_handle(us3_handle_struct_t* handle) {
+  const bool is_inplace = handle->is_inplace;
+  handle->~us3_handle_struct_t();
+  if (!is_inplace) {
+    us3::heap_free(handle);
+  }
+}
+
 bool is_valid_handle(const us3_handle_t& handle) {
   // TODO(m): Do a more robust check.
   return handle != NULL;
@@ -65,6 +107,10 @@ us3_status_t to_capi_status(const us3::status_t& result) {
       return US3_FORBIDDEN;
     case us3::status_t::NOT_FOUND:
       return US3_NOT_FOUND;
+    case us3::status_t::CHECKSUM_MISMATCH:
+      return US3_CHECKSUM_MISMATCH;
+    case us3::status_t::SERVER_ERROR:
+      return US3_SERVER_ERROR;
     case us3::status_t::ERROR:
     default:
       return US3_ERROR;
@@ -80,34 +126,201 @@ us3::connection_t::mode_t to_connection_mode(const us3_mode_t mode) {
       return us3::connection_t::WRITE;
   }
 }
-}  // namespace
 
-US3_API us3_status_t us3_open(const char* url,
-                              const char* access_key,
-                              const char* secret_key,
-                              const us3_mode_t mode,
-                              const size_t size,
-                              const us3_microseconds_t connect_timeout,
-                              const us3_microseconds_t socket_timeout,
-                              us3_handle_t* handle) {
-  // Sanity check arguments.
-  if (url == NULL) {
+us3::connection_t::signature_t to_connection_signature(const us3_signature_t signature) {
+  switch (signature) {
+    default:
+    case US3_SIGNATURE_V2:
+      return us3::connection_t::SIGV2;
+    case US3_SIGNATURE_V4:
+      return us3::connection_t::SIGV4;
+  }
+}
+
+us3::checksum_t::algorithm_t to_checksum_algorithm(const us3_checksum_t checksum) {
+  switch (checksum) {
+    default:
+    case US3_CHECKSUM_NONE:
+      return us3::checksum_t::NONE;
+    case US3_CHECKSUM_CRC32C:
+      return us3::checksum_t::CRC32C;
+    case US3_CHECKSUM_CRC64NVME:
+      return us3::checksum_t::CRC64NVME;
+  }
+}
+
+// Convert a phase time to a time relative to the start of the request (-1 if not reached).
+us3_microseconds_t to_relative_time(const int64_t time,
+                                    const us3::connection_t::stats_t& stats) {
+  return (time != 0) ? static_cast<us3_microseconds_t>(time - stats.start_time) : -1;
+}
+
+// The global tracing hooks (forwarded to by the global connection tracing hooks). Open streams
+// keep using the table that was installed when they were opened, so each installed table is an
+// immutable copy that is never freed. Identical tables are shared, so that switching between a few
+// sets of hooks does not keep allocating memory.
+struct global_hooks_t {
+  us3_hooks_t hooks;
+  global_hooks_t* next;
+};
+
+us3::mutex_t& global_hooks_mutex() {
+  static us3::mutex_t* s_mutex = new us3::mutex_t();
+  return *s_mutex;
+}
+
+global_hooks_t* s_global_hooks = NULL;
+
+// Create the mutex during static initialization (before any threads are started).
+const us3::mutex_t& s_global_hooks_mutex = global_hooks_mutex();
+
+// Get an immutable copy of a hooks table, or NULL if out of memory.
+const us3_hooks_t* get_global_hooks_copy(const us3_hooks_t& hooks) {
+  us3::lock_guard_t lock(global_hooks_mutex());
+  for (global_hooks_t* it = s_global_hooks; it != NULL; it = it->next) {
+    if (it->hooks.on_event == hooks.on_event &&
+        it->hooks.get_request_headers == hooks.get_request_headers &&
+        it->hooks.user_data == hooks.user_data) {
+      return &it->hooks;
+    }
+  }
+  global_hooks_t* copy = static_cast<global_hooks_t*>(us3::heap_alloc(sizeof(global_hooks_t)));
+  if (copy == NULL) {
+    return NULL;
+  }
+  copy->hooks = hooks;
+  copy->next = s_global_hooks;
+  s_global_hooks = copy;
+  return &copy->hooks;
+}
+
+void forward_trace_event(const us3::trace_event_t& event, void* user_data) {
+  const us3_hooks_t* hooks = reinterpret_cast<const us3_hooks_t*>(user_data);
+  us3_event_t capi_event;
+  capi_event.type = static_cast<us3_event_type_t>(event.type);
+  capi_event.stream = event.stream;
+  capi_event.time = static_cast<us3_microseconds_t>(event.time);
+  capi_event.host = event.host;
+  capi_event.status_code = event.status_code;
+  capi_event.bytes = event.bytes;
+  capi_event.status = to_capi_status(us3::make_result(event.status));
+  hooks->on_event(&capi_event, hooks->user_data);
+}
+
+const char* forward_get_request_headers(const void* stream, void* user_data) {
+  const us3_hooks_t* hooks = reinterpret_cast<const us3_hooks_t*>(user_data);
+  return hooks->get_request_headers(stream, hooks->user_data);
+}
+
+// Translate tracing hooks to connection tracing hooks.
+us3::trace_hooks_t to_trace_hooks(const us3_hooks_t* hooks) {
+  us3::trace_hooks_t trace_hooks;
+  if (hooks != NULL) {
+    trace_hooks.on_event = (hooks->on_event != NULL) ? forward_trace_event : NULL;
+    trace_hooks.get_request_headers =
+        (hooks->get_request_headers != NULL) ? forward_get_request_headers : NULL;
+    trace_hooks.user_data = const_cast<us3_hooks_t*>(hooks);
+  }
+  return trace_hooks;
+}
+
+// Validate the options, and translate them to connection options. The loopback and recording
+// configurations (if any) are stored in loopback and recording, which must outlive the connection.
+us3_status_t to_connection_options(const us3_options_t* options,
+                                   us3::connection_t::options_t& connection_options,
+                                   us3::net::loopback_config_t& loopback,
+                                   us3::net::recording_config_t& recording) {
+  // Use the default options if none were given.
+  us3_options_t default_options;
+  if (options == NULL) {
+    us3_init_options(&default_options);
+    options = &default_options;
+  }
+  if (options->signature != US3_SIGNATURE_V2 && options->signature != US3_SIGNATURE_V4) {
     return US3_INVALID_ARGUMENT;
   }
-  if (access_key == NULL) {
+  if (options->checksum != US3_CHECKSUM_NONE && options->checksum != US3_CHECKSUM_CRC32C &&
+      options->checksum != US3_CHECKSUM_CRC64NVME) {
     return US3_INVALID_ARGUMENT;
   }
-  if (secret_key == NULL) {
+  if (options->socket.send_buffer_size < US3_AUTO_BUFFER_SIZE ||
+      options->socket.recv_buffer_size < US3_AUTO_BUFFER_SIZE ||
+      options->socket.link_bandwidth < 0 || options->socket.busy_poll < 0 ||
+      options->socket.recv_lowat < 0) {
     return US3_INVALID_ARGUMENT;
   }
-  if (mode != US3_READ && mode != US3_WRITE) {
+  if (options->hedge_delay < US3_ADAPTIVE_HEDGE_DELAY) {
     return US3_INVALID_ARGUMENT;
   }
-  if (handle == NULL) {
+  if (options->retry.max_attempts < 1 || options->retry.base_delay < 0 ||
+      options->retry.max_delay < 0) {
+    return US3_INVALID_ARGUMENT;
+  }
+  if ((options->transport == US3_TRANSPORT_UNIX && options->unix_socket_path == NULL) ||
+      (options->transport == US3_TRANSPORT_LOOPBACK && options->loopback_response == NULL &&
+       options->loopback_response_size > 0) ||
+      (options->transport != US3_TRANSPORT_TCP && options->transport != US3_TRANSPORT_UNIX &&
+       options->transport != US3_TRANSPORT_LOOPBACK)) {
     return US3_INVALID_ARGUMENT;
   }
 
-  // Parse the URL.
+  // Translate the options.
+  connection_options.connect_timeout = static_cast<us3::net::timeout_t>(options->connect_timeout);
+  connection_options.socket_timeout = static_cast<us3::net::timeout_t>(options->socket_timeout);
+  connection_options.signature = to_connection_signature(options->signature);
+  connection_options.region = options->region;
+  connection_options.chunk_size = options->chunk_size;
+  connection_options.checksum = to_checksum_algorithm(options->checksum);
+  connection_options.verify_etag = (options->verify_etag != 0);
+  connection_options.socket.tcp_nodelay = (options->socket.tcp_nodelay != 0);
+  connection_options.socket.send_buffer_size = options->socket.send_buffer_size;
+  connection_options.socket.recv_buffer_size = options->socket.recv_buffer_size;
+  connection_options.socket.link_bandwidth = options->socket.link_bandwidth;
+  connection_options.socket.tcp_quickack = (options->socket.tcp_quickack != 0);
+  connection_options.socket.busy_poll = options->socket.busy_poll;
+  connection_options.socket.recv_lowat = options->socket.recv_lowat;
+  connection_options.hedge_delay = (options->hedge_delay == US3_ADAPTIVE_HEDGE_DELAY)
+                                       ? us3::connection_t::ADAPTIVE_HEDGE_DELAY
+                                       : static_cast<us3::net::timeout_t>(options->hedge_delay);
+  connection_options.retry.max_attempts = options->retry.max_attempts;
+  connection_options.retry.base_delay = static_cast<us3::net::timeout_t>(options->retry.base_delay);
+  connection_options.retry.max_delay = static_cast<us3::net::timeout_t>(options->retry.max_delay);
+  connection_options.retry.retry_on = 0;
+  if ((options->retry.retry_on & US3_RETRY_CONNECTION) != 0) {
+    connection_options.retry.retry_on |= us3::retry_policy_t::RETRY_CONNECTION;
+  }
+  if ((options->retry.retry_on & US3_RETRY_TIMEOUT) != 0) {
+    connection_options.retry.retry_on |= us3::retry_policy_t::RETRY_TIMEOUT;
+  }
+  if ((options->retry.retry_on & US3_RETRY_SERVER_ERROR) != 0) {
+    connection_options.retry.retry_on |= us3::retry_policy_t::RETRY_SERVER_ERROR;
+  }
+  connection_options.trace_hooks = to_trace_hooks(options->hooks);
+  connection_options.arena = options->arena;
+  connection_options.arena_size = options->arena_size;
+  if (options->transport == US3_TRANSPORT_UNIX) {
+    connection_options.transport = &us3::net::unix_socket_transport();
+    connection_options.transport_data = options->unix_socket_path;
+  } else if (options->transport == US3_TRANSPORT_LOOPBACK) {
+    loopback.response = options->loopback_response;
+    loopback.response_size = options->loopback_response_size;
+    loopback.segment_size = options->loopback_segment_size;
+    connection_options.transport = &us3::net::loopback_transport();
+    connection_options.transport_data = &loopback;
+  }
+  if (options->record_path != NULL) {
+    recording.path = options->record_path;
+    recording.transport = connection_options.transport;
+    recording.transport_data = connection_options.transport_data;
+    connection_options.transport = &us3::net::recording_transport();
+    connection_options.transport_data = &recording;
+  }
+
+  return US3_SUCCESS;
+}
+
+// Parse an object URL.
+us3_status_t parse_object_url(const char* url, us3::url_parts_t& parts) {
   const us3::result_t<us3::url_parts_t> url_parts = us3::parse_url(url);
   if (url_parts.is_error()) {
     return to_capi_status(url_parts);
@@ -118,26 +331,261 @@ US3_API us3_status_t us3_open(const char* url,
     return US3_INVALID_URL;
   }
 
+  parts = *url_parts;
+  return US3_SUCCESS;
+}
+
+us3_status_t open_handle(const char* url,
+                         const char* access_key,
+                         const char* secret_key,
+                         const us3_mode_t mode,
+                         const size_t size,
+                         const us3_options_t* options,
+                         const char* content_md5,
+                         void* storage,
+                         const size_t storage_size,
+                         us3_handle_t* handle) {
+  // Sanity check arguments.
+  if (url == NULL) {
+    return US3_INVALID_ARGUMENT;
+  }
+  if (access_key == NULL) {
+    return US3_INVALID_ARGUMENT;
+  }
+  if (secret_key == NULL) {
+    return US3_INVALID_ARGUMENT;
+  }
+  if (mode != US3_READ && mode != US3_WRITE) {
+    return US3_INVALID_ARGUMENT;
+  }
+  if (handle == NULL) {
+    return US3_INVALID_ARGUMENT;
+  }
+
+  // The transport configurations must live as long as the handle.
+  void* memory = (storage != NULL) ? storage : us3::heap_alloc(sizeof(us3_handle_struct_t));
+  if (memory == NULL) {
+    return US3_ERROR;
+  }
+  us3_handle_struct_t* new_handle = new (memory) us3_handle_struct_t;
+  new_handle->is_inplace = (storage != NULL);
+  us3::connection_t::options_t connection_options;
+  const us3_status_t options_status = to_connection_options(
+      options, connection_options, new_handle->loopback, new_handle->recording);
+  if (options_status != US3_SUCCESS) {
+    destroy_handle(new_handle);
+    return options_status;
+  }
+  connection_options.content_md5 = content_md5;
+  us3::connection_t::mode_t connection_mode = to_connection_mode(mode);
+  if (mode == US3_WRITE && size == 0 && content_md5 != NULL) {
+    // An empty object (with a known Content-MD5) is uploaded as a PUT request with an empty body,
+    // and the response is read when the stream is opened. A WRITE stream of size 0 would use
+    // chunked transfer.
+    connection_mode = us3::connection_t::READ;
+    connection_options.method = "PUT";
+    connection_options.body = "";
+    connection_options.checksum = us3::checksum_t::NONE;
+    connection_options.verify_etag = false;
+  }
+  if (storage != NULL) {
+    connection_options.arena = static_cast<char*>(storage) + HANDLE_SIZE;
+    connection_options.arena_size = storage_size - HANDLE_SIZE;
+    connection_options.fixed_arena = true;
+  }
+
+  // Parse the URL.
+  us3::url_parts_t url_parts;
+  const us3_status_t url_status = parse_object_url(url, url_parts);
+  if (url_status != US3_SUCCESS) {
+    destroy_handle(new_handle);
+    return url_status;
+  }
+
   // Open the connection.
-  us3_handle_struct_t* new_handle = new us3_handle_struct_t;
-  const us3::status_t result =
-      new_handle->connection.open(url_parts->host.c_str(),
-                                  url_parts->port,
-                                  url_parts->path.c_str(),
-                                  access_key,
-                                  secret_key,
-                                  to_connection_mode(mode),
-                                  size,
-                                  static_cast<us3::net::timeout_t>(connect_timeout),
-                                  static_cast<us3::net::timeout_t>(socket_timeout));
+  const us3::status_t result = new_handle->connection.open(url_parts.host.c_str(),
+                                                           url_parts.port,
+                                                           url_parts.path.c_str(),
+                                                           access_key,
+                                                           secret_key,
+                                                           connection_mode,
+                                                           size,
+                                                           connection_options);
   if (result.is_error()) {
-    delete new_handle;
+    destroy_handle(new_handle);
     return to_capi_status(result);
   }
 
   *handle = new_handle;
   return US3_SUCCESS;
 }
+}  // namespace
+
+US3_API void us3_init_options(us3_options_t* options) {
+  if (options == NULL) {
+    return;
+  }
+  options->connect_timeout = US3_NO_TIMEOUT;
+  options->socket_timeout = US3_NO_TIMEOUT;
+  options->signature = US3_SIGNATURE_V2;
+  options->region = NULL;
+  options->chunk_size = 0;
+  options->checksum = US3_CHECKSUM_NONE;
+  options->verify_etag = 0;
+  options->socket.tcp_nodelay = 1;
+  options->socket.send_buffer_size = 0;
+  options->socket.recv_buffer_size = 0;
+  options->socket.link_bandwidth = 0;
+  options->socket.tcp_quickack = 0;
+  options->socket.busy_poll = 0;
+  options->socket.recv_lowat = 0;
+  options->hedge_delay = 0;
+  options->retry.max_attempts = 1;
+  options->retry.base_delay = 100000;
+  options->retry.max_delay = 20000000;
+  options->retry.retry_on = US3_RETRY_CONNECTION | US3_RETRY_TIMEOUT | US3_RETRY_SERVER_ERROR;
+  options->hooks = NULL;
+  options->transport = US3_TRANSPORT_TCP;
+  options->unix_socket_path = NULL;
+  options->loopback_response = NULL;
+  options->loopback_response_size = 0;
+  options->loopback_segment_size = 0;
+  options->record_path = NULL;
+  options->arena = NULL;
+  options->arena_size = 0;
+}
+
+US3_API us3_status_t us3_open(const char* url,
+                              const char* access_key,
+                              const char* secret_key,
+                              const us3_mode_t mode,
+                              const size_t size,
+                              const us3_microseconds_t connect_timeout,
+                              const us3_microseconds_t socket_timeout,
+                              us3_handle_t* handle) {
+  us3_options_t options;
+  us3_init_options(&options);
+  options.connect_timeout = connect_timeout;
+  options.socket_timeout = socket_timeout;
+  return us3_open_with_options(url, access_key, secret_key, mode, size, &options, handle);
+}
+
+US3_API us3_status_t us3_open_with_options(const char* url,
+                                           const char* access_key,
+                                           const char* secret_key,
+                                           const us3_mode_t mode,
+                                           const size_t size,
+                                           const us3_options_t* options,
+                                           us3_handle_t* handle) {
+  return open_handle(url, access_key, secret_key, mode, size, options, NULL, NULL, 0, handle);
+}
+
+US3_API us3_status_t us3_open_inplace(void* storage,
+                                      const size_t storage_size,
+                                      const char* url,
+                                      const char* access_key,
+                                      const char* secret_key,
+                                      const us3_mode_t mode,
+                                      const size_t size,
+                                      const us3_options_t* options,
+                                      us3_handle_t* handle) {
+  // Sanity check the storage (the rest is checked by open_handle()).
+  if (storage == NULL || reinterpret_cast<size_t>(storage) % US3_HANDLE_STORAGE_ALIGNMENT != 0 ||
+      storage_size < us3_handle_storage_size()) {
+    return US3_INVALID_ARGUMENT;
+  }
+  return open_handle(
+      url, access_key, secret_key, mode, size, options, NULL, storage, storage_size, handle);
+}
+
+US3_API size_t us3_handle_storage_size(void) {
+  return HANDLE_SIZE + MIN_INPLACE_ARENA_SIZE;
+}
+
+US3_API size_t us3_handle_storage_alignment(void) {
+  return US3_HANDLE_STORAGE_ALIGNMENT;
+}
+
+US3_API us3_status_t us3_put_buffer(const char* url,
+                                    const char* access_key,
+                                    const char* secret_key,
+                                    const void* buf,
+                                    const size_t size,
+                                    const us3_options_t* options) {
+  // Sanity check arguments (the rest are checked when opening the stream).
+  if (buf == NULL && size > 0) {
+    return US3_INVALID_ARGUMENT;
+  }
+
+  // Calculate the Content-MD5 before sending any headers.
+  char content_md5[us3::md5_t::MD5_BASE64_SIZE + 1];
+  {
+    us3::md5_t md5;
+    md5.update(buf, size);
+    md5.finalize_base64(content_md5);
+  }
+
+  // Note: An empty object is sent (and the HTTP response is read) when the stream is opened.
+  us3_handle_t handle;
+  const us3_status_t open_status = open_handle(
+      url, access_key, secret_key, US3_WRITE, size, options, &content_md5[0], NULL, 0, &handle);
+  if (open_status != US3_SUCCESS) {
+    return open_status;
+  }
+
+  // Send the data. The final write also reads the HTTP response.
+  const char* data = reinterpret_cast<const char*>(buf);
+  size_t bytes_left = size;
+  us3_status_t status = US3_SUCCESS;
+  while (status == US3_SUCCESS && bytes_left > 0) {
+    const us3::result_t<size_t> result = handle->connection.write(data, bytes_left);
+    status = to_capi_status(result);
+    data += *result;
+    bytes_left -= *result;
+  }
+
+  const us3_status_t close_status = us3_close(handle);
+  return (status != US3_SUCCESS) ? status : close_status;
+}
+
+US3_API us3_status_t us3_upload_file(const char* url,
+                                     const char* access_key,
+                                     const char* secret_key,
+                                     const char* file_path,
+                                     const char* journal_path,
+                                     const size_t part_size,
+                                     const us3_options_t* options) {
+  // Sanity check arguments.
+  if (url == NULL || access_key == NULL || secret_key == NULL || file_path == NULL ||
+      journal_path == NULL) {
+    return US3_INVALID_ARGUMENT;
+  }
+
+  us3::connection_t::options_t connection_options;
+  us3::net::loopback_config_t loopback;
+  us3::net::recording_config_t recording;
+  const us3_status_t options_status =
+      to_connection_options(options, connection_options, loopback, recording);
+  if (options_status != US3_SUCCESS) {
+    return options_status;
+  }
+
+  us3::url_parts_t url_parts;
+  const us3_status_t url_status = parse_object_url(url, url_parts);
+  if (url_status != US3_SUCCESS) {
+    return url_status;
+  }
+
+  return to_capi_status(us3::upload_file(url_parts.host.c_str(),
+                                         url_parts.port,
+                                         url_parts.path.c_str(),
+                                         access_key,
+                                         secret_key,
+                                         file_path,
+                                         journal_path,
+                                         part_size,
+                                         connection_options));
+}
 
 US3_API us3_status_t us3_close(us3_handle_t handle) {
   // Sanity check arguments.
@@ -147,7 +595,7 @@ US3_API us3_status_t us3_close(us3_handle_t handle) {
 
   // Close and delete the connection.
   us3::status_t result = handle->connection.close();
-  delete handle;
+  destroy_handle(handle);
   return to_capi_status(result);
 }
 
@@ -237,3 +685,102 @@ US3_API us3_status_t us3_get_content_length(us3_handle_t handle, size_t* content
   *content_length = *result;
   return to_capi_status(result);
 }
+
+US3_API us3_status_t us3_get_checksum(us3_handle_t handle, const char** checksum) {
+  // Sanity check arguments.
+  if (!is_valid_handle(handle)) {
+    return US3_INVALID_HANDLE;
+  }
+  if (checksum == NULL) {
+    return US3_INVALID_ARGUMENT;
+  }
+
+  us3::result_t<const char*> result = handle->connection.get_checksum();
+  *checksum = *result;
+  return to_capi_status(result);
+}
+
+US3_API us3_status_t us3_get_stats(us3_handle_t handle, us3_stats_t* stats) {
+  // Sanity check arguments.
+  if (!is_valid_handle(handle)) {
+    return US3_INVALID_HANDLE;
+  }
+  if (stats == NULL) {
+    return US3_INVALID_ARGUMENT;
+  }
+
+  const us3::connection_t::stats_t connection_stats = handle->connection.get_stats();
+  stats->resolve_time = to_relative_time(connection_stats.resolve_time, connection_stats);
+  stats->connect_time = to_relative_time(connection_stats.connect_time, connection_stats);
+  stats->headers_sent_time = to_relative_time(connection_stats.headers_sent_time, connection_stats);
+  stats->first_byte_time = to_relative_time(connection_stats.first_byte_time, connection_stats);
+  stats->headers_parsed_time =
+      to_relative_time(connection_stats.headers_parsed_time, connection_stats);
+  stats->body_complete_time =
+      to_relative_time(connection_stats.body_complete_time, connection_stats);
+  stats->bytes_sent = static_cast<size_t>(connection_stats.bytes_sent);
+  stats->bytes_received = static_cast<size_t>(connection_stats.bytes_received);
+  stats->send_calls = connection_stats.send_calls;
+  stats->recv_calls = connection_stats.recv_calls;
+  return US3_SUCCESS;
+}
+
+US3_API void us3_configure_dns_cache(const us3_microseconds_t ttl,
+                                     const us3_microseconds_t negative_ttl) {
+  us3::net::global_resolver().configure(static_cast<us3::net::timeout_t>(ttl),
+                                        static_cast<us3::net::timeout_t>(negative_ttl));
+}
+
+US3_API void us3_flush_dns_cache(void) {
+  us3::net::global_resolver().flush();
+}
+
+US3_API void us3_flush_redirect_cache(void) {
+  us3::global_redirect_cache().flush();
+}
+
+US3_API void us3_set_allocator(void* (*malloc_fn)(size_t size, void* user_data),
+                               void* (*realloc_fn)(void* ptr, size_t size, void* user_data),
+                               void (*free_fn)(void* ptr, void* user_data),
+                               void* user_data) {
+  us3::allocator_hooks_t hooks;
+  hooks.malloc_fn = malloc_fn;
+  hooks.realloc_fn = realloc_fn;
+  hooks.free_fn = free_fn;
+  hooks.user_data = user_data;
+  us3::set_allocator_hooks(hooks);
+}
+
+US3_API void us3_set_global_hooks(const us3_hooks_t* hooks) {
+  if (hooks != NULL) {
+    const us3_hooks_t* copy = get_global_hooks_copy(*hooks);
+    if (copy != NULL) {
+      us3::set_global_trace_hooks(to_trace_hooks(copy));
+    }
+  } else {
+    us3::set_global_trace_hooks(us3::trace_hooks_t());
+  }
+}
+
+US3_API us3_status_t us3_get_hedge_stats(us3_hedge_stats_t* stats) {
+  // Sanity check arguments.
+  if (stats == NULL) {
+    return US3_INVALID_ARGUMENT;
+  }
+
+  const us3::hedge_stats_t hedge_stats = us3::get_hedge_stats();
+  stats->requests = hedge_stats.requests;
+  stats->fired = hedge_stats.fired;
+  stats->won = hedge_stats.won;
+  return US3_SUCCESS;
+}
+
+US3_API size_t us3_metrics_dump(char* buf, const size_t size) {
+  const std::string metrics = us3::render_metrics();
+  if (buf != NULL && size > 0) {
+    const size_t length = std::min(metrics.size(), size - 1);
+    std::memcpy(buf, metrics.data(), length);
+    buf[length] = 0;
+  }
+  return metrics.size();
+}
@@ -53,6 +53,10 @@ US3_API const char* us3_status_str(const us3_status_t status) {
       return "The server refused to authorize the request";
     case US3_NOT_FOUND:
       return "The object was not found";
+    case US3_CHECKSUM_MISMATCH:
+      return "The checksum of the transferred data did not match";
+    case US3_SERVER_ERROR:
+      return "The server failed or was overloaded";
     default:
       return "(invalid status code)";
   }
@@ -19,34 +19,26 @@
 
 #include "connection.hpp"
 
+#include "hedging.hpp"
 #include "hmac_sha1.hpp"
+#include "metrics.hpp"
+#include "platform.hpp"
+#include "url_parser.hpp"
 #include <algorithm>
 #include <cctype>
 #include <clocale>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
-#include <sstream>
+#include <map>
+#include <vector>
 
 namespace us3 {
 
 namespace {
 
-struct header_field_t {
-  header_field_t(const std::string& n, const std::string& v) : name(n), value(v) {
-  }
-  header_field_t() {
-  }
-
-  operator bool() const {
-    return !name.empty();
-  }
-
-  std::string name;
-  std::string value;
-};
-
-std::string get_date_rfc2616_gmt() {
+string_t get_date_gmt(const char* format) {
   // TODO(m): setlocale() is not guaranteed to be thread safe. Can we do this in a more thread safe
   // manner?
 
@@ -58,27 +50,113 @@ std::string get_date_rfc2616_gmt() {
   std::time_t now = std::time(0);
   std::tm now_gmt = *std::gmtime(&now);
 
-  // Format the date & time according to RFC2616.
+  // Format the date & time.
   char buf[100];
-  if (std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &now_gmt) == 0) {
+  if (std::strftime(buf, sizeof(buf), format, &now_gmt) == 0) {
     buf[0] = '\0';
   }
 
   // Restore the old locale.
   std::setlocale(LC_ALL, old_locale);
 
-  return std::string(&buf[0]);
+  return string_t(&buf[0]);
+}
+
+string_t get_date_rfc2616_gmt() {
+  return get_date_gmt("%a, %d %b %Y %H:%M:%S GMT");
+}
+
+string_t get_date_iso8601_gmt() {
+  return get_date_gmt("%Y%m%dT%H%M%SZ");
 }
 
-std::string mode_to_http_method(const connection_t::mode_t mode) {
+string_t size_to_string(size_t size) {
+  // Note: size_t may be wider than unsigned long (e.g. on 64-bit Windows), so we do not use
+  // printf() style formatting.
+  char buf[32];
+  char* p = &buf[sizeof(buf)];
+  do {
+    *--p = static_cast<char>('0' + size % 10U);
+    size /= 10U;
+  } while (size > 0U);
+  return string_t(p, static_cast<size_t>(&buf[sizeof(buf)] - p));
+}
+
+const char* mode_to_http_method(const connection_t::mode_t mode) {
   return (mode == connection_t::WRITE) ? "PUT" : "GET";
 }
 
-status_t send_string(net::socket_t socket, const std::string& str) {
-  size_t remaining = str.size();
+bool is_sigv2_subresource(const string_t& name) {
+  // Query parameters that are part of the SIGV2 canonicalized resource (sorted).
+  static const char* const SUBRESOURCES[] = {"acl",
+                                             "cors",
+                                             "delete",
+                                             "lifecycle",
+                                             "location",
+                                             "logging",
+                                             "notification",
+                                             "partNumber",
+                                             "policy",
+                                             "requestPayment",
+                                             "response-cache-control",
+                                             "response-content-disposition",
+                                             "response-content-encoding",
+                                             "response-content-language",
+                                             "response-content-type",
+                                             "response-expires",
+                                             "restore",
+                                             "tagging",
+                                             "torrent",
+                                             "uploadId",
+                                             "uploads",
+                                             "versionId",
+                                             "versioning",
+                                             "versions",
+                                             "website"};
+  for (size_t i = 0; i < sizeof(SUBRESOURCES) / sizeof(SUBRESOURCES[0]); ++i) {
+    if (name == SUBRESOURCES[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Get the SIGV2 canonicalized resource of a path: Other query parameters than the sub-resources
+// (e.g. list markers) are not signed, and the sub-resources are sorted by name.
+string_t sigv2_canonical_resource(const string_t& path) {
+  const string_t::size_type query_pos = path.find('?');
+  if (query_pos == string_t::npos) {
+    return path;
+  }
+  std::vector<string_t, std_allocator_t<string_t> > subresources;
+  string_t::size_type start = query_pos + 1;
+  while (start <= path.size()) {
+    string_t::size_type end = path.find('&', start);
+    if (end == string_t::npos) {
+      end = path.size();
+    }
+    const string_t param = path.substr(start, end - start);
+    if (is_sigv2_subresource(param.substr(0, param.find('=')))) {
+      subresources.push_back(param);
+    }
+    start = end + 1;
+  }
+  std::sort(subresources.begin(), subresources.end());
+  string_t resource = path.substr(0, query_pos);
+  for (size_t i = 0; i < subresources.size(); ++i) {
+    resource += (i == 0 ? "?" : "&") + subresources[i];
+  }
+  return resource;
+}
+
+status_t send_buffer(const net::transport_t& transport,
+                     net::socket_t socket,
+                     const char* buf,
+                     const size_t size) {
+  size_t remaining = size;
   size_t sent = 0;
   while (remaining > 0) {
-    const result_t<size_t> count = net::send(socket, &str[sent], remaining);
+    const result_t<size_t> count = transport.send(socket, &buf[sent], remaining);
     if (count.is_error()) {
       return make_result(count.status());
     }
@@ -88,63 +166,55 @@ status_t send_string(net::socket_t socket, const std::string& str) {
   return make_result(status_t::SUCCESS);
 }
 
-std::string extract_line(const char* buf, const size_t buf_size, const bool has_cr = false) {
-  // Empty buffer -> empty string.
-  if (buf_size == 0) {
-    return std::string();
-  }
-
-  // Do we already have a CR from a previous string?
-  if (has_cr && buf[0] == '\n') {
-    return std::string(buf, 1);
-  }
+status_t send_string(const net::transport_t& transport,
+                     net::socket_t socket,
+                     const string_t& str) {
+  return send_buffer(transport, socket, str.data(), str.size());
+}
 
-  // Try to find a new-line marker (CRLF).
-  for (size_t i = 0; i < (buf_size - 1); ++i) {
-    if (buf[i] == '\r' && buf[i + 1] == '\n') {
-      return std::string(buf, i + 2);
-    }
-  }
+// HTTP request header fields, sorted by name.
+typedef std::map<string_t,
+                 string_t,
+                 std::less<string_t>,
+                 std_allocator_t<std::pair<const string_t, string_t> > >
+    header_map_t;
 
-  // Return an incomplete string.
-  return std::string(buf, buf_size);
+void append_header(string_t& http_header, const string_t& name, const string_t& value) {
+  http_header.append("\r\n").append(name).append(": ").append(value);
 }
 
-header_field_t parse_header_field(const std::string& line) {
+// Parse a header field line ("Name: value", without the CRLF) in place. The name is turned into
+// lower case, and the value is stripped of leading and trailing white space.
+bool parse_header_field(char* line, const char*& name, const char*& value) {
   // Find the separating colon.
-  const std::string::size_type colon_pos = line.find(':');
-  if (colon_pos == std::string::npos) {
-    return header_field_t();
+  char* colon = std::strchr(line, ':');
+  if (colon == NULL) {
+    return false;
   }
+  *colon = 0;
 
-  // Extract the field name and turn it into lowercase.
-  std::string name(line.c_str(), colon_pos);
-  for (std::string::iterator it = name.begin(); it != name.end(); it++) {
-    unsigned char c = static_cast<unsigned char>(*it);
+  // Turn the field name into lowercase.
+  for (char* p = line; *p != 0; ++p) {
+    const unsigned char c = static_cast<unsigned char>(*p);
     if (c >= static_cast<unsigned char>('A') && c <= static_cast<unsigned char>('Z')) {
-      c = static_cast<unsigned char>(c + 'z' - 'Z');
-      *it = static_cast<std::string::value_type>(c);
+      *p = static_cast<char>(c + 'z' - 'Z');
     }
   }
 
-  // Extract the field value and strip leading and trailing spaces.
-  std::string value;
-  {
-    size_t start_pos;
-    for (start_pos = colon_pos + 1;
-         (start_pos < line.size()) && (std::isspace(line[start_pos]) != 0);
-         ++start_pos) {
-    }
-    if (start_pos < line.size()) {
-      size_t end_pos;
-      for (end_pos = line.size() - 1; (end_pos > start_pos) && (std::isspace(line[end_pos]) != 0);
-           --end_pos) {
-      }
-      value = line.substr(start_pos, end_pos - start_pos + 1);
-    }
+  // Strip leading and trailing spaces from the field value.
+  char* start = colon + 1;
+  while (*start != 0 && std::isspace(static_cast<unsigned char>(*start)) != 0) {
+    ++start;
+  }
+  char* end = start + std::strlen(start);
+  while (end > start && std::isspace(static_cast<unsigned char>(end[-1])) != 0) {
+    --end;
   }
+  *end = 0;
 
-  return header_field_t(name, value);
+  name = line;
+  value = start;
+  return true;
 }
 
 }  // namespace
@@ -156,100 +226,462 @@ status_t connection_t::open(const char* host_name,
                             const char* secret_key,
                             const mode_t mode,
                             const size_t size,
-                            const net::timeout_t connect_timeout,
-                            const net::timeout_t socket_timeout) {
+                            const options_t& options) {
   // Sanity check arguments.
   // Note: All pointers are guaranteed to be non-NULL at this point.
   if (port < 1 || port > 65535) {
     return make_result(status_t::INVALID_OPERATION);
   }
+  if (options.chunk_size != 0 && options.chunk_size < MIN_CHUNK_SIZE) {
+    return make_result(status_t::INVALID_ARGUMENT);
+  }
 
   // We must not open a connection that is already opened.
   if (m_mode != NONE) {
     return make_result(status_t::INVALID_OPERATION);
   }
 
+  // Remember the request, so that it can be repeated. The Content-MD5 is only needed while opening
+  // the connection.
+  m_host = host_name;
+  m_port = port;
+  m_path = path;
+  m_access_key = access_key;
+  m_secret_key = secret_key;
+  m_options = options;
+  if (options.region != NULL) {
+    m_region = options.region;
+    m_options.region = m_region.c_str();
+  }
+  if (options.method != NULL) {
+    m_method = options.method;
+    m_options.method = m_method.c_str();
+  }
+  if (options.body != NULL) {
+    m_body = options.body;
+    m_options.body = m_body.c_str();
+  }
+  m_mode = mode;
+  m_transport = (options.transport != NULL) ? options.transport : &net::tcp_transport();
+  m_arena.use_buffer(options.arena, options.arena_size, options.fixed_arena);
+  m_status_line = "";
+  m_response_fields = NULL;
+  m_retry_count = 0;
+  m_range_start = 0;
+  m_stats = stats_t();
+  m_stats.start_time = get_monotonic_time_us();
+  if (!m_options.trace_hooks.is_enabled()) {
+    m_options.trace_hooks = get_global_trace_hooks();
+  }
+  trace(trace_event_t::OPEN_START, 0, status_t::SUCCESS);
+
+  // Go straight to the endpoint of a bucket that has been redirected before.
+  m_request_host = host_name;
+  m_request_port = port;
+  m_request_path = path;
+  endpoint_t endpoint;
+  if (global_redirect_cache().lookup(
+          m_request_host.c_str(), m_request_port, m_request_path.c_str(), endpoint)) {
+    use_endpoint(endpoint);
+  }
+
+  // Send the request, and follow redirects.
+  status_t::status_enum_t status = open_with_retries(size).status();
+  for (int redirects = 0; is_redirect() && redirects < MAX_REDIRECTS; ++redirects) {
+    string_t redirect_path;
+    status = get_redirect_target(endpoint, redirect_path).status();
+    if (status != status_t::SUCCESS) {
+      break;
+    }
+    disconnect_socket(m_socket);
+    m_socket = NULL;
+    use_endpoint(endpoint);
+    m_path = redirect_path;
+    m_retry_count = 0;
+    status = open_with_retries(size).status();
+  }
+  m_options.content_md5 = NULL;
+  m_options.body = NULL;
+  if (status != status_t::SUCCESS && m_socket == NULL) {
+    // We never got connected.
+    record_metrics();
+    m_mode = NONE;
+  }
+  trace(trace_event_t::OPEN_END, 0, status);
+  return make_result(status);
+}
+
+status_t connection_t::open_with_retries(const size_t size) {
+  // Send the request, and retry it if it fails.
+  status_t::status_enum_t status = open_request(size).status();
+  while (m_options.retry.is_retryable(status) &&
+         m_retry_count + 1 < m_options.retry.max_attempts) {
+    if (m_socket != NULL) {
+      disconnect_socket(m_socket);
+      m_socket = NULL;
+    }
+    sleep_us(m_options.retry.backoff_delay(m_retry_count, next_random(m_random_state)));
+    ++m_retry_count;
+    status = open_request(size).status();
+  }
+  return make_result(status);
+}
+
+status_t connection_t::open_request(const size_t size) {
+  start_attempt();
+
   // Connect to the remote host.
-  result_t<net::socket_t> socket = net::connect(host_name, port, connect_timeout, socket_timeout);
+  result_t<net::socket_t> socket = m_transport->connect(m_options.transport_data,
+                                                       m_host.c_str(),
+                                                       m_port,
+                                                       m_options.connect_timeout,
+                                                       m_options.socket_timeout,
+                                                       m_options.socket);
   if (socket.is_error()) {
     return make_result(socket.status());
   }
 
   // We're now officially connected.
-  m_mode = mode;
   m_socket = *socket;
+  record_connect_times();
 
   // Send the HTTP headers.
-  const status_t headers_result = send_http_headers(host_name, path, access_key, secret_key, size);
+  const status_t headers_result = send_http_headers(m_host.c_str(),
+                                                    m_port,
+                                                    m_path.c_str(),
+                                                    m_access_key.c_str(),
+                                                    m_secret_key.c_str(),
+                                                    size,
+                                                    m_options);
   if (headers_result.is_error()) {
     return headers_result;
   }
+  m_stats.headers_sent_time = get_monotonic_time_us();
 
   // If we're done sending data (i.e. we're in READ mode), read the HTTP response now. Otherwise
   // we defer the read to after we're done sending our message.
   m_have_http_response = false;
+  m_verify_etag = false;
+  m_buffer_pos = 0;
+  m_buffer_size = 0;
   if (m_mode == READ) {
-    return read_http_response();
+    if (m_options.hedge_delay != 0 && is_get_request()) {
+      const status_t hedge_result = hedge_request(m_host.c_str(),
+                                                  m_port,
+                                                  m_path.c_str(),
+                                                  m_access_key.c_str(),
+                                                  m_secret_key.c_str(),
+                                                  m_options);
+      if (hedge_result.is_error()) {
+        return hedge_result;
+      }
+      record_connect_times();
+    }
+    const status_t response_result = read_http_response();
+    if (response_result.is_success() && m_options.verify_etag) {
+      start_etag_verification();
+    }
+    return response_result;
   }
   return make_result(status_t::SUCCESS);
 }
 
+status_t connection_t::resume(const status_t::status_enum_t failure) {
+  // Note: A chunked response can not be resumed, since its length is not known.
+  if (!m_options.retry.is_retryable(failure) || !is_get_request() || m_is_chunked ||
+      m_retry_count + 1 >= m_options.retry.max_attempts) {
+    return make_result(failure);
+  }
+
+  // Keep the response of the original request, and the state of the download.
+  // The response is kept in the arena, so only the pointers to it need to be saved. The responses
+  // to the new requests are only needed until they have been validated, so their arena memory is
+  // released after each attempt (otherwise the arena would grow with every resumed download).
+  const arena_t::mark_t arena_mark = m_arena.mark();
+  const char* status_line = m_status_line;
+  response_field_t* response_fields = m_response_fields;
+  const size_t content_length = m_content_length;
+  const size_t content_left = m_content_left;
+  const checksum_t checksum = m_checksum;
+  const char* etag = find_response_field("etag");
+  m_resume_etag = (etag != NULL) ? etag : "";
+  m_range_start = content_length - content_left;
+
+  if (m_socket != NULL) {
+    disconnect_socket(m_socket);
+    m_socket = NULL;
+  }
+
+  status_t::status_enum_t status = failure;
+  while (m_options.retry.is_retryable(status) &&
+         m_retry_count + 1 < m_options.retry.max_attempts) {
+    sleep_us(m_options.retry.backoff_delay(m_retry_count, next_random(m_random_state)));
+    ++m_retry_count;
+    start_attempt();
+
+    // Request the rest of the object.
+    result_t<net::socket_t> socket = m_transport->connect(m_options.transport_data,
+                                                         m_host.c_str(),
+                                                         m_port,
+                                                         m_options.connect_timeout,
+                                                         m_options.socket_timeout,
+                                                         m_options.socket);
+    status = socket.status();
+    if (socket.is_success()) {
+      m_socket = *socket;
+      record_connect_times();
+      m_have_http_response = false;
+      m_buffer_pos = 0;
+      m_buffer_size = 0;
+      status = send_http_headers(m_host.c_str(),
+                                 m_port,
+                                 m_path.c_str(),
+                                 m_access_key.c_str(),
+                                 m_secret_key.c_str(),
+                                 0,
+                                 m_options)
+                   .status();
+      if (status == status_t::SUCCESS) {
+        m_stats.headers_sent_time = get_monotonic_time_us();
+        status = read_http_response().status();
+      }
+
+      // The response must be the requested range of the same object.
+      if (status == status_t::SUCCESS) {
+        const char* content_range = find_response_field("content-range");
+        const string_t expected_range = "bytes " + size_to_string(m_range_start) + "-";
+        if (m_status_code != 206 || !m_has_content_length || m_content_length != content_left ||
+            content_range == NULL ||
+            std::strncmp(content_range, expected_range.c_str(), expected_range.size()) != 0) {
+          status = status_t::ERROR;
+        }
+      }
+    }
+
+    // Restore the original response (send_http_headers() also resets the checksum).
+    m_arena.release(arena_mark);
+    m_status_line = status_line;
+    m_response_fields = response_fields;
+    m_content_length = content_length;
+    m_content_left = content_left;
+    m_has_content_length = true;
+    m_checksum = checksum;
+
+    if (status == status_t::SUCCESS) {
+      break;
+    }
+    if (m_socket != NULL) {
+      disconnect_socket(m_socket);
+      m_socket = NULL;
+    }
+  }
+
+  m_range_start = 0;
+  return make_result(status);
+}
+
 status_t connection_t::close() {
   // We can not close a connection that is already closed.
   if (m_mode == NONE) {
     return make_result(status_t::INVALID_OPERATION);
   }
 
-  // Disconnect.
-  status_t result = net::disconnect(m_socket);
+  // Disconnect (the socket is already gone if a resumed download failed).
+  status_t result =
+      (m_socket != NULL) ? disconnect_socket(m_socket) : make_result(status_t::SUCCESS);
 
   // We're no longer connected.
-  m_mode = NONE;
   m_socket = NULL;
+  record_metrics();
+  trace(trace_event_t::CLOSE,
+        static_cast<size_t>(m_stats.bytes_sent + m_stats.bytes_received),
+        result.status());
+  m_mode = NONE;
+  m_is_aws_chunked = false;
 
   return result;
 }
 
 result_t<size_t> connection_t::read(void* buf, const size_t count) {
+  const result_t<size_t> result = read_content(buf, count);
+  trace(trace_event_t::READ, *result, result.status());
+  return result;
+}
+
+result_t<size_t> connection_t::write(const void* buf, const size_t count) {
+  const result_t<size_t> result = write_content(buf, count);
+  trace(trace_event_t::WRITE, *result, result.status());
+  return result;
+}
+
+result_t<size_t> connection_t::read_content(void* buf, const size_t count) {
   // The connection must have been opened in read mode.
   if (m_mode != READ) {
     return make_result<size_t>(0, status_t::INVALID_OPERATION);
   }
 
-  // TODO(m): Implement support for chunked transfer.
-  if (m_is_chunked || !m_has_content_length) {
+  // Responses without a known length (ended by closing the connection) are not supported.
+  if (!m_is_chunked && !m_has_content_length) {
     return make_result<size_t>(0, status_t::UNSUPPORTED);
   }
 
+  // Start the next chunk of a chunked response when the current chunk has been read.
+  if (m_is_chunked && m_content_left == 0 && !m_is_last_chunk && count > 0) {
+    const status_t chunk_result = read_chunk_header();
+    if (chunk_result.is_error()) {
+      return make_result<size_t>(0, chunk_result.status());
+    }
+  }
+
   char* target = reinterpret_cast<char*>(buf);
-  size_t bytes_left = std::min(count, m_content_left);
-  size_t actual_count = 0;
+  const size_t bytes_to_read = std::min(count, m_content_left);
 
   // If we have leftovers in the internal buffer we start by copying them.
-  const size_t bytes_from_buffer = std::min(bytes_left, m_buffer_size);
+  size_t actual_count = read_from_buffer(target, bytes_to_read);
+
+  // Retrieve the rest of the bytes from the socket. If the connection fails, the download is
+  // resumed with a new request (if the retry policy allows it). Note that we must not return zero
+  // bytes before the end of the content, since that would look like the end of the stream.
+  status_t::status_enum_t status = status_t::SUCCESS;
+  while (actual_count < bytes_to_read) {
+    const result_t<size_t> bytes_from_socket =
+        (m_socket != NULL)
+            ? m_transport->recv(m_socket, &target[actual_count], bytes_to_read - actual_count)
+            : make_result<size_t>(0, status_t::CONNECTION_RESET);
+    status = bytes_from_socket.status();
+    if (status == status_t::SUCCESS && *bytes_from_socket == 0) {
+      // The connection was closed before the end of the content.
+      status = status_t::CONNECTION_RESET;
+    }
+    if (status == status_t::SUCCESS) {
+      actual_count += *bytes_from_socket;
+      m_content_left -= *bytes_from_socket;
+      m_retry_count = 0;
+      break;
+    }
+
+    status = resume(status).status();
+    if (status != status_t::SUCCESS || actual_count > 0) {
+      break;
+    }
+
+    // The response to the new request may have left data in the internal buffer.
+    actual_count = read_from_buffer(target, bytes_to_read);
+  }
+
+  const bool is_complete = is_content_complete();
+  if (is_complete && m_stats.body_complete_time == 0) {
+    m_stats.body_complete_time = get_monotonic_time_us();
+  }
+
+  // Update the checksum, and verify it when we have reached the end of the stream.
+  if (m_checksum.algorithm() != checksum_t::NONE) {
+    m_checksum.update(buf, actual_count);
+    if (is_complete && status == status_t::SUCCESS) {
+      status = verify_checksum().status();
+    }
+  }
+
+  // Ditto for the ETag.
+  if (m_verify_etag) {
+    m_md5.update(buf, actual_count);
+    if (is_complete && status == status_t::SUCCESS) {
+      status = verify_etag().status();
+    }
+  }
+
+  return make_result(actual_count, status);
+}
+
+size_t connection_t::read_from_buffer(char* target, const size_t count) {
+  const size_t bytes_from_buffer = std::min(count, m_buffer_size);
   if (bytes_from_buffer > 0) {
     std::memcpy(target, &m_buffer[m_buffer_pos], bytes_from_buffer);
     m_buffer_pos += bytes_from_buffer;
     m_buffer_size -= bytes_from_buffer;
-    target += bytes_from_buffer;
-    bytes_left -= bytes_from_buffer;
-    actual_count += bytes_from_buffer;
+    m_content_left -= bytes_from_buffer;
   }
+  return bytes_from_buffer;
+}
 
-  // Retrieve the rest of the bytes from the socket.
-  status_t::status_enum_t status = status_t::SUCCESS;
-  if (bytes_left > 0) {
-    result_t<size_t> bytes_from_socket = net::recv(m_socket, target, bytes_left);
-    actual_count += *bytes_from_socket;
-    status = bytes_from_socket.status();
+bool connection_t::is_content_complete() const {
+  // Note: For chunked responses, the end is known when the last (empty) chunk has been read.
+  return m_content_left == 0 && (!m_is_chunked || m_is_last_chunk);
+}
+
+status_t connection_t::read_line(char* line, const size_t max_size) {
+  size_t size = 0;
+  while (true) {
+    if (m_buffer_size == 0) {
+      m_buffer_pos = 0;
+      const status_t result = read_data_to_buffer();
+      if (result.is_error()) {
+        return result;
+      }
+    }
+    const char c = m_buffer[m_buffer_pos];
+    ++m_buffer_pos;
+    --m_buffer_size;
+    if (c == '\n') {
+      break;
+    }
+    if (size + 1 < max_size) {
+      line[size++] = c;
+    }
   }
 
-  m_content_left -= actual_count;
+  // Remove the trailing CR.
+  if (size > 0 && line[size - 1] == '\r') {
+    --size;
+  }
+  line[size] = 0;
+  return make_result(status_t::SUCCESS);
+}
+
+status_t connection_t::read_chunk_header() {
+  char line[MAX_CHUNK_LINE_SIZE];
 
-  return make_result(actual_count, status);
+  // The data of the previous chunk is terminated by a CRLF.
+  if (m_has_read_chunk) {
+    const status_t result = read_line(&line[0], sizeof(line));
+    if (result.is_error()) {
+      return result;
+    }
+    if (line[0] != 0) {
+      return make_result(status_t::ERROR);
+    }
+  }
+
+  // The chunk size is a hex number, optionally followed by chunk extensions.
+  const status_t result = read_line(&line[0], sizeof(line));
+  if (result.is_error()) {
+    return result;
+  }
+  if (!std::isxdigit(static_cast<unsigned char>(line[0]))) {
+    return make_result(status_t::ERROR);
+  }
+  const unsigned long chunk_size = std::strtoul(&line[0], NULL, 16);
+  m_has_read_chunk = true;
+  m_content_left = static_cast<size_t>(chunk_size);
+
+  // The last chunk is followed by optional trailer fields, and a blank line.
+  if (chunk_size == 0) {
+    do {
+      const status_t trailer_result = read_line(&line[0], sizeof(line));
+      if (trailer_result.is_error()) {
+        return trailer_result;
+      }
+    } while (line[0] != 0);
+    m_is_last_chunk = true;
+  }
+  return make_result(status_t::SUCCESS);
 }
 
-result_t<size_t> connection_t::write(const void* buf, const size_t count) {
+bool connection_t::is_get_request() const {
+  return m_options.method == NULL || std::strcmp(m_options.method, "GET") == 0;
+}
+
+result_t<size_t> connection_t::write_content(const void* buf, const size_t count) {
   // The connection must have been opened in write mode.
   if (m_mode != WRITE) {
     return make_result<size_t>(0, status_t::INVALID_OPERATION);
@@ -265,16 +697,30 @@ result_t<size_t> connection_t::write(const void* buf, const size_t count) {
     return make_result<size_t>(0, status_t::INVALID_OPERATION);
   }
 
+  // Signed streaming uploads are sent in chunks.
+  if (m_is_aws_chunked) {
+    return write_aws_chunked(buf, count);
+  }
+
   // Send the buffer over the socket.
-  result_t<size_t> actual_count = net::send(m_socket, buf, count);
-  if (m_has_content_length && actual_count.is_success()) {
-    m_content_left -= *actual_count;
+  result_t<size_t> actual_count = m_transport->send(m_socket, buf, count);
+  if (actual_count.is_success()) {
+    if (m_has_content_length) {
+      m_content_left -= *actual_count;
+    }
+    m_checksum.update(buf, *actual_count);
   }
 
-  // If we're done writing data, now is a good time to read the HTTP response.
+  // If we're done writing data, now is a good time to read the HTTP response. A redirect can not
+  // be followed (the data has been sent), but it is remembered for later requests.
   if (m_has_content_length && m_content_left == 0) {
     const status_t response_result = read_http_response();
     if (response_result.is_error()) {
+      if (is_redirect()) {
+        endpoint_t endpoint;
+        string_t redirect_path;
+        get_redirect_target(endpoint, redirect_path);
+      }
       return make_result(*actual_count, response_result.status());
     }
   }
@@ -282,11 +728,31 @@ result_t<size_t> connection_t::write(const void* buf, const size_t count) {
   return actual_count;
 }
 
+result_t<const char*> connection_t::get_checksum() {
+  if (m_mode == NONE || m_checksum.algorithm() == checksum_t::NONE) {
+    return make_result<const char*>(NULL, status_t::INVALID_OPERATION);
+  }
+  m_checksum.to_base64(m_checksum_base64);
+  return make_result<const char*>(&m_checksum_base64[0], status_t::SUCCESS);
+}
+
+connection_t::stats_t connection_t::get_stats() const {
+  stats_t stats = m_stats;
+  if (m_socket != NULL) {
+    const net::socket_stats_t socket_stats = m_transport->get_socket_stats(m_socket);
+    stats.bytes_sent += socket_stats.bytes_sent;
+    stats.bytes_received += socket_stats.bytes_received;
+    stats.send_calls += socket_stats.send_calls;
+    stats.recv_calls += socket_stats.recv_calls;
+  }
+  return stats;
+}
+
 result_t<const char*> connection_t::get_status_line() {
   if (m_mode == NONE) {
     return make_result<const char*>(NULL, status_t::INVALID_OPERATION);
   }
-  return make_result(m_status_line.c_str(), status_t::SUCCESS);
+  return make_result(m_status_line, status_t::SUCCESS);
 }
 
 result_t<const char*> connection_t::get_response_field(const char* name) {
@@ -295,12 +761,12 @@ result_t<const char*> connection_t::get_response_field(const char* name) {
   }
 
   // Look up the field among the response fields.
-  std::map<std::string, std::string>::const_iterator field = m_response_fields.find(name);
-  if (field == m_response_fields.end()) {
+  const char* value = find_response_field(name);
+  if (value == NULL) {
     return make_result<const char*>(NULL, status_t::NO_SUCH_FIELD);
   }
 
-  return make_result(field->second.c_str(), status_t::SUCCESS);
+  return make_result(value, status_t::SUCCESS);
 }
 
 result_t<size_t> connection_t::get_content_length() {
@@ -314,10 +780,12 @@ result_t<size_t> connection_t::get_content_length() {
 }
 
 status_t connection_t::send_http_headers(const char* host_name,
+                                         const int port,
                                          const char* path,
                                          const char* access_key,
                                          const char* secret_key,
-                                         const size_t size) {
+                                         const size_t size,
+                                         const options_t& options) {
   if (m_mode == WRITE) {
     // Determine how to write data.
     if (size > 0) {
@@ -333,45 +801,574 @@ status_t connection_t::send_http_headers(const char* host_name,
     m_has_content_length = false;
     m_is_chunked = false;
   }
+  m_is_aws_chunked = false;
+  m_has_checksum_trailer = false;
+  m_checksum = checksum_t(options.checksum);
 
   // Gather information for the HTTP request.
-  const std::string http_method = mode_to_http_method(m_mode);
-  const std::string content_type = "application/octet-stream";
-  const std::string date_formatted = get_date_rfc2616_gmt();
-  const std::string relative_path = std::string(path);
+  const char* http_method = (options.method != NULL) ? options.method : mode_to_http_method(m_mode);
+  const bool is_get = (std::strcmp(http_method, "GET") == 0);
+  const char* body = (m_mode == READ && options.body != NULL) ? options.body : "";
+  const size_t body_size = std::strlen(body);
+  const char* content_type = "application/octet-stream";
+
+  // Resumed downloads request the rest of the object, which must not have changed.
+  header_map_t range_headers;
+  if (m_mode == READ && m_range_start > 0) {
+    range_headers["Range"] = "bytes=" + size_to_string(m_range_start) + "-";
+    if (!m_resume_etag.empty()) {
+      range_headers["If-Match"] = m_resume_etag;
+    }
+  }
 
-  // Generate a signature based on the request info and the S3 secret key.
-  const std::string string_to_sign =
-      http_method + "\n\n" + content_type + "\n" + date_formatted + "\n" + relative_path;
-  const result_t<hmac_sha1_t> digest = hmac_sha1(secret_key, string_to_sign.c_str());
-  if (digest.is_error()) {
-    return make_result(digest.status());
+  // Collect x-amz-* headers (they are part of the signature).
+  header_map_t amz_headers;
+  if (m_mode == READ && m_checksum.algorithm() != checksum_t::NONE) {
+    // Ask the server to include the object checksum in the response.
+    amz_headers["x-amz-checksum-mode"] = "ENABLED";
+  }
+  for (size_t i = 0; i < options.amz_header_count; ++i) {
+    amz_headers[options.amz_headers[i].name] = options.amz_headers[i].value;
   }
-  const std::string signature = std::string(digest->c_str());
 
   // Construct the HTTP request header.
-  std::ostringstream http_header;
-  http_header << http_method << " " << path << " HTTP/1.1";
-  http_header << "\r\nHost: " << host_name;
-  http_header << "\r\nContent-Type: " << content_type;
-  http_header << "\r\nDate: " << date_formatted;
-  http_header << "\r\nAuthorization: AWS " << access_key << ":" << signature;
-  if (m_has_content_length) {
-    http_header << "\r\nContent-Length: " << m_content_length;
+  string_t http_header;
+  http_header.append(http_method).append(" ").append(path).append(" HTTP/1.1");
+  if (options.signature == SIGV4) {
+    const string_t date_formatted = get_date_iso8601_gmt();
+    const string_t region =
+        (options.region != NULL) ? string_t(options.region) : sigv4_region_from_host(host_name);
+    string_t host = host_name;
+    if (port != 80) {
+      host += ":" + size_to_string(static_cast<size_t>(port));
+    }
+
+    // Collect the headers to sign.
+    m_signer = sigv4_signer_t(access_key, secret_key, region.c_str(), date_formatted.c_str());
+    m_signer.add_header("Host", host.c_str());
+    m_signer.add_header("Content-Type", content_type);
+    http_header.append("\r\nHost: ").append(host);
+    http_header.append("\r\nContent-Type: ").append(content_type);
+    if (options.content_md5 != NULL) {
+      m_signer.add_header("Content-MD5", options.content_md5);
+      http_header.append("\r\nContent-MD5: ").append(options.content_md5);
+    }
+    for (header_map_t::const_iterator it = range_headers.begin(); it != range_headers.end();
+         ++it) {
+      m_signer.add_header(it->first.c_str(), it->second.c_str());
+      append_header(http_header, it->first, it->second);
+    }
+    amz_headers["x-amz-date"] = date_formatted;
+
+    // Uploads are sent as a signed aws-chunked stream, so that we do not have to hash the entire
+    // payload before sending the headers. A checksum is sent as a signed trailer.
+    const char* payload_hash = SIGV4_EMPTY_PAYLOAD;
+    char body_hash[sha256_t::SHA256_HEX_SIZE + 1];
+    if (body_size > 0) {
+      sha256_t sha256;
+      sha256.update(body, body_size);
+      sha256.finalize_hex(body_hash);
+      payload_hash = &body_hash[0];
+    }
+    if (m_mode == READ && !is_get) {
+      const string_t content_length = size_to_string(body_size);
+      m_signer.add_header("Content-Length", content_length.c_str());
+      http_header.append("\r\nContent-Length: ").append(content_length);
+    }
+    if (m_has_content_length) {
+      const size_t chunk_size = (options.chunk_size != 0) ? options.chunk_size : DEFAULT_CHUNK_SIZE;
+      size_t trailer_size = 0;
+      payload_hash = SIGV4_STREAMING_PAYLOAD;
+      if (m_checksum.algorithm() != checksum_t::NONE) {
+        // Trailer: "<checksum-header>:<base64>\r\nx-amz-trailer-signature:<signature>\r\n".
+        char base64[checksum_t::MAX_BASE64_SIZE + 1];
+        m_checksum.to_base64(base64);
+        trailer_size = std::strlen(m_checksum.header_name()) + 1 + std::strlen(&base64[0]) + 2 +
+                       24 + sha256_t::SHA256_HEX_SIZE + 2;
+        payload_hash = SIGV4_STREAMING_PAYLOAD_TRAILER;
+        amz_headers["x-amz-trailer"] = m_checksum.header_name();
+        m_has_checksum_trailer = true;
+      }
+      const string_t encoded_size =
+          size_to_string(sigv4_chunked_size(size, chunk_size, trailer_size));
+      m_signer.add_header("Content-Encoding", "aws-chunked");
+      m_signer.add_header("Content-Length", encoded_size.c_str());
+      http_header.append("\r\nContent-Encoding: aws-chunked");
+      http_header.append("\r\nContent-Length: ").append(encoded_size);
+      amz_headers["x-amz-decoded-content-length"] = size_to_string(size);
+
+      const size_t buffer_size = MAX_CHUNK_HEADER_SIZE + chunk_size + 2;
+      if (buffer_size > m_chunk_buffer_capacity) {
+        void* new_buffer = heap_realloc(m_chunk_buffer, buffer_size);
+        if (new_buffer == NULL) {
+          return make_result(status_t::ERROR);
+        }
+        m_chunk_buffer = static_cast<char*>(new_buffer);
+        m_chunk_buffer_capacity = buffer_size;
+      }
+      m_is_aws_chunked = true;
+      m_chunk_size = chunk_size;
+      m_chunk_fill = 0;
+      m_chunk_hash = sha256_t();
+    }
+    amz_headers["x-amz-content-sha256"] = payload_hash;
+
+    for (header_map_t::const_iterator it = amz_headers.begin(); it != amz_headers.end(); ++it) {
+      m_signer.add_header(it->first.c_str(), it->second.c_str());
+      append_header(http_header, it->first, it->second);
+    }
+
+    // Generate a signature based on the request info and the S3 secret key.
+    const string_t authorization = m_signer.sign_request(http_method, path, payload_hash);
+    http_header.append("\r\nAuthorization: ").append(authorization);
+  } else {
+    const string_t date_formatted = get_date_rfc2616_gmt();
+    const string_t relative_path = sigv2_canonical_resource(path);
+
+    // The canonicalized x-amz-* headers are sorted by name (as given by the map).
+    string_t canonical_amz_headers;
+    for (header_map_t::const_iterator it = amz_headers.begin(); it != amz_headers.end(); ++it) {
+      canonical_amz_headers.append(it->first).append(":").append(it->second).append("\n");
+    }
+
+    // Generate a signature based on the request info and the S3 secret key.
+    const char* content_md5 = (options.content_md5 != NULL) ? options.content_md5 : "";
+    string_t string_to_sign;
+    string_to_sign.append(http_method)
+        .append("\n")
+        .append(content_md5)
+        .append("\n")
+        .append(content_type)
+        .append("\n")
+        .append(date_formatted)
+        .append("\n")
+        .append(canonical_amz_headers)
+        .append(relative_path);
+    const result_t<hmac_sha1_t> digest = hmac_sha1(secret_key, string_to_sign.c_str());
+    if (digest.is_error()) {
+      return make_result(digest.status());
+    }
+
+    http_header.append("\r\nHost: ").append(host_name);
+    http_header.append("\r\nContent-Type: ").append(content_type);
+    if (content_md5[0] != 0) {
+      http_header.append("\r\nContent-MD5: ").append(content_md5);
+    }
+    http_header.append("\r\nDate: ").append(date_formatted);
+    for (header_map_t::const_iterator it = range_headers.begin(); it != range_headers.end();
+         ++it) {
+      append_header(http_header, it->first, it->second);
+    }
+    for (header_map_t::const_iterator it = amz_headers.begin(); it != amz_headers.end(); ++it) {
+      append_header(http_header, it->first, it->second);
+    }
+    http_header.append("\r\nAuthorization: AWS ")
+        .append(access_key)
+        .append(":")
+        .append(digest->c_str());
+    if (m_has_content_length) {
+      http_header.append("\r\nContent-Length: ").append(size_to_string(m_content_length));
+    } else if (m_mode == READ && !is_get) {
+      http_header.append("\r\nContent-Length: ").append(size_to_string(body_size));
+    }
+  }
+
+  // Extra (unsigned) headers from the tracing hooks, e.g. a trace context.
+  if (options.trace_hooks.get_request_headers != NULL) {
+    const char* extra_headers =
+        options.trace_hooks.get_request_headers(this, options.trace_hooks.user_data);
+    if (extra_headers != NULL && extra_headers[0] != 0) {
+      http_header.append("\r\n").append(extra_headers);
+    }
   }
-  http_header << "\r\n\r\n";
+  http_header.append("\r\n\r\n").append(body, body_size);
 
   // Send the HTTP header.
   {
-    status_t header_send_status = send_string(m_socket, http_header.str());
+    status_t header_send_status = send_string(*m_transport, m_socket, http_header);
     if (header_send_status.is_error()) {
       return make_result(header_send_status.status());
     }
   }
+  trace(trace_event_t::HEADERS_SENT, http_header.size() - body_size, status_t::SUCCESS);
 
   return make_result(status_t::SUCCESS);
 }
 
+status_t connection_t::hedge_request(const char* host_name,
+                                     const int port,
+                                     const char* path,
+                                     const char* access_key,
+                                     const char* secret_key,
+                                     const options_t& options) {
+  // The latency sample is the response time of the winning request, measured from when that
+  // request was sent (so that the hedge delay is not counted when the hedge request wins).
+  int64_t send_time = get_monotonic_time_us();
+  latency_tracker_t& tracker = hedge_latency_tracker();
+  net::timeout_t delay = options.hedge_delay;
+  if (delay == ADAPTIVE_HEDGE_DELAY) {
+    // Until we have enough samples to estimate the p95 latency, we do not hedge.
+    delay = static_cast<net::timeout_t>(tracker.percentile(95));
+  }
+
+  // Wait for the response to start arriving, but no longer than the hedge delay.
+  bool fired = false;
+  bool won = false;
+  const net::timeout_t first_wait = (delay > 0) ? delay : options.socket_timeout;
+  status_t::status_enum_t status = m_transport->wait_readable(&m_socket, 1, first_wait).status();
+  if (delay > 0 && status == status_t::TIMEOUT) {
+    // Send a duplicate request on a second connection.
+    const result_t<net::socket_t> hedge_socket = m_transport->connect(options.transport_data,
+                                                                      host_name,
+                                                                      port,
+                                                                      options.connect_timeout,
+                                                                      options.socket_timeout,
+                                                                      options.socket);
+    status_t::status_enum_t hedge_status = hedge_socket.status();
+    int64_t hedge_time = 0;
+    if (hedge_socket.is_success()) {
+      net::socket_t first_socket = m_socket;
+      m_socket = *hedge_socket;
+      hedge_status =
+          send_http_headers(host_name, port, path, access_key, secret_key, 0, options).status();
+      m_socket = first_socket;
+      hedge_time = get_monotonic_time_us();
+    }
+
+    if (hedge_status == status_t::SUCCESS) {
+      // Use whichever response arrives first, and cancel the other request.
+      fired = true;
+      const net::socket_t sockets[2] = {m_socket, *hedge_socket};
+      const result_t<size_t> ready =
+          m_transport->wait_readable(&sockets[0], 2, options.socket_timeout);
+      status = ready.status();
+      won = ready.is_success() && *ready == 1;
+      disconnect_socket(sockets[won ? 0 : 1]);
+      m_socket = sockets[won ? 1 : 0];
+      if (won) {
+        send_time = hedge_time;
+      }
+    } else {
+      // The hedge request failed, so stick with the first request.
+      if (hedge_socket.is_success()) {
+        disconnect_socket(*hedge_socket);
+      }
+      status = m_transport->wait_readable(&m_socket, 1, options.socket_timeout).status();
+    }
+  }
+
+  if (status == status_t::SUCCESS) {
+    tracker.add_sample(get_monotonic_time_us() - send_time);
+  }
+  count_hedged_request(fired, won);
+  return make_result(status);
+}
+
+result_t<size_t> connection_t::write_aws_chunked(const void* buf, const size_t count) {
+  const char* source = reinterpret_cast<const char*>(buf);
+  const size_t chunk_size = m_chunk_size;
+  char* chunk_data = &m_chunk_buffer[MAX_CHUNK_HEADER_SIZE];
+
+  size_t actual_count = 0;
+  while (actual_count < count) {
+    // Append data to the current chunk. We hash the data while it is still hot in the cache.
+    const size_t bytes_to_copy = std::min(count - actual_count, chunk_size - m_chunk_fill);
+    std::memcpy(&chunk_data[m_chunk_fill], &source[actual_count], bytes_to_copy);
+    m_chunk_hash.update(&source[actual_count], bytes_to_copy);
+    m_checksum.update(&source[actual_count], bytes_to_copy);
+    m_chunk_fill += bytes_to_copy;
+    m_content_left -= bytes_to_copy;
+    actual_count += bytes_to_copy;
+
+    // Send the chunk when it is full, or when it is the last chunk.
+    if (m_chunk_fill == chunk_size || m_content_left == 0) {
+      const status_t chunk_result = send_aws_chunk();
+      if (chunk_result.is_error()) {
+        return make_result(actual_count, chunk_result.status());
+      }
+    }
+  }
+
+  // If we're done writing data, send the terminating zero-sized chunk and read the HTTP response.
+  if (m_content_left == 0) {
+    const status_t chunk_result = send_aws_chunk();
+    if (chunk_result.is_error()) {
+      return make_result(actual_count, chunk_result.status());
+    }
+    const status_t response_result = read_http_response();
+    if (response_result.is_error()) {
+      return make_result(actual_count, response_result.status());
+    }
+  }
+
+  return make_result(actual_count, status_t::SUCCESS);
+}
+
+status_t connection_t::send_aws_chunk() {
+  // Sign the chunk.
+  char chunk_hash[sha256_t::SHA256_HEX_SIZE + 1];
+  m_chunk_hash.finalize_hex(chunk_hash);
+  m_chunk_hash = sha256_t();
+  const char* chunk_signature = m_signer.sign_chunk(&chunk_hash[0]);
+
+  // Put the chunk header right in front of the chunk data, and CRLF right after it.
+  char chunk_header[MAX_CHUNK_HEADER_SIZE + 1];
+  const int header_size = std::snprintf(&chunk_header[0],
+                                        sizeof(chunk_header),
+                                        "%lx;chunk-signature=%s\r\n",
+                                        static_cast<unsigned long>(m_chunk_fill),
+                                        chunk_signature);
+  if (header_size <= 0 || static_cast<size_t>(header_size) > MAX_CHUNK_HEADER_SIZE) {
+    return make_result(status_t::ERROR);
+  }
+  // The final chunk is followed by the trailer (if any).
+  if (m_chunk_fill == 0 && m_has_checksum_trailer) {
+    char base64[checksum_t::MAX_BASE64_SIZE + 1];
+    m_checksum.to_base64(base64);
+    char trailer[64 + checksum_t::MAX_BASE64_SIZE + 2];
+    const int trailer_size = std::snprintf(
+        &trailer[0], sizeof(trailer), "%s:%s\n", m_checksum.header_name(), &base64[0]);
+    if (trailer_size <= 0 || static_cast<size_t>(trailer_size) >= sizeof(trailer)) {
+      return make_result(status_t::ERROR);
+    }
+    const char* trailer_signature = m_signer.sign_trailer(&trailer[0]);
+    trailer[trailer_size - 1] = 0;
+    char final_chunk[sizeof(chunk_header) + sizeof(trailer) + 32 + sha256_t::SHA256_HEX_SIZE];
+    const int final_size = std::snprintf(&final_chunk[0],
+                                         sizeof(final_chunk),
+                                         "%s%s\r\nx-amz-trailer-signature:%s\r\n\r\n",
+                                         &chunk_header[0],
+                                         &trailer[0],
+                                         trailer_signature);
+    if (final_size <= 0 || static_cast<size_t>(final_size) >= sizeof(final_chunk)) {
+      return make_result(status_t::ERROR);
+    }
+    return send_buffer(*m_transport, m_socket, &final_chunk[0], static_cast<size_t>(final_size));
+  }
+
+  char* chunk_start = &m_chunk_buffer[MAX_CHUNK_HEADER_SIZE - static_cast<size_t>(header_size)];
+  std::memcpy(chunk_start, &chunk_header[0], static_cast<size_t>(header_size));
+  char* chunk_end = &m_chunk_buffer[MAX_CHUNK_HEADER_SIZE + m_chunk_fill];
+  chunk_end[0] = '\r';
+  chunk_end[1] = '\n';
+
+  // Send the entire chunk.
+  const size_t total_size = static_cast<size_t>(header_size) + m_chunk_fill + 2;
+  m_chunk_fill = 0;
+  return send_buffer(*m_transport, m_socket, chunk_start, total_size);
+}
+
+status_t connection_t::verify_checksum() {
+  // Look for a checksum in the HTTP response.
+  const char* field = find_response_field(m_checksum.header_name());
+  if (field == NULL) {
+    return make_result(status_t::SUCCESS);
+  }
+
+  // Composite checksums of multipart objects (e.g. "xxxxxx==-3") can not be verified.
+  if (std::strchr(field, '-') != NULL) {
+    return make_result(status_t::SUCCESS);
+  }
+
+  m_checksum.to_base64(m_checksum_base64);
+  if (std::strcmp(field, &m_checksum_base64[0]) != 0) {
+    return make_result(status_t::CHECKSUM_MISMATCH);
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+void connection_t::start_etag_verification() {
+  const char* etag = find_response_field("etag");
+  if (etag == NULL) {
+    return;
+  }
+
+  // The ETag of a single-part object is the quoted hex MD5 of the object. Multipart (and some
+  // encrypted) objects have other ETags, which we can not verify.
+  if (std::strlen(etag) != md5_t::MD5_HEX_SIZE + 2 || etag[0] != '"' ||
+      etag[md5_t::MD5_HEX_SIZE + 1] != '"') {
+    return;
+  }
+  char md5_hex[md5_t::MD5_HEX_SIZE + 1];
+  for (size_t i = 0; i < md5_t::MD5_HEX_SIZE; ++i) {
+    const int c = static_cast<unsigned char>(etag[i + 1]);
+    if (std::isxdigit(c) == 0) {
+      return;
+    }
+    md5_hex[i] = static_cast<char>(std::tolower(c));
+  }
+  md5_hex[md5_t::MD5_HEX_SIZE] = 0;
+
+  std::memcpy(m_expected_md5, md5_hex, sizeof(m_expected_md5));
+  m_md5 = md5_t();
+  m_verify_etag = true;
+}
+
+bool connection_t::is_redirect() const {
+  return m_have_http_response && (m_status_code == 301 || m_status_code == 302 ||
+                                  m_status_code == 307 || m_status_code == 308);
+}
+
+status_t connection_t::get_redirect_target(endpoint_t& endpoint, string_t& path) {
+  endpoint.host = m_host.c_str();
+  endpoint.port = m_port;
+  endpoint.region.clear();
+  path = m_path.c_str();
+
+  // The target is given by the Location field, or by the <Endpoint> of an S3 PermanentRedirect
+  // error (which is what S3 responds with for path-style requests to the wrong region).
+  const char* location = find_response_field("location");
+  if (location != NULL && location[0] != 0) {
+    if (location[0] == '/') {
+      path = location;
+    } else {
+      const result_t<url_parts_t> url_parts = parse_url(location);
+      if (url_parts.is_error()) {
+        return make_result(url_parts.status());
+      }
+      if (url_parts->scheme != "http") {
+        return make_result(status_t::UNSUPPORTED);
+      }
+      endpoint.host = url_parts->host.c_str();
+      endpoint.port = url_parts->port;
+      path = url_parts->path;
+    }
+  } else {
+    string_t body;
+    const status_t body_result = read_small_body(body);
+    if (body_result.is_error()) {
+      return body_result;
+    }
+    const string_t::size_type start = body.find("<Endpoint>");
+    const string_t::size_type end = body.find("</Endpoint>");
+    if (start == string_t::npos || end == string_t::npos || end <= start + 10) {
+      return make_result(status_t::ERROR);
+    }
+    endpoint.host.assign(body.data() + start + 10, end - start - 10);
+  }
+
+  // S3 tells us the region of the bucket, which is needed for signing requests (SIGV4).
+  const char* region = find_response_field("x-amz-bucket-region");
+  if (region != NULL) {
+    endpoint.region = region;
+  }
+
+  // Remember permanent redirects of the bucket to another endpoint. Redirects that change the path
+  // are followed, but not cached.
+  const bool is_permanent = (m_status_code == 301 || m_status_code == 308);
+  if (is_permanent && path == m_path) {
+    global_redirect_cache().store(
+        m_request_host.c_str(), m_request_port, m_request_path.c_str(), endpoint);
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+status_t connection_t::read_small_body(string_t& body) {
+  const char* field = find_response_field("content-length");
+  if (field == NULL) {
+    return make_result(status_t::UNSUPPORTED);
+  }
+  const long int content_length = std::strtol(field, NULL, 10);
+  if (content_length < 0 || static_cast<size_t>(content_length) > MAX_REDIRECT_BODY_SIZE) {
+    return make_result(status_t::ERROR);
+  }
+
+  // Note: This must not touch the content state (m_content_left etc), which belongs to the upload
+  // in WRITE mode.
+  body.assign(&m_buffer[m_buffer_pos],
+              std::min(m_buffer_size, static_cast<size_t>(content_length)));
+  while (body.size() < static_cast<size_t>(content_length)) {
+    char buf[MAX_BUFFER_SIZE];
+    const size_t count = std::min(sizeof(buf), static_cast<size_t>(content_length) - body.size());
+    const result_t<size_t> result = m_transport->recv(m_socket, &buf[0], count);
+    if (result.is_error()) {
+      return make_result(result.status());
+    }
+    if (*result == 0) {
+      return make_result(status_t::CONNECTION_RESET);
+    }
+    body.append(&buf[0], *result);
+  }
+  m_buffer_pos = 0;
+  m_buffer_size = 0;
+  return make_result(status_t::SUCCESS);
+}
+
+void connection_t::use_endpoint(const endpoint_t& endpoint) {
+  m_host = endpoint.host.c_str();
+  m_port = endpoint.port;
+  if (!endpoint.region.empty()) {
+    m_region = endpoint.region.c_str();
+    m_options.region = m_region.c_str();
+  }
+}
+
+status_t connection_t::disconnect_socket(net::socket_t socket) {
+  // Keep the counters of the socket.
+  const net::socket_stats_t socket_stats = m_transport->get_socket_stats(socket);
+  m_stats.bytes_sent += socket_stats.bytes_sent;
+  m_stats.bytes_received += socket_stats.bytes_received;
+  m_stats.send_calls += socket_stats.send_calls;
+  m_stats.recv_calls += socket_stats.recv_calls;
+  return m_transport->disconnect(socket);
+}
+
+void connection_t::record_metrics() {
+  const char* method = (m_options.method != NULL) ? m_method.c_str() : mode_to_http_method(m_mode);
+  const int64_t end_time = (m_stats.body_complete_time != 0) ? m_stats.body_complete_time
+                                                              : get_monotonic_time_us();
+  record_request_metrics(method,
+                         m_have_http_response ? m_status_code : 0,
+                         m_host.c_str(),
+                         end_time - m_stats.start_time,
+                         m_stats.bytes_sent,
+                         m_stats.bytes_received);
+}
+
+void connection_t::fire_trace_event(const trace_event_t::type_t type,
+                                    const size_t bytes,
+                                    const status_t::status_enum_t status) {
+  trace_event_t event;
+  event.type = type;
+  event.stream = this;
+  event.time = get_monotonic_time_us() - m_stats.start_time;
+  event.host = m_host.c_str();
+  // The response of a previous attempt is not reported when a new request is started.
+  const bool has_response = m_have_http_response && type != trace_event_t::OPEN_START &&
+                            type != trace_event_t::HEADERS_SENT;
+  event.status_code = has_response ? m_status_code : 0;
+  event.bytes = bytes;
+  event.status = status;
+  m_options.trace_hooks.on_event(event, m_options.trace_hooks.user_data);
+}
+
+void connection_t::start_attempt() {
+  m_stats.resolve_time = 0;
+  m_stats.connect_time = 0;
+  m_stats.headers_sent_time = 0;
+  m_stats.first_byte_time = 0;
+  m_stats.headers_parsed_time = 0;
+  m_stats.body_complete_time = 0;
+}
+
+void connection_t::record_connect_times() {
+  const net::socket_stats_t socket_stats = m_transport->get_socket_stats(m_socket);
+  m_stats.resolve_time = socket_stats.resolve_time;
+  m_stats.connect_time = socket_stats.connect_time;
+}
+
+status_t connection_t::verify_etag() {
+  // The MD5 can only be finalized once.
+  m_verify_etag = false;
+
+  char md5_hex[md5_t::MD5_HEX_SIZE + 1];
+  m_md5.finalize_hex(md5_hex);
+  if (std::strcmp(m_expected_md5, &md5_hex[0]) != 0) {
+    return make_result(status_t::CHECKSUM_MISMATCH);
+  }
+  return make_result(status_t::SUCCESS);
+}
+
 status_t connection_t::read_data_to_buffer() {
   // End of buffer reached?
   if (m_buffer_pos == MAX_BUFFER_SIZE) {
@@ -380,31 +1377,59 @@ status_t connection_t::read_data_to_buffer() {
 
   // Try to read enough data to fill the buffer.
   const size_t bytes_to_read = MAX_BUFFER_SIZE - (m_buffer_pos + m_buffer_size);
-  result_t<size_t> result = net::recv(m_socket, &m_buffer[m_buffer_pos], bytes_to_read);
+  result_t<size_t> result = m_transport->recv(m_socket, &m_buffer[m_buffer_pos], bytes_to_read);
   if (result.is_error()) {
     return make_result(result.status());
   }
+  if (*result == 0) {
+    // The connection was closed before the HTTP response was complete.
+    return make_result(status_t::CONNECTION_RESET);
+  }
+  if (m_stats.first_byte_time == 0) {
+    m_stats.first_byte_time = get_monotonic_time_us();
+  }
   m_buffer_size += *result;
 
   return make_result(status_t::SUCCESS);
 }
 
+const char* connection_t::find_response_field(const char* name) const {
+  for (const response_field_t* field = m_response_fields; field != NULL; field = field->next) {
+    if (std::strcmp(field->name, name) == 0) {
+      return field->value;
+    }
+  }
+  return NULL;
+}
+
 status_t connection_t::read_http_response() {
   // We do not have to read the HTTP reponse again if we already have it.
   if (m_have_http_response) {
     return make_result(status_t::SUCCESS);
   }
 
-  m_status_line.clear();
+  m_status_line = "";
+  m_response_fields = NULL;
+  m_status_code = 0;
+
+  // When an upload reads the response, the whole body has been sent.
+  if (m_mode == WRITE && m_stats.body_complete_time == 0) {
+    m_stats.body_complete_time = get_monotonic_time_us();
+  }
 
   if (m_mode == READ) {
     m_content_length = 0;
     m_content_left = 0;
     m_has_content_length = false;
     m_is_chunked = false;
+    m_has_read_chunk = false;
+    m_is_last_chunk = false;
   }
 
-  std::string incomplete_line;
+  // The response lines are collected in the arena (a line may span several reads, and is then grown
+  // in place), and the parsed status line and header fields point into them.
+  char* line = NULL;
+  size_t line_size = 0;
   while (!m_have_http_response) {
     // Read more data into our buffer.
     status_t result = read_data_to_buffer();
@@ -414,44 +1439,59 @@ status_t connection_t::read_http_response() {
 
     // Read lines.
     while (m_buffer_size > 0) {
-      // Extract a new string from the buffer.
-      const bool has_cr =
-          (!incomplete_line.empty() && incomplete_line[incomplete_line.size() - 1] == '\r');
-      std::string line = extract_line(&m_buffer[m_buffer_pos], m_buffer_size, has_cr);
-      m_buffer_pos += line.size();
-      m_buffer_size -= line.size();
-
-      // Prepend a previous incomplete line (if any).
-      line += incomplete_line;
-
-      // Final blank line that terminates the HTTP response?
-      if (line == "\r\n") {
-        m_have_http_response = true;
-        break;
+      // Append the data up to the next LF (if any) to the current line.
+      const char* data = &m_buffer[m_buffer_pos];
+      const char* lf = static_cast<const char*>(std::memchr(data, '\n', m_buffer_size));
+      const size_t count = (lf != NULL) ? static_cast<size_t>(lf - data) + 1 : m_buffer_size;
+      char* new_line = static_cast<char*>(
+          m_arena.grow(line, (line != NULL) ? line_size + 1 : 0, line_size + count + 1));
+      if (new_line == NULL) {
+        return make_result(status_t::ERROR);
       }
+      std::memcpy(&new_line[line_size], data, count);
+      line = new_line;
+      line_size += count;
+      line[line_size] = 0;
+      m_buffer_pos += count;
+      m_buffer_size -= count;
 
       // Incomplete line (i.e. we've reached the end of the buffer but we don't have a terminating
       // CRLF)?
-      if (m_buffer_size == 0 &&
-          (line.size() < 2 || (line[line.size() - 2] != '\r' || line[line.size() - 1] != '\n'))) {
-        incomplete_line = line;
-        break;
+      if (line_size < 2 || line[line_size - 2] != '\r' || line[line_size - 1] != '\n') {
+        continue;
       }
-      incomplete_line = "";
 
-      // Sanity check.
-      if (line.size() < 2) {
-        return make_result(status_t::ERROR);
+      // We now have a CRLF-terminated HTTP response line. Remove the trailing \r\n.
+      line[line_size - 2] = 0;
+      char* complete_line = line;
+      const bool is_blank_line = (line_size == 2);
+      line = NULL;
+      line_size = 0;
+
+      // Final blank line that terminates the HTTP response?
+      if (is_blank_line) {
+        m_have_http_response = true;
+        m_stats.headers_parsed_time = get_monotonic_time_us();
+        break;
       }
 
-      // We now have a CRLF-terminated HTTP response line.
-      if (m_status_line.empty()) {
-        // The first line is the status line. Remove the trailing \r\n.
-        m_status_line = line.substr(0, line.size() - 2);
+      if (m_status_line[0] == 0) {
+        // The first line is the status line.
+        m_status_line = complete_line;
       } else {
-        header_field_t header_field = parse_header_field(line);
-        if (header_field) {
-          m_response_fields[header_field.name] = header_field.value;
+        const char* name;
+        const char* value;
+        if (parse_header_field(complete_line, name, value)) {
+          // Later fields go first, so that a repeated field is found with its last value.
+          response_field_t* field =
+              static_cast<response_field_t*>(m_arena.allocate(sizeof(response_field_t)));
+          if (field == NULL) {
+            return make_result(status_t::ERROR);
+          }
+          field->name = name;
+          field->value = value;
+          field->next = m_response_fields;
+          m_response_fields = field;
         }
       }
     }
@@ -459,43 +1499,45 @@ status_t connection_t::read_http_response() {
 
   if (m_mode == READ) {
     // Parse the content-length field (if present).
-    {
-      std::map<std::string, std::string>::const_iterator field =
-          m_response_fields.find("content-length");
-      if (field != m_response_fields.end()) {
-        const long int x = std::strtol(field->second.c_str(), NULL, 10);
-        m_content_length = static_cast<size_t>(x);
-        m_content_left = m_content_length;
-        m_has_content_length = true;
-      }
+    const char* content_length = find_response_field("content-length");
+    if (content_length != NULL) {
+      const long int x = std::strtol(content_length, NULL, 10);
+      m_content_length = static_cast<size_t>(x);
+      m_content_left = m_content_length;
+      m_has_content_length = true;
     }
 
-    // Check if this is a chunked transfer.
-    {
-      std::map<std::string, std::string>::const_iterator field =
-          m_response_fields.find("transfer-encoding");
-      if (field != m_response_fields.end()) {
-        if (field->second.find("chunked") != std::string::npos) {
-          m_is_chunked = true;
-        }
-      }
+    // Check if this is a chunked transfer (which overrides any Content-Length).
+    const char* transfer_encoding = find_response_field("transfer-encoding");
+    if (transfer_encoding != NULL && std::strstr(transfer_encoding, "chunked") != NULL) {
+      m_is_chunked = true;
+      m_has_content_length = false;
+      m_content_length = 0;
+      m_content_left = 0;
     }
   }
 
   // Check the HTTP status code (should be "HTTP/1.1 200 OK").
-  if (std::strncmp(m_status_line.c_str(), "HTTP/1.1 ", 9) != 0) {
+  if (std::strncmp(m_status_line, "HTTP/1.1 ", 9) != 0) {
     return make_result(status_t::UNSUPPORTED);
   }
-  const int status_code = (static_cast<int>(m_status_line[9] - '0') * 100) +
-                          (static_cast<int>(m_status_line[10] - '0') * 10) +
-                          static_cast<int>(m_status_line[11] - '0');
-  switch (status_code) {
+  m_status_code = (static_cast<int>(m_status_line[9] - '0') * 100) +
+                  (static_cast<int>(m_status_line[10] - '0') * 10) +
+                  static_cast<int>(m_status_line[11] - '0');
+  trace(trace_event_t::RESPONSE, m_has_content_length ? m_content_length : 0, status_t::SUCCESS);
+  switch (m_status_code) {
     case 200:
+    case 206:
       return make_result(status_t::SUCCESS);
     case 403:
       return make_result(status_t::FORBIDDEN);
     case 404:
       return make_result(status_t::NOT_FOUND);
+    case 500:
+    case 502:
+    case 503:
+    case 504:
+      return make_result(status_t::SERVER_ERROR);
     default:
       return make_result(status_t::ERROR);
   }
@@ -20,10 +20,21 @@
 #ifndef US3_CONNECTION_HPP_
 #define US3_CONNECTION_HPP_
 
+#include "allocator.hpp"
+#include "arena.hpp"
+#include "crc.hpp"
+#include "md5.hpp"
 #include "network_socket.hpp"
+#include "platform.hpp"
+#include "redirect_cache.hpp"
+#include "retry_policy.hpp"
 #include "return_value.hpp"
+#include "sha256.hpp"
+#include "sigv4.hpp"
+#include "tracing.hpp"
+#include "transport.hpp"
 #include <cstddef>
-#include <map>
+#include <stdint.h>
 #include <string>
 
 namespace us3 {
@@ -37,22 +48,137 @@ public:
     WRITE = 2  ///< The stream is open in write mode.
   };
 
+  /// @brief Request signature version.
+  enum signature_t {
+    SIGV2 = 0,  ///< AWS signature version 2 (HMAC-SHA1).
+    SIGV4 = 1   ///< AWS signature version 4 (HMAC-SHA256).
+  };
+
+  /// @brief A hedge delay that is estimated from recent response latencies (p95).
+  static const net::timeout_t ADAPTIVE_HEDGE_DELAY = -1;
+
+  /// @brief An extra x-amz-* request header (it is included in the request signature).
+  struct amz_header_t {
+    const char* name;   ///< Lower case header name, e.g. "x-amz-checksum-crc32c".
+    const char* value;  ///< Header value.
+  };
+
+  /// @brief Connection options.
+  struct options_t {
+    options_t()
+        : connect_timeout(0),
+          socket_timeout(0),
+          signature(SIGV2),
+          region(NULL),
+          chunk_size(0),
+          checksum(checksum_t::NONE),
+          content_md5(NULL),
+          verify_etag(false),
+          hedge_delay(0),
+          method(NULL),
+          body(NULL),
+          amz_headers(NULL),
+          amz_header_count(0),
+          transport(NULL),
+          transport_data(NULL),
+          arena(NULL),
+          arena_size(0),
+          fixed_arena(false) {
+    }
+
+    net::timeout_t connect_timeout;     ///< Connection timeout in μs, or 0 for no timeout.
+    net::timeout_t socket_timeout;      ///< Socket timeout in μs, or 0 for no timeout.
+    signature_t signature;              ///< Request signature version.
+    const char* region;                 ///< SIGV4 region, or NULL to derive it from the host name.
+    size_t chunk_size;                  ///< SIGV4 upload chunk size, or 0 for the default size.
+    checksum_t::algorithm_t checksum;   ///< Checksum to calculate while transferring data.
+    const char* content_md5;            ///< Base64 encoded Content-MD5 of an upload, or NULL.
+    bool verify_etag;                   ///< Verify downloads against a single-part (MD5) ETag.
+    net::socket_options_t socket;       ///< Socket tuning options.
+    net::timeout_t hedge_delay;         ///< READ hedge delay (μs), 0, or ADAPTIVE_HEDGE_DELAY.
+    retry_policy_t retry;               ///< Retry policy for failed requests.
+    const char* method;                 ///< HTTP method, or NULL for GET (READ) or PUT (WRITE).
+    const char* body;                   ///< READ request body (e.g. for POST), or NULL for none.
+    const amz_header_t* amz_headers;    ///< Extra signed x-amz-* headers, or NULL for none.
+    size_t amz_header_count;            ///< The number of extra x-amz-* headers.
+    trace_hooks_t trace_hooks;          ///< Tracing hooks (none for the global hooks).
+    const net::transport_t* transport;  ///< The transport, or NULL for TCP.
+    const void* transport_data;         ///< Transport specific data (must outlive the connection).
+    void* arena;                        ///< Memory for per-request data (see open()), or NULL.
+    size_t arena_size;                  ///< The size of the arena memory, in bytes.
+    bool fixed_arena;                   ///< Never allocate arena memory beyond the given arena.
+  };
+
+  /// @brief Request statistics.
+  ///
+  /// The times are monotonic timestamps (μs, see get_monotonic_time_us()), or 0 if the phase has
+  /// not been reached. For requests that are retried, resumed or redirected, the phase times are
+  /// those of the latest attempt, while the byte and system call counters are totals.
+  struct stats_t {
+    stats_t()
+        : start_time(0),
+          resolve_time(0),
+          connect_time(0),
+          headers_sent_time(0),
+          first_byte_time(0),
+          headers_parsed_time(0),
+          body_complete_time(0),
+          bytes_sent(0),
+          bytes_received(0),
+          send_calls(0),
+          recv_calls(0) {
+    }
+
+    int64_t start_time;           ///< When the connection was opened.
+    int64_t resolve_time;         ///< When the host name was resolved.
+    int64_t connect_time;         ///< When the TCP connection was established.
+    int64_t headers_sent_time;    ///< When the (signed) HTTP request headers were sent.
+    int64_t first_byte_time;      ///< When the first byte of the response was received.
+    int64_t headers_parsed_time;  ///< When the HTTP response headers were parsed.
+    int64_t body_complete_time;   ///< When the body was completely received (READ) or sent (WRITE).
+    uint64_t bytes_sent;          ///< The number of bytes sent (including HTTP headers).
+    uint64_t bytes_received;      ///< The number of bytes received (including HTTP headers).
+    unsigned long send_calls;     ///< The number of send system calls.
+    unsigned long recv_calls;     ///< The number of receive system calls.
+  };
+
   connection_t()
       : m_mode(NONE),
+        m_transport(&net::tcp_transport()),
         m_socket(NULL),
         m_buffer_pos(0),
         m_buffer_size(0),
         m_have_http_response(false),
+        m_status_line(""),
+        m_status_code(0),
+        m_response_fields(NULL),
         m_content_length(0),
         m_content_left(0),
         m_has_content_length(false),
-        m_is_chunked(false) {
+        m_is_chunked(false),
+        m_has_read_chunk(false),
+        m_is_last_chunk(false),
+        m_is_aws_chunked(false),
+        m_chunk_buffer(NULL),
+        m_chunk_buffer_capacity(0),
+        m_chunk_size(0),
+        m_chunk_fill(0),
+        m_has_checksum_trailer(false),
+        m_checksum_base64(),
+        m_verify_etag(false),
+        m_expected_md5(),
+        m_port(0),
+        m_request_port(0),
+        m_retry_count(0),
+        m_range_start(0),
+        m_random_state(static_cast<uint64_t>(get_monotonic_time_us())) {
   }
 
   ~connection_t() {
     if (m_mode != NONE) {
       close();
     }
+    heap_free(m_chunk_buffer);
   }
 
   /**
@@ -61,6 +187,28 @@ public:
    * This method opens a connection to the specified host and initiates S3 authentication by sending
    * the apropriate HTTP message headers. If this is a READ request, the HTTP response is also read.
    *
+   * Failures are retried according to the retry policy of the options. For READ connections, a
+   * download that fails after the HTTP response has been received is transparently resumed by
+   * read(), using a Range request from the current offset (and If-Match, so that the object
+   * must not have changed). Uploads are only retried until the HTTP headers have been sent.
+   *
+   * Redirects of READ requests are followed (up to MAX_REDIRECTS), and the request is signed for
+   * the new host. Permanent redirects of a bucket to another endpoint are remembered in the
+   * process wide redirect cache, so that later requests for the bucket (including uploads) go
+   * straight to the right endpoint. Uploads can not follow redirects, since the data has already
+   * been sent when the response arrives, but they still populate the cache.
+   *
+   * READ connections may use another HTTP method than GET (e.g. POST) and send a small request
+   * body together with the HTTP headers. Such requests are retried but never resumed or hedged.
+   *
+   * The per-request data (the HTTP response) is allocated from an arena that is owned by the
+   * connection and reused by later requests, so that read() and write() do not allocate heap
+   * memory. The exceptions are the recovery paths that send or parse another request: resuming
+   * a download after a failure (which signs a new request) and reading the target of a redirect
+   * response to an upload. The first block of the arena can be supplied with options.arena, in
+   * which case it must stay valid until the connection is opened again or destroyed. With
+   * options.fixed_arena, responses that do not fit in that memory fail with status_t::ERROR.
+   *
    * @param host_name Name of the host.
    * @param port Port to connection to.
    * @param path Full path to the object (including the leading slash).
@@ -68,8 +216,7 @@ public:
    * @param secret_key The S3 secret key.
    * @param mode Stream mode.
    * @param size Number of bytes to send (ignored for READ connections).
-   * @param connect_timeout Connection timeout in μs, or 0 for no timeout.
-   * @param socket_timeout Socket timeout in μs, or 0 for no timeout
+   * @param options Connection options.
    * @returns status_t::SUCCESS for success, otherwise an error code.
    */
   status_t open(const char* host_name,
@@ -79,8 +226,7 @@ public:
                 const char* secret_key,
                 mode_t mode,
                 size_t size,
-                net::timeout_t connect_timeout,
-                net::timeout_t socket_timeout);
+                const options_t& options);
 
   /**
    * @brief Close the connection.
@@ -127,18 +273,96 @@ public:
    */
   result_t<size_t> get_content_length();
 
+  /**
+   * @brief Get the checksum of the data that has been transferred so far.
+   * @returns the base64 encoded checksum, or status_t::INVALID_OPERATION if the connection was not
+   * opened with a checksum algorithm.
+   */
+  result_t<const char*> get_checksum();
+
+  /// @brief Get the statistics of the current request.
+  /// @note The statistics are collected at all times (the cost is a few counters and clock reads
+  /// per request).
+  stats_t get_stats() const;
+
 private:
+  // A response header field. The fields are kept in a list (allocated in the arena), where later
+  // fields come first so that a repeated field is found with its last value.
+  struct response_field_t {
+    const char* name;
+    const char* value;
+    response_field_t* next;
+  };
+
   static const size_t MAX_BUFFER_SIZE = 1024;
 
+  // The maximum number of redirects to follow, and the largest redirect response body to read.
+  static const int MAX_REDIRECTS = 5;
+  static const size_t MAX_REDIRECT_BODY_SIZE = 16384;
+
+  // Default and minimum chunk sizes for aws-chunked uploads (AWS requires at least 8 KiB).
+  static const size_t DEFAULT_CHUNK_SIZE = 65536;
+  static const size_t MIN_CHUNK_SIZE = 8192;
+
+  // Room for the chunk header (hex size + ";chunk-signature=" + signature + CRLF).
+  static const size_t MAX_CHUNK_HEADER_SIZE = 2 * sizeof(size_t) + 17 + 64 + 2;
+
+  // The longest chunk line of a chunked response that is kept (longer lines are truncated, which
+  // only drops chunk extensions and trailer fields, which are ignored).
+  static const size_t MAX_CHUNK_LINE_SIZE = 64;
+
   status_t send_http_headers(const char* host_name,
+                             int port,
                              const char* path,
                              const char* access_key,
                              const char* secret_key,
-                             size_t size);
+                             size_t size,
+                             const options_t& options);
+  status_t open_request(size_t size);
+  status_t open_with_retries(size_t size);
+  bool is_redirect() const;
+  status_t get_redirect_target(endpoint_t& endpoint, string_t& path);
+  status_t read_small_body(string_t& body);
+  void use_endpoint(const endpoint_t& endpoint);
+  status_t disconnect_socket(net::socket_t socket);
+  void start_attempt();
+  void record_connect_times();
+  void record_metrics();
+  result_t<size_t> read_content(void* buf, size_t count);
+  result_t<size_t> write_content(const void* buf, size_t count);
+  void fire_trace_event(trace_event_t::type_t type, size_t bytes, status_t::status_enum_t status);
+
+  // Report a lifecycle event to the tracing hooks (if any).
+  void trace(const trace_event_t::type_t type,
+             const size_t bytes,
+             const status_t::status_enum_t status) {
+    if (m_options.trace_hooks.on_event != NULL) {
+      fire_trace_event(type, bytes, status);
+    }
+  }
+  status_t resume(status_t::status_enum_t failure);
+  status_t hedge_request(const char* host_name,
+                         int port,
+                         const char* path,
+                         const char* access_key,
+                         const char* secret_key,
+                         const options_t& options);
+  size_t read_from_buffer(char* target, size_t count);
+  bool is_get_request() const;
   status_t read_data_to_buffer();
+  status_t read_line(char* line, size_t max_size);
+  status_t read_chunk_header();
+  bool is_content_complete() const;
   status_t read_http_response();
+  const char* find_response_field(const char* name) const;
+  result_t<size_t> write_aws_chunked(const void* buf, size_t count);
+  status_t send_aws_chunk();
+  status_t verify_checksum();
+  void start_etag_verification();
+  status_t verify_etag();
 
   mode_t m_mode;
+  const net::transport_t* m_transport;
   net::socket_t m_socket;
 
   // Internal buffer used for reading the HTTP response.
@@ -146,14 +370,68 @@ private:
   size_t m_buffer_size;
   char m_buffer[MAX_BUFFER_SIZE];
 
-  // HTTP response values.
+  // HTTP response values. The status line and the header fields are allocated in the arena, which
+  // is released when the connection is opened again.
+  arena_t m_arena;
   bool m_have_http_response;
-  std::string m_status_line;
-  std::map<std::string, std::string> m_response_fields;
+  const char* m_status_line;
+  int m_status_code;
+  response_field_t* m_response_fields;
   size_t m_content_length;
   size_t m_content_left;
   bool m_has_content_length;
+
+  // State for chunked responses. m_content_left is then the number of bytes left of the current
+  // chunk.
   bool m_is_chunked;
+  bool m_has_read_chunk;
+  bool m_is_last_chunk;
+
+  // State for aws-chunked (SIGV4 streaming) uploads. The chunk buffer holds room for the chunk
+  // header, the chunk data and the trailing CRLF, so that each chunk is sent in one go. The buffer
+  // is kept between requests, and only grows.
+  bool m_is_aws_chunked;
+  sigv4_signer_t m_signer;
+  sha256_t m_chunk_hash;
+  char* m_chunk_buffer;
+  size_t m_chunk_buffer_capacity;
+  size_t m_chunk_size;
+  size_t m_chunk_fill;
+
+  // Data integrity checksum. For SIGV4 uploads, the checksum is sent in a signed trailer.
+  checksum_t m_checksum;
+  bool m_has_checksum_trailer;
+  char m_checksum_base64[checksum_t::MAX_BASE64_SIZE + 1];
+
+  // Download verification against the (MD5) ETag of a single-part object.
+  bool m_verify_etag;
+  md5_t m_md5;
+  char m_expected_md5[md5_t::MD5_HEX_SIZE + 1];
+
+  // The request, so that it can be repeated (retried or resumed).
+  string_t m_host;
+  int m_port;
+  string_t m_path;
+  string_t m_access_key;
+  string_t m_secret_key;
+  string_t m_region;
+  string_t m_method;
+  string_t m_body;
+  options_t m_options;
+
+  // The originally requested endpoint (the key for the redirect cache).
+  string_t m_request_host;
+  int m_request_port;
+  string_t m_request_path;
+
+  // Retry state. m_range_start is the first byte to request when resuming a download.
+  int m_retry_count;
+  size_t m_range_start;
+  string_t m_resume_etag;
+  uint64_t m_random_state;
+
+  // Request statistics. The byte and system call counters are those of closed sockets.
+  stats_t m_stats;
 };
 
 }  // namespace us3
@@ -0,0 +1,104 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "cpu_features.hpp"
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define US3_CPU_X86 1
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+#endif
+
+namespace us3 {
+
+namespace {
+
+#if defined(US3_CPU_X86)
+// Execute the CPUID instruction. Returns false if the leaf is not supported.
+bool cpuid(const unsigned int leaf, unsigned int (&regs)[4]) {
+#  if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (static_cast<unsigned int>(info[0]) < leaf) {
+    return false;
+  }
+  __cpuidex(info, static_cast<int>(leaf), 0);
+  for (int i = 0; i < 4; ++i) {
+    regs[i] = static_cast<unsigned int>(info[i]);
+  }
+  return true;
+#  else
+  if (__get_cpuid_max(0, NULL) < leaf) {
+    return false;
+  }
+  __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+  return true;
+#  endif
+}
+
+// Get the OS enabled register state (XCR0).
+unsigned int xgetbv0() {
+#  if defined(_MSC_VER)
+  return static_cast<unsigned int>(_xgetbv(0));
+#  else
+  unsigned int eax;
+  unsigned int edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return eax;
+#  endif
+}
+#endif
+
+cpu_features_t detect_cpu_features() {
+  cpu_features_t features;
+  features.sse42 = false;
+  features.pclmul = false;
+  features.avx2 = false;
+
+#if defined(US3_CPU_X86)
+  unsigned int regs[4];
+  if (cpuid(1, regs)) {
+    const unsigned int ecx = regs[2];
+    features.sse42 = (ecx & (1U << 20)) != 0U;
+    features.pclmul = ((ecx & (1U << 1)) != 0U) && ((ecx & (1U << 19)) != 0U);
+
+    // AVX2 requires that the OS saves the XMM and YMM registers (OSXSAVE + XCR0 bits 1 & 2).
+    const bool has_osxsave = (ecx & (1U << 27)) != 0U;
+    if (has_osxsave && (xgetbv0() & 6U) == 6U && cpuid(7, regs)) {
+      features.avx2 = (regs[1] & (1U << 5)) != 0U;
+    }
+  }
+#endif
+
+  return features;
+}
+
+}  // namespace
+
+const cpu_features_t& cpu_features() {
+  static const cpu_features_t s_features = detect_cpu_features();
+  return s_features;
+}
+
+}  // namespace us3
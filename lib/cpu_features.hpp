@@ -0,0 +1,38 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_CPU_FEATURES_HPP_
+#define US3_CPU_FEATURES_HPP_
+
+namespace us3 {
+
+/// @brief Instruction set extensions that are available on the host CPU.
+struct cpu_features_t {
+  bool sse42;   ///< SSE 4.2 (including the CRC32 instruction).
+  bool pclmul;  ///< Carry-less multiplication (PCLMULQDQ) and SSE 4.1.
+  bool avx2;    ///< AVX2, with OS support for saving the YMM registers.
+};
+
+/// @brief Get the features of the host CPU.
+/// @note The features are only detected on x86 CPUs. On other CPUs all features are false.
+const cpu_features_t& cpu_features();
+
+}  // namespace us3
+
+#endif  // US3_CPU_FEATURES_HPP_
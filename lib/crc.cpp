@@ -0,0 +1,475 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "crc.hpp"
+
+#include "base64.hpp"
+#include "cpu_features.hpp"
+#include <cstring>
+
+// Select hardware accelerated implementations.
+#if defined(__x86_64__) || defined(_M_X64)
+#  define US3_CRC_X86 1
+#  if defined(_MSC_VER)
+#    define US3_TARGET(x)
+#  else
+#    define US3_TARGET(x) __attribute__((target(x)))
+#  endif
+#  include <nmmintrin.h>
+#  include <wmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#  define US3_CRC_ARM 1
+#  include <arm_acle.h>
+#endif
+
+namespace us3 {
+
+namespace {
+
+// The CRC32C polynomial 0x1EDC6F41, bit reversed.
+const uint32_t CRC32C_POLY = 0x82F63B78U;
+
+// The CRC64NVME polynomial 0xAD93D23594C935A9, bit reversed.
+const uint64_t CRC64NVME_POLY = (static_cast<uint64_t>(0x9A6C9329U) << 32) | 0xAC4BC9B5U;
+
+typedef uint32_t (*crc32c_fun_t)(uint32_t, const unsigned char*, size_t);
+typedef uint64_t (*crc64nvme_fun_t)(uint64_t, const unsigned char*, size_t);
+
+uint64_t load_uint64_le(const unsigned char* ptr) {
+  uint64_t x = 0;
+  for (int i = 7; i >= 0; --i) {
+    x = (x << 8) | static_cast<uint64_t>(ptr[i]);
+  }
+  return x;
+}
+
+uint32_t load_uint32_le(const unsigned char* ptr) {
+  return static_cast<uint32_t>(ptr[0]) | (static_cast<uint32_t>(ptr[1]) << 8) |
+         (static_cast<uint32_t>(ptr[2]) << 16) | (static_cast<uint32_t>(ptr[3]) << 24);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Portable slicing-by-8 implementations.
+//--------------------------------------------------------------------------------------------------
+
+struct crc_tables_t {
+  crc_tables_t() {
+    for (uint32_t i = 0; i < 256U; ++i) {
+      uint32_t c32 = i;
+      uint64_t c64 = i;
+      for (int k = 0; k < 8; ++k) {
+        c32 = ((c32 & 1U) != 0U) ? ((c32 >> 1) ^ CRC32C_POLY) : (c32 >> 1);
+        c64 = ((c64 & 1U) != 0U) ? ((c64 >> 1) ^ CRC64NVME_POLY) : (c64 >> 1);
+      }
+      crc32c[0][i] = c32;
+      crc64nvme[0][i] = c64;
+    }
+    for (int t = 1; t < 8; ++t) {
+      for (int i = 0; i < 256; ++i) {
+        const uint32_t c32 = crc32c[t - 1][i];
+        const uint64_t c64 = crc64nvme[t - 1][i];
+        crc32c[t][i] = (c32 >> 8) ^ crc32c[0][c32 & 0xFFU];
+        crc64nvme[t][i] = (c64 >> 8) ^ crc64nvme[0][c64 & 0xFFU];
+      }
+    }
+  }
+
+  uint32_t crc32c[8][256];
+  uint64_t crc64nvme[8][256];
+};
+
+const crc_tables_t& tables() {
+  static const crc_tables_t s_tables;
+  return s_tables;
+}
+
+// Note: The CRC register is passed and returned without pre/post inversion.
+uint32_t crc32c_raw_sw(uint32_t crc, const unsigned char* data, size_t size) {
+  const uint32_t(&t)[8][256] = tables().crc32c;
+  while (size >= 8U) {
+    const uint32_t lo = crc ^ load_uint32_le(data);
+    const uint32_t hi = load_uint32_le(data + 4);
+    crc = t[7][lo & 0xFFU] ^ t[6][(lo >> 8) & 0xFFU] ^ t[5][(lo >> 16) & 0xFFU] ^ t[4][lo >> 24] ^
+          t[3][hi & 0xFFU] ^ t[2][(hi >> 8) & 0xFFU] ^ t[1][(hi >> 16) & 0xFFU] ^ t[0][hi >> 24];
+    data += 8;
+    size -= 8U;
+  }
+  for (; size > 0U; --size) {
+    crc = t[0][(crc ^ *data++) & 0xFFU] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+uint64_t crc64nvme_raw_sw(uint64_t crc, const unsigned char* data, size_t size) {
+  const uint64_t(&t)[8][256] = tables().crc64nvme;
+  while (size >= 8U) {
+    const uint64_t x = crc ^ load_uint64_le(data);
+    crc = t[7][x & 0xFFU] ^ t[6][(x >> 8) & 0xFFU] ^ t[5][(x >> 16) & 0xFFU] ^
+          t[4][(x >> 24) & 0xFFU] ^ t[3][(x >> 32) & 0xFFU] ^ t[2][(x >> 40) & 0xFFU] ^
+          t[1][(x >> 48) & 0xFFU] ^ t[0][x >> 56];
+    data += 8;
+    size -= 8U;
+  }
+  for (; size > 0U; --size) {
+    crc = t[0][(crc ^ *data++) & 0xFFU] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+uint32_t crc32c_sw(const uint32_t crc, const unsigned char* data, const size_t size) {
+  return ~crc32c_raw_sw(~crc, data, size);
+}
+
+uint64_t crc64nvme_sw(const uint64_t crc, const unsigned char* data, const size_t size) {
+  return ~crc64nvme_raw_sw(~crc, data, size);
+}
+
+//--------------------------------------------------------------------------------------------------
+// x86 implementations (SSE4.2 CRC32 and PCLMULQDQ).
+//--------------------------------------------------------------------------------------------------
+
+#if defined(US3_CRC_X86)
+
+US3_TARGET("sse4.2")
+uint32_t crc32c_sse42(const uint32_t crc, const unsigned char* data, size_t size) {
+  uint64_t c = static_cast<uint32_t>(~crc);
+  for (; size >= 8U; size -= 8U, data += 8) {
+    uint64_t x;
+    std::memcpy(&x, data, sizeof(x));
+    c = _mm_crc32_u64(c, x);
+  }
+  uint32_t c32 = static_cast<uint32_t>(c);
+  for (; size > 0U; --size) {
+    c32 = _mm_crc32_u8(c32, *data++);
+  }
+  return ~c32;
+}
+
+// Folding constants for the reflected CRC64NVME polynomial, i.e. x^n mod P (bit reversed).
+// See "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Intel, 2009).
+struct crc64_fold_constants_t {
+  crc64_fold_constants_t() {
+    // Calculate x^n mod P for all the n that we need.
+    uint64_t x_pow_n = static_cast<uint64_t>(1U) << 63;  // x^0
+    for (int n = 0; n <= 575; ++n) {
+      if (n == 127) {
+        fold_128_hi = x_pow_n;
+      } else if (n == 191) {
+        fold_128_lo = x_pow_n;
+      } else if (n == 511) {
+        fold_512_hi = x_pow_n;
+      } else if (n == 575) {
+        fold_512_lo = x_pow_n;
+      }
+      x_pow_n = ((x_pow_n & 1U) != 0U) ? ((x_pow_n >> 1) ^ CRC64NVME_POLY) : (x_pow_n >> 1);
+    }
+  }
+
+  uint64_t fold_128_lo;
+  uint64_t fold_128_hi;
+  uint64_t fold_512_lo;
+  uint64_t fold_512_hi;
+};
+
+const crc64_fold_constants_t& crc64_fold_constants() {
+  static const crc64_fold_constants_t s_constants;
+  return s_constants;
+}
+
+US3_TARGET("pclmul,sse4.1")
+__m128i fold(const __m128i x, const __m128i k) {
+  return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+US3_TARGET("pclmul,sse4.1")
+uint64_t crc64nvme_pclmul(const uint64_t crc, const unsigned char* data, size_t size) {
+  // Fall back to the table driven implementation for short messages.
+  if (size < 64U) {
+    return crc64nvme_sw(crc, data, size);
+  }
+
+  const crc64_fold_constants_t& c = crc64_fold_constants();
+  const __m128i k_512 = _mm_set_epi64x(static_cast<int64_t>(c.fold_512_hi),
+                                       static_cast<int64_t>(c.fold_512_lo));
+  const __m128i k_128 = _mm_set_epi64x(static_cast<int64_t>(c.fold_128_hi),
+                                       static_cast<int64_t>(c.fold_128_lo));
+  const __m128i* src = reinterpret_cast<const __m128i*>(data);
+
+  // Load the first 64 bytes into four accumulators, and add the initial CRC register value.
+  __m128i x0 = _mm_xor_si128(_mm_loadu_si128(src),
+                             _mm_set_epi64x(0, static_cast<int64_t>(~crc)));
+  __m128i x1 = _mm_loadu_si128(src + 1);
+  __m128i x2 = _mm_loadu_si128(src + 2);
+  __m128i x3 = _mm_loadu_si128(src + 3);
+  src += 4;
+  size -= 64U;
+
+  // Fold 64 bytes at a time (four independent dependency chains).
+  for (; size >= 64U; size -= 64U, src += 4) {
+    x0 = _mm_xor_si128(fold(x0, k_512), _mm_loadu_si128(src));
+    x1 = _mm_xor_si128(fold(x1, k_512), _mm_loadu_si128(src + 1));
+    x2 = _mm_xor_si128(fold(x2, k_512), _mm_loadu_si128(src + 2));
+    x3 = _mm_xor_si128(fold(x3, k_512), _mm_loadu_si128(src + 3));
+  }
+
+  // Fold the four accumulators into one.
+  x1 = _mm_xor_si128(fold(x0, k_128), x1);
+  x2 = _mm_xor_si128(fold(x1, k_128), x2);
+  x3 = _mm_xor_si128(fold(x2, k_128), x3);
+
+  // Fold 16 bytes at a time.
+  for (; size >= 16U; size -= 16U, ++src) {
+    x3 = _mm_xor_si128(fold(x3, k_128), _mm_loadu_si128(src));
+  }
+
+  // The remaining 128 bits are congruent with the message so far, so we can reduce them (and the
+  // tail) with the table driven implementation, starting with a zero CRC register.
+  unsigned char folded[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&folded[0]), x3);
+  uint64_t result = crc64nvme_raw_sw(0, &folded[0], sizeof(folded));
+  result = crc64nvme_raw_sw(result, reinterpret_cast<const unsigned char*>(src), size);
+  return ~result;
+}
+
+crc32c_fun_t select_crc32c() {
+  if (cpu_features().sse42) {
+    return crc32c_sse42;
+  }
+  return crc32c_sw;
+}
+
+crc64nvme_fun_t select_crc64nvme() {
+  if (cpu_features().pclmul) {
+    (void)crc64_fold_constants();
+    return crc64nvme_pclmul;
+  }
+  return crc64nvme_sw;
+}
+
+//--------------------------------------------------------------------------------------------------
+// ARMv8 implementations (CRC32 extension).
+//--------------------------------------------------------------------------------------------------
+
+#elif defined(US3_CRC_ARM)
+
+uint32_t crc32c_armv8(const uint32_t crc, const unsigned char* data, size_t size) {
+  uint32_t c = ~crc;
+  for (; size >= 8U; size -= 8U, data += 8) {
+    uint64_t x;
+    std::memcpy(&x, data, sizeof(x));
+    c = __crc32cd(c, x);
+  }
+  for (; size > 0U; --size) {
+    c = __crc32cb(c, *data++);
+  }
+  return ~c;
+}
+
+crc32c_fun_t select_crc32c() {
+  return crc32c_armv8;
+}
+
+crc64nvme_fun_t select_crc64nvme() {
+  return crc64nvme_sw;
+}
+
+#else
+
+crc32c_fun_t select_crc32c() {
+  return crc32c_sw;
+}
+
+crc64nvme_fun_t select_crc64nvme() {
+  return crc64nvme_sw;
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// CRC combination.
+//
+// The CRC of A followed by B is CRC(A) * x^(8 * len(B)) + CRC(B) (mod P), which also holds for the
+// pre/post inverted CRC values. The power of x is assembled from a table of x^(2^k) mod P, so the
+// work is logarithmic in the length of B.
+//--------------------------------------------------------------------------------------------------
+
+template <typename T>
+struct crc_poly_t {
+  // In the bit reversed representation the top bit is x^0.
+  static T one() {
+    return static_cast<T>(static_cast<T>(1U) << (8U * sizeof(T) - 1U));
+  }
+
+  // Calculate a * b mod P (a must be non-zero, which holds for all powers of x).
+  static T multiply(T a, T b, const T poly) {
+    T m = one();
+    T p = 0;
+    while (true) {
+      if ((a & m) != 0U) {
+        p ^= b;
+        if ((a & static_cast<T>(m - 1U)) == 0U) {
+          break;
+        }
+      }
+      m >>= 1;
+      b = ((b & 1U) != 0U) ? static_cast<T>((b >> 1) ^ poly) : static_cast<T>(b >> 1);
+    }
+    return p;
+  }
+};
+
+// x^(2^k) mod P, for k = 0..X2N_TABLE_SIZE-1 (enough for any 64-bit bit count).
+const int X2N_TABLE_SIZE = 67;
+
+struct x2n_tables_t {
+  x2n_tables_t() {
+    uint32_t p32 = crc_poly_t<uint32_t>::one() >> 1;  // x^1
+    uint64_t p64 = crc_poly_t<uint64_t>::one() >> 1;  // x^1
+    for (int k = 0; k < X2N_TABLE_SIZE; ++k) {
+      crc32c[k] = p32;
+      crc64nvme[k] = p64;
+      p32 = crc_poly_t<uint32_t>::multiply(p32, p32, CRC32C_POLY);
+      p64 = crc_poly_t<uint64_t>::multiply(p64, p64, CRC64NVME_POLY);
+    }
+  }
+
+  uint32_t crc32c[X2N_TABLE_SIZE];
+  uint64_t crc64nvme[X2N_TABLE_SIZE];
+};
+
+const x2n_tables_t& x2n_tables() {
+  static const x2n_tables_t s_x2n_tables;
+  return s_x2n_tables;
+}
+
+// Calculate x^(8 * size) mod P.
+template <typename T>
+T x8nmodp(uint64_t size, const T (&x2n_table)[X2N_TABLE_SIZE], const T poly) {
+  T p = crc_poly_t<T>::one();
+  for (int k = 3; size != 0U; size >>= 1, ++k) {
+    if ((size & 1U) != 0U) {
+      p = crc_poly_t<T>::multiply(x2n_table[k], p, poly);
+    }
+  }
+  return p;
+}
+
+// The implementations are selected once, during static initialization. We also initialize the
+// lookup tables at this point, so that they are ready before any threads start using them.
+const crc32c_fun_t s_crc32c = select_crc32c();
+const crc64nvme_fun_t s_crc64nvme = select_crc64nvme();
+const crc_tables_t& s_tables = tables();
+const x2n_tables_t& s_x2n_tables = x2n_tables();
+
+}  // namespace
+
+uint32_t crc32c(const uint32_t crc, const void* data, const size_t size) {
+  return s_crc32c(crc, reinterpret_cast<const unsigned char*>(data), size);
+}
+
+uint64_t crc64nvme(const uint64_t crc, const void* data, const size_t size) {
+  return s_crc64nvme(crc, reinterpret_cast<const unsigned char*>(data), size);
+}
+
+uint32_t crc32c_combine(const uint32_t crc1, const uint32_t crc2, const uint64_t size2) {
+  const uint32_t x8n = x8nmodp(size2, x2n_tables().crc32c, CRC32C_POLY);
+  return crc_poly_t<uint32_t>::multiply(x8n, crc1, CRC32C_POLY) ^ crc2;
+}
+
+uint64_t crc64nvme_combine(const uint64_t crc1, const uint64_t crc2, const uint64_t size2) {
+  const uint64_t x8n = x8nmodp(size2, x2n_tables().crc64nvme, CRC64NVME_POLY);
+  return crc_poly_t<uint64_t>::multiply(x8n, crc1, CRC64NVME_POLY) ^ crc2;
+}
+
+const char* checksum_t::header_name() const {
+  switch (m_algorithm) {
+    case CRC32C:
+      return "x-amz-checksum-crc32c";
+    case CRC64NVME:
+      return "x-amz-checksum-crc64nvme";
+    case NONE:
+    default:
+      return NULL;
+  }
+}
+
+void checksum_t::to_base64(char (&base64)[MAX_BASE64_SIZE + 1]) const {
+  // The checksum is encoded as a big endian number (4 bytes for CRC32C, 8 bytes for CRC64NVME).
+  const size_t size = (m_algorithm == CRC64NVME) ? 8U : 4U;
+  unsigned char raw[8];
+  for (size_t i = 0; i < size; ++i) {
+    raw[i] = static_cast<unsigned char>(m_value >> (8U * (size - 1U - i)));
+  }
+  base64_encode(&raw[0], size, &base64[0]);
+}
+
+bool composite_checksum_t::add_part(const uint64_t offset,
+                                    const uint64_t size,
+                                    const checksum_t& checksum) {
+  // Find the neighbouring ranges and check for overlaps.
+  part_map_t::iterator next = m_parts.lower_bound(offset);
+  if (next != m_parts.end() && next->first < offset + size) {
+    return false;
+  }
+  part_map_t::iterator prev = next;
+  const bool has_prev = (prev != m_parts.begin());
+  if (has_prev) {
+    --prev;
+    if (prev->first + prev->second.size > offset) {
+      return false;
+    }
+  }
+
+  // Append to the preceding range, or insert a new range.
+  part_map_t::iterator part;
+  if (has_prev && prev->first + prev->second.size == offset) {
+    part = prev;
+    part->second.checksum.combine(checksum, size);
+    part->second.size += size;
+  } else {
+    part_t new_part;
+    new_part.size = size;
+    new_part.checksum = checksum;
+    part = m_parts.insert(next, std::make_pair(offset, new_part));
+  }
+
+  // Merge with the following range.
+  if (next != m_parts.end() && part->first + part->second.size == next->first) {
+    part->second.checksum.combine(next->second.checksum, next->second.size);
+    part->second.size += next->second.size;
+    m_parts.erase(next);
+  }
+
+  return true;
+}
+
+uint64_t composite_checksum_t::covered_size() const {
+  part_map_t::const_iterator first = m_parts.begin();
+  return (first != m_parts.end() && first->first == 0U) ? first->second.size : 0U;
+}
+
+checksum_t composite_checksum_t::checksum() const {
+  part_map_t::const_iterator first = m_parts.begin();
+  if (first != m_parts.end() && first->first == 0U) {
+    return first->second.checksum;
+  }
+  return checksum_t(m_algorithm);
+}
+
+}  // namespace us3
@@ -0,0 +1,162 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_CRC_HPP_
+#define US3_CRC_HPP_
+
+#include <cstddef>
+#include <map>
+#include <stdint.h>
+
+namespace us3 {
+
+/// @brief Update a CRC32C (Castagnoli) checksum.
+/// @param crc The checksum of the preceding data (0 for the first call).
+/// @param data The data to checksum.
+/// @param size The number of bytes to checksum.
+/// @returns the updated checksum.
+/// @note SSE4.2 or ARMv8 CRC instructions are used when available.
+uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+
+/// @brief Update a CRC64NVME checksum.
+/// @param crc The checksum of the preceding data (0 for the first call).
+/// @param data The data to checksum.
+/// @param size The number of bytes to checksum.
+/// @returns the updated checksum.
+/// @note PCLMULQDQ folding is used when available.
+uint64_t crc64nvme(uint64_t crc, const void* data, size_t size);
+
+/// @brief Combine two CRC32C checksums.
+/// @param crc1 The checksum of the first block of data.
+/// @param crc2 The checksum of the second block of data.
+/// @param size2 The size of the second block of data, in bytes.
+/// @returns the checksum of the two blocks concatenated.
+/// @note The complexity is O(log(size2)), independent of the amount of data.
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t size2);
+
+/// @brief Combine two CRC64NVME checksums.
+/// @param crc1 The checksum of the first block of data.
+/// @param crc2 The checksum of the second block of data.
+/// @param size2 The size of the second block of data, in bytes.
+/// @returns the checksum of the two blocks concatenated.
+/// @note The complexity is O(log(size2)), independent of the amount of data.
+uint64_t crc64nvme_combine(uint64_t crc1, uint64_t crc2, uint64_t size2);
+
+/// @brief A streaming checksum calculator, as used for S3 additional checksums.
+class checksum_t {
+public:
+  /// @brief Checksum algorithm.
+  enum algorithm_t {
+    NONE = 0,      ///< No checksum.
+    CRC32C = 1,    ///< CRC32C (x-amz-checksum-crc32c).
+    CRC64NVME = 2  ///< CRC64NVME (x-amz-checksum-crc64nvme).
+  };
+
+  // The maximum size of a base64 encoded checksum (excluding the zero termination).
+  static const size_t MAX_BASE64_SIZE = 12;
+
+  explicit checksum_t(const algorithm_t algorithm = NONE, const uint64_t value = 0)
+      : m_algorithm(algorithm), m_value(value) {
+  }
+
+  /// @brief Add data to the checksum.
+  void update(const void* data, const size_t size) {
+    if (m_algorithm == CRC32C) {
+      m_value = crc32c(static_cast<uint32_t>(m_value), data, size);
+    } else if (m_algorithm == CRC64NVME) {
+      m_value = crc64nvme(m_value, data, size);
+    }
+  }
+
+  /// @brief Append the checksum of a following block of data (without touching the data).
+  /// @param next The checksum of the following block (must use the same algorithm).
+  /// @param next_size The size of the following block, in bytes.
+  void combine(const checksum_t& next, const uint64_t next_size) {
+    if (m_algorithm == CRC32C) {
+      m_value = crc32c_combine(static_cast<uint32_t>(m_value),
+                               static_cast<uint32_t>(next.m_value),
+                               next_size);
+    } else if (m_algorithm == CRC64NVME) {
+      m_value = crc64nvme_combine(m_value, next.m_value, next_size);
+    }
+  }
+
+  /// @brief Get the checksum algorithm.
+  algorithm_t algorithm() const {
+    return m_algorithm;
+  }
+
+  /// @brief Get the checksum value.
+  uint64_t value() const {
+    return m_value;
+  }
+
+  /// @brief Get the name of the HTTP header that carries the checksum (e.g.
+  /// "x-amz-checksum-crc32c"), or NULL if there is no checksum.
+  const char* header_name() const;
+
+  /// @brief Get the checksum as a base64 encoded big endian number (as used in HTTP headers).
+  /// @param[out] base64 The zero terminated base64 encoded checksum.
+  void to_base64(char (&base64)[MAX_BASE64_SIZE + 1]) const;
+
+private:
+  algorithm_t m_algorithm;
+  uint64_t m_value;
+};
+
+/// @brief A full object checksum that is assembled from the checksums of its parts.
+///
+/// Parts (e.g. from a parallel multipart transfer) may be added in any order. Adjacent parts are
+/// merged as soon as possible, so the memory usage is proportional to the number of gaps, not to
+/// the number of parts.
+class composite_checksum_t {
+public:
+  explicit composite_checksum_t(const checksum_t::algorithm_t algorithm = checksum_t::NONE)
+      : m_algorithm(algorithm) {
+  }
+
+  /// @brief Add the checksum of a part.
+  /// @param offset The offset of the part within the object, in bytes.
+  /// @param size The size of the part, in bytes.
+  /// @param checksum The checksum of the part.
+  /// @returns false if the part overlaps a previously added part (the part is then ignored).
+  bool add_part(uint64_t offset, uint64_t size, const checksum_t& checksum);
+
+  /// @brief Get the size of the contiguous range, starting at offset zero, that is covered by the
+  /// parts that have been added so far.
+  uint64_t covered_size() const;
+
+  /// @brief Get the checksum of the contiguous range that starts at offset zero.
+  /// @note This is the full object checksum when covered_size() equals the object size.
+  checksum_t checksum() const;
+
+private:
+  struct part_t {
+    uint64_t size;
+    checksum_t checksum;
+  };
+  typedef std::map<uint64_t, part_t> part_map_t;
+
+  checksum_t::algorithm_t m_algorithm;
+  part_map_t m_parts;  // Non-adjacent ranges, keyed by offset.
+};
+
+}  // namespace us3
+
+#endif  // US3_CRC_HPP_
@@ -0,0 +1,201 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "crc.hpp"
+
+#include <algorithm>
+#include <doctest.h>
+#include <string>
+#include <vector>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+// Bit-by-bit reference implementations.
+uint32_t crc32c_ref(const unsigned char* data, const size_t size) {
+  uint32_t crc = 0xFFFFFFFFU;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; ++k) {
+      crc = ((crc & 1U) != 0U) ? ((crc >> 1) ^ 0x82F63B78U) : (crc >> 1);
+    }
+  }
+  return ~crc;
+}
+
+uint64_t crc64nvme_ref(const unsigned char* data, const size_t size) {
+  const uint64_t poly = (static_cast<uint64_t>(0x9A6C9329U) << 32) | 0xAC4BC9B5U;
+  uint64_t crc = ~static_cast<uint64_t>(0);
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; ++k) {
+      crc = ((crc & 1U) != 0U) ? ((crc >> 1) ^ poly) : (crc >> 1);
+    }
+  }
+  return ~crc;
+}
+
+std::vector<unsigned char> make_data(const size_t size) {
+  std::vector<unsigned char> data(size + 1);
+  uint32_t x = 12345;
+  for (size_t i = 0; i < data.size(); ++i) {
+    x = x * 1103515245U + 12345U;
+    data[i] = static_cast<unsigned char>(x >> 16);
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST_CASE("CRC check values") {
+  const char* data = "123456789";
+
+  CHECK_EQ(us3::crc32c(0, data, 9), 0xE3069283U);
+  CHECK_EQ(us3::crc64nvme(0, data, 9),
+           (static_cast<uint64_t>(0xAE8B1486U) << 32) | 0x0A799888U);
+}
+
+TEST_CASE("CRC matches the reference implementation") {
+  // Test various sizes and alignments, so that all code paths of the optimized implementations are
+  // exercised.
+  const std::vector<unsigned char> data = make_data(5000);
+  for (size_t offset = 0; offset < 2; ++offset) {
+    for (size_t size = 0; size < 5000; size = (size < 300) ? size + 1 : size * 3 / 2) {
+      CHECK_EQ(us3::crc32c(0, &data[offset], size), crc32c_ref(&data[offset], size));
+      CHECK_EQ(us3::crc64nvme(0, &data[offset], size), crc64nvme_ref(&data[offset], size));
+    }
+  }
+}
+
+TEST_CASE("CRC can be calculated incrementally") {
+  // GIVEN
+  const std::vector<unsigned char> data = make_data(1000);
+
+  // WHEN
+  uint32_t crc32 = 0;
+  uint64_t crc64 = 0;
+  for (size_t pos = 0; pos < 1000; pos += 77) {
+    const size_t size = (1000 - pos) < 77 ? (1000 - pos) : 77;
+    crc32 = us3::crc32c(crc32, &data[pos], size);
+    crc64 = us3::crc64nvme(crc64, &data[pos], size);
+  }
+
+  // THEN
+  CHECK_EQ(crc32, crc32c_ref(&data[0], 1000));
+  CHECK_EQ(crc64, crc64nvme_ref(&data[0], 1000));
+}
+
+TEST_CASE("Checksum base64 encoding") {
+  SUBCASE("CRC32C") {
+    // GIVEN
+    us3::checksum_t checksum(us3::checksum_t::CRC32C);
+
+    // WHEN
+    checksum.update("123456789", 9);
+    char base64[us3::checksum_t::MAX_BASE64_SIZE + 1];
+    checksum.to_base64(base64);
+
+    // THEN
+    CHECK_EQ(std::string(checksum.header_name()), "x-amz-checksum-crc32c");
+    CHECK_EQ(std::string(&base64[0]), "4waSgw==");
+  }
+
+  SUBCASE("CRC64NVME") {
+    // GIVEN
+    us3::checksum_t checksum(us3::checksum_t::CRC64NVME);
+
+    // WHEN
+    checksum.update("123456789", 9);
+    char base64[us3::checksum_t::MAX_BASE64_SIZE + 1];
+    checksum.to_base64(base64);
+
+    // THEN
+    CHECK_EQ(std::string(checksum.header_name()), "x-amz-checksum-crc64nvme");
+    CHECK_EQ(std::string(&base64[0]), "rosUhgp5mIg=");
+  }
+}
+
+TEST_CASE("CRC combine") {
+  // GIVEN
+  const std::vector<unsigned char> data = make_data(3000);
+
+  for (size_t split = 0; split <= 3000; split = (split < 20) ? split + 1 : split * 2) {
+    // WHEN
+    const uint32_t crc32 = us3::crc32c_combine(
+        us3::crc32c(0, &data[0], split), us3::crc32c(0, &data[split], 3000 - split), 3000 - split);
+    const uint64_t crc64 = us3::crc64nvme_combine(us3::crc64nvme(0, &data[0], split),
+                                                  us3::crc64nvme(0, &data[split], 3000 - split),
+                                                  3000 - split);
+
+    // THEN
+    CHECK_EQ(crc32, crc32c_ref(&data[0], 3000));
+    CHECK_EQ(crc64, crc64nvme_ref(&data[0], 3000));
+  }
+}
+
+TEST_CASE("CRC combine with huge sizes") {
+  // Combining is associative, so splitting a huge (virtual) block in two must not change the
+  // result. This exercises the high x^(2^k) table entries.
+  const uint64_t size = static_cast<uint64_t>(1U) << 40;
+  const uint32_t crc32_a = us3::crc32c_combine(0, 0, size);
+  const uint32_t crc32_b = us3::crc32c_combine(us3::crc32c_combine(0, 0, size / 2), 0, size / 2);
+  CHECK_EQ(crc32_a, crc32_b);
+  const uint64_t crc64_a = us3::crc64nvme_combine(1, 2, size + 3);
+  const uint64_t crc64_b = us3::crc64nvme_combine(us3::crc64nvme_combine(1, 0, size), 2, 3);
+  CHECK_EQ(crc64_a, crc64_b);
+}
+
+TEST_CASE("Composite checksum") {
+  // GIVEN
+  const std::vector<unsigned char> data = make_data(1000);
+  const size_t part_size = 150;
+  us3::checksum_t expected(us3::checksum_t::CRC64NVME);
+  expected.update(&data[0], 1000);
+
+  // Parts in a scrambled order.
+  const size_t order[] = {3, 0, 6, 5, 1, 4, 2};
+  us3::composite_checksum_t composite(us3::checksum_t::CRC64NVME);
+  for (size_t i = 0; i < 7; ++i) {
+    const size_t offset = order[i] * part_size;
+    const size_t size = std::min(part_size, 1000 - offset);
+    us3::checksum_t part(us3::checksum_t::CRC64NVME);
+    part.update(&data[offset], size);
+
+    // WHEN
+    CHECK(composite.add_part(offset, size, part));
+
+    // THEN
+    if (i < 6) {
+      CHECK(composite.covered_size() < 1000U);
+    }
+  }
+  CHECK_EQ(composite.covered_size(), 1000U);
+  CHECK_EQ(composite.checksum().value(), expected.value());
+
+  SUBCASE("Overlapping parts are rejected") {
+    us3::checksum_t part(us3::checksum_t::CRC64NVME);
+    CHECK_FALSE(composite.add_part(100, 10, part));
+    CHECK_FALSE(composite.add_part(999, 10, part));
+    CHECK(composite.add_part(1000, 0, part));
+    CHECK_EQ(composite.checksum().value(), expected.value());
+  }
+}
@@ -0,0 +1,73 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_FIXED_POOL_HPP_
+#define US3_FIXED_POOL_HPP_
+
+#include "platform.hpp"
+#include <cstddef>
+
+namespace us3 {
+
+/// @brief A thread safe pool of a fixed number of objects.
+///
+/// The objects are statically allocated, which lets builds that must not use the heap put a
+/// compile-time cap on the number of live objects (e.g. sockets) instead.
+template <typename T, size_t N>
+class fixed_pool_t {
+public:
+  fixed_pool_t() : m_free_count(N) {
+    for (size_t i = 0; i < N; ++i) {
+      m_free[i] = &m_objects[i];
+    }
+  }
+
+  /// @brief Take an object from the pool.
+  /// @returns a value initialized object, or NULL if all objects are in use.
+  T* allocate() {
+    lock_guard_t lock(m_mutex);
+    if (m_free_count == 0) {
+      return NULL;
+    }
+    T* object = m_free[--m_free_count];
+    *object = T();
+    return object;
+  }
+
+  /// @brief Return an object to the pool.
+  /// @param object An object that was taken from the pool with allocate().
+  void release(T* object) {
+    lock_guard_t lock(m_mutex);
+    m_free[m_free_count++] = object;
+  }
+
+private:
+  // Not copyable.
+  fixed_pool_t(const fixed_pool_t&);
+  fixed_pool_t& operator=(const fixed_pool_t&);
+
+  mutex_t m_mutex;
+  T m_objects[N];
+  T* m_free[N];
+  size_t m_free_count;
+};
+
+}  // namespace us3
+
+#endif  // US3_FIXED_POOL_HPP_
@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "hedging.hpp"
+
+#include <algorithm>
+
+namespace us3 {
+
+latency_tracker_t::latency_tracker_t() : m_count(0), m_next(0) {
+}
+
+void latency_tracker_t::add_sample(const int64_t latency) {
+  lock_guard_t lock(m_mutex);
+  m_samples[m_next] = latency;
+  m_next = (m_next + 1) % MAX_SAMPLES;
+  if (m_count < MAX_SAMPLES) {
+    ++m_count;
+  }
+}
+
+int64_t latency_tracker_t::percentile(const int percent) const {
+  int64_t samples[MAX_SAMPLES];
+  size_t count;
+  {
+    lock_guard_t lock(m_mutex);
+    count = m_count;
+    std::copy(&m_samples[0], &m_samples[count], &samples[0]);
+  }
+  if (count < MIN_SAMPLES) {
+    return 0;
+  }
+
+  // Nearest-rank percentile.
+  const size_t p = static_cast<size_t>(std::min(std::max(percent, 0), 100));
+  const size_t rank = std::max<size_t>((p * count + 99) / 100, 1);
+  std::nth_element(&samples[0], &samples[rank - 1], &samples[count]);
+  return samples[rank - 1];
+}
+
+namespace {
+
+mutex_t& stats_mutex() {
+  static mutex_t* s_mutex = new mutex_t();
+  return *s_mutex;
+}
+
+hedge_stats_t s_stats = {0, 0, 0};
+
+// Create the globals during static initialization (before any threads are started).
+const latency_tracker_t& s_latency_tracker = hedge_latency_tracker();
+const mutex_t& s_stats_mutex = stats_mutex();
+
+}  // namespace
+
+latency_tracker_t& hedge_latency_tracker() {
+  static latency_tracker_t* s_tracker = new latency_tracker_t();
+  return *s_tracker;
+}
+
+void count_hedged_request(const bool fired, const bool won) {
+  lock_guard_t lock(stats_mutex());
+  ++s_stats.requests;
+  if (fired) {
+    ++s_stats.fired;
+  }
+  if (won) {
+    ++s_stats.won;
+  }
+}
+
+hedge_stats_t get_hedge_stats() {
+  lock_guard_t lock(stats_mutex());
+  return s_stats;
+}
+
+}  // namespace us3
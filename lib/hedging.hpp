@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_HEDGING_HPP_
+#define US3_HEDGING_HPP_
+
+#include "platform.hpp"
+#include <cstddef>
+#include <stdint.h>
+
+namespace us3 {
+
+/// @brief Tracks recent response latencies, for estimating adaptive hedge delays.
+///
+/// The tracker keeps the most recent MAX_SAMPLES samples in a ring buffer. It is thread safe.
+class latency_tracker_t {
+public:
+  /// @brief The number of recent samples that are kept.
+  static const size_t MAX_SAMPLES = 256;
+
+  /// @brief The number of samples that are required before a percentile can be estimated.
+  static const size_t MIN_SAMPLES = 20;
+
+  latency_tracker_t();
+
+  /// @brief Add a latency sample.
+  /// @param latency The latency, in μs.
+  void add_sample(int64_t latency);
+
+  /// @brief Estimate a latency percentile.
+  /// @param percent The percentile (0-100).
+  /// @returns the latency (μs), or 0 if there are fewer than MIN_SAMPLES samples.
+  int64_t percentile(int percent) const;
+
+private:
+  // Not copyable.
+  latency_tracker_t(const latency_tracker_t&);
+  latency_tracker_t& operator=(const latency_tracker_t&);
+
+  mutable mutex_t m_mutex;
+  int64_t m_samples[MAX_SAMPLES];
+  size_t m_count;
+  size_t m_next;
+};
+
+/// @brief Hedged request counters.
+struct hedge_stats_t {
+  unsigned long requests;  ///< The number of requests that were eligible for hedging.
+  unsigned long fired;     ///< The number of requests for which a hedge request was sent.
+  unsigned long won;       ///< The number of hedge requests that responded first.
+};
+
+/// @brief Get the process wide latency tracker for hedged requests.
+latency_tracker_t& hedge_latency_tracker();
+
+/// @brief Count a request that was eligible for hedging.
+/// @param fired True if a hedge request was sent.
+/// @param won True if the hedge request responded first.
+void count_hedged_request(bool fired, bool won);
+
+/// @brief Get the process wide hedged request counters.
+hedge_stats_t get_hedge_stats();
+
+}  // namespace us3
+
+#endif  // US3_HEDGING_HPP_
@@ -0,0 +1,80 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "hedging.hpp"
+
+#include <doctest.h>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+TEST_CASE("Latency percentiles") {
+  // GIVEN
+  us3::latency_tracker_t tracker;
+
+  SUBCASE("Too few samples") {
+    for (int64_t i = 1; i < static_cast<int64_t>(us3::latency_tracker_t::MIN_SAMPLES); ++i) {
+      tracker.add_sample(i);
+    }
+    CHECK_EQ(tracker.percentile(95), 0);
+  }
+
+  SUBCASE("Nearest rank") {
+    // WHEN (the samples 1..100 in a scrambled order)
+    for (int64_t i = 0; i < 100; ++i) {
+      tracker.add_sample(((i * 37) % 100) + 1);
+    }
+
+    // THEN
+    CHECK_EQ(tracker.percentile(50), 50);
+    CHECK_EQ(tracker.percentile(95), 95);
+    CHECK_EQ(tracker.percentile(100), 100);
+    CHECK_EQ(tracker.percentile(0), 1);
+  }
+
+  SUBCASE("Only recent samples are used") {
+    // WHEN
+    for (size_t i = 0; i < us3::latency_tracker_t::MAX_SAMPLES; ++i) {
+      tracker.add_sample(1000000);
+    }
+    for (size_t i = 0; i < us3::latency_tracker_t::MAX_SAMPLES; ++i) {
+      tracker.add_sample(10);
+    }
+
+    // THEN
+    CHECK_EQ(tracker.percentile(95), 10);
+  }
+}
+
+TEST_CASE("Hedge counters") {
+  // GIVEN
+  const us3::hedge_stats_t before = us3::get_hedge_stats();
+
+  // WHEN
+  us3::count_hedged_request(false, false);
+  us3::count_hedged_request(true, false);
+  us3::count_hedged_request(true, true);
+
+  // THEN
+  const us3::hedge_stats_t after = us3::get_hedge_stats();
+  CHECK_EQ(after.requests - before.requests, 3U);
+  CHECK_EQ(after.fired - before.fired, 2U);
+  CHECK_EQ(after.won - before.won, 1U);
+}
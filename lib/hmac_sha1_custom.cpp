@@ -19,6 +19,7 @@
 
 #include "hmac_sha1.hpp"
 
+#include "allocator.hpp"
 #include <algorithm>
 #include <cstring>
 #include <stdint.h>
@@ -28,6 +29,9 @@ namespace us3 {
 
 namespace {
 
+// Message buffers are allocated with the allocation hooks (see us3_set_allocator()).
+typedef std::vector<unsigned char, std_allocator_t<unsigned char> > byte_vector_t;
+
 // Read a big endian 32-bit word from a byte array.
 uint32_t get_uint32_be(const unsigned char* ptr) {
   return (static_cast<uint32_t>(ptr[0]) << 24) | (static_cast<uint32_t>(ptr[1]) << 16) |
@@ -57,7 +61,7 @@ bool sha1(const unsigned char* msg, size_t msg_size, unsigned char (&hash)[20])
   const size_t MAX_EXTRA_BYTES = 129U;
 
   // Make a copy of the message into a new buffer.
-  std::vector<unsigned char> message(msg_size + MAX_EXTRA_BYTES);
+  byte_vector_t message(msg_size + MAX_EXTRA_BYTES);
   std::copy(msg, msg + msg_size, &message[0]);
 
   // Set the first bit after the message to 1.
@@ -199,7 +203,7 @@ result_t<hmac_sha1_t> hmac_sha1(const char* key, const char* data) {
   {
     // Concatenate inner_key_pad + data.
     const size_t data_len = std::strlen(data);
-    std::vector<unsigned char> msg(sizeof(inner_key_pad) + data_len);
+    byte_vector_t msg(sizeof(inner_key_pad) + data_len);
     std::memcpy(&msg[0], &inner_key_pad[0], sizeof(inner_key_pad));
     std::memcpy(&msg[sizeof(inner_key_pad)], &data[0], data_len);
 
@@ -213,7 +217,7 @@ result_t<hmac_sha1_t> hmac_sha1(const char* key, const char* data) {
   unsigned char outer_hash[20];
   {
     // Concatenate outer_key_pad + inner_hash.
-    std::vector<unsigned char> msg(sizeof(outer_key_pad) + sizeof(inner_hash));
+    byte_vector_t msg(sizeof(outer_key_pad) + sizeof(inner_hash));
     std::memcpy(&msg[0], &outer_key_pad[0], sizeof(outer_key_pad));
     std::memcpy(&msg[sizeof(outer_key_pad)], &inner_hash[0], sizeof(inner_hash));
 
@@ -0,0 +1,434 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "md5.hpp"
+
+#include "base64.hpp"
+#include "cpu_features.hpp"
+#include "sha256.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define US3_MD5_AVX2 1
+#  if defined(_MSC_VER)
+#    define US3_TARGET(x)
+#  else
+#    define US3_TARGET(x) __attribute__((target(x)))
+#  endif
+#  include <immintrin.h>
+#endif
+
+namespace us3 {
+
+namespace {
+
+// The sine derived constants, K[i] = floor(abs(sin(i + 1)) * 2^32).
+const uint32_t K[64] = {
+    0xd76aa478U, 0xe8c7b756U, 0x242070dbU, 0xc1bdceeeU, 0xf57c0fafU, 0x4787c62aU, 0xa8304613U,
+    0xfd469501U, 0x698098d8U, 0x8b44f7afU, 0xffff5bb1U, 0x895cd7beU, 0x6b901122U, 0xfd987193U,
+    0xa679438eU, 0x49b40821U, 0xf61e2562U, 0xc040b340U, 0x265e5a51U, 0xe9b6c7aaU, 0xd62f105dU,
+    0x02441453U, 0xd8a1e681U, 0xe7d3fbc8U, 0x21e1cde6U, 0xc33707d6U, 0xf4d50d87U, 0x455a14edU,
+    0xa9e3e905U, 0xfcefa3f8U, 0x676f02d9U, 0x8d2a4c8aU, 0xfffa3942U, 0x8771f681U, 0x6d9d6122U,
+    0xfde5380cU, 0xa4beea44U, 0x4bdecfa9U, 0xf6bb4b60U, 0xbebfbc70U, 0x289b7ec6U, 0xeaa127faU,
+    0xd4ef3085U, 0x04881d05U, 0xd9d4d039U, 0xe6db99e5U, 0x1fa27cf8U, 0xc4ac5665U, 0xf4292244U,
+    0x432aff97U, 0xab9423a7U, 0xfc93a039U, 0x655b59c3U, 0x8f0ccc92U, 0xffeff47dU, 0x85845dd1U,
+    0x6fa87e4fU, 0xfe2ce6e0U, 0xa3014314U, 0x4e0811a1U, 0xf7537e82U, 0xbd3af235U, 0x2ad7d2bbU,
+    0xeb86d391U};
+
+// Per-round shift amounts.
+const int S[64] = {7,  12, 17, 22, 7,  12, 17, 22, 7,  12, 17, 22, 7,  12, 17, 22,
+                   5,  9,  14, 20, 5,  9,  14, 20, 5,  9,  14, 20, 5,  9,  14, 20,
+                   4,  11, 16, 23, 4,  11, 16, 23, 4,  11, 16, 23, 4,  11, 16, 23,
+                   6,  10, 15, 21, 6,  10, 15, 21, 6,  10, 15, 21, 6,  10, 15, 21};
+
+// Message word index for each step.
+const int G[64] = {0, 1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+                   1, 6,  11, 0,  5,  10, 15, 4,  9,  14, 3,  8,  13, 2,  7,  12,
+                   5, 8,  11, 14, 1,  4,  7,  10, 13, 0,  3,  6,  9,  12, 15, 2,
+                   0, 7,  14, 5,  12, 3,  10, 1,  8,  15, 6,  13, 4,  11, 2,  9};
+
+const uint32_t INITIAL_STATE[4] = {0x67452301U, 0xefcdab89U, 0x98badcfeU, 0x10325476U};
+
+// Read a little endian 32-bit word from a byte array.
+uint32_t get_uint32_le(const unsigned char* ptr) {
+  return static_cast<uint32_t>(ptr[0]) | (static_cast<uint32_t>(ptr[1]) << 8) |
+         (static_cast<uint32_t>(ptr[2]) << 16) | (static_cast<uint32_t>(ptr[3]) << 24);
+}
+
+// Write a little endian 32-bit word to a byte array.
+void set_uint32_le(const uint32_t x, unsigned char* ptr) {
+  ptr[0] = static_cast<unsigned char>(x);
+  ptr[1] = static_cast<unsigned char>(x >> 8);
+  ptr[2] = static_cast<unsigned char>(x >> 16);
+  ptr[3] = static_cast<unsigned char>(x >> 24);
+}
+
+uint32_t rotl(const uint32_t x, const int n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+void step(uint32_t& a,
+          uint32_t& b,
+          uint32_t& c,
+          uint32_t& d,
+          const uint32_t f,
+          const uint32_t (&m)[16],
+          const int i) {
+  const uint32_t x = f + a + K[i] + m[G[i]];
+  a = d;
+  d = c;
+  c = b;
+  b += rotl(x, S[i]);
+}
+
+// Based on pseudocode from Wikipedia: https://en.wikipedia.org/wiki/MD5#Pseudocode
+void process_block(uint32_t (&state)[4], const unsigned char* block) {
+  uint32_t m[16];
+  for (int i = 0; i < 16; ++i) {
+    m[i] = get_uint32_le(&block[i * 4]);
+  }
+
+  uint32_t a = state[0];
+  uint32_t b = state[1];
+  uint32_t c = state[2];
+  uint32_t d = state[3];
+
+  // The four rounds only differ in the mixing function.
+  for (int i = 0; i < 16; ++i) {
+    step(a, b, c, d, d ^ (b & (c ^ d)), m, i);
+  }
+  for (int i = 16; i < 32; ++i) {
+    step(a, b, c, d, c ^ (d & (b ^ c)), m, i);
+  }
+  for (int i = 32; i < 48; ++i) {
+    step(a, b, c, d, b ^ c ^ d, m, i);
+  }
+  for (int i = 48; i < 64; ++i) {
+    step(a, b, c, d, c ^ (b | ~d), m, i);
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+}
+
+// Create the final one or two padded blocks of a message.
+// Returns the number of padded blocks (1 or 2).
+size_t make_final_blocks(const unsigned char* tail,
+                         const size_t tail_size,
+                         const uint64_t total_size,
+                         unsigned char (&blocks)[128]) {
+  // Append the 1-bit, pad with zeros and append the message size as a 64-bit little endian number.
+  const size_t num_blocks = (tail_size < 56U) ? 1U : 2U;
+  const size_t padded_size = num_blocks * 64U;
+  std::memcpy(&blocks[0], tail, tail_size);
+  blocks[tail_size] = 0x80U;
+  std::memset(&blocks[tail_size + 1], 0, padded_size - 8U - (tail_size + 1));
+  const uint64_t total_size_bits = total_size * 8U;
+  for (size_t i = 0; i < 8; ++i) {
+    blocks[padded_size - 8U + i] = static_cast<unsigned char>(total_size_bits >> (8U * i));
+  }
+  return num_blocks;
+}
+
+void state_to_digest(const uint32_t (&state)[4], unsigned char (&digest)[md5_t::MD5_RAW_SIZE]) {
+  for (int i = 0; i < 4; ++i) {
+    set_uint32_le(state[i], &digest[i * 4]);
+  }
+}
+
+#if defined(US3_MD5_AVX2)
+
+//--------------------------------------------------------------------------------------------------
+// Multi-buffer AVX2 implementation: eight independent MD5 streams, one per 32-bit lane.
+//--------------------------------------------------------------------------------------------------
+
+const size_t NUM_LANES = 8;
+
+US3_TARGET("avx2")
+inline void step_x8(__m256i& a,
+                    __m256i& b,
+                    __m256i& c,
+                    __m256i& d,
+                    const __m256i f,
+                    const __m256i (&w)[16],
+                    const int i) {
+  const __m256i k = _mm256_set1_epi32(static_cast<int>(K[i]));
+  const __m256i x = _mm256_add_epi32(_mm256_add_epi32(f, a), _mm256_add_epi32(k, w[G[i]]));
+  a = d;
+  d = c;
+  c = b;
+  const __m128i shift_left = _mm_cvtsi32_si128(S[i]);
+  const __m128i shift_right = _mm_cvtsi32_si128(32 - S[i]);
+  b = _mm256_add_epi32(
+      b, _mm256_or_si256(_mm256_sll_epi32(x, shift_left), _mm256_srl_epi32(x, shift_right)));
+}
+
+US3_TARGET("avx2")
+void process_blocks_x8(__m256i (&state)[4], const unsigned char* const (&blocks)[NUM_LANES]) {
+  // Load and transpose the message words, so that w[i] holds word i of all eight blocks.
+  __m256i w[16];
+  for (int half = 0; half < 2; ++half) {
+    __m256i r[NUM_LANES];
+    for (size_t lane = 0; lane < NUM_LANES; ++lane) {
+      r[lane] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blocks[lane] + half * 32));
+    }
+    const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+    const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+    __m256i* dst = &w[half * 8];
+    dst[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    dst[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    dst[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    dst[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    dst[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    dst[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    dst[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    dst[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+  }
+
+  __m256i a = state[0];
+  __m256i b = state[1];
+  __m256i c = state[2];
+  __m256i d = state[3];
+
+  // The four rounds only differ in the mixing function.
+  const __m256i ones = _mm256_set1_epi32(-1);
+  for (int i = 0; i < 16; ++i) {
+    step_x8(a, b, c, d, _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d))), w, i);
+  }
+  for (int i = 16; i < 32; ++i) {
+    step_x8(a, b, c, d, _mm256_xor_si256(c, _mm256_and_si256(d, _mm256_xor_si256(b, c))), w, i);
+  }
+  for (int i = 32; i < 48; ++i) {
+    step_x8(a, b, c, d, _mm256_xor_si256(_mm256_xor_si256(b, c), d), w, i);
+  }
+  for (int i = 48; i < 64; ++i) {
+    step_x8(a,
+            b,
+            c,
+            d,
+            _mm256_xor_si256(c, _mm256_or_si256(b, _mm256_xor_si256(d, ones))),
+            w,
+            i);
+  }
+
+  state[0] = _mm256_add_epi32(state[0], a);
+  state[1] = _mm256_add_epi32(state[1], b);
+  state[2] = _mm256_add_epi32(state[2], c);
+  state[3] = _mm256_add_epi32(state[3], d);
+}
+
+// Process whole blocks of up to eight hashes in parallel: num_blocks[lane] blocks that are read
+// from src[lane] are added to the state states[lane].
+US3_TARGET("avx2")
+void process_blocks_multi_avx2(uint32_t* const (&states)[NUM_LANES],
+                               const unsigned char* const (&src)[NUM_LANES],
+                               const size_t (&num_blocks)[NUM_LANES],
+                               const size_t num_active) {
+  static const unsigned char DUMMY_BLOCK[64] = {0};
+
+  // Load the states of the lanes.
+  uint32_t lane_state[4][NUM_LANES];
+  std::memset(&lane_state[0][0], 0, sizeof(lane_state));
+  size_t max_blocks = 0;
+  for (size_t lane = 0; lane < num_active; ++lane) {
+    for (int i = 0; i < 4; ++i) {
+      lane_state[i][lane] = states[lane][i];
+    }
+    max_blocks = std::max(max_blocks, num_blocks[lane]);
+  }
+  __m256i state[4];
+  for (int i = 0; i < 4; ++i) {
+    state[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lane_state[i][0]));
+  }
+
+  for (size_t block = 0; block < max_blocks; ++block) {
+    // Lanes that are done (or unused) hash a dummy block, and their result is ignored.
+    const unsigned char* blocks[NUM_LANES];
+    for (size_t lane = 0; lane < NUM_LANES; ++lane) {
+      blocks[lane] = (lane < num_active && block < num_blocks[lane]) ? &src[lane][block * 64U]
+                                                                      : &DUMMY_BLOCK[0];
+    }
+    process_blocks_x8(state, blocks);
+
+    // Store the states of the lanes that finished with this block.
+    bool has_extracted = false;
+    for (size_t lane = 0; lane < num_active; ++lane) {
+      if (num_blocks[lane] != block + 1U) {
+        continue;
+      }
+      if (!has_extracted) {
+        for (int i = 0; i < 4; ++i) {
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(&lane_state[i][0]), state[i]);
+        }
+        has_extracted = true;
+      }
+      for (int i = 0; i < 4; ++i) {
+        states[lane][i] = lane_state[i][lane];
+      }
+    }
+  }
+}
+
+#endif  // US3_MD5_AVX2
+
+}  // namespace
+
+md5_t::md5_t() : m_total_size(0), m_block_size(0) {
+  for (int i = 0; i < 4; ++i) {
+    m_state[i] = INITIAL_STATE[i];
+  }
+}
+
+void md5_t::update(const void* data, size_t size) {
+  const unsigned char* src = reinterpret_cast<const unsigned char*>(data);
+  m_total_size += static_cast<uint64_t>(size);
+  fill_block(src, size);
+
+  // Process whole blocks directly from the source buffer.
+  while (size >= 64U) {
+    process_block(m_state, src);
+    src += 64;
+    size -= 64U;
+  }
+
+  keep_remainder(src, size);
+}
+
+void md5_t::fill_block(const unsigned char*& src, size_t& size) {
+  if (m_block_size == 0) {
+    return;
+  }
+  const size_t count = (size < (64U - m_block_size)) ? size : (64U - m_block_size);
+  std::memcpy(&m_block[m_block_size], src, count);
+  m_block_size += count;
+  src += count;
+  size -= count;
+  if (m_block_size == 64U) {
+    process_block(m_state, &m_block[0]);
+    m_block_size = 0;
+  }
+}
+
+void md5_t::keep_remainder(const unsigned char* src, const size_t size) {
+  if (size > 0) {
+    std::memcpy(&m_block[m_block_size], src, size);
+    m_block_size += size;
+  }
+}
+
+void md5_t::finalize(unsigned char (&digest)[MD5_RAW_SIZE]) {
+  unsigned char final_blocks[128];
+  const size_t num_blocks =
+      make_final_blocks(&m_block[0], m_block_size, m_total_size, final_blocks);
+  for (size_t i = 0; i < num_blocks; ++i) {
+    process_block(m_state, &final_blocks[i * 64U]);
+  }
+  state_to_digest(m_state, digest);
+}
+
+void md5_t::finalize_hex(char (&digest)[MD5_HEX_SIZE + 1]) {
+  unsigned char raw_digest[MD5_RAW_SIZE];
+  finalize(raw_digest);
+  to_hex(&raw_digest[0], sizeof(raw_digest), &digest[0]);
+}
+
+void md5_t::finalize_base64(char (&digest)[MD5_BASE64_SIZE + 1]) {
+  unsigned char raw_digest[MD5_RAW_SIZE];
+  finalize(raw_digest);
+  base64_encode(&raw_digest[0], sizeof(raw_digest), &digest[0]);
+}
+
+void md5_update_multi(md5_t* const* hashes,
+                      const void* const* data,
+                      const size_t* sizes,
+                      const size_t count) {
+#if defined(US3_MD5_AVX2)
+  // The multi-buffer implementation only pays off when there are several hashes to update.
+  if (count > 1U && cpu_features().avx2) {
+    for (size_t first = 0; first < count; first += NUM_LANES) {
+      const size_t num_active = std::min(count - first, NUM_LANES);
+      uint32_t* states[NUM_LANES];
+      const unsigned char* src[NUM_LANES];
+      size_t num_blocks[NUM_LANES];
+      for (size_t lane = 0; lane < NUM_LANES; ++lane) {
+        states[lane] = NULL;
+        src[lane] = NULL;
+        num_blocks[lane] = 0;
+      }
+
+      // Partial blocks are handled one hash at a time, and the whole blocks in parallel.
+      for (size_t lane = 0; lane < num_active; ++lane) {
+        md5_t& hash = *hashes[first + lane];
+        const unsigned char* lane_src = reinterpret_cast<const unsigned char*>(data[first + lane]);
+        size_t size = sizes[first + lane];
+        hash.m_total_size += static_cast<uint64_t>(size);
+        hash.fill_block(lane_src, size);
+        states[lane] = &hash.m_state[0];
+        src[lane] = lane_src;
+        num_blocks[lane] = size / 64U;
+        hash.keep_remainder(&lane_src[num_blocks[lane] * 64U], size % 64U);
+      }
+      process_blocks_multi_avx2(states, src, num_blocks, num_active);
+    }
+    return;
+  }
+#endif
+  for (size_t i = 0; i < count; ++i) {
+    hashes[i]->update(data[i], sizes[i]);
+  }
+}
+
+void md5_multi(const void* const* data,
+               const size_t* sizes,
+               const size_t count,
+               unsigned char (*digests)[md5_t::MD5_RAW_SIZE]) {
+  // Hash the buffers in groups of as many buffers as there are vector lanes.
+  const size_t GROUP_SIZE = 8;
+  for (size_t first = 0; first < count; first += GROUP_SIZE) {
+    const size_t group_count = std::min(count - first, GROUP_SIZE);
+    md5_t hashes[GROUP_SIZE];
+    md5_t* hash_ptrs[GROUP_SIZE];
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      hash_ptrs[i] = &hashes[i];
+    }
+    md5_update_multi(&hash_ptrs[0], &data[first], &sizes[first], group_count);
+    for (size_t i = 0; i < group_count; ++i) {
+      hashes[i].finalize(digests[first + i]);
+    }
+  }
+}
+
+}  // namespace us3
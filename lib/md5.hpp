@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_MD5_HPP_
+#define US3_MD5_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace us3 {
+
+/// @brief An incremental MD5 hash calculator.
+class md5_t {
+public:
+  // The raw MD5 digest size is 16 bytes.
+  static const size_t MD5_RAW_SIZE = 16;
+
+  // The hex encoded MD5 digest size is 32 bytes (excluding the zero termination).
+  static const size_t MD5_HEX_SIZE = 32;
+
+  // The base64 encoded MD5 digest size is 24 bytes (excluding the zero termination).
+  static const size_t MD5_BASE64_SIZE = 24;
+
+  md5_t();
+
+  /// @brief Add data to the hash.
+  /// @param data The data to hash.
+  /// @param size The number of bytes to hash.
+  void update(const void* data, size_t size);
+
+  /// @brief Finish the hash calculation and get the raw digest.
+  /// @param digest The resulting digest.
+  /// @note After calling this method, the hash object must not be updated again.
+  void finalize(unsigned char (&digest)[MD5_RAW_SIZE]);
+
+  /// @brief Finish the hash calculation and get the hex encoded digest (as used in S3 ETags).
+  /// @param digest The resulting zero terminated digest (lower case).
+  void finalize_hex(char (&digest)[MD5_HEX_SIZE + 1]);
+
+  /// @brief Finish the hash calculation and get the base64 encoded digest (as used in the
+  /// Content-MD5 HTTP header).
+  /// @param digest The resulting zero terminated digest.
+  void finalize_base64(char (&digest)[MD5_BASE64_SIZE + 1]);
+
+private:
+  friend void md5_update_multi(md5_t* const* hashes,
+                               const void* const* data,
+                               const size_t* sizes,
+                               size_t count);
+
+  // Fill up a partial block (and process it when it is full).
+  void fill_block(const unsigned char*& src, size_t& size);
+
+  // Keep the remainder (less than a block) of the data for later.
+  void keep_remainder(const unsigned char* src, size_t size);
+
+  uint32_t m_state[4];
+  uint64_t m_total_size;
+  unsigned char m_block[64];
+  size_t m_block_size;
+};
+
+/// @brief Add data to several independent hashes.
+///
+/// This is equivalent to calling hashes[i]->update(data[i], sizes[i]) for each hash, but when AVX2
+/// is available, eight hashes are updated in parallel (one per 32-bit vector lane), which gives a
+/// much higher total throughput than hashing the buffers one at a time, since a single MD5 stream
+/// can not be parallelized. This is useful for the parts of a multipart upload, for instance,
+/// which can be hashed in batches as the part data is read.
+/// @param hashes The hashes to update.
+/// @param data The data to add to each hash.
+/// @param sizes The number of bytes to add to each hash.
+/// @param count The number of hashes.
+void md5_update_multi(md5_t* const* hashes,
+                      const void* const* data,
+                      const size_t* sizes,
+                      size_t count);
+
+/// @brief Calculate the MD5 digests of several independent buffers (see md5_update_multi()).
+/// @param data The buffers to hash.
+/// @param sizes The sizes of the buffers, in bytes.
+/// @param count The number of buffers.
+/// @param[out] digests The resulting raw digests (one per buffer).
+void md5_multi(const void* const* data,
+               const size_t* sizes,
+               size_t count,
+               unsigned char (*digests)[md5_t::MD5_RAW_SIZE]);
+
+}  // namespace us3
+
+#endif  // US3_MD5_HPP_
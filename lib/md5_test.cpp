@@ -0,0 +1,169 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "md5.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <doctest.h>
+#include <string>
+#include <vector>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+std::string md5_hex(const std::string& str) {
+  us3::md5_t hash;
+  hash.update(str.data(), str.size());
+  char digest[us3::md5_t::MD5_HEX_SIZE + 1];
+  hash.finalize_hex(digest);
+  return std::string(&digest[0]);
+}
+
+}  // namespace
+
+TEST_CASE("MD5 test vectors") {
+  // Test vectors from RFC 1321.
+  CHECK_EQ(md5_hex(""), "d41d8cd98f00b204e9800998ecf8427e");
+  CHECK_EQ(md5_hex("a"), "0cc175b9c0f1b6a831c399e269772661");
+  CHECK_EQ(md5_hex("abc"), "900150983cd24fb0d6963f7d28e17f72");
+  CHECK_EQ(md5_hex("message digest"), "f96b697d7cb7938d525a2f31aaf161d0");
+  CHECK_EQ(md5_hex("abcdefghijklmnopqrstuvwxyz"), "c3fcd3d76192e4007dfb496cca67e13b");
+  CHECK_EQ(md5_hex("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"),
+           "d174ab98d277d9f5a5611c2c9f419d9f");
+  CHECK_EQ(md5_hex("1234567890123456789012345678901234567890123456789012345678901234567890123456789"
+                   "0"),
+           "57edf4a22be3c955ac49da2e2107b67a");
+}
+
+TEST_CASE("MD5 can be calculated incrementally") {
+  // GIVEN
+  const std::string data(1000, 'x');
+  us3::md5_t hash;
+
+  // WHEN
+  for (size_t pos = 0; pos < data.size(); pos += 77) {
+    hash.update(&data[pos], std::min<size_t>(77, data.size() - pos));
+  }
+  char digest[us3::md5_t::MD5_HEX_SIZE + 1];
+  hash.finalize_hex(digest);
+
+  // THEN
+  CHECK_EQ(std::string(&digest[0]), md5_hex(data));
+}
+
+TEST_CASE("MD5 base64 encoding") {
+  // GIVEN
+  us3::md5_t hash;
+  hash.update("abc", 3);
+
+  // WHEN
+  char digest[us3::md5_t::MD5_BASE64_SIZE + 1];
+  hash.finalize_base64(digest);
+
+  // THEN
+  CHECK_EQ(std::string(&digest[0]), "kAFQmDzST7DWlj99KOF/cg==");
+}
+
+TEST_CASE("Multi-buffer MD5 matches the scalar implementation") {
+  // GIVEN: More buffers than there are vector lanes, with sizes that end up in different padding
+  // cases.
+  const size_t sizes_init[] = {0, 1, 55, 56, 63, 64, 65, 119, 120, 1000, 3, 4096, 200, 17, 128};
+  const size_t count = sizeof(sizes_init) / sizeof(sizes_init[0]);
+  std::vector<std::string> buffers;
+  std::vector<const void*> data;
+  std::vector<size_t> sizes(&sizes_init[0], &sizes_init[count]);
+  for (size_t i = 0; i < count; ++i) {
+    std::string buffer(sizes[i], ' ');
+    for (size_t j = 0; j < buffer.size(); ++j) {
+      buffer[j] = static_cast<char>((i * 31U + j * 7U) & 0xFFU);
+    }
+    buffers.push_back(buffer);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    data.push_back(buffers[i].data());
+  }
+
+  // WHEN
+  std::vector<unsigned char> digests(count * us3::md5_t::MD5_RAW_SIZE);
+  us3::md5_multi(&data[0],
+                 &sizes[0],
+                 count,
+                 reinterpret_cast<unsigned char(*)[us3::md5_t::MD5_RAW_SIZE]>(&digests[0]));
+
+  // THEN
+  for (size_t i = 0; i < count; ++i) {
+    us3::md5_t hash;
+    hash.update(buffers[i].data(), buffers[i].size());
+    unsigned char expected[us3::md5_t::MD5_RAW_SIZE];
+    hash.finalize(expected);
+    CHECK(std::memcmp(&digests[i * us3::md5_t::MD5_RAW_SIZE], &expected[0], sizeof(expected)) ==
+          0);
+  }
+}
+
+TEST_CASE("Multi-buffer MD5 can be calculated incrementally") {
+  // GIVEN: Buffers that are added in pieces of different sizes, so that the hashes have partial
+  // blocks of different sizes between the updates.
+  const size_t count = 11;
+  const size_t piece_sizes[] = {0, 1, 63, 64, 65, 130, 7, 4000};
+  const size_t num_pieces = sizeof(piece_sizes) / sizeof(piece_sizes[0]);
+  std::vector<std::string> buffers;
+  for (size_t i = 0; i < count; ++i) {
+    std::string buffer;
+    for (size_t j = 0; j < 5000; ++j) {
+      buffer += static_cast<char>((i * 13U + j * 5U) & 0xFFU);
+    }
+    buffers.push_back(buffer);
+  }
+
+  // WHEN
+  std::vector<us3::md5_t> hashes(count);
+  std::vector<us3::md5_t*> hash_ptrs;
+  for (size_t i = 0; i < count; ++i) {
+    hash_ptrs.push_back(&hashes[i]);
+  }
+  std::vector<size_t> positions(count, 0);
+  for (size_t piece = 0; piece < num_pieces; ++piece) {
+    std::vector<const void*> data;
+    std::vector<size_t> sizes;
+    for (size_t i = 0; i < count; ++i) {
+      // Each hash gets a different piece size in each update.
+      const size_t size = piece_sizes[(piece + i) % num_pieces];
+      data.push_back(&buffers[i][positions[i]]);
+      sizes.push_back(size);
+      positions[i] += size;
+    }
+    us3::md5_update_multi(&hash_ptrs[0], &data[0], &sizes[0], count);
+  }
+
+  // THEN
+  for (size_t i = 0; i < count; ++i) {
+    unsigned char actual[us3::md5_t::MD5_RAW_SIZE];
+    hashes[i].finalize(actual);
+    us3::md5_t hash;
+    hash.update(buffers[i].data(), positions[i]);
+    unsigned char expected[us3::md5_t::MD5_RAW_SIZE];
+    hash.finalize(expected);
+    CHECK(std::memcmp(&actual[0], &expected[0], sizeof(expected)) == 0);
+  }
+}
@@ -0,0 +1,340 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "metrics.hpp"
+
+#include "allocator.hpp"
+#include "platform.hpp"
+#include <cstring>
+#include <locale>
+#include <sstream>
+
+namespace us3 {
+
+namespace {
+
+// The maximum number of series (method, status class, host). Further series are dropped.
+const size_t MAX_SERIES = 64;
+
+// Series states.
+const int32_t SERIES_EMPTY = 0;
+const int32_t SERIES_CLAIMED = 1;
+const int32_t SERIES_READY = 2;
+
+// A sharded counter (one cache line per shard).
+struct counter_t {
+  struct shard_t {
+    uint64_t value;
+    char padding[56];
+  };
+
+  void add(const uint64_t value) {
+    atomic_add(shards[get_thread_shard(histogram_t::SHARD_COUNT)].value, value);
+  }
+
+  uint64_t get() {
+    uint64_t total = 0;
+    for (size_t i = 0; i < histogram_t::SHARD_COUNT; ++i) {
+      total += atomic_load(shards[i].value);
+    }
+    return total;
+  }
+
+  shard_t shards[histogram_t::SHARD_COUNT];
+};
+
+struct series_t {
+  volatile int32_t state;
+  char method[16];
+  char status[8];
+  char host[256];
+  histogram_t* duration;    // μs.
+  histogram_t* throughput;  // Bytes per second.
+  counter_t* bytes_sent;
+  counter_t* bytes_received;
+};
+
+// The series table is statically allocated (zero initialized, i.e. all series are empty), and
+// the histograms of a series are allocated when the series is claimed. They are never freed.
+series_t s_series[MAX_SERIES];
+counter_t s_dropped;
+
+void copy_label(char* target, const size_t size, const char* source) {
+  std::strncpy(target, source, size - 1);
+  target[size - 1] = 0;
+}
+
+bool is_same_label(const char* label, const size_t size, const char* value) {
+  return std::strncmp(label, value, size - 1) == 0;
+}
+
+const char* status_class(const int status_code) {
+  static const char* const CLASSES[] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+  if (status_code >= 100 && status_code < 600) {
+    return CLASSES[status_code / 100 - 1];
+  }
+  return "error";
+}
+
+// Find a series, or create it if it does not exist. Lock-free: A new series is claimed with a
+// compare-and-swap, and published when its key and histograms are ready.
+series_t* find_series(const char* method, const char* status, const char* host) {
+  // FNV-1a hash of the key.
+  uint32_t hash = 2166136261U;
+  const char* const parts[] = {method, status, host};
+  for (size_t i = 0; i < 3; ++i) {
+    for (const char* c = parts[i]; *c != 0; ++c) {
+      hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619U;
+    }
+  }
+
+  for (size_t i = 0; i < MAX_SERIES; ++i) {
+    series_t& series = s_series[(hash + i) % MAX_SERIES];
+    int32_t state = atomic_load(series.state);
+    if (state == SERIES_EMPTY) {
+      if (atomic_compare_and_swap(series.state, SERIES_EMPTY, SERIES_CLAIMED)) {
+        copy_label(series.method, sizeof(series.method), method);
+        copy_label(series.status, sizeof(series.status), status);
+        copy_label(series.host, sizeof(series.host), host);
+        series.duration = heap_new<histogram_t>();
+        series.throughput = heap_new<histogram_t>();
+        series.bytes_sent = heap_new<counter_t>();
+        series.bytes_received = heap_new<counter_t>();
+        if (series.duration == NULL || series.throughput == NULL || series.bytes_sent == NULL ||
+            series.bytes_received == NULL) {
+          // Out of memory: Give the slot back (the request is counted as dropped).
+          heap_delete(series.duration);
+          heap_delete(series.throughput);
+          heap_delete(series.bytes_sent);
+          heap_delete(series.bytes_received);
+          atomic_store(series.state, SERIES_EMPTY);
+          return NULL;
+        }
+        atomic_store(series.state, SERIES_READY);
+        return &series;
+      }
+      state = atomic_load(series.state);
+    }
+
+    // Another thread is creating the series: Wait until it is ready.
+    while (state == SERIES_CLAIMED) {
+      sleep_us(1);
+      state = atomic_load(series.state);
+    }
+
+    if (is_same_label(series.method, sizeof(series.method), method) &&
+        is_same_label(series.status, sizeof(series.status), status) &&
+        is_same_label(series.host, sizeof(series.host), host)) {
+      return &series;
+    }
+  }
+  return NULL;
+}
+
+std::string escape_label(const char* value) {
+  std::string result;
+  for (const char* c = value; *c != 0; ++c) {
+    if (*c == '\\' || *c == '"') {
+      result += '\\';
+      result += *c;
+    } else if (*c == '\n') {
+      result += "\\n";
+    } else {
+      result += *c;
+    }
+  }
+  return result;
+}
+
+std::string series_labels(const series_t& series) {
+  return "method=\"" + escape_label(series.method) + "\",status=\"" + series.status +
+         "\",host=\"" + escape_label(series.host) + "\"";
+}
+
+void render_summary(std::ostringstream& out,
+                    const char* name,
+                    const char* help,
+                    const bool is_duration) {
+  static const char* const QUANTILES[] = {"0.5", "0.9", "0.99", "0.999"};
+  static const double QUANTILE_VALUES[] = {0.5, 0.9, 0.99, 0.999};
+  const double scale = is_duration ? 0.000001 : 1.0;
+
+  out << "# HELP " << name << " " << help << "\n";
+  out << "# TYPE " << name << " summary\n";
+  for (size_t i = 0; i < MAX_SERIES; ++i) {
+    series_t& series = s_series[i];
+    if (atomic_load(series.state) != SERIES_READY) {
+      continue;
+    }
+    const std::string labels = series_labels(series);
+    const histogram_t::snapshot_t snapshot =
+        (is_duration ? series.duration : series.throughput)->snapshot();
+    for (size_t q = 0; q < sizeof(QUANTILES) / sizeof(QUANTILES[0]); ++q) {
+      out << name << "{" << labels << ",quantile=\"" << QUANTILES[q] << "\"} "
+          << static_cast<double>(snapshot.quantile(QUANTILE_VALUES[q])) * scale << "\n";
+    }
+    out << name << "_sum{" << labels << "} " << static_cast<double>(snapshot.sum) * scale << "\n";
+    out << name << "_count{" << labels << "} " << snapshot.count << "\n";
+  }
+}
+
+void render_counter(std::ostringstream& out,
+                    const char* name,
+                    const char* help,
+                    const bool is_sent) {
+  out << "# HELP " << name << " " << help << "\n";
+  out << "# TYPE " << name << " counter\n";
+  for (size_t i = 0; i < MAX_SERIES; ++i) {
+    series_t& series = s_series[i];
+    if (atomic_load(series.state) != SERIES_READY) {
+      continue;
+    }
+    out << name << "{" << series_labels(series) << "} "
+        << (is_sent ? series.bytes_sent : series.bytes_received)->get() << "\n";
+  }
+}
+
+}  // namespace
+
+const int histogram_t::SUB_BUCKET_BITS;
+const uint64_t histogram_t::SUB_BUCKETS;
+const int histogram_t::MAX_VALUE_BITS;
+const size_t histogram_t::BUCKET_COUNT;
+const size_t histogram_t::SHARD_COUNT;
+
+uint64_t histogram_t::snapshot_t::quantile(const double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  const double clamped = (q < 0.0) ? 0.0 : ((q > 1.0) ? 1.0 : q);
+  uint64_t rank = static_cast<uint64_t>(clamped * static_cast<double>(count) + 0.5);
+  rank = (rank < 1) ? 1 : ((rank > count) ? count : rank);
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    cumulative += counts[i];
+    if (cumulative >= rank) {
+      return bucket_value(i);
+    }
+  }
+  return bucket_value(counts.size() - 1);
+}
+
+histogram_t::histogram_t() {
+  std::memset(&m_shards[0], 0, sizeof(m_shards));
+}
+
+void histogram_t::record(const uint64_t value) {
+  shard_t& shard = m_shards[get_thread_shard(SHARD_COUNT)];
+  atomic_add(shard.counts[bucket_index(value)], 1);
+  atomic_add(shard.sum, value);
+}
+
+histogram_t::snapshot_t histogram_t::snapshot() {
+  snapshot_t result;
+  result.counts.resize(BUCKET_COUNT);
+  result.count = 0;
+  result.sum = 0;
+  for (size_t shard = 0; shard < SHARD_COUNT; ++shard) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+      const uint64_t count = atomic_load(m_shards[shard].counts[i]);
+      result.counts[i] += count;
+      result.count += count;
+    }
+    result.sum += atomic_load(m_shards[shard].sum);
+  }
+  return result;
+}
+
+size_t histogram_t::bucket_index(const uint64_t value) {
+  const uint64_t max_value = (static_cast<uint64_t>(1) << MAX_VALUE_BITS) - 1;
+  const uint64_t v = (value < max_value) ? value : max_value;
+  if (v < SUB_BUCKETS) {
+    return static_cast<size_t>(v);
+  }
+
+  // Bucket (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + the next SUB_BUCKET_BITS bits.
+  int exponent = SUB_BUCKET_BITS;
+  while ((v >> (exponent + 1)) != 0) {
+    ++exponent;
+  }
+  const uint64_t sub_bucket = (v >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+  return static_cast<size_t>(static_cast<uint64_t>(exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS +
+                             sub_bucket);
+}
+
+uint64_t histogram_t::bucket_value(const size_t index) {
+  if (index < SUB_BUCKETS) {
+    return static_cast<uint64_t>(index);
+  }
+  const int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+  const uint64_t low = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+  const uint64_t width = static_cast<uint64_t>(1) << shift;
+  return low + (width - 1) / 2;
+}
+
+size_t get_thread_shard(const size_t shard_count) {
+  // Fibonacci hashing of the thread ID (which is often an aligned pointer).
+  const uint64_t golden_ratio = (static_cast<uint64_t>(0x9e3779b9U) << 32) | 0x7f4a7c15U;
+  return static_cast<size_t>(((get_thread_id() * golden_ratio) >> 32) % shard_count);
+}
+
+void record_request_metrics(const char* method,
+                            const int status_code,
+                            const char* host,
+                            const int64_t duration,
+                            const uint64_t bytes_sent,
+                            const uint64_t bytes_received) {
+  series_t* series = find_series(method, status_class(status_code), host);
+  if (series == NULL) {
+    s_dropped.add(1);
+    return;
+  }
+  const uint64_t duration_us = (duration > 0) ? static_cast<uint64_t>(duration) : 0;
+  series->duration->record(duration_us);
+  if (duration_us > 0) {
+    const double bytes = static_cast<double>(bytes_sent + bytes_received);
+    series->throughput->record(
+        static_cast<uint64_t>(bytes * 1000000.0 / static_cast<double>(duration_us)));
+  }
+  series->bytes_sent->add(bytes_sent);
+  series->bytes_received->add(bytes_received);
+}
+
+std::string render_metrics() {
+  std::ostringstream out;
+  out.imbue(std::locale::classic());
+  out.precision(15);
+  render_summary(out,
+                 "us3_request_duration_seconds",
+                 "Duration of requests, from opening to completing the transfer.",
+                 true);
+  render_summary(out,
+                 "us3_request_throughput_bytes_per_second",
+                 "Bytes transferred per second of request duration.",
+                 false);
+  render_counter(out, "us3_sent_bytes_total", "Bytes sent, including HTTP headers.", true);
+  render_counter(
+      out, "us3_received_bytes_total", "Bytes received, including HTTP headers.", false);
+  out << "# HELP us3_dropped_requests_total Requests that were not recorded (too many series).\n";
+  out << "# TYPE us3_dropped_requests_total counter\n";
+  out << "us3_dropped_requests_total " << s_dropped.get() << "\n";
+  return out.str();
+}
+
+}  // namespace us3
@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_METRICS_HPP_
+#define US3_METRICS_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace us3 {
+
+/// @brief A lock-free, sharded histogram with logarithmic buckets (HDR style).
+///
+/// Each power of two is split into SUB_BUCKETS linear buckets, so a quantile has a relative error
+/// of at most 1/SUB_BUCKETS. Values below SUB_BUCKETS are exact, and values above MAX_VALUE are
+/// counted as MAX_VALUE. Samples are recorded with atomic adds in one of SHARD_COUNT shards,
+/// which is selected by the calling thread, so that concurrent recording rarely contends.
+class histogram_t {
+public:
+  static const int SUB_BUCKET_BITS = 4;
+  static const uint64_t SUB_BUCKETS = 16;
+  static const int MAX_VALUE_BITS = 40;
+  static const size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+  static const size_t SHARD_COUNT = 8;
+
+  /// @brief The merged contents of all shards.
+  struct snapshot_t {
+    std::vector<uint64_t> counts;  ///< Count per bucket.
+    uint64_t count;                ///< Total number of samples.
+    uint64_t sum;                  ///< Sum of all samples.
+
+    /// @brief Estimate a quantile.
+    /// @param q The quantile (0-1).
+    /// @returns the estimated value, or 0 if there are no samples.
+    uint64_t quantile(double q) const;
+  };
+
+  histogram_t();
+
+  /// @brief Record a sample.
+  void record(uint64_t value);
+
+  /// @brief Get the merged contents of all shards.
+  snapshot_t snapshot();
+
+  /// @brief Get the bucket of a value.
+  static size_t bucket_index(uint64_t value);
+
+  /// @brief Get the value that represents a bucket (the middle of the bucket).
+  static uint64_t bucket_value(size_t index);
+
+private:
+  struct shard_t {
+    uint64_t counts[BUCKET_COUNT];
+    uint64_t sum;
+    char padding[64];  // Keep the shards on separate cache lines.
+  };
+
+  // Not copyable.
+  histogram_t(const histogram_t&);
+  histogram_t& operator=(const histogram_t&);
+
+  shard_t m_shards[SHARD_COUNT];
+};
+
+/// @brief Get the shard of the calling thread.
+/// @param shard_count The number of shards.
+size_t get_thread_shard(size_t shard_count);
+
+/// @brief Record a finished request in the process wide metrics.
+///
+/// The metrics are split into series by method, status class and host. Recording is lock-free.
+/// @param method The HTTP method (e.g. "GET").
+/// @param status_code The HTTP status code, or 0 if no response was received.
+/// @param host The host name.
+/// @param duration The duration of the request (μs).
+/// @param bytes_sent The number of bytes sent.
+/// @param bytes_received The number of bytes received.
+void record_request_metrics(const char* method,
+                            int status_code,
+                            const char* host,
+                            int64_t duration,
+                            uint64_t bytes_sent,
+                            uint64_t bytes_received);
+
+/// @brief Render the process wide metrics in the Prometheus text format.
+std::string render_metrics();
+
+}  // namespace us3
+
+#endif  // US3_METRICS_HPP_
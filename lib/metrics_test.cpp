@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "metrics.hpp"
+
+#include <cstdlib>
+#include <doctest.h>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+TEST_CASE("Histogram buckets") {
+  SUBCASE("Small values are exact") {
+    for (uint64_t value = 0; value < us3::histogram_t::SUB_BUCKETS; ++value) {
+      CHECK(us3::histogram_t::bucket_value(us3::histogram_t::bucket_index(value)) == value);
+    }
+  }
+
+  SUBCASE("Large values have a bounded relative error") {
+    size_t last_index = 0;
+    for (uint64_t value = 1; value < (static_cast<uint64_t>(1) << 39); value += value / 7 + 1) {
+      const size_t index = us3::histogram_t::bucket_index(value);
+      REQUIRE(index < us3::histogram_t::BUCKET_COUNT);
+      CHECK(index >= last_index);
+      last_index = index;
+      const double estimate = static_cast<double>(us3::histogram_t::bucket_value(index));
+      const double error = (estimate - static_cast<double>(value)) / static_cast<double>(value);
+      CHECK(error < 1.0 / 16.0);
+      CHECK(error > -1.0 / 16.0);
+    }
+  }
+
+  SUBCASE("Huge values are clamped") {
+    CHECK(us3::histogram_t::bucket_index(~static_cast<uint64_t>(0)) ==
+          us3::histogram_t::BUCKET_COUNT - 1);
+  }
+}
+
+TEST_CASE("Histogram quantiles") {
+  // GIVEN
+  us3::histogram_t histogram;
+
+  // WHEN
+  for (uint64_t value = 1; value <= 1000; ++value) {
+    histogram.record(value);
+  }
+  const us3::histogram_t::snapshot_t snapshot = histogram.snapshot();
+
+  // THEN
+  CHECK(snapshot.count == 1000);
+  CHECK(snapshot.sum == 500500);
+  CHECK(snapshot.quantile(0.0) == 1);
+  CHECK(snapshot.quantile(0.5) >= 470);
+  CHECK(snapshot.quantile(0.5) <= 530);
+  CHECK(snapshot.quantile(0.99) >= 930);
+  CHECK(snapshot.quantile(0.99) <= 1050);
+  CHECK(snapshot.quantile(1.0) >= 970);
+}
+
+TEST_CASE("Empty histogram") {
+  us3::histogram_t histogram;
+  const us3::histogram_t::snapshot_t snapshot = histogram.snapshot();
+  CHECK(snapshot.count == 0);
+  CHECK(snapshot.quantile(0.5) == 0);
+}
+
+TEST_CASE("Render metrics") {
+  // GIVEN
+  us3::record_request_metrics("GET", 200, "s3.example.com", 2000000, 100, 1000);
+  us3::record_request_metrics("GET", 200, "s3.example.com", 2000000, 100, 1000);
+  us3::record_request_metrics("PUT", 0, "bad\"host", 1000, 10, 0);
+
+  // WHEN
+  const std::string metrics = us3::render_metrics();
+
+  // THEN
+  CHECK(metrics.find("# TYPE us3_request_duration_seconds summary\n") != std::string::npos);
+  CHECK(metrics.find("us3_request_duration_seconds_count{method=\"GET\",status=\"2xx\","
+                     "host=\"s3.example.com\"} 2\n") != std::string::npos);
+  const std::string median_key =
+      "us3_request_duration_seconds{method=\"GET\",status=\"2xx\",host=\"s3.example.com\","
+      "quantile=\"0.5\"} ";
+  const size_t median_pos = metrics.find(median_key);
+  REQUIRE(median_pos != std::string::npos);
+  const double median = std::atof(metrics.c_str() + median_pos + median_key.size());
+  CHECK(median > 1.9);
+  CHECK(median < 2.1);
+  CHECK(metrics.find("us3_sent_bytes_total{method=\"GET\",status=\"2xx\","
+                     "host=\"s3.example.com\"} 200\n") != std::string::npos);
+  CHECK(metrics.find("us3_received_bytes_total{method=\"GET\",status=\"2xx\","
+                     "host=\"s3.example.com\"} 2000\n") != std::string::npos);
+  CHECK(metrics.find("{method=\"PUT\",status=\"error\",host=\"bad\\\"host\"}") !=
+        std::string::npos);
+  CHECK(metrics.find("us3_dropped_requests_total 0\n") != std::string::npos);
+}
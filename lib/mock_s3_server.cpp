@@ -0,0 +1,1274 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "mock_s3_server.hpp"
+
+#include "hmac_sha1.hpp"
+#include "md5.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace us3 {
+
+namespace {
+
+// How often blocked threads check if the server is stopping (ms).
+const int POLL_INTERVAL_MS = 100;
+
+// The largest accepted HTTP request header.
+const size_t MAX_HEADER_SIZE = 65536;
+
+// The size of the chunks of chunked responses.
+const size_t RESPONSE_CHUNK_SIZE = 16384;
+
+// The maximum number of parts in a ListParts response, and in a multipart upload.
+const uint64_t MAX_LIST_PARTS = 1000;
+const uint64_t MAX_PARTS = 10000;
+
+// Avoid SIGPIPE when the peer has closed the connection (we want EPIPE instead).
+#if defined(MSG_NOSIGNAL)
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+typedef std::map<std::string, std::string> string_map_t;
+
+std::string to_lower(const std::string& str) {
+  std::string result = str;
+  for (size_t i = 0; i < result.size(); ++i) {
+    result[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(result[i])));
+  }
+  return result;
+}
+
+std::string trim(const std::string& str) {
+  const std::string::size_type start = str.find_first_not_of(" \t");
+  if (start == std::string::npos) {
+    return std::string();
+  }
+  const std::string::size_type end = str.find_last_not_of(" \t");
+  return str.substr(start, end - start + 1);
+}
+
+std::string to_string(const uint64_t value) {
+  std::ostringstream str;
+  str << value;
+  return str.str();
+}
+
+bool parse_uint64(const std::string& str, uint64_t& value) {
+  if (str.empty() || str.size() > 19) {
+    return false;
+  }
+  value = 0;
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (str[i] < '0' || str[i] > '9') {
+      return false;
+    }
+    value = value * 10 + static_cast<uint64_t>(str[i] - '0');
+  }
+  return true;
+}
+
+int hex_digit_value(const char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+std::string url_decode(const std::string& str) {
+  std::string result;
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (str[i] == '%' && i + 2 < str.size() && hex_digit_value(str[i + 1]) >= 0 &&
+        hex_digit_value(str[i + 2]) >= 0) {
+      result += static_cast<char>(hex_digit_value(str[i + 1]) * 16 + hex_digit_value(str[i + 2]));
+      i += 2;
+    } else if (str[i] == '+') {
+      result += ' ';
+    } else {
+      result += str[i];
+    }
+  }
+  return result;
+}
+
+std::string xml_escape(const std::string& str) {
+  std::string result;
+  for (size_t i = 0; i < str.size(); ++i) {
+    switch (str[i]) {
+      case '&':
+        result += "&amp;";
+        break;
+      case '<':
+        result += "&lt;";
+        break;
+      case '>':
+        result += "&gt;";
+        break;
+      case '"':
+        result += "&quot;";
+        break;
+      default:
+        result += str[i];
+    }
+  }
+  return result;
+}
+
+std::string xml_unescape(const std::string& str) {
+  static const char* const ENTITIES[][2] = {
+      {"&quot;", "\""}, {"&apos;", "'"}, {"&lt;", "<"}, {"&gt;", ">"}, {"&amp;", "&"}};
+  std::string result;
+  for (size_t pos = 0; pos < str.size(); ++pos) {
+    bool found = false;
+    for (size_t i = 0; i < sizeof(ENTITIES) / sizeof(ENTITIES[0]) && !found; ++i) {
+      const size_t length = std::strlen(ENTITIES[i][0]);
+      if (str.compare(pos, length, ENTITIES[i][0]) == 0) {
+        result += ENTITIES[i][1];
+        pos += length - 1;
+        found = true;
+      }
+    }
+    if (!found) {
+      result += str[pos];
+    }
+  }
+  return result;
+}
+
+// Find the next <tag>value</tag> element, starting at pos (which is updated).
+bool find_xml_element(const std::string& xml,
+                      const char* tag,
+                      std::string::size_type& pos,
+                      std::string& value) {
+  const std::string open_tag = std::string("<") + tag + ">";
+  const std::string close_tag = std::string("</") + tag + ">";
+  const std::string::size_type start = xml.find(open_tag, pos);
+  if (start == std::string::npos) {
+    return false;
+  }
+  const std::string::size_type end = xml.find(close_tag, start + open_tag.size());
+  if (end == std::string::npos) {
+    return false;
+  }
+  value = xml.substr(start + open_tag.size(), end - start - open_tag.size());
+  pos = end + close_tag.size();
+  return true;
+}
+
+std::string unquote(const std::string& etag) {
+  if (etag.size() >= 2 && etag[0] == '"' && etag[etag.size() - 1] == '"') {
+    return etag.substr(1, etag.size() - 2);
+  }
+  return etag;
+}
+
+std::string md5_etag(const std::string& data) {
+  md5_t md5;
+  md5.update(data.data(), data.size());
+  char hex[md5_t::MD5_HEX_SIZE + 1];
+  md5.finalize_hex(hex);
+  return std::string("\"") + &hex[0] + "\"";
+}
+
+std::string md5_base64(const std::string& data) {
+  md5_t md5;
+  md5.update(data.data(), data.size());
+  char base64[md5_t::MD5_BASE64_SIZE + 1];
+  md5.finalize_base64(base64);
+  return &base64[0];
+}
+
+// The S3 name of a checksum algorithm, as used in x-amz-checksum-algorithm and in XML elements.
+const char* checksum_algorithm_name(const checksum_t::algorithm_t algorithm) {
+  return (algorithm == checksum_t::CRC64NVME) ? "CRC64NVME" : "CRC32C";
+}
+
+bool parse_checksum_algorithm(const std::string& name, checksum_t::algorithm_t& algorithm) {
+  if (name.empty()) {
+    algorithm = checksum_t::NONE;
+  } else if (name == "CRC32C") {
+    algorithm = checksum_t::CRC32C;
+  } else if (name == "CRC64NVME") {
+    algorithm = checksum_t::CRC64NVME;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::string checksum_base64(const checksum_t::algorithm_t algorithm, const std::string& data) {
+  checksum_t checksum(algorithm);
+  checksum.update(data.data(), data.size());
+  char base64[checksum_t::MAX_BASE64_SIZE + 1];
+  checksum.to_base64(base64);
+  return &base64[0];
+}
+
+bool is_sigv2_subresource(const std::string& name) {
+  static const char* const SUBRESOURCES[] = {"acl",
+                                             "cors",
+                                             "delete",
+                                             "lifecycle",
+                                             "location",
+                                             "logging",
+                                             "notification",
+                                             "partNumber",
+                                             "policy",
+                                             "requestPayment",
+                                             "response-cache-control",
+                                             "response-content-disposition",
+                                             "response-content-encoding",
+                                             "response-content-language",
+                                             "response-content-type",
+                                             "response-expires",
+                                             "restore",
+                                             "tagging",
+                                             "torrent",
+                                             "uploadId",
+                                             "uploads",
+                                             "versionId",
+                                             "versioning",
+                                             "versions",
+                                             "website"};
+  for (size_t i = 0; i < sizeof(SUBRESOURCES) / sizeof(SUBRESOURCES[0]); ++i) {
+    if (name == SUBRESOURCES[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The SIGV2 canonicalized resource: The path, followed by the sorted sub-resources of the query.
+std::string sigv2_canonical_resource(const std::string& path, const std::string& query) {
+  std::vector<std::string> subresources;
+  std::string::size_type start = 0;
+  while (!query.empty() && start <= query.size()) {
+    std::string::size_type end = query.find('&', start);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+    const std::string param = query.substr(start, end - start);
+    if (is_sigv2_subresource(param.substr(0, param.find('=')))) {
+      subresources.push_back(param);
+    }
+    start = end + 1;
+  }
+  std::sort(subresources.begin(), subresources.end());
+  std::string resource = path;
+  for (size_t i = 0; i < subresources.size(); ++i) {
+    resource += (i == 0 ? "?" : "&") + subresources[i];
+  }
+  return resource;
+}
+
+// Decode an aws-chunked (SIGV4 streaming) body. The chunk signatures and trailers are ignored.
+bool decode_aws_chunked(const std::string& encoded, std::string& decoded) {
+  decoded.clear();
+  std::string::size_type pos = 0;
+  while (true) {
+    const std::string::size_type line_end = encoded.find("\r\n", pos);
+    if (line_end == std::string::npos) {
+      return false;
+    }
+    const std::string size_str = encoded.substr(pos, encoded.find(';', pos) - pos);
+    char* end = NULL;
+    const unsigned long size = std::strtoul(size_str.c_str(), &end, 16);
+    if (size_str.empty() || end == NULL || *end != 0) {
+      return false;
+    }
+    pos = line_end + 2;
+    if (size == 0) {
+      return true;
+    }
+    if (encoded.size() < pos + size + 2 || encoded.compare(pos + size, 2, "\r\n") != 0) {
+      return false;
+    }
+    decoded.append(encoded, pos, size);
+    pos += size + 2;
+  }
+}
+
+const char* reason_phrase(const int status_code) {
+  switch (status_code) {
+    case 200:
+      return "OK";
+    case 204:
+      return "No Content";
+    case 206:
+      return "Partial Content";
+    case 400:
+      return "Bad Request";
+    case 403:
+      return "Forbidden";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 412:
+      return "Precondition Failed";
+    case 416:
+      return "Range Not Satisfiable";
+    case 501:
+      return "Not Implemented";
+    default:
+      return "Internal Server Error";
+  }
+}
+
+bool send_all(const int fd, const char* data, const size_t size) {
+  size_t sent = 0;
+  while (sent < size) {
+    const ssize_t count = ::send(fd, &data[sent], size - sent, SEND_FLAGS);
+    if (count <= 0) {
+      return false;
+    }
+    sent += static_cast<size_t>(count);
+  }
+  return true;
+}
+
+// Objects in a root directory must not escape the directory.
+bool is_safe_path(const std::string& path) {
+  return path.find("/../") == std::string::npos && path.find("/./") == std::string::npos &&
+         path.find("//") == std::string::npos && path.find('\\') == std::string::npos &&
+         (path.size() < 3 || path.compare(path.size() - 3, 3, "/..") != 0);
+}
+
+bool make_parent_directories(const std::string& file_name) {
+  for (std::string::size_type pos = file_name.find('/', 1); pos != std::string::npos;
+       pos = file_name.find('/', pos + 1)) {
+    const std::string dir = file_name.substr(0, pos);
+    if (::mkdir(dir.c_str(), 0755) != 0) {
+      struct ::stat info;
+      if (::stat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool read_file(const std::string& file_name, std::string& data) {
+  std::FILE* file = std::fopen(file_name.c_str(), "rb");
+  if (file == NULL) {
+    return false;
+  }
+  data.clear();
+  char buffer[65536];
+  size_t count;
+  while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.append(buffer, count);
+  }
+  const bool success = std::ferror(file) == 0;
+  std::fclose(file);
+  return success;
+}
+
+bool write_file(const std::string& file_name, const std::string& data) {
+  if (!make_parent_directories(file_name)) {
+    return false;
+  }
+  std::FILE* file = std::fopen(file_name.c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+  const bool success = data.empty() || std::fwrite(data.data(), data.size(), 1, file) == 1;
+  return (std::fclose(file) == 0) && success;
+}
+
+}  // namespace
+
+struct mock_s3_server_t::request_t {
+  request_t() : keep_alive(false) {
+  }
+
+  std::string header(const char* name) const {
+    const string_map_t::const_iterator it = headers.find(name);
+    return (it != headers.end()) ? it->second : std::string();
+  }
+
+  bool has_param(const char* name) const {
+    return params.find(name) != params.end();
+  }
+
+  std::string param(const char* name) const {
+    const string_map_t::const_iterator it = params.find(name);
+    return (it != params.end()) ? it->second : std::string();
+  }
+
+  std::string method;
+  std::string path;
+  std::string query;
+  string_map_t params;
+  string_map_t headers;
+  std::string body;
+  bool keep_alive;
+};
+
+struct mock_s3_server_t::response_t {
+  response_t() : status_code(0) {
+  }
+
+  void add_header(const std::string& name, const std::string& value) {
+    headers.push_back(std::make_pair(name, value));
+  }
+
+  void set_error(const int code, const char* error_code, const char* message) {
+    status_code = code;
+    headers.clear();
+    add_header("Content-Type", "application/xml");
+    body = std::string("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<Error><Code>") + error_code +
+           "</Code><Message>" + message + "</Message></Error>";
+  }
+
+  int status_code;
+  std::vector<std::pair<std::string, std::string> > headers;
+  std::string body;
+};
+
+mock_s3_server_t::mock_s3_server_t()
+    : m_listen_fd(-1),
+      m_port(0),
+      m_is_running(false),
+      m_accept_thread(),
+      m_stopping(false),
+      m_active_clients(0),
+      m_next_upload_id(1) {
+  m_stats.connections = 0;
+  m_stats.requests = 0;
+  m_stats.auth_failures = 0;
+}
+
+mock_s3_server_t::~mock_s3_server_t() {
+  stop();
+}
+
+status_t mock_s3_server_t::start(const options_t& options) {
+  if (m_is_running) {
+    return make_result(status_t::INVALID_OPERATION);
+  }
+
+  m_options = options;
+  m_access_key = (options.access_key != NULL) ? options.access_key : "";
+  m_secret_key = (options.secret_key != NULL) ? options.secret_key : "";
+  m_root_dir = (options.root_dir != NULL) ? options.root_dir : "";
+  m_options.access_key = (options.access_key != NULL) ? m_access_key.c_str() : NULL;
+  m_options.secret_key = m_secret_key.c_str();
+  m_options.root_dir = (options.root_dir != NULL) ? m_root_dir.c_str() : NULL;
+
+  // Listen on the loopback interface.
+  m_listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (m_listen_fd < 0) {
+    return make_result(status_t::ERROR);
+  }
+  const int reuse = 1;
+  ::setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  ::sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(static_cast<uint16_t>(options.port));
+  ::socklen_t addr_len = sizeof(addr);
+  if (::bind(m_listen_fd, reinterpret_cast< ::sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      ::listen(m_listen_fd, 64) != 0 ||
+      ::getsockname(m_listen_fd, reinterpret_cast< ::sockaddr*>(&addr), &addr_len) != 0) {
+    ::close(m_listen_fd);
+    m_listen_fd = -1;
+    return make_result(status_t::ERROR);
+  }
+  m_port = ntohs(addr.sin_port);
+
+  m_stopping = false;
+  if (::pthread_create(&m_accept_thread, NULL, accept_thread, this) != 0) {
+    ::close(m_listen_fd);
+    m_listen_fd = -1;
+    return make_result(status_t::ERROR);
+  }
+  m_is_running = true;
+  return make_result(status_t::SUCCESS);
+}
+
+void mock_s3_server_t::stop() {
+  if (!m_is_running) {
+    return;
+  }
+  {
+    lock_guard_t lock(m_mutex);
+    m_stopping = true;
+  }
+  ::pthread_join(m_accept_thread, NULL);
+  ::close(m_listen_fd);
+  m_listen_fd = -1;
+  m_is_running = false;
+}
+
+int mock_s3_server_t::port() const {
+  return m_port;
+}
+
+void mock_s3_server_t::put_object(const std::string& path, const std::string& data) {
+  object_t object;
+  object.data = data;
+  object.etag = md5_etag(data);
+  store_object(path, object);
+}
+
+bool mock_s3_server_t::get_object(const std::string& path, std::string& data) {
+  object_t object;
+  if (!load_object(path, object)) {
+    return false;
+  }
+  data = object.data;
+  return true;
+}
+
+mock_s3_server_t::stats_t mock_s3_server_t::get_stats() {
+  lock_guard_t lock(m_mutex);
+  return m_stats;
+}
+
+void* mock_s3_server_t::accept_thread(void* arg) {
+  mock_s3_server_t* server = reinterpret_cast<mock_s3_server_t*>(arg);
+  while (!server->is_stopping()) {
+    ::pollfd poll_fd;
+    poll_fd.fd = server->m_listen_fd;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+    if (::poll(&poll_fd, 1, POLL_INTERVAL_MS) <= 0) {
+      continue;
+    }
+    const int fd = ::accept(server->m_listen_fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+
+    // Serve the connection in a detached thread.
+    client_t* client = new client_t;
+    client->server = server;
+    client->fd = fd;
+    {
+      lock_guard_t lock(server->m_mutex);
+      ++server->m_stats.connections;
+      ++server->m_active_clients;
+    }
+    pthread_t thread;
+    if (::pthread_create(&thread, NULL, client_thread, client) == 0) {
+      ::pthread_detach(thread);
+    } else {
+      client_thread(client);
+    }
+  }
+
+  // Wait for the client threads to finish (they check if the server is stopping regularly).
+  while (true) {
+    {
+      lock_guard_t lock(server->m_mutex);
+      if (server->m_active_clients == 0) {
+        break;
+      }
+    }
+    sleep_us(1000);
+  }
+  return NULL;
+}
+
+void* mock_s3_server_t::client_thread(void* arg) {
+  client_t* client = reinterpret_cast<client_t*>(arg);
+  mock_s3_server_t* server = client->server;
+  server->serve_client(*client);
+  ::close(client->fd);
+  delete client;
+  lock_guard_t lock(server->m_mutex);
+  --server->m_active_clients;
+  return NULL;
+}
+
+void mock_s3_server_t::serve_client(client_t& client) {
+  while (true) {
+    request_t request;
+    response_t response;
+    if (!read_request(client, request, response)) {
+      break;
+    }
+    if (response.status_code == 0) {
+      handle_request(request, response);
+    }
+    if (!send_response(client, request, response) || !request.keep_alive) {
+      break;
+    }
+  }
+}
+
+bool mock_s3_server_t::receive_more(client_t& client) {
+  while (true) {
+    if (is_stopping()) {
+      return false;
+    }
+    ::pollfd poll_fd;
+    poll_fd.fd = client.fd;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+    const int poll_result = ::poll(&poll_fd, 1, POLL_INTERVAL_MS);
+    if (poll_result < 0) {
+      return false;
+    }
+    if (poll_result > 0) {
+      break;
+    }
+  }
+  char buffer[65536];
+  const ssize_t count = ::recv(client.fd, buffer, sizeof(buffer), 0);
+  if (count <= 0) {
+    return false;
+  }
+  client.buffer.append(buffer, static_cast<size_t>(count));
+  return true;
+}
+
+bool mock_s3_server_t::read_request(client_t& client, request_t& request, response_t& response) {
+  // Read the request header.
+  std::string::size_type header_end;
+  while ((header_end = client.buffer.find("\r\n\r\n")) == std::string::npos) {
+    if (client.buffer.size() > MAX_HEADER_SIZE) {
+      response.set_error(400, "RequestHeaderSectionTooLarge", "The request header is too large.");
+      return true;
+    }
+    if (!receive_more(client)) {
+      return false;
+    }
+  }
+  const std::string header = client.buffer.substr(0, header_end + 2);
+  client.buffer.erase(0, header_end + 4);
+
+  // Parse the request line: "METHOD /path?query HTTP/1.1".
+  std::string::size_type line_end = header.find("\r\n");
+  std::istringstream request_line(header.substr(0, line_end));
+  std::string target;
+  std::string version;
+  request_line >> request.method >> target >> version;
+  if (request.method.empty() || target.empty() || target[0] != '/' ||
+      version.compare(0, 5, "HTTP/") != 0) {
+    response.set_error(400, "BadRequest", "Malformed request line.");
+    return true;
+  }
+  const std::string::size_type query_pos = target.find('?');
+  request.path = target.substr(0, query_pos);
+  if (query_pos != std::string::npos) {
+    request.query = target.substr(query_pos + 1);
+    std::string::size_type start = 0;
+    while (start <= request.query.size()) {
+      std::string::size_type end = request.query.find('&', start);
+      if (end == std::string::npos) {
+        end = request.query.size();
+      }
+      const std::string param = request.query.substr(start, end - start);
+      const std::string::size_type eq_pos = param.find('=');
+      if (!param.empty()) {
+        request.params[url_decode(param.substr(0, eq_pos))] =
+            (eq_pos != std::string::npos) ? url_decode(param.substr(eq_pos + 1)) : "";
+      }
+      start = end + 1;
+    }
+  }
+
+  // Parse the header fields.
+  for (std::string::size_type pos = line_end + 2; pos < header.size(); pos = line_end + 2) {
+    line_end = header.find("\r\n", pos);
+    const std::string line = header.substr(pos, line_end - pos);
+    const std::string::size_type colon_pos = line.find(':');
+    if (colon_pos == std::string::npos) {
+      response.set_error(400, "BadRequest", "Malformed header field.");
+      return true;
+    }
+    request.headers[to_lower(trim(line.substr(0, colon_pos)))] = trim(line.substr(colon_pos + 1));
+  }
+  request.keep_alive = (version == "HTTP/1.1") && to_lower(request.header("connection")) != "close";
+
+  // Read the request body.
+  if (to_lower(request.header("expect")) == "100-continue" &&
+      !send_all(client.fd, "HTTP/1.1 100 Continue\r\n\r\n", 25)) {
+    return false;
+  }
+  if (to_lower(request.header("transfer-encoding")).find("chunked") != std::string::npos) {
+    if (!read_chunked_body(client, request.body)) {
+      return false;
+    }
+  } else if (!request.header("content-length").empty()) {
+    uint64_t content_length;
+    if (!parse_uint64(request.header("content-length"), content_length)) {
+      request.keep_alive = false;
+      response.set_error(400, "BadRequest", "Invalid Content-Length.");
+      return true;
+    }
+    while (client.buffer.size() < content_length) {
+      if (!receive_more(client)) {
+        return false;
+      }
+    }
+    request.body = client.buffer.substr(0, static_cast<size_t>(content_length));
+    client.buffer.erase(0, static_cast<size_t>(content_length));
+  }
+
+  // Decode signed streaming (SIGV4) uploads.
+  if (to_lower(request.header("content-encoding")).find("aws-chunked") != std::string::npos) {
+    std::string decoded;
+    uint64_t decoded_length;
+    if (!decode_aws_chunked(request.body, decoded) ||
+        !parse_uint64(request.header("x-amz-decoded-content-length"), decoded_length) ||
+        decoded_length != decoded.size()) {
+      response.set_error(400, "IncompleteBody", "Invalid aws-chunked body.");
+      return true;
+    }
+    request.body.swap(decoded);
+  }
+  return true;
+}
+
+bool mock_s3_server_t::read_chunked_body(client_t& client, std::string& body) {
+  while (true) {
+    std::string::size_type line_end;
+    while ((line_end = client.buffer.find("\r\n")) == std::string::npos) {
+      if (!receive_more(client)) {
+        return false;
+      }
+    }
+    const unsigned long size = std::strtoul(client.buffer.c_str(), NULL, 16);
+    client.buffer.erase(0, line_end + 2);
+    if (size == 0) {
+      // Skip the trailer (if any), up to and including the final empty line.
+      while (true) {
+        while ((line_end = client.buffer.find("\r\n")) == std::string::npos) {
+          if (!receive_more(client)) {
+            return false;
+          }
+        }
+        client.buffer.erase(0, line_end + 2);
+        if (line_end == 0) {
+          return true;
+        }
+      }
+    }
+    while (client.buffer.size() < size + 2) {
+      if (!receive_more(client)) {
+        return false;
+      }
+    }
+    body.append(client.buffer, 0, size);
+    client.buffer.erase(0, size + 2);
+  }
+}
+
+bool mock_s3_server_t::is_authorized(const request_t& request) {
+  if (m_options.access_key == NULL) {
+    return true;
+  }
+  const std::string authorization = request.header("authorization");
+
+  // SIGV2: "AWS <access key>:<signature>".
+  if (authorization.compare(0, 4, "AWS ") == 0) {
+    const std::string::size_type colon_pos = authorization.find(':');
+    if (colon_pos == std::string::npos || authorization.substr(4, colon_pos - 4) != m_access_key) {
+      return false;
+    }
+    std::string canonical_amz_headers;
+    for (string_map_t::const_iterator it = request.headers.begin(); it != request.headers.end();
+         ++it) {
+      if (it->first.compare(0, 6, "x-amz-") == 0) {
+        canonical_amz_headers += it->first + ":" + it->second + "\n";
+      }
+    }
+    const std::string date = request.header("x-amz-date").empty() ? request.header("date") : "";
+    const std::string string_to_sign = request.method + "\n" + request.header("content-md5") +
+                                       "\n" + request.header("content-type") + "\n" + date +
+                                       "\n" + canonical_amz_headers +
+                                       sigv2_canonical_resource(request.path, request.query);
+    const result_t<hmac_sha1_t> digest =
+        hmac_sha1(m_secret_key.c_str(), string_to_sign.c_str());
+    return digest.is_success() && authorization.substr(colon_pos + 1) == digest->c_str();
+  }
+
+  // SIGV4: "AWS4-HMAC-SHA256 Credential=<access key>/<scope>, ...".
+  if (authorization.compare(0, 17, "AWS4-HMAC-SHA256 ") == 0) {
+    const std::string::size_type credential_pos = authorization.find("Credential=");
+    if (credential_pos == std::string::npos) {
+      return false;
+    }
+    const std::string::size_type key_start = credential_pos + 11;
+    return authorization.compare(key_start, m_access_key.size(), m_access_key) == 0 &&
+           authorization.compare(key_start + m_access_key.size(), 1, "/") == 0;
+  }
+
+  return false;
+}
+
+void mock_s3_server_t::handle_request(const request_t& request, response_t& response) {
+  {
+    lock_guard_t lock(m_mutex);
+    ++m_stats.requests;
+  }
+
+  if (!is_authorized(request)) {
+    lock_guard_t lock(m_mutex);
+    ++m_stats.auth_failures;
+    response.set_error(403, "SignatureDoesNotMatch", "The request signature does not match.");
+    return;
+  }
+
+  // We only support object requests ("/bucket/key").
+  const std::string::size_type key_pos = request.path.find('/', 1);
+  if (key_pos == std::string::npos || key_pos == 1 || key_pos + 1 == request.path.size()) {
+    response.set_error(501, "NotImplemented", "Only object requests are supported.");
+    return;
+  }
+  if (m_options.root_dir != NULL && !is_safe_path(request.path)) {
+    response.set_error(400, "InvalidURI", "Invalid object path.");
+    return;
+  }
+
+  if (request.method == "GET" || request.method == "HEAD") {
+    if (request.has_param("uploadId") && request.method == "GET") {
+      serve_list_parts(request, response);
+    } else {
+      serve_get(request, response);
+    }
+  } else if (request.method == "PUT") {
+    if (request.has_param("uploadId") && request.has_param("partNumber")) {
+      serve_upload_part(request, response);
+    } else {
+      serve_put(request, response);
+    }
+  } else if (request.method == "POST") {
+    if (request.has_param("uploads")) {
+      serve_initiate_upload(request, response);
+    } else if (request.has_param("uploadId")) {
+      serve_complete_upload(request, response);
+    } else {
+      response.set_error(405, "MethodNotAllowed", "Unsupported POST request.");
+    }
+  } else if (request.method == "DELETE") {
+    if (request.has_param("uploadId")) {
+      serve_abort_upload(request, response);
+    } else {
+      serve_delete(request, response);
+    }
+  } else {
+    response.set_error(405, "MethodNotAllowed", "Unsupported method.");
+  }
+}
+
+void mock_s3_server_t::serve_get(const request_t& request, response_t& response) {
+  object_t object;
+  if (!load_object(request.path, object)) {
+    response.set_error(404, "NoSuchKey", "The specified key does not exist.");
+    return;
+  }
+  const std::string if_match = request.header("if-match");
+  if (!if_match.empty() && if_match != "*" && unquote(if_match) != unquote(object.etag)) {
+    response.set_error(412, "PreconditionFailed", "The ETag does not match.");
+    return;
+  }
+
+  // Range requests: "bytes=first-last", "bytes=first-" or "bytes=-suffix".
+  const uint64_t size = object.data.size();
+  uint64_t first = 0;
+  uint64_t last = (size > 0) ? size - 1 : 0;
+  const std::string range = request.header("range");
+  const bool is_range = !range.empty();
+  if (is_range) {
+    const std::string::size_type dash_pos = range.find('-');
+    const std::string first_str =
+        (range.compare(0, 6, "bytes=") == 0 && dash_pos != std::string::npos)
+            ? range.substr(6, dash_pos - 6)
+            : std::string("x");
+    const std::string last_str =
+        (dash_pos != std::string::npos) ? range.substr(dash_pos + 1) : std::string();
+    uint64_t suffix = 0;
+    bool is_valid = false;
+    if (first_str.empty()) {
+      is_valid = parse_uint64(last_str, suffix) && suffix > 0 && size > 0;
+      first = (suffix < size) ? size - suffix : 0;
+    } else if (parse_uint64(first_str, first)) {
+      is_valid = first < size &&
+                 (last_str.empty() || (parse_uint64(last_str, last) && last >= first));
+      last = std::min(last, size - 1);
+    }
+    if (!is_valid) {
+      response.set_error(416, "InvalidRange", "The requested range is not satisfiable.");
+      response.add_header("Content-Range", "bytes */" + to_string(size));
+      return;
+    }
+  }
+
+  response.status_code = is_range ? 206 : 200;
+  response.add_header("ETag", object.etag);
+  response.add_header("Accept-Ranges", "bytes");
+  response.add_header("Content-Type", "application/octet-stream");
+  if (is_range) {
+    response.add_header(
+        "Content-Range",
+        "bytes " + to_string(first) + "-" + to_string(last) + "/" + to_string(size));
+    response.body = object.data.substr(static_cast<size_t>(first),
+                                       static_cast<size_t>(last - first + 1));
+  } else {
+    response.body.swap(object.data);
+  }
+}
+
+void mock_s3_server_t::serve_put(const request_t& request, response_t& response) {
+  const std::string content_md5 = request.header("content-md5");
+  if (!content_md5.empty() && content_md5 != md5_base64(request.body)) {
+    response.set_error(400, "BadDigest", "The Content-MD5 does not match.");
+    return;
+  }
+  put_object(request.path, request.body);
+  response.status_code = 200;
+  response.add_header("ETag", md5_etag(request.body));
+}
+
+void mock_s3_server_t::serve_delete(const request_t& request, response_t& response) {
+  remove_object(request.path);
+  response.status_code = 204;
+}
+
+void mock_s3_server_t::serve_initiate_upload(const request_t& request, response_t& response) {
+  checksum_t::algorithm_t checksum;
+  if (!parse_checksum_algorithm(request.header("x-amz-checksum-algorithm"), checksum)) {
+    response.set_error(400, "InvalidRequest", "Unsupported checksum algorithm.");
+    return;
+  }
+  std::string upload_id;
+  {
+    lock_guard_t lock(m_mutex);
+    upload_id = "mock-upload-" + to_string(m_next_upload_id++);
+    m_uploads[upload_id].path = request.path;
+    m_uploads[upload_id].checksum = checksum;
+  }
+  const std::string::size_type key_pos = request.path.find('/', 1);
+  response.status_code = 200;
+  response.add_header("Content-Type", "application/xml");
+  response.body =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<InitiateMultipartUploadResult><Bucket>" +
+      xml_escape(request.path.substr(1, key_pos - 1)) + "</Bucket><Key>" +
+      xml_escape(request.path.substr(key_pos + 1)) + "</Key><UploadId>" + xml_escape(upload_id) +
+      "</UploadId></InitiateMultipartUploadResult>";
+}
+
+void mock_s3_server_t::serve_upload_part(const request_t& request, response_t& response) {
+  uint64_t part_number;
+  if (!parse_uint64(request.param("partNumber"), part_number) || part_number < 1 ||
+      part_number > MAX_PARTS) {
+    response.set_error(400, "InvalidArgument", "Invalid part number.");
+    return;
+  }
+  const std::string content_md5 = request.header("content-md5");
+  if (!content_md5.empty() && content_md5 != md5_base64(request.body)) {
+    response.set_error(400, "BadDigest", "The Content-MD5 does not match.");
+    return;
+  }
+  static const checksum_t::algorithm_t ALGORITHMS[] = {checksum_t::CRC32C, checksum_t::CRC64NVME};
+  for (size_t i = 0; i < sizeof(ALGORITHMS) / sizeof(ALGORITHMS[0]); ++i) {
+    const std::string checksum = request.header(checksum_t(ALGORITHMS[i]).header_name());
+    if (!checksum.empty() && checksum != checksum_base64(ALGORITHMS[i], request.body)) {
+      response.set_error(400, "BadDigest", "The checksum does not match.");
+      return;
+    }
+  }
+
+  object_t part;
+  part.data = request.body;
+  part.etag = md5_etag(request.body);
+  {
+    lock_guard_t lock(m_mutex);
+    upload_map_t::iterator upload = m_uploads.find(request.param("uploadId"));
+    if (upload == m_uploads.end() || upload->second.path != request.path) {
+      response.set_error(404, "NoSuchUpload", "The specified upload does not exist.");
+      return;
+    }
+    if (upload->second.checksum != checksum_t::NONE) {
+      part.checksum = checksum_base64(upload->second.checksum, request.body);
+    }
+    upload->second.parts[static_cast<int>(part_number)] = part;
+  }
+  response.status_code = 200;
+  response.add_header("ETag", part.etag);
+}
+
+void mock_s3_server_t::serve_list_parts(const request_t& request, response_t& response) {
+  uint64_t marker = 0;
+  uint64_t max_parts = MAX_LIST_PARTS;
+  if ((request.has_param("part-number-marker") &&
+       !parse_uint64(request.param("part-number-marker"), marker)) ||
+      (request.has_param("max-parts") && !parse_uint64(request.param("max-parts"), max_parts))) {
+    response.set_error(400, "InvalidArgument", "Invalid list parameters.");
+    return;
+  }
+  max_parts = std::min(max_parts, MAX_LIST_PARTS);
+
+  std::ostringstream parts_xml;
+  uint64_t next_marker = marker;
+  bool is_truncated = false;
+  {
+    lock_guard_t lock(m_mutex);
+    upload_map_t::const_iterator upload = m_uploads.find(request.param("uploadId"));
+    if (upload == m_uploads.end() || upload->second.path != request.path) {
+      response.set_error(404, "NoSuchUpload", "The specified upload does not exist.");
+      return;
+    }
+    uint64_t count = 0;
+    for (std::map<int, object_t>::const_iterator it =
+             upload->second.parts.upper_bound(static_cast<int>(marker));
+         it != upload->second.parts.end();
+         ++it) {
+      if (count == max_parts) {
+        is_truncated = true;
+        break;
+      }
+      parts_xml << "<Part><PartNumber>" << it->first << "</PartNumber><ETag>"
+                << xml_escape(it->second.etag) << "</ETag><Size>" << it->second.data.size()
+                << "</Size></Part>";
+      next_marker = static_cast<uint64_t>(it->first);
+      ++count;
+    }
+  }
+
+  response.status_code = 200;
+  response.add_header("Content-Type", "application/xml");
+  response.body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<ListPartsResult><UploadId>" +
+                  xml_escape(request.param("uploadId")) + "</UploadId><PartNumberMarker>" +
+                  to_string(marker) + "</PartNumberMarker><NextPartNumberMarker>" +
+                  to_string(next_marker) + "</NextPartNumberMarker><MaxParts>" +
+                  to_string(max_parts) + "</MaxParts><IsTruncated>" +
+                  (is_truncated ? "true" : "false") + "</IsTruncated>" + parts_xml.str() +
+                  "</ListPartsResult>";
+}
+
+void mock_s3_server_t::serve_complete_upload(const request_t& request, response_t& response) {
+  upload_t upload;
+  {
+    lock_guard_t lock(m_mutex);
+    upload_map_t::iterator it = m_uploads.find(request.param("uploadId"));
+    if (it == m_uploads.end() || it->second.path != request.path) {
+      response.set_error(404, "NoSuchUpload", "The specified upload does not exist.");
+      return;
+    }
+    upload = it->second;
+  }
+
+  // Assemble the object from the listed parts, which must be in ascending order. The ETag of a
+  // multipart object is the MD5 of the concatenated (raw) part MD5s, followed by the part count.
+  // Part checksums are optional, but must match if given.
+  const std::string checksum_tag =
+      std::string("Checksum") + checksum_algorithm_name(upload.checksum);
+  object_t object;
+  md5_t etag_md5;
+  int last_number = 0;
+  int part_count = 0;
+  std::string::size_type pos = 0;
+  std::string part_xml;
+  while (find_xml_element(request.body, "Part", pos, part_xml)) {
+    std::string number_str;
+    std::string etag;
+    std::string::size_type number_pos = 0;
+    std::string::size_type etag_pos = 0;
+    uint64_t number = 0;
+    if (!find_xml_element(part_xml, "PartNumber", number_pos, number_str) ||
+        !find_xml_element(part_xml, "ETag", etag_pos, etag) ||
+        !parse_uint64(number_str, number) || number > MAX_PARTS) {
+      response.set_error(400, "MalformedXML", "Invalid part list.");
+      return;
+    }
+    if (static_cast<int>(number) <= last_number) {
+      response.set_error(400, "InvalidPartOrder", "The parts must be in ascending order.");
+      return;
+    }
+    const std::map<int, object_t>::const_iterator part =
+        upload.parts.find(static_cast<int>(number));
+    if (part == upload.parts.end() || unquote(xml_unescape(etag)) != unquote(part->second.etag)) {
+      response.set_error(400, "InvalidPart", "A part was not found, or its ETag does not match.");
+      return;
+    }
+    std::string part_checksum;
+    std::string::size_type checksum_pos = 0;
+    if (upload.checksum != checksum_t::NONE &&
+        find_xml_element(part_xml, checksum_tag.c_str(), checksum_pos, part_checksum) &&
+        part_checksum != part->second.checksum) {
+      response.set_error(400, "InvalidPart", "The checksum of a part does not match.");
+      return;
+    }
+    object.data += part->second.data;
+    md5_t part_md5;
+    part_md5.update(part->second.data.data(), part->second.data.size());
+    unsigned char digest[md5_t::MD5_RAW_SIZE];
+    part_md5.finalize(digest);
+    etag_md5.update(digest, sizeof(digest));
+    last_number = static_cast<int>(number);
+    ++part_count;
+  }
+  if (part_count == 0) {
+    response.set_error(400, "MalformedXML", "No parts were given.");
+    return;
+  }
+  char etag_hex[md5_t::MD5_HEX_SIZE + 1];
+  etag_md5.finalize_hex(etag_hex);
+  object.etag = std::string("\"") + &etag_hex[0] + "-" +
+                to_string(static_cast<uint64_t>(part_count)) + "\"";
+
+  // The full object checksum (if requested) must match the assembled object.
+  std::string checksum_xml;
+  if (upload.checksum != checksum_t::NONE) {
+    const std::string checksum = checksum_base64(upload.checksum, object.data);
+    const std::string expected = request.header(checksum_t(upload.checksum).header_name());
+    if (!expected.empty() && expected != checksum) {
+      response.set_error(400, "BadDigest", "The full object checksum does not match.");
+      return;
+    }
+    checksum_xml = "<" + checksum_tag + ">" + checksum + "</" + checksum_tag +
+                   "><ChecksumType>FULL_OBJECT</ChecksumType>";
+  }
+  store_object(request.path, object);
+  {
+    lock_guard_t lock(m_mutex);
+    m_uploads.erase(request.param("uploadId"));
+  }
+
+  const std::string::size_type key_pos = request.path.find('/', 1);
+  response.status_code = 200;
+  response.add_header("Content-Type", "application/xml");
+  response.body =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<CompleteMultipartUploadResult><Bucket>" +
+      xml_escape(request.path.substr(1, key_pos - 1)) + "</Bucket><Key>" +
+      xml_escape(request.path.substr(key_pos + 1)) + "</Key><ETag>" + xml_escape(object.etag) +
+      "</ETag>" + checksum_xml + "</CompleteMultipartUploadResult>";
+}
+
+void mock_s3_server_t::serve_abort_upload(const request_t& request, response_t& response) {
+  lock_guard_t lock(m_mutex);
+  if (m_uploads.erase(request.param("uploadId")) == 0) {
+    response.set_error(404, "NoSuchUpload", "The specified upload does not exist.");
+    return;
+  }
+  response.status_code = 204;
+}
+
+bool mock_s3_server_t::send_response(client_t& client,
+                                     const request_t& request,
+                                     const response_t& response) {
+  const bool is_head = (request.method == "HEAD");
+  const bool is_chunked = m_options.chunked_responses && !is_head &&
+                          (response.status_code == 200 || response.status_code == 206);
+
+  std::ostringstream header;
+  header << "HTTP/1.1 " << response.status_code << " " << reason_phrase(response.status_code)
+         << "\r\n";
+  for (size_t i = 0; i < response.headers.size(); ++i) {
+    header << response.headers[i].first << ": " << response.headers[i].second << "\r\n";
+  }
+  if (is_chunked) {
+    header << "Transfer-Encoding: chunked\r\n";
+  } else {
+    header << "Content-Length: " << response.body.size() << "\r\n";
+  }
+  if (!request.keep_alive) {
+    header << "Connection: close\r\n";
+  }
+  header << "\r\n";
+  const std::string header_str = header.str();
+  if (!send_all(client.fd, header_str.data(), header_str.size())) {
+    return false;
+  }
+  if (is_head) {
+    return true;
+  }
+
+  if (is_chunked) {
+    for (size_t pos = 0; pos < response.body.size(); pos += RESPONSE_CHUNK_SIZE) {
+      const size_t size = std::min(RESPONSE_CHUNK_SIZE, response.body.size() - pos);
+      char chunk_header[32];
+      std::snprintf(
+          chunk_header, sizeof(chunk_header), "%lx\r\n", static_cast<unsigned long>(size));
+      if (!send_all(client.fd, chunk_header, std::strlen(chunk_header)) ||
+          !send_all(client.fd, &response.body[pos], size) || !send_all(client.fd, "\r\n", 2)) {
+        return false;
+      }
+    }
+    return send_all(client.fd, "0\r\n\r\n", 5);
+  }
+  return send_all(client.fd, response.body.data(), response.body.size());
+}
+
+bool mock_s3_server_t::load_object(const std::string& path, object_t& object) {
+  if (m_options.root_dir != NULL) {
+    if (!read_file(m_root_dir + path, object.data)) {
+      return false;
+    }
+    object.etag = md5_etag(object.data);
+    return true;
+  }
+  lock_guard_t lock(m_mutex);
+  const object_map_t::const_iterator it = m_objects.find(path);
+  if (it == m_objects.end()) {
+    return false;
+  }
+  object = it->second;
+  return true;
+}
+
+void mock_s3_server_t::store_object(const std::string& path, const object_t& object) {
+  if (m_options.root_dir != NULL) {
+    write_file(m_root_dir + path, object.data);
+    return;
+  }
+  lock_guard_t lock(m_mutex);
+  m_objects[path] = object;
+}
+
+bool mock_s3_server_t::remove_object(const std::string& path) {
+  if (m_options.root_dir != NULL) {
+    return std::remove((m_root_dir + path).c_str()) == 0;
+  }
+  lock_guard_t lock(m_mutex);
+  return m_objects.erase(path) > 0;
+}
+
+bool mock_s3_server_t::is_stopping() {
+  lock_guard_t lock(m_mutex);
+  return m_stopping;
+}
+
+}  // namespace us3
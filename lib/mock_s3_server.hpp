@@ -0,0 +1,176 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_MOCK_S3_SERVER_HPP_
+#define US3_MOCK_S3_SERVER_HPP_
+
+#include "crc.hpp"
+#include "platform.hpp"
+#include "return_value.hpp"
+#include <map>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace us3 {
+
+/// @brief A small S3 stand-in that serves requests on the loopback interface.
+///
+/// The server is meant for integration tests and benchmarks that must run without a network. It
+/// handles path-style requests ("/bucket/key") for:
+///  - GET (including Range and If-Match) and HEAD of objects.
+///  - PUT of objects, with Content-Length, chunked or aws-chunked (SIGV4 streaming) bodies, and
+///    Content-MD5 verification.
+///  - DELETE of objects.
+///  - Multipart uploads (initiate, upload part, list parts, complete and abort).
+///
+/// Connections are kept alive until the client closes them (or sends "Connection: close"), and
+/// each connection is served by its own thread. Objects are kept in memory, or in a directory (in
+/// which case the ETag of an object is always the MD5 of its data).
+///
+/// SIGV2 requests are authenticated by verifying the Authorization header against the configured
+/// credentials. For SIGV4 requests, only the access key of the credential scope is checked.
+///
+/// @note The server is only available on POSIX systems.
+class mock_s3_server_t {
+public:
+  /// @brief Server options.
+  struct options_t {
+    options_t()
+        : port(0), access_key(NULL), secret_key(NULL), root_dir(NULL), chunked_responses(false) {
+    }
+
+    int port;                ///< The port to listen on, or 0 for any free port.
+    const char* access_key;  ///< The accepted access key, or NULL to accept all requests.
+    const char* secret_key;  ///< The secret key for verifying SIGV2 signatures.
+    const char* root_dir;    ///< Directory to keep the objects in, or NULL to keep them in memory.
+    bool chunked_responses;  ///< Send successful responses with Transfer-Encoding: chunked.
+  };
+
+  /// @brief Server statistics.
+  struct stats_t {
+    unsigned long connections;   ///< The number of accepted connections.
+    unsigned long requests;      ///< The number of handled requests.
+    unsigned long auth_failures; ///< The number of requests that failed authentication.
+  };
+
+  mock_s3_server_t();
+  ~mock_s3_server_t();
+
+  /// @brief Start serving requests (in a background thread).
+  /// @param options The server options.
+  /// @returns status_t::SUCCESS for success, otherwise an error code.
+  status_t start(const options_t& options);
+
+  /// @brief Stop serving requests, and close all connections.
+  void stop();
+
+  /// @brief Get the port that the server listens on.
+  int port() const;
+
+  /// @brief Store an object.
+  /// @param path The object path ("/bucket/key").
+  /// @param data The object data.
+  void put_object(const std::string& path, const std::string& data);
+
+  /// @brief Get an object.
+  /// @param path The object path ("/bucket/key").
+  /// @param[out] data The object data.
+  /// @returns true if the object exists.
+  bool get_object(const std::string& path, std::string& data);
+
+  /// @brief Get the server statistics.
+  stats_t get_stats();
+
+private:
+  struct request_t;
+  struct response_t;
+
+  struct object_t {
+    std::string data;
+    std::string etag;
+    std::string checksum;  // Base64 encoded checksum (only for parts of a multipart upload).
+  };
+
+  struct upload_t {
+    upload_t() : checksum(checksum_t::NONE) {
+    }
+
+    std::string path;
+    checksum_t::algorithm_t checksum;  // The full object checksum algorithm, if any.
+    std::map<int, object_t> parts;
+  };
+
+  struct client_t {
+    mock_s3_server_t* server;
+    int fd;
+    std::string buffer;
+  };
+
+  typedef std::map<std::string, object_t> object_map_t;
+  typedef std::map<std::string, upload_t> upload_map_t;
+
+  // Not copyable.
+  mock_s3_server_t(const mock_s3_server_t&);
+  mock_s3_server_t& operator=(const mock_s3_server_t&);
+
+  static void* accept_thread(void* arg);
+  static void* client_thread(void* arg);
+  void serve_client(client_t& client);
+  bool receive_more(client_t& client);
+  bool read_request(client_t& client, request_t& request, response_t& response);
+  bool read_chunked_body(client_t& client, std::string& body);
+  bool is_authorized(const request_t& request);
+  void handle_request(const request_t& request, response_t& response);
+  void serve_get(const request_t& request, response_t& response);
+  void serve_put(const request_t& request, response_t& response);
+  void serve_delete(const request_t& request, response_t& response);
+  void serve_initiate_upload(const request_t& request, response_t& response);
+  void serve_upload_part(const request_t& request, response_t& response);
+  void serve_list_parts(const request_t& request, response_t& response);
+  void serve_complete_upload(const request_t& request, response_t& response);
+  void serve_abort_upload(const request_t& request, response_t& response);
+  bool send_response(client_t& client, const request_t& request, const response_t& response);
+  bool load_object(const std::string& path, object_t& object);
+  void store_object(const std::string& path, const object_t& object);
+  bool remove_object(const std::string& path);
+  bool is_stopping();
+
+  options_t m_options;
+  std::string m_access_key;
+  std::string m_secret_key;
+  std::string m_root_dir;
+  int m_listen_fd;
+  int m_port;
+  bool m_is_running;
+  pthread_t m_accept_thread;
+
+  // Protects all state below (and the object store).
+  mutex_t m_mutex;
+  bool m_stopping;
+  unsigned long m_active_clients;
+  object_map_t m_objects;
+  upload_map_t m_uploads;
+  unsigned long m_next_upload_id;
+  stats_t m_stats;
+};
+
+}  // namespace us3
+
+#endif  // US3_MOCK_S3_SERVER_HPP_
@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "mock_s3_server.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+volatile std::sig_atomic_t s_stop = 0;
+
+void handle_signal(int) {
+  s_stop = 1;
+}
+
+void print_usage(const char* program) {
+  std::fprintf(stderr,
+               "Usage: %s [options]\n"
+               "  -p PORT    The port to listen on (default: any free port)\n"
+               "  -d DIR     Keep the objects in DIR (default: in memory)\n"
+               "  -a KEY     The access key (default: accept all requests)\n"
+               "  -s SECRET  The secret key (for verifying SIGV2 signatures)\n"
+               "  -c         Send chunked GET responses\n",
+               program);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  us3::mock_s3_server_t::options_t options;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    if (std::strcmp(argv[i], "-p") == 0 && has_value) {
+      options.port = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-d") == 0 && has_value) {
+      options.root_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "-a") == 0 && has_value) {
+      options.access_key = argv[++i];
+    } else if (std::strcmp(argv[i], "-s") == 0 && has_value) {
+      options.secret_key = argv[++i];
+    } else if (std::strcmp(argv[i], "-c") == 0) {
+      options.chunked_responses = true;
+    } else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  us3::mock_s3_server_t server;
+  if (server.start(options).is_error()) {
+    std::fprintf(stderr, "Unable to listen on port %d\n", options.port);
+    return 1;
+  }
+  std::printf("Listening on http://127.0.0.1:%d/\n", server.port());
+  std::fflush(stdout);
+
+  std::signal(SIGINT, handle_signal);
+  std::signal(SIGTERM, handle_signal);
+  while (s_stop == 0) {
+    us3::sleep_us(100000);
+  }
+  server.stop();
+  return 0;
+}
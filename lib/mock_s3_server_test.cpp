@@ -0,0 +1,833 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "mock_s3_server.hpp"
+
+#include "connection.hpp"
+#include "recording.hpp"
+#include <us3/us3.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <doctest.h>
+#include <string>
+#include <vector>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+const char* const ACCESS_KEY = "mock-access-key";
+const char* const SECRET_KEY = "mock-secret-key";
+const char* const UPLOAD_FILE_PATH = "mock_s3_server_test.bin";
+const char* const JOURNAL_PATH = "mock_s3_server_test.journal";
+const char* const RECORDING_PATH = "mock_s3_server_test.rec";
+
+// A mock server that is started for the lifetime of the object.
+class server_fixture_t {
+public:
+  explicit server_fixture_t(const bool chunked_responses = false) {
+    us3::mock_s3_server_t::options_t options;
+    options.access_key = ACCESS_KEY;
+    options.secret_key = SECRET_KEY;
+    options.chunked_responses = chunked_responses;
+    REQUIRE(server.start(options).is_success());
+  }
+
+  std::string url(const char* path) const {
+    char port[16];
+    std::snprintf(port, sizeof(port), "%d", server.port());
+    return std::string("http://127.0.0.1:") + port + path;
+  }
+
+  us3::mock_s3_server_t server;
+};
+
+std::string make_data(const size_t size) {
+  std::string data(size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>((i * 7919) >> 8);
+  }
+  return data;
+}
+
+us3_status_t put_object(const std::string& url,
+                        const std::string& data,
+                        const us3_options_t* options,
+                        const char* secret_key = SECRET_KEY) {
+  us3_handle_t handle;
+  us3_status_t status = us3_open_with_options(
+      url.c_str(), ACCESS_KEY, secret_key, US3_WRITE, data.size(), options, &handle);
+  if (status != US3_SUCCESS) {
+    return status;
+  }
+  size_t pos = 0;
+  while (status == US3_SUCCESS && pos < data.size()) {
+    size_t count = 0;
+    status = us3_write(handle, &data[pos], data.size() - pos, &count);
+    pos += count;
+  }
+  const us3_status_t close_status = us3_close(handle);
+  return (status != US3_SUCCESS) ? status : close_status;
+}
+
+us3_status_t get_object(const std::string& url, std::string& data, const us3_options_t* options) {
+  us3_handle_t handle;
+  us3_status_t status =
+      us3_open_with_options(url.c_str(), ACCESS_KEY, SECRET_KEY, US3_READ, 0, options, &handle);
+  if (status != US3_SUCCESS) {
+    return status;
+  }
+  data.clear();
+  char buf[10000];
+  size_t count = 1;
+  while (status == US3_SUCCESS && count > 0) {
+    status = us3_read(handle, buf, sizeof(buf), &count);
+    data.append(buf, count);
+  }
+  const us3_status_t close_status = us3_close(handle);
+  return (status != US3_SUCCESS) ? status : close_status;
+}
+
+std::vector<int> s_events;
+
+void record_event(const us3_event_t* event, void* user_data) {
+  (void)user_data;
+  s_events.push_back(event->type);
+}
+
+// Record events in the std::vector<int> that is given as the user data.
+void record_event_in(const us3_event_t* event, void* user_data) {
+  static_cast<std::vector<int>*>(user_data)->push_back(event->type);
+}
+
+// Allocation functions that count the live allocations.
+struct allocation_counts_t {
+  int allocations;
+  int live;
+};
+
+void* counting_malloc(size_t size, void* user_data) {
+  allocation_counts_t* counts = static_cast<allocation_counts_t*>(user_data);
+  ++counts->allocations;
+  ++counts->live;
+  return std::malloc(size);
+}
+
+void* counting_realloc(void* ptr, size_t size, void* user_data) {
+  allocation_counts_t* counts = static_cast<allocation_counts_t*>(user_data);
+  ++counts->allocations;
+  if (ptr == NULL) {
+    ++counts->live;
+  }
+  return std::realloc(ptr, size);
+}
+
+void counting_free(void* ptr, void* user_data) {
+  if (ptr != NULL) {
+    --static_cast<allocation_counts_t*>(user_data)->live;
+  }
+  std::free(ptr);
+}
+
+}  // namespace
+
+TEST_CASE("Upload and download an object") {
+  // GIVEN
+  server_fixture_t fixture;
+  const std::string data = make_data(300000);
+  us3_options_t options;
+  us3_init_options(&options);
+
+  SUBCASE("SIGV2") {
+    options.signature = US3_SIGNATURE_V2;
+  }
+  SUBCASE("SIGV4") {
+    options.signature = US3_SIGNATURE_V4;
+    options.region = "us-east-1";
+  }
+  SUBCASE("SIGV2 with a checksum and ETag verification") {
+    options.checksum = US3_CHECKSUM_CRC32C;
+    options.verify_etag = 1;
+  }
+  SUBCASE("SIGV4 with a checksum trailer") {
+    options.signature = US3_SIGNATURE_V4;
+    options.region = "us-east-1";
+    options.checksum = US3_CHECKSUM_CRC32C;
+  }
+
+  // WHEN
+  const std::string url = fixture.url("/bucket/path/to/object");
+  REQUIRE_EQ(put_object(url, data, &options), US3_SUCCESS);
+  std::string downloaded;
+  const us3_status_t status = get_object(url, downloaded, &options);
+
+  // THEN
+  CHECK_EQ(status, US3_SUCCESS);
+  CHECK(downloaded == data);
+  std::string stored;
+  REQUIRE(fixture.server.get_object("/bucket/path/to/object", stored));
+  CHECK(stored == data);
+  CHECK_EQ(fixture.server.get_stats().auth_failures, 0);
+}
+
+TEST_CASE("Upload from a buffer with Content-MD5") {
+  // GIVEN
+  server_fixture_t fixture;
+  const std::string data = make_data(1000);
+
+  // WHEN
+  const us3_status_t status = us3_put_buffer(fixture.url("/bucket/object").c_str(),
+                                             ACCESS_KEY,
+                                             SECRET_KEY,
+                                             data.data(),
+                                             data.size(),
+                                             NULL);
+
+  // THEN
+  CHECK_EQ(status, US3_SUCCESS);
+  std::string stored;
+  REQUIRE(fixture.server.get_object("/bucket/object", stored));
+  CHECK(stored == data);
+}
+
+TEST_CASE("Upload an empty object from a buffer") {
+  // GIVEN
+  server_fixture_t fixture;
+  us3_options_t options;
+  us3_init_options(&options);
+
+  SUBCASE("SIGV2") {
+    options.signature = US3_SIGNATURE_V2;
+  }
+  SUBCASE("SIGV4") {
+    options.signature = US3_SIGNATURE_V4;
+  }
+
+  // WHEN
+  const us3_status_t status = us3_put_buffer(
+      fixture.url("/bucket/empty").c_str(), ACCESS_KEY, SECRET_KEY, NULL, 0, &options);
+
+  // THEN
+  CHECK_EQ(status, US3_SUCCESS);
+  std::string stored = "not empty";
+  REQUIRE(fixture.server.get_object("/bucket/empty", stored));
+  CHECK(stored.empty());
+  CHECK_EQ(fixture.server.get_stats().auth_failures, 0);
+}
+
+TEST_CASE("Requests with a bad signature are refused") {
+  // GIVEN
+  server_fixture_t fixture;
+
+  // WHEN
+  const us3_status_t status =
+      put_object(fixture.url("/bucket/object"), make_data(100), NULL, "wrong-secret-key");
+
+  // THEN
+  CHECK_EQ(status, US3_FORBIDDEN);
+  CHECK_EQ(fixture.server.get_stats().auth_failures, 1);
+  std::string stored;
+  CHECK_FALSE(fixture.server.get_object("/bucket/object", stored));
+}
+
+TEST_CASE("Missing objects are not found") {
+  // GIVEN
+  server_fixture_t fixture;
+
+  // WHEN
+  std::string data;
+  const us3_status_t status = get_object(fixture.url("/bucket/missing"), data, NULL);
+
+  // THEN
+  CHECK_EQ(status, US3_NOT_FOUND);
+}
+
+TEST_CASE("Multipart upload of a file") {
+  // GIVEN
+  server_fixture_t fixture;
+  const std::string data = make_data(1000000);
+  std::FILE* file = std::fopen(UPLOAD_FILE_PATH, "wb");
+  REQUIRE(file != static_cast<std::FILE*>(NULL));
+  std::fwrite(data.data(), 1, data.size(), file);
+  std::fclose(file);
+  std::remove(JOURNAL_PATH);
+  us3_options_t options;
+  us3_init_options(&options);
+
+  SUBCASE("Without a checksum") {
+  }
+
+  // The server verifies the part checksums, and the full object checksum that is combined from
+  // them.
+  SUBCASE("SIGV2 with a CRC32C checksum") {
+    options.checksum = US3_CHECKSUM_CRC32C;
+  }
+
+  SUBCASE("SIGV4 with a CRC64NVME checksum") {
+    options.signature = US3_SIGNATURE_V4;
+    options.checksum = US3_CHECKSUM_CRC64NVME;
+  }
+
+  // WHEN (eleven parts, the last one being partial, which are hashed in two batches)
+  const us3_status_t status = us3_upload_file(fixture.url("/bucket/large").c_str(),
+                                              ACCESS_KEY,
+                                              SECRET_KEY,
+                                              UPLOAD_FILE_PATH,
+                                              JOURNAL_PATH,
+                                              95000,
+                                              &options);
+
+  // THEN
+  CHECK_EQ(status, US3_SUCCESS);
+  std::string stored;
+  REQUIRE(fixture.server.get_object("/bucket/large", stored));
+  CHECK(stored == data);
+  std::remove(UPLOAD_FILE_PATH);
+}
+
+TEST_CASE("Chunked responses are decoded") {
+  // GIVEN
+  server_fixture_t fixture(true);
+  const std::string data = make_data(300000);
+
+  SUBCASE("Download an object with checksum and ETag verification") {
+    us3_options_t options;
+    us3_init_options(&options);
+    options.checksum = US3_CHECKSUM_CRC32C;
+    options.verify_etag = 1;
+    const std::string url = fixture.url("/bucket/chunked");
+    REQUIRE_EQ(put_object(url, data, &options), US3_SUCCESS);
+
+    // WHEN
+    std::string downloaded;
+    const us3_status_t status = get_object(url, downloaded, &options);
+
+    // THEN
+    CHECK_EQ(status, US3_SUCCESS);
+    CHECK(downloaded == data);
+  }
+
+  SUBCASE("Multipart upload of a file") {
+    std::FILE* file = std::fopen(UPLOAD_FILE_PATH, "wb");
+    REQUIRE(file != static_cast<std::FILE*>(NULL));
+    std::fwrite(data.data(), 1, data.size(), file);
+    std::fclose(file);
+    std::remove(JOURNAL_PATH);
+
+    // WHEN (the InitiateMultipartUpload and CompleteMultipartUpload responses are chunked)
+    const us3_status_t status = us3_upload_file(fixture.url("/bucket/large").c_str(),
+                                                ACCESS_KEY,
+                                                SECRET_KEY,
+                                                UPLOAD_FILE_PATH,
+                                                JOURNAL_PATH,
+                                                100000,
+                                                NULL);
+
+    // THEN
+    CHECK_EQ(status, US3_SUCCESS);
+    std::string stored;
+    REQUIRE(fixture.server.get_object("/bucket/large", stored));
+    CHECK(stored == data);
+    std::remove(UPLOAD_FILE_PATH);
+  }
+}
+
+TEST_CASE("Statistics and tracing events") {
+  // GIVEN
+  server_fixture_t fixture;
+  fixture.server.put_object("/bucket/object", make_data(5000));
+  us3_hooks_t hooks = {record_event, NULL, NULL};
+  us3_options_t options;
+  us3_init_options(&options);
+  options.hooks = &hooks;
+  s_events.clear();
+
+  // WHEN
+  us3_handle_t handle;
+  REQUIRE_EQ(us3_open_with_options(fixture.url("/bucket/object").c_str(),
+                                   ACCESS_KEY,
+                                   SECRET_KEY,
+                                   US3_READ,
+                                   0,
+                                   &options,
+                                   &handle),
+             US3_SUCCESS);
+  char buf[5000];
+  size_t count = 0;
+  size_t total = 0;
+  while (total < sizeof(buf) && us3_read(handle, &buf[total], sizeof(buf) - total, &count) ==
+                                    US3_SUCCESS) {
+    total += count;
+  }
+  us3_stats_t stats;
+  REQUIRE_EQ(us3_get_stats(handle, &stats), US3_SUCCESS);
+  REQUIRE_EQ(us3_close(handle), US3_SUCCESS);
+
+  // THEN
+  CHECK_EQ(total, 5000);
+  CHECK(stats.bytes_received > 5000);
+  CHECK(stats.bytes_sent > 0);
+  CHECK(stats.headers_parsed_time >= stats.headers_sent_time);
+  CHECK(stats.body_complete_time >= stats.headers_parsed_time);
+  REQUIRE(s_events.size() >= 6);
+  CHECK_EQ(s_events.front(), US3_EVENT_OPEN_START);
+  CHECK_EQ(s_events[1], US3_EVENT_HEADERS_SENT);
+  CHECK_EQ(s_events[2], US3_EVENT_RESPONSE);
+  CHECK_EQ(s_events[3], US3_EVENT_OPEN_END);
+  CHECK_EQ(s_events[4], US3_EVENT_READ);
+  CHECK_EQ(s_events.back(), US3_EVENT_CLOSE);
+}
+
+TEST_CASE("Open streams keep the global hooks that they were opened with") {
+  // GIVEN
+  const std::string response =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "hello";
+  us3_options_t options;
+  us3_init_options(&options);
+  options.transport = US3_TRANSPORT_LOOPBACK;
+  options.loopback_response = response.data();
+  options.loopback_response_size = response.size();
+  std::vector<int> first_events;
+  std::vector<int> second_events;
+  us3_hooks_t hooks;
+  hooks.on_event = record_event_in;
+  hooks.get_request_headers = NULL;
+  hooks.user_data = &first_events;
+  us3_set_global_hooks(&hooks);
+  us3_handle_t handle;
+  REQUIRE_EQ(us3_open_with_options("http://s3.example.com/bucket/hello",
+                                   ACCESS_KEY,
+                                   SECRET_KEY,
+                                   US3_READ,
+                                   0,
+                                   &options,
+                                   &handle),
+             US3_SUCCESS);
+
+  // WHEN (the global hooks are replaced, and the caller's table is changed, while it is open)
+  hooks.user_data = &second_events;
+  us3_set_global_hooks(&hooks);
+  hooks.on_event = NULL;
+  char data[5];
+  size_t count = 0;
+  const us3_status_t read_status = us3_read(handle, &data[0], sizeof(data), &count);
+  const us3_status_t close_status = us3_close(handle);
+  us3_set_global_hooks(NULL);
+
+  // THEN
+  CHECK_EQ(read_status, US3_SUCCESS);
+  CHECK_EQ(close_status, US3_SUCCESS);
+  REQUIRE(first_events.size() >= 2);
+  CHECK_EQ(first_events.front(), US3_EVENT_OPEN_START);
+  CHECK_EQ(first_events.back(), US3_EVENT_CLOSE);
+  CHECK(second_events.empty());
+}
+
+TEST_CASE("The loopback transport serves canned responses") {
+  // GIVEN (no server, only a canned response)
+  const std::string response =
+      "HTTP/1.1 200 OK\r\n"
+      "ETag: \"5d41402abc4b2a76b9719d911017c592\"\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "hello";
+  us3_options_t options;
+  us3_init_options(&options);
+  options.transport = US3_TRANSPORT_LOOPBACK;
+  options.loopback_response = response.data();
+  options.loopback_response_size = response.size();
+  options.loopback_segment_size = 7;
+  options.verify_etag = 1;
+
+  // WHEN
+  std::string data;
+  const us3_status_t status = get_object("http://s3.example.com/bucket/hello", data, &options);
+
+  // THEN
+  CHECK_EQ(status, US3_SUCCESS);
+  CHECK_EQ(data, "hello");
+}
+
+TEST_CASE("The response is parsed into a caller supplied arena") {
+  // GIVEN (a response that arrives in small segments, with a repeated field)
+  const std::string response =
+      "HTTP/1.1 200 OK\r\n"
+      "X-Amz-Meta-Color:  red \r\n"
+      "x-amz-meta-color: blue\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "hello";
+  us3::net::loopback_config_t loopback;
+  loopback.response = response.data();
+  loopback.response_size = response.size();
+  loopback.segment_size = 7;
+  char arena[512];
+  us3::connection_t::options_t options;
+  options.transport = &us3::net::loopback_transport();
+  options.transport_data = &loopback;
+  options.arena = &arena[0];
+  options.arena_size = sizeof(arena);
+  us3::connection_t connection;
+
+  // WHEN
+  REQUIRE(connection
+              .open("s3.example.com", 80, "/bucket/hello", "ak", "sk", connection.READ, 0, options)
+              .is_success());
+  char data[5];
+  const us3::result_t<size_t> count = connection.read(&data[0], sizeof(data));
+
+  // THEN
+  CHECK(std::string(*connection.get_status_line()) == "HTTP/1.1 200 OK");
+  const us3::result_t<const char*> color = connection.get_response_field("x-amz-meta-color");
+  REQUIRE(color.is_success());
+  CHECK(std::string(*color) == "blue");
+  CHECK(*color > &arena[0]);
+  CHECK(*color < &arena[sizeof(arena)]);
+  CHECK(*count == 5);
+  CHECK(std::string(&data[0], 5) == "hello");
+  CHECK(connection.close().is_success());
+}
+
+TEST_CASE("Streams can be opened in caller provided storage") {
+  // GIVEN
+  const std::string response =
+      "HTTP/1.1 200 OK\r\n"
+      "x-amz-meta-color: blue\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "hello";
+  us3_options_t options;
+  us3_init_options(&options);
+  options.transport = US3_TRANSPORT_LOOPBACK;
+  options.loopback_response = response.data();
+  options.loopback_response_size = response.size();
+  options.loopback_segment_size = 7;
+  static char buffer[US3_HANDLE_STORAGE_SIZE + US3_HANDLE_STORAGE_ALIGNMENT];
+  const size_t misalignment = reinterpret_cast<size_t>(&buffer[0]) % us3_handle_storage_alignment();
+  char* storage = &buffer[(misalignment != 0) ? us3_handle_storage_alignment() - misalignment : 0];
+  const char* const url = "http://s3.example.com/bucket/hello";
+
+  // THEN
+  CHECK(us3_handle_storage_size() <= US3_HANDLE_STORAGE_SIZE);
+  CHECK_EQ(us3_handle_storage_alignment(), US3_HANDLE_STORAGE_ALIGNMENT);
+
+  SUBCASE("Read an object (twice, reusing the storage)") {
+    for (int i = 0; i < 2; ++i) {
+      // WHEN
+      us3_handle_t handle;
+      REQUIRE_EQ(us3_open_inplace(storage,
+                                  US3_HANDLE_STORAGE_SIZE,
+                                  url,
+                                  ACCESS_KEY,
+                                  SECRET_KEY,
+                                  US3_READ,
+                                  0,
+                                  &options,
+                                  &handle),
+                 US3_SUCCESS);
+      char data[5];
+      size_t count = 0;
+      const us3_status_t read_status = us3_read(handle, &data[0], sizeof(data), &count);
+      const char* color = NULL;
+      const us3_status_t field_status = us3_get_response_field(handle, "x-amz-meta-color", &color);
+
+      // THEN (the handle and the response live in the storage)
+      CHECK(reinterpret_cast<char*>(handle) == storage);
+      CHECK_EQ(read_status, US3_SUCCESS);
+      CHECK(std::string(&data[0], count) == "hello");
+      REQUIRE_EQ(field_status, US3_SUCCESS);
+      CHECK(std::string(color) == "blue");
+      CHECK(color > storage);
+      CHECK(color < storage + US3_HANDLE_STORAGE_SIZE);
+      CHECK_EQ(us3_close(handle), US3_SUCCESS);
+    }
+  }
+
+  SUBCASE("Responses that arrive one byte at a time are read") {
+    // GIVEN (each header line is only stored once, although it arrives in many reads)
+    const std::string trickled_response =
+        "HTTP/1.1 200 OK\r\n"
+        "x-amz-meta-color: " + std::string(100, 'b') + "\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+    options.loopback_response = trickled_response.data();
+    options.loopback_response_size = trickled_response.size();
+    options.loopback_segment_size = 1;
+
+    // WHEN
+    us3_handle_t handle;
+    REQUIRE_EQ(us3_open_inplace(storage,
+                                US3_HANDLE_STORAGE_SIZE,
+                                url,
+                                ACCESS_KEY,
+                                SECRET_KEY,
+                                US3_READ,
+                                0,
+                                &options,
+                                &handle),
+               US3_SUCCESS);
+    char data[5];
+    size_t total = 0;
+    us3_status_t read_status = US3_SUCCESS;
+    while (read_status == US3_SUCCESS && total < sizeof(data)) {
+      size_t count = 0;
+      read_status = us3_read(handle, &data[total], sizeof(data) - total, &count);
+      total += count;
+    }
+    const char* color = NULL;
+    const us3_status_t field_status = us3_get_response_field(handle, "x-amz-meta-color", &color);
+
+    // THEN
+    CHECK_EQ(read_status, US3_SUCCESS);
+    CHECK(std::string(&data[0], total) == "hello");
+    REQUIRE_EQ(field_status, US3_SUCCESS);
+    CHECK(std::string(color) == std::string(100, 'b'));
+    CHECK_EQ(us3_close(handle), US3_SUCCESS);
+  }
+
+  SUBCASE("Too small or misaligned storage is rejected") {
+    us3_handle_t handle;
+    CHECK_EQ(us3_open_inplace(storage,
+                              us3_handle_storage_size() - 1,
+                              url,
+                              ACCESS_KEY,
+                              SECRET_KEY,
+                              US3_READ,
+                              0,
+                              &options,
+                              &handle),
+             US3_INVALID_ARGUMENT);
+    CHECK_EQ(us3_open_inplace(storage + 1,
+                              US3_HANDLE_STORAGE_SIZE - 1,
+                              url,
+                              ACCESS_KEY,
+                              SECRET_KEY,
+                              US3_READ,
+                              0,
+                              &options,
+                              &handle),
+             US3_INVALID_ARGUMENT);
+  }
+
+  SUBCASE("Responses that do not fit in the storage fail") {
+    // GIVEN
+    const std::string big_response =
+        "HTTP/1.1 200 OK\r\n"
+        "x-amz-meta-big: " + std::string(8192, 'x') + "\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+    options.loopback_response = big_response.data();
+    options.loopback_response_size = big_response.size();
+
+    // WHEN
+    us3_handle_t handle;
+    const us3_status_t status = us3_open_inplace(storage,
+                                                 US3_HANDLE_STORAGE_SIZE,
+                                                 url,
+                                                 ACCESS_KEY,
+                                                 SECRET_KEY,
+                                                 US3_READ,
+                                                 0,
+                                                 &options,
+                                                 &handle);
+
+    // THEN
+    CHECK_EQ(status, US3_ERROR);
+  }
+}
+
+TEST_CASE("In-place streams fit the documented response header size") {
+  // GIVEN (a response header that fills the documented header space of the recommended storage,
+  // with each line costing its length plus 48 bytes)
+  const size_t header_space = (US3_HANDLE_STORAGE_SIZE - us3_handle_storage_size() + 992) & ~15U;
+  const std::string status_line = "HTTP/1.1 200 OK\r\n";
+  const std::string length_line = "Content-Length: 5\r\n";
+  std::string header = status_line + length_line;
+  size_t used = status_line.size() + length_line.size() + 3 * 48 + 2;
+  const size_t field_size = 100;
+  int field_count = 0;
+  for (; used + field_size + 48 <= header_space; used += field_size + 48, ++field_count) {
+    char name[32];
+    std::sprintf(&name[0], "x-amz-meta-field%02d: ", field_count);
+    header += name + std::string(field_size - std::strlen(&name[0]) - 2, 'v') + "\r\n";
+  }
+  const std::string response = header + "\r\n" + "hello";
+  us3_options_t options;
+  us3_init_options(&options);
+  options.transport = US3_TRANSPORT_LOOPBACK;
+  options.loopback_response = response.data();
+  options.loopback_response_size = response.size();
+  static char buffer[US3_HANDLE_STORAGE_SIZE + US3_HANDLE_STORAGE_ALIGNMENT];
+  const size_t misalignment = reinterpret_cast<size_t>(&buffer[0]) % us3_handle_storage_alignment();
+  char* storage = &buffer[(misalignment != 0) ? us3_handle_storage_alignment() - misalignment : 0];
+  REQUIRE(field_count >= 20);
+
+  // The header is stored once, however it is split into reads.
+  const size_t SEGMENT_SIZES[] = {1, 3, 64, 0};
+  for (size_t i = 0; i < sizeof(SEGMENT_SIZES) / sizeof(SEGMENT_SIZES[0]); ++i) {
+    CAPTURE(SEGMENT_SIZES[i]);
+    options.loopback_segment_size = SEGMENT_SIZES[i];
+
+    // WHEN
+    us3_handle_t handle;
+    REQUIRE_EQ(us3_open_inplace(storage,
+                                US3_HANDLE_STORAGE_SIZE,
+                                "http://s3.example.com/bucket/hello",
+                                ACCESS_KEY,
+                                SECRET_KEY,
+                                US3_READ,
+                                0,
+                                &options,
+                                &handle),
+               US3_SUCCESS);
+    char data[5];
+    size_t total = 0;
+    us3_status_t read_status = US3_SUCCESS;
+    while (read_status == US3_SUCCESS && total < sizeof(data)) {
+      size_t count = 0;
+      read_status = us3_read(handle, &data[total], sizeof(data) - total, &count);
+      total += count;
+    }
+    const char* last_field = NULL;
+    char last_name[32];
+    std::sprintf(&last_name[0], "x-amz-meta-field%02d", field_count - 1);
+    const us3_status_t field_status = us3_get_response_field(handle, &last_name[0], &last_field);
+
+    // THEN
+    CHECK_EQ(read_status, US3_SUCCESS);
+    CHECK(std::string(&data[0], total) == "hello");
+    CHECK_EQ(field_status, US3_SUCCESS);
+    CHECK_EQ(us3_close(handle), US3_SUCCESS);
+  }
+}
+
+TEST_CASE("Streams use the allocation functions of the application") {
+  // GIVEN
+  const std::string response =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "hello";
+  us3_options_t options;
+  us3_init_options(&options);
+  options.transport = US3_TRANSPORT_LOOPBACK;
+  options.loopback_response = response.data();
+  options.loopback_response_size = response.size();
+  allocation_counts_t counts = {0, 0};
+  us3_set_allocator(counting_malloc, counting_realloc, counting_free, &counts);
+
+  // WHEN
+  us3_handle_t handle;
+  const us3_status_t open_status =
+      us3_open_with_options("http://s3.example.com/a-bucket-with-a-long-name/hello",
+                            ACCESS_KEY,
+                            SECRET_KEY,
+                            US3_READ,
+                            0,
+                            &options,
+                            &handle);
+  const int open_allocations = counts.allocations;
+  char data[5];
+  size_t count = 0;
+  const us3_status_t read_status = us3_read(handle, &data[0], sizeof(data), &count);
+  const us3_status_t close_status = us3_close(handle);
+  us3_set_allocator(NULL, NULL, NULL, NULL);
+
+  // THEN
+  REQUIRE_EQ(open_status, US3_SUCCESS);
+  CHECK_EQ(read_status, US3_SUCCESS);
+  CHECK(std::string(&data[0], count) == "hello");
+  CHECK_EQ(close_status, US3_SUCCESS);
+  CHECK(open_allocations > 0);
+  CHECK_EQ(counts.live, 0);
+}
+
+TEST_CASE("The Unix socket transport requires a path") {
+  // GIVEN
+  us3_options_t options;
+  us3_init_options(&options);
+  options.transport = US3_TRANSPORT_UNIX;
+
+  // WHEN
+  std::string data;
+  const us3_status_t status = get_object("http://s3.example.com/bucket/hello", data, &options);
+
+  // THEN
+  CHECK_EQ(status, US3_INVALID_ARGUMENT);
+}
+
+TEST_CASE("Recorded traffic can be replayed") {
+  // GIVEN
+  std::remove(RECORDING_PATH);
+  server_fixture_t fixture;
+  const std::string data = make_data(100000);
+  REQUIRE_EQ(put_object(fixture.url("/bucket/recorded"), data, NULL), US3_SUCCESS);
+  us3_options_t options;
+  us3_init_options(&options);
+  options.record_path = RECORDING_PATH;
+  std::string recorded_data;
+  REQUIRE_EQ(get_object(fixture.url("/bucket/recorded"), recorded_data, &options), US3_SUCCESS);
+  fixture.server.stop();
+
+  // WHEN
+  us3::net::replay_t replay;
+  REQUIRE(replay.load(RECORDING_PATH).is_success());
+  us3::connection_t::options_t connection_options;
+  connection_options.transport = &us3::net::replay_t::transport();
+  connection_options.transport_data = &replay;
+  us3::connection_t connection;
+  REQUIRE(connection
+              .open("127.0.0.1",
+                    fixture.server.port(),
+                    "/bucket/recorded",
+                    ACCESS_KEY,
+                    SECRET_KEY,
+                    us3::connection_t::READ,
+                    0,
+                    connection_options)
+              .is_success());
+  std::string replayed_data;
+  char buf[10000];
+  while (true) {
+    const us3::result_t<size_t> count = connection.read(buf, sizeof(buf));
+    REQUIRE(count.is_success());
+    if (*count == 0) {
+      break;
+    }
+    replayed_data.append(buf, *count);
+  }
+  connection.close();
+
+  // THEN
+  REQUIRE_EQ(replay.connections().size(), 1);
+  CHECK_EQ(replay.connections()[0].host, "127.0.0.1");
+  CHECK_EQ(replay.connections()[0].sent_data().compare(0, 21, "GET /bucket/recorded "), 0);
+  CHECK_EQ(recorded_data, data);
+  CHECK_EQ(replayed_data, data);
+  std::remove(RECORDING_PATH);
+}
@@ -0,0 +1,778 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "multipart.hpp"
+
+#include "crc.hpp"
+#include "md5.hpp"
+#include "platform.hpp"
+#include "retry_policy.hpp"
+#include "upload_journal.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+namespace us3 {
+
+namespace {
+
+// The largest response body that we accept (a ListParts page of 1000 parts is ~250 KiB).
+const size_t MAX_RESPONSE_SIZE = 4 * 1024 * 1024;
+
+// The size of the buffer that is used for reading the file.
+const size_t FILE_BUFFER_SIZE = 65536;
+
+// The number of parts that are hashed together (see md5_update_multi()).
+const size_t MD5_BATCH_SIZE = 8;
+
+// An uploaded part, and its checksum (if the upload uses an additional checksum).
+struct completed_part_t {
+  std::string etag;
+  checksum_t checksum;
+};
+
+typedef std::map<int, completed_part_t> part_map_t;
+
+std::string uint64_to_string(const uint64_t x) {
+  std::ostringstream str;
+  str << x;
+  return str.str();
+}
+
+std::string xml_unescape(const std::string& str) {
+  static const char* const ENTITIES[][2] = {{"&quot;", "\""},
+                                            {"&apos;", "'"},
+                                            {"&lt;", "<"},
+                                            {"&gt;", ">"},
+                                            {"&amp;", "&"},
+                                            {"&#34;", "\""}};
+  std::string result;
+  std::string::size_type pos = 0;
+  while (pos < str.size()) {
+    bool found = false;
+    if (str[pos] == '&') {
+      for (size_t i = 0; i < sizeof(ENTITIES) / sizeof(ENTITIES[0]); ++i) {
+        const size_t length = std::strlen(ENTITIES[i][0]);
+        if (str.compare(pos, length, ENTITIES[i][0]) == 0) {
+          result += ENTITIES[i][1];
+          pos += length;
+          found = true;
+          break;
+        }
+      }
+    }
+    if (!found) {
+      result += str[pos];
+      ++pos;
+    }
+  }
+  return result;
+}
+
+std::string xml_escape(const std::string& str) {
+  std::string result;
+  for (std::string::size_type i = 0; i < str.size(); ++i) {
+    switch (str[i]) {
+      case '&':
+        result += "&amp;";
+        break;
+      case '<':
+        result += "&lt;";
+        break;
+      case '>':
+        result += "&gt;";
+        break;
+      default:
+        result += str[i];
+    }
+  }
+  return result;
+}
+
+// Find the next <tag>...</tag> element at or after pos, and get its (unescaped) text.
+bool find_xml_element(const std::string& xml,
+                      const char* tag,
+                      std::string::size_type& pos,
+                      std::string& value) {
+  const std::string open_tag = std::string("<") + tag + ">";
+  const std::string close_tag = std::string("</") + tag + ">";
+  const std::string::size_type start = xml.find(open_tag, pos);
+  if (start == std::string::npos) {
+    return false;
+  }
+  const std::string::size_type end = xml.find(close_tag, start + open_tag.size());
+  if (end == std::string::npos) {
+    return false;
+  }
+  value = xml_unescape(xml.substr(start + open_tag.size(), end - start - open_tag.size()));
+  pos = end + close_tag.size();
+  return true;
+}
+
+bool parse_uint64(const std::string& str, uint64_t& value) {
+  if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  std::istringstream stream(str);
+  stream >> value;
+  return !stream.fail();
+}
+
+// Percent-encode a query parameter value (everything except unreserved characters).
+std::string url_encode(const std::string& str) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  std::string result;
+  for (std::string::size_type i = 0; i < str.size(); ++i) {
+    const unsigned char c = static_cast<unsigned char>(str[i]);
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' ||
+        c == '_' || c == '.' || c == '~') {
+      result += static_cast<char>(c);
+    } else {
+      result += '%';
+      result += HEX_DIGITS[c >> 4];
+      result += HEX_DIGITS[c & 15];
+    }
+  }
+  return result;
+}
+
+std::string unquote(const std::string& etag) {
+  if (etag.size() >= 2 && etag[0] == '"' && etag[etag.size() - 1] == '"') {
+    return etag.substr(1, etag.size() - 2);
+  }
+  return etag;
+}
+
+// Check if an ETag is the MD5 of the part data (it is not for e.g. SSE-KMS encrypted objects).
+bool is_md5_etag(const std::string& etag) {
+  const std::string hex = unquote(etag);
+  return hex.size() == md5_t::MD5_HEX_SIZE &&
+         hex.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos;
+}
+
+// The S3 name of a checksum algorithm, e.g. for the x-amz-checksum-algorithm header.
+const char* checksum_algorithm_name(const checksum_t::algorithm_t algorithm) {
+  return (algorithm == checksum_t::CRC64NVME) ? "CRC64NVME" : "CRC32C";
+}
+
+bool is_same_md5(const std::string& etag, const char* md5_hex) {
+  const std::string hex = unquote(etag);
+  if (hex.size() != md5_t::MD5_HEX_SIZE) {
+    return false;
+  }
+  for (size_t i = 0; i < md5_t::MD5_HEX_SIZE; ++i) {
+    if (std::tolower(static_cast<unsigned char>(hex[i])) != md5_hex[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Retries a request according to a retry policy.
+class retry_state_t {
+public:
+  explicit retry_state_t(const retry_policy_t& policy)
+      : m_policy(policy),
+        m_retry_count(0),
+        m_random_state(static_cast<uint64_t>(get_monotonic_time_us())) {
+  }
+
+  // Check if a failed request should be retried, and if so, wait before the retry.
+  bool should_retry(const status_t::status_enum_t status) {
+    if (!m_policy.is_retryable(status) || m_retry_count + 1 >= m_policy.max_attempts) {
+      return false;
+    }
+    sleep_us(m_policy.backoff_delay(m_retry_count, next_random(m_random_state)));
+    ++m_retry_count;
+    return true;
+  }
+
+private:
+  const retry_policy_t m_policy;
+  int m_retry_count;
+  uint64_t m_random_state;
+};
+
+// The target of a multipart upload.
+struct upload_context_t {
+  std::string host;
+  int port;
+  std::string path;
+  std::string access_key;
+  std::string secret_key;
+  connection_t::options_t options;
+  retry_policy_t retry;
+  checksum_t::algorithm_t checksum;  // Full object checksum algorithm (sent with each part).
+};
+
+status_t read_response_body(connection_t& connection, std::string& body) {
+  const result_t<size_t> content_length = connection.get_content_length();
+  if (content_length.is_error()) {
+    // Chunked response: Read until the end of the stream.
+    body.clear();
+    char buf[1024];
+    while (true) {
+      const result_t<size_t> count = connection.read(&buf[0], sizeof(buf));
+      if (count.is_error()) {
+        return make_result(count.status());
+      }
+      if (*count == 0) {
+        return make_result(status_t::SUCCESS);
+      }
+      if (body.size() + *count > MAX_RESPONSE_SIZE) {
+        return make_result(status_t::ERROR);
+      }
+      body.append(&buf[0], *count);
+    }
+  }
+  if (*content_length > MAX_RESPONSE_SIZE) {
+    return make_result(status_t::ERROR);
+  }
+  body.resize(*content_length);
+  size_t pos = 0;
+  while (pos < body.size()) {
+    const result_t<size_t> count = connection.read(&body[pos], body.size() - pos);
+    if (count.is_error()) {
+      return make_result(count.status());
+    }
+    if (*count == 0) {
+      return make_result(status_t::CONNECTION_RESET);
+    }
+    pos += *count;
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+// Send a request with a small (or no) body, and read the response body.
+status_t send_request(const upload_context_t& context,
+                      const char* method,
+                      const std::string& query,
+                      const std::string& body,
+                      std::string& response) {
+  connection_t::options_t options = context.options;
+  options.method = method;
+  options.body = body.empty() ? NULL : body.c_str();
+  const std::string path = context.path + "?" + query;
+
+  connection_t connection;
+  status_t::status_enum_t status = connection
+                                       .open(context.host.c_str(),
+                                             context.port,
+                                             path.c_str(),
+                                             context.access_key.c_str(),
+                                             context.secret_key.c_str(),
+                                             connection_t::READ,
+                                             0,
+                                             options)
+                                       .status();
+  response.clear();
+  if (status == status_t::SUCCESS) {
+    status = read_response_body(connection, response).status();
+  }
+
+  // CompleteMultipartUpload can fail after the "200 OK" response headers have been sent.
+  if (status == status_t::SUCCESS && response.find("<Error>") != std::string::npos) {
+    status = status_t::SERVER_ERROR;
+  }
+  return make_result(status);
+}
+
+status_t send_request_with_retries(const upload_context_t& context,
+                                   const char* method,
+                                   const std::string& query,
+                                   const std::string& body,
+                                   std::string& response) {
+  retry_state_t retry(context.retry);
+  status_t::status_enum_t status;
+  do {
+    status = send_request(context, method, query, body, response).status();
+  } while (retry.should_retry(status));
+  return make_result(status);
+}
+
+status_t initiate_upload(const upload_context_t& context, std::string& upload_id) {
+  // Ask for a full object checksum, which can be combined from the part checksums.
+  upload_context_t initiate_context = context;
+  const connection_t::amz_header_t headers[] = {
+      {"x-amz-checksum-algorithm", checksum_algorithm_name(context.checksum)},
+      {"x-amz-checksum-type", "FULL_OBJECT"}};
+  if (context.checksum != checksum_t::NONE) {
+    initiate_context.options.amz_headers = &headers[0];
+    initiate_context.options.amz_header_count = sizeof(headers) / sizeof(headers[0]);
+  }
+
+  std::string response;
+  const status_t result =
+      send_request_with_retries(initiate_context, "POST", "uploads", "", response);
+  if (result.is_error()) {
+    return result;
+  }
+  std::string::size_type pos = 0;
+  if (!find_xml_element(response, "UploadId", pos, upload_id) || upload_id.empty()) {
+    return make_result(status_t::ERROR);
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+status_t list_parts(const upload_context_t& context,
+                    const std::string& upload_id,
+                    std::vector<listed_part_t>& parts) {
+  int marker = 0;
+  bool is_truncated = true;
+  while (is_truncated) {
+    std::string query = "uploadId=" + url_encode(upload_id);
+    if (marker > 0) {
+      query += "&part-number-marker=" + uint64_to_string(static_cast<uint64_t>(marker));
+    }
+    std::string response;
+    const status_t result = send_request_with_retries(context, NULL, query, "", response);
+    if (result.is_error()) {
+      return result;
+    }
+    int next_marker = 0;
+    is_truncated = parse_list_parts(response, parts, next_marker);
+    if (is_truncated && next_marker <= marker) {
+      return make_result(status_t::ERROR);
+    }
+    marker = next_marker;
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+// Read the next block of at most FILE_BUFFER_SIZE (and at most left) bytes from a file.
+size_t read_file(std::FILE* file, std::vector<char>& buffer, const uint64_t left) {
+  const size_t size = static_cast<size_t>(std::min<uint64_t>(left, buffer.size()));
+  return std::fread(&buffer[0], 1, size, file);
+}
+
+// The hashes of a part: The MD5 (for the ETag and the Content-MD5 header), and the checksum.
+struct part_hashes_t {
+  char md5_hex[md5_t::MD5_HEX_SIZE + 1];
+  char md5_base64[md5_t::MD5_BASE64_SIZE + 1];
+  checksum_t checksum;
+};
+
+// Calculate the hashes of up to MD5_BATCH_SIZE parts of a file. The parts are read one block at a
+// time in turn, so that their MD5 can be calculated in parallel.
+bool get_parts_hashes(std::FILE* file,
+                      const uint64_t* offsets,
+                      const uint64_t* sizes,
+                      const size_t count,
+                      const checksum_t::algorithm_t algorithm,
+                      part_hashes_t* part_hashes) {
+  std::vector<char> buffer(count * FILE_BUFFER_SIZE);
+  md5_t hashes[MD5_BATCH_SIZE];
+  md5_t* hash_ptrs[MD5_BATCH_SIZE];
+  uint64_t positions[MD5_BATCH_SIZE];
+  for (size_t i = 0; i < count; ++i) {
+    hash_ptrs[i] = &hashes[i];
+    positions[i] = 0;
+    part_hashes[i].checksum = checksum_t(algorithm);
+  }
+
+  bool has_data = true;
+  while (has_data) {
+    const void* data[MD5_BATCH_SIZE];
+    size_t data_sizes[MD5_BATCH_SIZE];
+    has_data = false;
+    for (size_t i = 0; i < count; ++i) {
+      char* part_buffer = &buffer[i * FILE_BUFFER_SIZE];
+      const size_t size =
+          static_cast<size_t>(std::min<uint64_t>(sizes[i] - positions[i], FILE_BUFFER_SIZE));
+      if (size > 0) {
+        if (!seek_file(file, offsets[i] + positions[i]) ||
+            std::fread(part_buffer, 1, size, file) != size) {
+          return false;
+        }
+        positions[i] += size;
+        part_hashes[i].checksum.update(part_buffer, size);
+        has_data = true;
+      }
+      data[i] = part_buffer;
+      data_sizes[i] = size;
+    }
+    if (has_data) {
+      md5_update_multi(&hash_ptrs[0], &data[0], &data_sizes[0], count);
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    md5_t hash_copy = hashes[i];
+    hashes[i].finalize_hex(part_hashes[i].md5_hex);
+    hash_copy.finalize_base64(part_hashes[i].md5_base64);
+  }
+  return true;
+}
+
+status_t upload_part(const upload_context_t& context,
+                     std::FILE* file,
+                     const std::string& upload_id,
+                     const int number,
+                     const uint64_t offset,
+                     const uint64_t size,
+                     const part_hashes_t& hashes,
+                     std::string& etag) {
+  connection_t::options_t options = context.options;
+  options.content_md5 = &hashes.md5_base64[0];
+  char checksum_base64[checksum_t::MAX_BASE64_SIZE + 1];
+  connection_t::amz_header_t checksum_header = {hashes.checksum.header_name(), NULL};
+  if (checksum_header.name != NULL) {
+    hashes.checksum.to_base64(checksum_base64);
+    checksum_header.value = &checksum_base64[0];
+    options.amz_headers = &checksum_header;
+    options.amz_header_count = 1;
+  }
+  const std::string path = context.path + "?partNumber=" +
+                           uint64_to_string(static_cast<uint64_t>(number)) +
+                           "&uploadId=" + url_encode(upload_id);
+
+  connection_t connection;
+  const status_t open_result = connection.open(context.host.c_str(),
+                                               context.port,
+                                               path.c_str(),
+                                               context.access_key.c_str(),
+                                               context.secret_key.c_str(),
+                                               connection_t::WRITE,
+                                               static_cast<size_t>(size),
+                                               options);
+  if (open_result.is_error()) {
+    return open_result;
+  }
+
+  // Send the part data. The final write also reads the HTTP response.
+  if (!seek_file(file, offset)) {
+    return make_result(status_t::ERROR);
+  }
+  std::vector<char> buffer(FILE_BUFFER_SIZE);
+  uint64_t left = size;
+  while (left > 0) {
+    const size_t count = read_file(file, buffer, left);
+    if (count == 0) {
+      return make_result(status_t::ERROR);
+    }
+    size_t sent = 0;
+    while (sent < count) {
+      const result_t<size_t> result = connection.write(&buffer[sent], count - sent);
+      if (result.is_error()) {
+        return make_result(result.status());
+      }
+      sent += *result;
+    }
+    left -= count;
+  }
+
+  const result_t<const char*> etag_field = connection.get_response_field("etag");
+  if (etag_field.is_error()) {
+    return make_result(status_t::ERROR);
+  }
+  etag = *etag_field;
+  return connection.close();
+}
+
+status_t complete_upload(const upload_context_t& context,
+                         const std::string& upload_id,
+                         const part_map_t& parts,
+                         const checksum_t& checksum) {
+  const std::string checksum_tag =
+      std::string("Checksum") + checksum_algorithm_name(checksum.algorithm());
+  std::ostringstream body;
+  body << "<CompleteMultipartUpload>";
+  for (part_map_t::const_iterator it = parts.begin(); it != parts.end(); ++it) {
+    body << "<Part><PartNumber>" << it->first << "</PartNumber><ETag>"
+         << xml_escape(it->second.etag) << "</ETag>";
+    if (checksum.algorithm() != checksum_t::NONE) {
+      char part_base64[checksum_t::MAX_BASE64_SIZE + 1];
+      it->second.checksum.to_base64(part_base64);
+      body << "<" << checksum_tag << ">" << &part_base64[0] << "</" << checksum_tag << ">";
+    }
+    body << "</Part>";
+  }
+  body << "</CompleteMultipartUpload>";
+
+  // The server rejects the upload if the full object checksum (combined from the part checksums)
+  // does not match the assembled object.
+  upload_context_t complete_context = context;
+  char base64[checksum_t::MAX_BASE64_SIZE + 1];
+  const connection_t::amz_header_t headers[] = {{"x-amz-checksum-type", "FULL_OBJECT"},
+                                                {checksum.header_name(), &base64[0]}};
+  if (checksum.algorithm() != checksum_t::NONE) {
+    checksum.to_base64(base64);
+    complete_context.options.amz_headers = &headers[0];
+    complete_context.options.amz_header_count = sizeof(headers) / sizeof(headers[0]);
+  }
+
+  std::string response;
+  const status_t result = send_request_with_retries(
+      complete_context, "POST", "uploadId=" + url_encode(upload_id), body.str(), response);
+  if (result.is_error() || checksum.algorithm() == checksum_t::NONE) {
+    return result;
+  }
+
+  // Verify the object checksum that the server returns, if any.
+  std::string::size_type pos = 0;
+  std::string object_checksum;
+  if (find_xml_element(response, checksum_tag.c_str(), pos, object_checksum) &&
+      object_checksum != &base64[0]) {
+    return make_result(status_t::CHECKSUM_MISMATCH);
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+status_t upload_parts(const upload_context_t& context,
+                      std::FILE* file,
+                      const uint64_t file_size,
+                      const uint64_t requested_part_size,
+                      const char* journal_path) {
+  // Note: An empty file would have zero parts, which is not a valid multipart upload.
+  if (file_size == 0) {
+    return make_result(status_t::INVALID_ARGUMENT);
+  }
+  const uint64_t part_size = get_part_size(file_size, requested_part_size);
+  if (static_cast<uint64_t>(static_cast<size_t>(part_size)) != part_size) {
+    return make_result(status_t::INVALID_ARGUMENT);
+  }
+  const int part_count = static_cast<int>((file_size + part_size - 1) / part_size);
+  const std::string url =
+      "http://" + context.host + ":" + uint64_to_string(static_cast<uint64_t>(context.port)) +
+      context.path;
+
+  // Resume the upload of the journal, if any. The server (ListParts) is the source of truth for
+  // which parts have been uploaded. Parts that are missing from the journal (e.g. when we crashed
+  // before the journal was updated) are accepted if their ETag matches the MD5 of the file data.
+  upload_journal_t journal;
+  std::string upload_id;
+  part_map_t completed;
+  if (journal.load(journal_path).is_success() && journal.url() == url &&
+      journal.file_size() == file_size && journal.part_size() == part_size) {
+    std::vector<listed_part_t> listed;
+    const status_t list_result = list_parts(context, journal.upload_id(), listed);
+    if (list_result.is_error() && list_result.status() != status_t::NOT_FOUND) {
+      return list_result;
+    }
+    if (list_result.is_success()) {
+      upload_id = journal.upload_id();
+      for (size_t i = 0; i < listed.size(); ++i) {
+        const listed_part_t& part = listed[i];
+        if (part.number < 1 || part.number > part_count) {
+          continue;
+        }
+        const uint64_t offset = static_cast<uint64_t>(part.number - 1) * part_size;
+        if (part.size != std::min(part_size, file_size - offset)) {
+          continue;
+        }
+        const upload_journal_t::part_map_t::const_iterator journal_part =
+            journal.parts().find(part.number);
+        const bool is_journaled =
+            journal_part != journal.parts().end() && journal_part->second == part.etag;
+        completed_part_t completed_part;
+        completed_part.etag = part.etag;
+        if (!is_journaled || context.checksum != checksum_t::NONE) {
+          part_hashes_t hashes;
+          if (!get_parts_hashes(file, &offset, &part.size, 1, context.checksum, &hashes)) {
+            return make_result(status_t::ERROR);
+          }
+          if (!is_journaled) {
+            if (!is_same_md5(part.etag, &hashes.md5_hex[0])) {
+              continue;
+            }
+            const status_t journal_result = journal.add_part(part.number, part.etag);
+            if (journal_result.is_error()) {
+              return journal_result;
+            }
+          }
+          completed_part.checksum = hashes.checksum;
+        }
+        completed[part.number] = completed_part;
+      }
+    }
+  }
+
+  // Otherwise start a new upload.
+  if (upload_id.empty()) {
+    const status_t initiate_result = initiate_upload(context, upload_id);
+    if (initiate_result.is_error()) {
+      return initiate_result;
+    }
+    const status_t journal_result =
+        journal.create(journal_path, url, file_size, part_size, upload_id);
+    if (journal_result.is_error()) {
+      return journal_result;
+    }
+  }
+
+  // Upload the missing parts. The hashes of the parts are calculated in batches.
+  std::vector<int> missing;
+  for (int number = 1; number <= part_count; ++number) {
+    if (completed.find(number) == completed.end()) {
+      missing.push_back(number);
+    }
+  }
+  for (size_t first = 0; first < missing.size(); first += MD5_BATCH_SIZE) {
+    const size_t batch_size = std::min(missing.size() - first, MD5_BATCH_SIZE);
+    uint64_t offsets[MD5_BATCH_SIZE];
+    uint64_t sizes[MD5_BATCH_SIZE];
+    part_hashes_t hashes[MD5_BATCH_SIZE];
+    for (size_t i = 0; i < batch_size; ++i) {
+      offsets[i] = static_cast<uint64_t>(missing[first + i] - 1) * part_size;
+      sizes[i] = std::min(part_size, file_size - offsets[i]);
+    }
+    if (!get_parts_hashes(
+            file, &offsets[0], &sizes[0], batch_size, context.checksum, &hashes[0])) {
+      return make_result(status_t::ERROR);
+    }
+
+    for (size_t i = 0; i < batch_size; ++i) {
+      const int number = missing[first + i];
+      retry_state_t retry(context.retry);
+      status_t::status_enum_t status;
+      std::string etag;
+      do {
+        status =
+            upload_part(context, file, upload_id, number, offsets[i], sizes[i], hashes[i], etag)
+                .status();
+      } while (retry.should_retry(status));
+      if (status != status_t::SUCCESS) {
+        return make_result(status);
+      }
+      if (is_md5_etag(etag) && !is_same_md5(etag, &hashes[i].md5_hex[0])) {
+        return make_result(status_t::CHECKSUM_MISMATCH);
+      }
+
+      const status_t journal_result = journal.add_part(number, etag);
+      if (journal_result.is_error()) {
+        return journal_result;
+      }
+      completed[number].etag = etag;
+      completed[number].checksum = hashes[i].checksum;
+    }
+  }
+
+  // The full object checksum is combined from the part checksums, without reading the file again.
+  composite_checksum_t composite(context.checksum);
+  for (part_map_t::const_iterator it = completed.begin(); it != completed.end(); ++it) {
+    const uint64_t offset = static_cast<uint64_t>(it->first - 1) * part_size;
+    composite.add_part(offset, std::min(part_size, file_size - offset), it->second.checksum);
+  }
+  if (composite.covered_size() != file_size) {
+    return make_result(status_t::ERROR);
+  }
+
+  const status_t complete_result =
+      complete_upload(context, upload_id, completed, composite.checksum());
+  if (complete_result.is_error()) {
+    return complete_result;
+  }
+  upload_journal_t::remove(journal_path);
+  return make_result(status_t::SUCCESS);
+}
+
+}  // namespace
+
+bool parse_list_parts(const std::string& xml, std::vector<listed_part_t>& parts, int& next_marker) {
+  std::string::size_type pos = 0;
+  std::string part_xml;
+  while (find_xml_element(xml, "Part", pos, part_xml)) {
+    std::string number;
+    std::string etag;
+    std::string size;
+    std::string::size_type number_pos = 0;
+    std::string::size_type etag_pos = 0;
+    std::string::size_type size_pos = 0;
+    listed_part_t part;
+    uint64_t part_number = 0;
+    if (find_xml_element(part_xml, "PartNumber", number_pos, number) &&
+        find_xml_element(part_xml, "ETag", etag_pos, etag) &&
+        find_xml_element(part_xml, "Size", size_pos, size) && parse_uint64(number, part_number) &&
+        part_number <= MAX_PARTS && parse_uint64(size, part.size)) {
+      part.number = static_cast<int>(part_number);
+      part.etag = etag;
+      parts.push_back(part);
+    }
+  }
+
+  std::string::size_type marker_pos = 0;
+  std::string marker;
+  uint64_t marker_value = 0;
+  next_marker = (find_xml_element(xml, "NextPartNumberMarker", marker_pos, marker) &&
+                 parse_uint64(marker, marker_value) && marker_value <= MAX_PARTS)
+                    ? static_cast<int>(marker_value)
+                    : 0;
+
+  std::string::size_type truncated_pos = 0;
+  std::string is_truncated;
+  return find_xml_element(xml, "IsTruncated", truncated_pos, is_truncated) &&
+         is_truncated == "true";
+}
+
+uint64_t get_part_size(const uint64_t file_size, const uint64_t part_size) {
+  uint64_t size = (part_size != 0) ? part_size : DEFAULT_PART_SIZE;
+  while ((file_size + size - 1) / size > MAX_PARTS) {
+    size *= 2;
+  }
+  return size;
+}
+
+status_t upload_file(const char* host_name,
+                     const int port,
+                     const char* path,
+                     const char* access_key,
+                     const char* secret_key,
+                     const char* file_path,
+                     const char* journal_path,
+                     const uint64_t part_size,
+                     const connection_t::options_t& options) {
+  // The query string is used for the multipart upload requests.
+  if (std::strchr(path, '?') != NULL) {
+    return make_result(status_t::INVALID_ARGUMENT);
+  }
+
+  // Each request is retried as a whole (including the part data), so the connections must not
+  // retry on their own. Integrity is checked per part with Content-MD5 (and the ETag), and with
+  // the part checksums and the full object checksum if a checksum algorithm is given.
+  upload_context_t context;
+  context.host = host_name;
+  context.port = port;
+  context.path = path;
+  context.access_key = access_key;
+  context.secret_key = secret_key;
+  context.options = options;
+  context.options.checksum = checksum_t::NONE;
+  context.options.content_md5 = NULL;
+  context.options.verify_etag = false;
+  context.options.hedge_delay = 0;
+  context.options.retry.max_attempts = 1;
+  context.retry = options.retry;
+  context.checksum = options.checksum;
+
+  std::FILE* file = std::fopen(file_path, "rb");
+  if (file == NULL) {
+    return make_result(status_t::NOT_FOUND);
+  }
+  uint64_t file_size = 0;
+  const status_t result = get_file_size(file, file_size)
+                              ? upload_parts(context, file, file_size, part_size, journal_path)
+                              : make_result(status_t::ERROR);
+  std::fclose(file);
+  return result;
+}
+
+}  // namespace us3
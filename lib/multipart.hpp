@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_MULTIPART_HPP_
+#define US3_MULTIPART_HPP_
+
+#include "connection.hpp"
+#include "return_value.hpp"
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace us3 {
+
+/// @brief The default part size of multipart uploads.
+const uint64_t DEFAULT_PART_SIZE = 8 * 1024 * 1024;
+
+/// @brief The maximum number of parts of a multipart upload.
+const uint64_t MAX_PARTS = 10000;
+
+/// @brief A part of a multipart upload, as listed by the server.
+struct listed_part_t {
+  int number;        ///< The part number.
+  std::string etag;  ///< The ETag of the part.
+  uint64_t size;     ///< The size of the part.
+};
+
+/// @brief Parse a ListParts response.
+/// @param xml The XML response.
+/// @param[out] parts The listed parts are appended to this vector.
+/// @param[out] next_marker The part number marker for the next page.
+/// @returns true if the list is truncated (i.e. there are more pages).
+bool parse_list_parts(const std::string& xml, std::vector<listed_part_t>& parts, int& next_marker);
+
+/// @brief Calculate the part size for a multipart upload.
+/// @param file_size The size of the file.
+/// @param part_size The requested part size, or 0 for DEFAULT_PART_SIZE.
+/// @returns the part size, which is doubled until the file fits in MAX_PARTS parts.
+uint64_t get_part_size(uint64_t file_size, uint64_t part_size);
+
+/**
+ * @brief Upload a file as a resumable multipart upload.
+ *
+ * The progress of the upload is recorded in a journal file. If the upload fails (or the process
+ * crashes), a later call with the same arguments resumes the upload: The parts that the server
+ * already has (according to ListParts) are skipped. The journal file is removed when the upload
+ * has been completed.
+ *
+ * Failed requests are retried according to the retry policy of the options. If options.checksum
+ * is set, each part is sent with its checksum, and the upload is completed with a full object
+ * checksum that is combined from the part checksums (see composite_checksum_t).
+ *
+ * @param host_name Name of the host.
+ * @param port Port to connection to.
+ * @param path Full path to the object (including the leading slash).
+ * @param access_key The S3 access key.
+ * @param secret_key The S3 secret key.
+ * @param file_path The file to upload.
+ * @param journal_path The journal file.
+ * @param part_size The part size, or 0 for the default part size.
+ * @param options Connection options.
+ * @returns status_t::SUCCESS for success, otherwise an error code.
+ */
+status_t upload_file(const char* host_name,
+                     int port,
+                     const char* path,
+                     const char* access_key,
+                     const char* secret_key,
+                     const char* file_path,
+                     const char* journal_path,
+                     uint64_t part_size,
+                     const connection_t::options_t& options);
+
+}  // namespace us3
+
+#endif  // US3_MULTIPART_HPP_
@@ -0,0 +1,332 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "network_simulator.hpp"
+
+#include "retry_policy.hpp"
+#include <algorithm>
+
+namespace us3 {
+namespace net {
+
+namespace {
+
+// Receive and send in pieces of at most 10 ms of data when the bandwidth is limited, so that the
+// pacing is smooth.
+const long PACING_PIECES_PER_SECOND = 100;
+
+double random_fraction(uint64_t& state) {
+  return static_cast<double>(next_random(state)) / 4294967296.0;
+}
+
+void sleep_until(const int64_t time) {
+  const int64_t now = get_monotonic_time_us();
+  if (time > now) {
+    sleep_us(time - now);
+  }
+}
+
+}  // namespace
+
+// A simulated connection: the underlying socket and the state of the simulation.
+struct network_simulator_t::socket_t {
+  network_simulator_t* simulator;
+  net::socket_t socket;
+  uint64_t random_state;
+  int64_t response_time;   // When the response to the latest request may start to arrive.
+  int64_t send_free_time;  // When the (simulated) link is free for sending more data.
+  int64_t recv_free_time;  // When the (simulated) link is free for receiving more data.
+  uint64_t bytes_received;
+  uint64_t next_stall_pos;  // The received byte count at which a stall may occur next.
+  uint64_t reset_pos;       // The received byte count at which the connection is reset, or 0.
+  bool has_received;
+  bool is_reset;
+};
+
+namespace {
+
+// Limit a transfer to the pacing piece size, and return the time it occupies the link.
+size_t paced_count(const size_t count, const long bandwidth) {
+  if (bandwidth <= 0) {
+    return count;
+  }
+  const size_t piece = static_cast<size_t>(std::max(bandwidth / PACING_PIECES_PER_SECOND, 1L));
+  return std::min(count, piece);
+}
+
+int64_t transfer_time(const size_t count, const long bandwidth) {
+  if (bandwidth <= 0) {
+    return 0;
+  }
+  return static_cast<int64_t>((static_cast<double>(count) * 1000000.0) /
+                              static_cast<double>(bandwidth));
+}
+
+}  // namespace
+
+network_simulator_t::network_simulator_t(const network_conditions_t& conditions,
+                                         const transport_t& transport,
+                                         const void* transport_data)
+    : m_conditions(conditions),
+      m_transport(transport),
+      m_transport_data(transport_data),
+      m_connection_count(0) {
+  m_stats.connections = 0;
+  m_stats.stalls = 0;
+  m_stats.resets = 0;
+}
+
+network_simulator_t::socket_t* network_simulator_t::to_sim_socket(const net::socket_t socket) {
+  return reinterpret_cast<socket_t*>(socket);
+}
+
+const transport_t& network_simulator_t::transport() {
+  static const transport_t SIMULATOR_TRANSPORT = {sim_connect,
+                                                  sim_disconnect,
+                                                  sim_send,
+                                                  sim_recv,
+                                                  sim_get_socket_stats,
+                                                  sim_wait_readable};
+  return SIMULATOR_TRANSPORT;
+}
+
+network_simulator_t::stats_t network_simulator_t::get_stats() {
+  lock_guard_t lock(m_mutex);
+  return m_stats;
+}
+
+result_t<net::socket_t> network_simulator_t::sim_connect(const void* data,
+                                                         const char* host,
+                                                         const int port,
+                                                         const timeout_t connect_timeout,
+                                                         const timeout_t socket_timeout,
+                                                         const socket_options_t& options) {
+  if (data == NULL) {
+    return make_result<net::socket_t>(NULL, status_t::INVALID_ARGUMENT);
+  }
+  network_simulator_t* simulator =
+      const_cast<network_simulator_t*>(static_cast<const network_simulator_t*>(data));
+  const network_conditions_t& conditions = simulator->m_conditions;
+
+  // Each connection gets its own random sequence, so that concurrent connections do not affect
+  // each other.
+  uint64_t random_state;
+  {
+    lock_guard_t lock(simulator->m_mutex);
+    random_state = conditions.seed + simulator->m_connection_count++;
+  }
+  for (int i = 0; i < 4; ++i) {
+    random_state ^= static_cast<uint64_t>(next_random(random_state)) << 32;
+  }
+  timeout_t delay = conditions.connect_latency;
+  if (conditions.jitter > 0) {
+    delay += static_cast<timeout_t>(random_fraction(random_state) *
+                                    static_cast<double>(conditions.jitter));
+  }
+  const bool will_reset = conditions.reset_after_bytes > 0 &&
+                          random_fraction(random_state) < conditions.reset_probability;
+
+  sleep_us(delay);
+  const result_t<net::socket_t> result = simulator->m_transport.connect(
+      simulator->m_transport_data, host, port, connect_timeout, socket_timeout, options);
+  if (result.is_error()) {
+    return result;
+  }
+
+  socket_t* socket = new socket_t;
+  socket->simulator = simulator;
+  socket->socket = *result;
+  socket->random_state = random_state;
+  socket->response_time = 0;
+  socket->send_free_time = 0;
+  socket->recv_free_time = 0;
+  socket->bytes_received = 0;
+  socket->next_stall_pos = conditions.stall_interval;
+  socket->reset_pos = will_reset ? conditions.reset_after_bytes : 0;
+  socket->has_received = false;
+  socket->is_reset = false;
+  {
+    lock_guard_t lock(simulator->m_mutex);
+    ++simulator->m_stats.connections;
+  }
+  return make_result(reinterpret_cast<net::socket_t>(socket), status_t::SUCCESS);
+}
+
+status_t network_simulator_t::sim_disconnect(net::socket_t socket) {
+  socket_t* sim = to_sim_socket(socket);
+  const status_t status = sim->simulator->m_transport.disconnect(sim->socket);
+  delete sim;
+  return status;
+}
+
+result_t<size_t> network_simulator_t::sim_send(net::socket_t socket,
+                                               const void* buf,
+                                               const size_t count) {
+  socket_t* sim = to_sim_socket(socket);
+  const network_conditions_t& conditions = sim->simulator->m_conditions;
+  if (sim->is_reset) {
+    return make_result<size_t>(0, status_t::CONNECTION_RESET);
+  }
+
+  sleep_until(sim->send_free_time);
+  const result_t<size_t> result =
+      sim->simulator->m_transport.send(sim->socket, buf, paced_count(count, conditions.bandwidth));
+  if (result.is_error()) {
+    return result;
+  }
+  const int64_t now = get_monotonic_time_us();
+  sim->send_free_time = now + transfer_time(*result, conditions.bandwidth);
+
+  // The response can not arrive until the request has crossed the network and back.
+  timeout_t delay = conditions.latency;
+  if (conditions.jitter > 0) {
+    delay += static_cast<timeout_t>(random_fraction(sim->random_state) *
+                                    static_cast<double>(conditions.jitter));
+  }
+  if (!sim->has_received) {
+    delay += conditions.first_byte_delay;
+  }
+  sim->response_time = sim->send_free_time + delay;
+  return result;
+}
+
+result_t<size_t> network_simulator_t::sim_recv(net::socket_t socket,
+                                               void* buf,
+                                               const size_t count) {
+  socket_t* sim = to_sim_socket(socket);
+  network_simulator_t* simulator = sim->simulator;
+  const network_conditions_t& conditions = simulator->m_conditions;
+  if (sim->is_reset) {
+    return make_result<size_t>(0, status_t::CONNECTION_RESET);
+  }
+
+  sleep_until(std::max(sim->response_time, sim->recv_free_time));
+
+  // Stalls happen at fixed positions in the received data, so that they do not depend on how the
+  // data is split into receive calls.
+  size_t actual_count = paced_count(count, conditions.bandwidth);
+  if (conditions.stall_probability > 0.0 && conditions.stall_interval > 0) {
+    if (sim->bytes_received == sim->next_stall_pos) {
+      sim->next_stall_pos += conditions.stall_interval;
+      if (random_fraction(sim->random_state) < conditions.stall_probability) {
+        {
+          lock_guard_t lock(simulator->m_mutex);
+          ++simulator->m_stats.stalls;
+        }
+        sleep_us(conditions.stall_duration);
+      }
+    }
+    actual_count = static_cast<size_t>(
+        std::min(static_cast<uint64_t>(actual_count), sim->next_stall_pos - sim->bytes_received));
+  }
+  if (sim->reset_pos > 0) {
+    if (sim->bytes_received >= sim->reset_pos) {
+      sim->is_reset = true;
+      {
+        lock_guard_t lock(simulator->m_mutex);
+        ++simulator->m_stats.resets;
+      }
+      return make_result<size_t>(0, status_t::CONNECTION_RESET);
+    }
+    actual_count = static_cast<size_t>(
+        std::min(static_cast<uint64_t>(actual_count), sim->reset_pos - sim->bytes_received));
+  }
+
+  const result_t<size_t> result = simulator->m_transport.recv(sim->socket, buf, actual_count);
+  if (result.is_error()) {
+    return result;
+  }
+  if (*result > 0) {
+    sim->has_received = true;
+    sim->bytes_received += *result;
+    sim->recv_free_time = get_monotonic_time_us() + transfer_time(*result, conditions.bandwidth);
+  }
+  return result;
+}
+
+socket_stats_t network_simulator_t::sim_get_socket_stats(net::socket_t socket) {
+  socket_t* sim = to_sim_socket(socket);
+  return sim->simulator->m_transport.get_socket_stats(sim->socket);
+}
+
+result_t<size_t> network_simulator_t::sim_wait_readable(const net::socket_t* sockets,
+                                                        const size_t count,
+                                                        const timeout_t timeout) {
+  const size_t MAX_SOCKETS = 64;
+  if (count == 0 || count > MAX_SOCKETS) {
+    return make_result<size_t>(0, status_t::INVALID_ARGUMENT);
+  }
+  const transport_t& transport = to_sim_socket(sockets[0])->simulator->m_transport;
+  const int64_t deadline = (timeout > 0) ? get_monotonic_time_us() + timeout : 0;
+
+  // Only wait for the underlying sockets whose responses are due, and wake up when the next
+  // response becomes due.
+  while (true) {
+    const int64_t now = get_monotonic_time_us();
+    net::socket_t due_sockets[MAX_SOCKETS];
+    size_t due_indices[MAX_SOCKETS];
+    size_t due_count = 0;
+    int64_t next_due_time = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const socket_t* sim = to_sim_socket(sockets[i]);
+      if (sim->is_reset) {
+        return make_result(i, status_t::SUCCESS);
+      }
+      const int64_t due_time = std::max(sim->response_time, sim->recv_free_time);
+      if (due_time <= now) {
+        due_sockets[due_count] = sim->socket;
+        due_indices[due_count] = i;
+        ++due_count;
+      } else if (next_due_time == 0 || due_time < next_due_time) {
+        next_due_time = due_time;
+      }
+    }
+
+    int64_t wake_time = next_due_time;
+    if (deadline > 0 && (wake_time == 0 || deadline < wake_time)) {
+      wake_time = deadline;
+    }
+    if (deadline > 0 && now >= deadline) {
+      if (due_count == 0) {
+        return make_result<size_t>(0, status_t::TIMEOUT);
+      }
+      wake_time = now + 1;
+    }
+    if (due_count == 0) {
+      sleep_until(wake_time);
+      continue;
+    }
+
+    const timeout_t wait_time =
+        (wake_time > 0) ? static_cast<timeout_t>(std::max(wake_time - now, int64_t(1))) : 0;
+    const result_t<size_t> result = transport.wait_readable(due_sockets, due_count, wait_time);
+    if (result.is_success()) {
+      return make_result(due_indices[*result], status_t::SUCCESS);
+    }
+    if (result.status() != status_t::TIMEOUT) {
+      return result;
+    }
+    if (deadline > 0 && get_monotonic_time_us() >= deadline) {
+      return make_result<size_t>(0, status_t::TIMEOUT);
+    }
+  }
+}
+
+}  // namespace net
+}  // namespace us3
@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_NETWORK_SIMULATOR_HPP_
+#define US3_NETWORK_SIMULATOR_HPP_
+
+#include "platform.hpp"
+#include "transport.hpp"
+#include <stdint.h>
+
+namespace us3 {
+namespace net {
+
+/// @brief Simulated network conditions.
+///
+/// All random decisions are drawn from generators that are seeded from @c seed, per connection and
+/// in the order that connections are made, so that a single threaded run is repeatable.
+struct network_conditions_t {
+  network_conditions_t()
+      : connect_latency(0),
+        latency(0),
+        jitter(0),
+        first_byte_delay(0),
+        bandwidth(0),
+        stall_probability(0.0),
+        stall_interval(65536),
+        stall_duration(0),
+        reset_probability(0.0),
+        reset_after_bytes(0),
+        seed(0) {
+  }
+
+  timeout_t connect_latency;   ///< Extra time for establishing a connection (μs).
+  timeout_t latency;           ///< Extra time from a request until its response arrives (μs).
+  timeout_t jitter;            ///< Random extra latency, uniform in [0, jitter] (μs).
+  timeout_t first_byte_delay;  ///< Extra delay of the first response of a connection (μs).
+  long bandwidth;              ///< Bandwidth per connection and direction (bytes/s), or 0.
+  double stall_probability;    ///< Probability of a stall for every stall_interval received bytes.
+  uint64_t stall_interval;     ///< The number of received bytes between possible stalls.
+  timeout_t stall_duration;    ///< The duration of a stall (μs).
+  double reset_probability;    ///< Probability that a connection is reset mid-transfer.
+  uint64_t reset_after_bytes;  ///< Received bytes after which a connection is reset (0 = never).
+  uint64_t seed;               ///< Seed for the random decisions.
+};
+
+/// @brief A transport shim that simulates network conditions on top of another transport.
+///
+/// The simulator is meant for tests and benchmarks against a local server (e.g. the mock S3
+/// server), where the real network is too fast and too reliable to exercise connection reuse,
+/// hedging, retries and parallel transfers. Use transport() as the connection transport, and the
+/// simulator object as the transport data:
+///
+/// @code
+///   net::network_conditions_t conditions;
+///   conditions.latency = 50000;
+///   net::network_simulator_t simulator(conditions);
+///   connection_t::options_t options;
+///   options.transport = &net::network_simulator_t::transport();
+///   options.transport_data = &simulator;
+/// @endcode
+///
+/// Delays are implemented by the client side only: a response may not be received until the
+/// latency has passed since the last send of the request, and data is paced to the bandwidth. A
+/// reset connection fails every subsequent receive with status_t::CONNECTION_RESET. The simulated
+/// delays do not count towards the socket timeout.
+class network_simulator_t {
+public:
+  /// @brief Simulator statistics.
+  struct stats_t {
+    unsigned long connections;  ///< The number of established connections.
+    unsigned long stalls;       ///< The number of stalls.
+    unsigned long resets;       ///< The number of reset connections.
+  };
+
+  /// @brief Create a simulator.
+  /// @param conditions The simulated network conditions.
+  /// @param transport The underlying transport.
+  /// @param transport_data The data of the underlying transport.
+  explicit network_simulator_t(const network_conditions_t& conditions,
+                               const transport_t& transport = tcp_transport(),
+                               const void* transport_data = NULL);
+
+  /// @brief The simulator transport (the transport data is a network_simulator_t).
+  static const transport_t& transport();
+
+  /// @brief Get the simulator statistics.
+  stats_t get_stats();
+
+private:
+  struct socket_t;
+
+  // Not copyable.
+  network_simulator_t(const network_simulator_t&);
+  network_simulator_t& operator=(const network_simulator_t&);
+
+  static socket_t* to_sim_socket(net::socket_t socket);
+  static result_t<net::socket_t> sim_connect(const void* data,
+                                             const char* host,
+                                             int port,
+                                             timeout_t connect_timeout,
+                                             timeout_t socket_timeout,
+                                             const socket_options_t& options);
+  static status_t sim_disconnect(net::socket_t socket);
+  static result_t<size_t> sim_send(net::socket_t socket, const void* buf, size_t count);
+  static result_t<size_t> sim_recv(net::socket_t socket, void* buf, size_t count);
+  static socket_stats_t sim_get_socket_stats(net::socket_t socket);
+  static result_t<size_t> sim_wait_readable(const net::socket_t* sockets,
+                                            size_t count,
+                                            timeout_t timeout);
+
+  const network_conditions_t m_conditions;
+  const transport_t& m_transport;
+  const void* m_transport_data;
+
+  // Protects the state below.
+  mutex_t m_mutex;
+  uint64_t m_connection_count;
+  stats_t m_stats;
+};
+
+}  // namespace net
+}  // namespace us3
+
+#endif  // US3_NETWORK_SIMULATOR_HPP_
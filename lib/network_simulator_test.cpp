@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "network_simulator.hpp"
+
+#include "connection.hpp"
+#include "mock_s3_server.hpp"
+#include <doctest.h>
+#include <string>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+const char* const OBJECT_PATH = "/bucket/object";
+
+// A mock server with a single object, and a simulator for talking to it.
+class simulator_fixture_t {
+public:
+  explicit simulator_fixture_t(const size_t object_size) : data(object_size, 0) {
+    for (size_t i = 0; i < object_size; ++i) {
+      data[i] = static_cast<char>((i * 7919) >> 8);
+    }
+    REQUIRE(server.start(us3::mock_s3_server_t::options_t()).is_success());
+    server.put_object(OBJECT_PATH, data);
+  }
+
+  // Download the object through a simulator with the given conditions.
+  us3::status_t::status_enum_t download(const us3::net::network_conditions_t& conditions,
+                         std::string& result,
+                         us3::connection_t::options_t options = us3::connection_t::options_t()) {
+    us3::net::network_simulator_t simulator(conditions);
+    options.transport = &us3::net::network_simulator_t::transport();
+    options.transport_data = &simulator;
+    us3::connection_t connection;
+    result.clear();
+    us3::status_t::status_enum_t status = connection.open("127.0.0.1",
+                                                          server.port(),
+                                                          OBJECT_PATH,
+                                                          "access-key",
+                                                          "secret-key",
+                                                          us3::connection_t::READ,
+                                                          0,
+                                                          options)
+                                              .status();
+    char buf[10000];
+    while (status == us3::status_t::SUCCESS) {
+      const us3::result_t<size_t> count = connection.read(buf, sizeof(buf));
+      status = count.status();
+      if (count.is_error() || *count == 0) {
+        break;
+      }
+      result.append(buf, *count);
+    }
+    stats = connection.get_stats();
+    simulator_stats = simulator.get_stats();
+    const us3::status_t::status_enum_t close_status = connection.close().status();
+    return (status != us3::status_t::SUCCESS) ? status : close_status;
+  }
+
+  us3::mock_s3_server_t server;
+  std::string data;
+  us3::connection_t::stats_t stats;
+  us3::net::network_simulator_t::stats_t simulator_stats;
+};
+
+}  // namespace
+
+TEST_CASE("Simulated latency delays connections and responses") {
+  // GIVEN
+  simulator_fixture_t fixture(1000);
+  us3::net::network_conditions_t conditions;
+  conditions.connect_latency = 20000;
+  conditions.latency = 30000;
+  conditions.first_byte_delay = 20000;
+
+  // WHEN
+  std::string result;
+  const us3::status_t::status_enum_t status = fixture.download(conditions, result);
+
+  // THEN
+  REQUIRE_EQ(status, us3::status_t::SUCCESS);
+  CHECK_EQ(result, fixture.data);
+  CHECK_GE(fixture.stats.connect_time - fixture.stats.start_time, 20000);
+  CHECK_GE(fixture.stats.first_byte_time - fixture.stats.headers_sent_time, 50000);
+}
+
+TEST_CASE("Simulated bandwidth limits the transfer rate") {
+  // GIVEN
+  simulator_fixture_t fixture(200000);
+  us3::net::network_conditions_t conditions;
+  conditions.bandwidth = 1000000;
+
+  // WHEN
+  std::string result;
+  const us3::status_t::status_enum_t status = fixture.download(conditions, result);
+
+  // THEN
+  REQUIRE_EQ(status, us3::status_t::SUCCESS);
+  CHECK_EQ(result, fixture.data);
+  CHECK_GE(fixture.stats.body_complete_time - fixture.stats.first_byte_time, 180000);
+}
+
+TEST_CASE("Simulated resets are resumed") {
+  // GIVEN
+  simulator_fixture_t fixture(100000);
+  us3::net::network_conditions_t conditions;
+  conditions.reset_probability = 1.0;
+  conditions.reset_after_bytes = 30000;
+  us3::connection_t::options_t options;
+  options.retry.max_attempts = 10;
+  options.retry.base_delay = 1000;
+
+  // WHEN
+  std::string result;
+  const us3::status_t::status_enum_t status = fixture.download(conditions, result, options);
+
+  // THEN
+  REQUIRE_EQ(status, us3::status_t::SUCCESS);
+  CHECK_EQ(result, fixture.data);
+  CHECK_GE(fixture.simulator_stats.resets, 3);
+  CHECK_EQ(fixture.simulator_stats.connections, fixture.simulator_stats.resets + 1);
+}
+
+TEST_CASE("Resumed downloads do not grow the response arena") {
+  // GIVEN (a fixed size arena that only has room for a couple of responses)
+  simulator_fixture_t fixture(100000);
+  us3::net::network_conditions_t conditions;
+  conditions.reset_probability = 1.0;
+  conditions.reset_after_bytes = 5000;
+  us3::connection_t::options_t options;
+  options.retry.max_attempts = 3;
+  options.retry.base_delay = 100;
+  char arena[2048];
+  options.arena = &arena[0];
+  options.arena_size = sizeof(arena);
+  options.fixed_arena = true;
+
+  // WHEN
+  std::string result;
+  const us3::status_t::status_enum_t status = fixture.download(conditions, result, options);
+
+  // THEN
+  REQUIRE_EQ(status, us3::status_t::SUCCESS);
+  CHECK_EQ(result, fixture.data);
+  CHECK_GE(fixture.simulator_stats.resets, 15);
+}
+
+TEST_CASE("Simulated stalls are repeatable") {
+  // GIVEN
+  simulator_fixture_t fixture(100000);
+  us3::net::network_conditions_t conditions;
+  conditions.stall_probability = 0.5;
+  conditions.stall_interval = 4096;
+  conditions.stall_duration = 1000;
+  conditions.seed = 42;
+
+  // WHEN
+  std::string result;
+  REQUIRE_EQ(fixture.download(conditions, result), us3::status_t::SUCCESS);
+  const unsigned long first_stalls = fixture.simulator_stats.stalls;
+  REQUIRE_EQ(fixture.download(conditions, result), us3::status_t::SUCCESS);
+
+  // THEN
+  CHECK_EQ(result, fixture.data);
+  CHECK_GT(first_stalls, 0);
+  CHECK_LT(first_stalls, 25);
+  CHECK_EQ(fixture.simulator_stats.stalls, first_stalls);
+}
+
+TEST_CASE("Hedged requests wait for simulated responses") {
+  // GIVEN
+  simulator_fixture_t fixture(10000);
+  us3::net::network_conditions_t conditions;
+  conditions.latency = 50000;
+  us3::connection_t::options_t options;
+  options.hedge_delay = 10000;
+
+  // WHEN
+  std::string result;
+  const us3::status_t::status_enum_t status = fixture.download(conditions, result, options);
+
+  // THEN
+  REQUIRE_EQ(status, us3::status_t::SUCCESS);
+  CHECK_EQ(result, fixture.data);
+  CHECK_EQ(fixture.simulator_stats.connections, 2);
+  CHECK_GE(fixture.stats.first_byte_time - fixture.stats.start_time, 50000);
+}
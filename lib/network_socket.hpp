@@ -20,8 +20,17 @@
 #ifndef US3_NETWORK_SOCKET_HPP_
 #define US3_NETWORK_SOCKET_HPP_
 
+#include "allocator.hpp"
 #include "return_value.hpp"
 #include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+// The number of statically allocated sockets, or 0 to allocate sockets on the heap. With static
+// sockets, connections fail with status_t::ERROR while all of them are in use.
+#ifndef US3_STATIC_SOCKETS
+#define US3_STATIC_SOCKETS 0
+#endif
 
 namespace us3 {
 namespace net {
@@ -33,11 +42,103 @@ struct socket_struct_t;
 /// @brief Timeout in microseconds.
 typedef long timeout_t;
 
+/// @brief A resolved socket address (a copy of the native sockaddr).
+struct address_t {
+  int family;            ///< Address family (AF_INET or AF_INET6).
+  size_t size;           ///< The size of the native address, in bytes.
+  uint64_t storage[16];  ///< The native address (large and aligned enough for any sockaddr).
+};
+
+/// @brief A list of resolved addresses.
+typedef std::vector<address_t, std_allocator_t<address_t> > address_list_t;
+
+/// @brief Result of a host name lookup.
+enum lookup_status_t {
+  LOOKUP_SUCCESS,           ///< The host name was resolved.
+  LOOKUP_NO_HOST,           ///< The host name does not exist (or has no addresses).
+  LOOKUP_TEMPORARY_FAILURE  ///< The lookup failed, but a later attempt may succeed.
+};
+
+/// @brief Look up the addresses of a host (without any caching).
+/// @param host The host name (or numeric address).
+/// @param port The port number.
+/// @param[out] addresses The resolved addresses.
+/// @returns the lookup status.
+lookup_status_t lookup_host(const char* host, int port, address_list_t& addresses);
+
+/// @brief A buffer size that is calculated from the bandwidth-delay product of the connection.
+const int AUTO_BUFFER_SIZE = -1;
+
+/// @brief Socket tuning options.
+///
+/// The options are applied on a best effort basis: options that are not supported by the platform
+/// (or that the process lacks the privileges for) are silently ignored.
+struct socket_options_t {
+  socket_options_t()
+      : tcp_nodelay(true),
+        send_buffer_size(0),
+        recv_buffer_size(0),
+        link_bandwidth(0),
+        tcp_quickack(false),
+        busy_poll(0),
+        recv_lowat(0) {
+  }
+
+  bool tcp_nodelay;      ///< Disable Nagle's algorithm (TCP_NODELAY).
+  int send_buffer_size;  ///< SO_SNDBUF (bytes), 0 for the system default, or AUTO_BUFFER_SIZE.
+  int recv_buffer_size;  ///< SO_RCVBUF (bytes), 0 for the system default, or AUTO_BUFFER_SIZE.
+  long link_bandwidth;   ///< Expected bandwidth (bytes/s) for AUTO_BUFFER_SIZE, or 0 for 1 Gbit/s.
+  bool tcp_quickack;     ///< Acknowledge received data immediately (TCP_QUICKACK, Linux only).
+  int busy_poll;         ///< SO_BUSY_POLL time (μs), or 0 to disable (Linux only).
+  int recv_lowat;        ///< SO_RCVLOWAT (bytes), or 0 for the system default.
+};
+
+/// @brief Timing and I/O counters of a socket connection.
+struct socket_stats_t {
+  int64_t resolve_time;      ///< When the host name was resolved (monotonic time, μs).
+  int64_t connect_time;      ///< When the connection was established (monotonic time, μs).
+  uint64_t bytes_sent;       ///< The number of bytes sent.
+  uint64_t bytes_received;   ///< The number of bytes received.
+  unsigned long send_calls;  ///< The number of send system calls.
+  unsigned long recv_calls;  ///< The number of receive system calls.
+};
+
+/// @brief Calculate a socket buffer size from the bandwidth-delay product.
+/// @param link_bandwidth The expected bandwidth in bytes/s, or 0 for 1 Gbit/s.
+/// @param rtt The round trip time in μs.
+/// @returns the buffer size in bytes (at most 64 MiB).
+inline int bdp_buffer_size(const long link_bandwidth, const int64_t rtt) {
+  const int64_t MAX_SIZE = 64 * 1024 * 1024;
+  const int64_t bandwidth = (link_bandwidth > 0) ? static_cast<int64_t>(link_bandwidth) : 125000000;
+  const int64_t size = (rtt > 0) ? (bandwidth / 1000) * rtt / 1000 : 0;
+  return static_cast<int>((size < MAX_SIZE) ? size : MAX_SIZE);
+}
+
 /// @brief Establish a socket connection.
+///
+/// Explicit buffer sizes are set before connecting (so that they affect the TCP window scaling).
+/// Automatic buffer sizes are set after connecting, using the connection handshake time as the
+/// round trip time, and they never shrink the buffers below the system default.
+/// @param host The host name (or numeric address).
+/// @param port The port number.
+/// @param connect_timeout The connection timeout (μs), or 0 for no timeout.
+/// @param socket_timeout The timeout for send and receive operations (μs), or 0 for no timeout.
+/// @param options Socket tuning options.
 result_t<socket_t> connect(const char* host,
                            int port,
                            timeout_t connect_timeout,
-                           timeout_t socket_timeout);
+                           timeout_t socket_timeout,
+                           const socket_options_t& options = socket_options_t());
+
+/// @brief Establish a Unix domain socket connection.
+/// @param path The path of the socket.
+/// @param connect_timeout The connection timeout (μs), or 0 for no timeout.
+/// @param socket_timeout The timeout for send and receive operations (μs), or 0 for no timeout.
+/// @returns the socket, or status_t::UNSUPPORTED if the platform has no Unix domain sockets.
+/// @note The socket is used with the same functions as TCP sockets (send(), recv() etc).
+result_t<socket_t> connect_unix(const char* path,
+                                timeout_t connect_timeout,
+                                timeout_t socket_timeout);
 
 /// @brief Close a socket connection.
 status_t disconnect(socket_t socket);
@@ -48,6 +149,16 @@ result_t<size_t> send(socket_t socket, const void* buf, size_t count);
 /// @brief Receive data over a socket.
 result_t<size_t> recv(socket_t socket, void* buf, size_t count);
 
+/// @brief Get the timing and I/O counters of a socket.
+socket_stats_t get_socket_stats(socket_t socket);
+
+/// @brief Wait until one of several sockets has data to receive (or has been closed).
+/// @param sockets The sockets to wait for.
+/// @param count The number of sockets (at most 64).
+/// @param timeout The maximum time to wait (μs), or 0 for no timeout.
+/// @returns the index of the first socket that is ready, or status_t::TIMEOUT.
+result_t<size_t> wait_readable(const socket_t* sockets, size_t count, timeout_t timeout);
+
 }  // namespace net
 }  // namespace us3
 
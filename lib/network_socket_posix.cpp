@@ -19,12 +19,23 @@
 
 #include "network_socket.hpp"
 
+#include "allocator.hpp"
+#include "fixed_pool.hpp"
+#include "platform.hpp"
+#include "resolver.hpp"
 #include <cstdio>
+#include <cstring>
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
+#include <vector>
 
 namespace us3 {
 namespace net {
@@ -32,6 +43,9 @@ namespace net {
 // Platform specific type.
 struct socket_struct_t {
   int fd;
+  timeout_t socket_timeout;
+  bool tcp_quickack;
+  socket_stats_t stats;
 };
 
 namespace {
@@ -42,15 +56,52 @@ const socket_t NULL_SOCKET_T(nullptr);
 const socket_t NULL_SOCKET_T(NULL);
 #endif
 
-status_t::status_enum_t errno_to_status() {
-  switch (errno) {
+#if US3_STATIC_SOCKETS > 0
+fixed_pool_t<socket_struct_t, US3_STATIC_SOCKETS> s_socket_pool;
+#endif
+
+// Allocate a socket struct (with the allocation hooks, or from the pool of static sockets), or
+// return NULL if that fails.
+socket_t new_socket_struct() {
+#if US3_STATIC_SOCKETS > 0
+  return s_socket_pool.allocate();
+#else
+  void* memory = heap_alloc(sizeof(socket_struct_t));
+  return (memory != NULL) ? new (memory) socket_struct_t() : NULL;
+#endif
+}
+
+void delete_socket_struct(socket_t socket) {
+#if US3_STATIC_SOCKETS > 0
+  s_socket_pool.release(socket);
+#else
+  socket->~socket_struct_t();
+  heap_free(socket);
+#endif
+}
+
+// Avoid SIGPIPE when the peer has closed the connection (we want EPIPE instead).
+#if defined(MSG_NOSIGNAL)
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+// The delay between starting connection attempts to different addresses (RFC 8305 recommends
+// 250 ms).
+const int64_t CONNECTION_ATTEMPT_DELAY = 250000;
+
+status_t::status_enum_t errno_to_status(const int err) {
+  switch (err) {
     case EACCES:
       return status_t::DENIED;
     case ECONNREFUSED:
       return status_t::REFUSED;
     case ENETUNREACH:
+    case EHOSTUNREACH:
       return status_t::UNREACHABLE;
     case ECONNRESET:
+    case EPIPE:
       return status_t::CONNECTION_RESET;
     case ETIMEDOUT:
       return status_t::TIMEOUT;
@@ -59,70 +110,464 @@ status_t::status_enum_t errno_to_status() {
   }
 }
 
-}  // namespace
+status_t::status_enum_t errno_to_status() {
+  return errno_to_status(errno);
+}
 
-result_t<socket_t> connect(const char* host,
-                           const int port,
-                           const timeout_t connect_timeout,
-                           const timeout_t socket_timeout) {
-  // TODO(m): Make use of these arguments.
-  (void)connect_timeout;
-  (void)socket_timeout;
+// Wait until the socket is ready for the requested events, or until the deadline has passed (a
+// deadline of zero means no deadline).
+status_t::status_enum_t wait_for_socket(const int fd, const short events, const int64_t deadline) {
+  while (true) {
+    int timeout_ms = -1;
+    if (deadline != 0) {
+      const int64_t time_left = deadline - get_monotonic_time_us();
+      if (time_left <= 0) {
+        return status_t::TIMEOUT;
+      }
+      // Round up, so that we do not spin with a zero timeout.
+      timeout_ms = static_cast<int>((time_left + 999) / 1000);
+    }
+
+    ::pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    const int result = ::poll(&pfd, 1, timeout_ms);
+    if (result > 0) {
+      return status_t::SUCCESS;
+    }
+    if (result == -1 && errno != EINTR) {
+      return errno_to_status();
+    }
+  }
+}
+
+int64_t make_deadline(const timeout_t timeout) {
+  return (timeout > 0) ? get_monotonic_time_us() + static_cast<int64_t>(timeout) : 0;
+}
+
+bool set_non_blocking(const int fd) {
+  const int flags = ::fcntl(fd, F_GETFL, 0);
+  return flags != -1 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+// Set an integer socket option. Failures are ignored, since the options are only hints.
+void set_int_option(const int fd, const int level, const int name, const int value) {
+  (void)::setsockopt(fd, level, name, &value, sizeof(value));
+}
+
+int get_int_option(const int fd, const int level, const int name) {
+  int value = 0;
+  ::socklen_t value_len = sizeof(value);
+  if (::getsockopt(fd, level, name, &value, &value_len) == -1) {
+    return 0;
+  }
+  return value;
+}
+
+// Apply the socket options that must be set before connecting.
+void apply_options_before_connect(const int fd, const socket_options_t& options) {
+  if (options.tcp_nodelay) {
+    set_int_option(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+  }
+  if (options.send_buffer_size > 0) {
+    set_int_option(fd, SOL_SOCKET, SO_SNDBUF, options.send_buffer_size);
+  }
+  if (options.recv_buffer_size > 0) {
+    set_int_option(fd, SOL_SOCKET, SO_RCVBUF, options.recv_buffer_size);
+  }
+#if defined(SO_BUSY_POLL)
+  if (options.busy_poll > 0) {
+    set_int_option(fd, SOL_SOCKET, SO_BUSY_POLL, options.busy_poll);
+  }
+#endif
+  if (options.recv_lowat > 0) {
+    set_int_option(fd, SOL_SOCKET, SO_RCVLOWAT, options.recv_lowat);
+  }
+}
+
+// Apply the socket options that depend on the connection (rtt is the handshake time in μs).
+void apply_options_after_connect(const int fd,
+                                 const socket_options_t& options,
+                                 const int64_t rtt) {
+  const int buffer_size = bdp_buffer_size(options.link_bandwidth, rtt);
+  if (options.send_buffer_size == AUTO_BUFFER_SIZE &&
+      buffer_size > get_int_option(fd, SOL_SOCKET, SO_SNDBUF)) {
+    set_int_option(fd, SOL_SOCKET, SO_SNDBUF, buffer_size);
+  }
+  if (options.recv_buffer_size == AUTO_BUFFER_SIZE &&
+      buffer_size > get_int_option(fd, SOL_SOCKET, SO_RCVBUF)) {
+    set_int_option(fd, SOL_SOCKET, SO_RCVBUF, buffer_size);
+  }
+}
+
+// TCP_QUICKACK is not permanent (the kernel may go back to delayed ACKs at any time), so it is
+// re-armed before every receive.
+void arm_quickack(const int fd) {
+#if defined(TCP_QUICKACK)
+  set_int_option(fd, IPPROTO_TCP, TCP_QUICKACK, 1);
+#else
+  (void)fd;
+#endif
+}
+
+// Get the pending error of a socket (e.g. the result of a non-blocking connect).
+int get_socket_error(const int fd) {
+  int err = 0;
+  ::socklen_t err_len = sizeof(err);
+  if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == -1) {
+    return errno;
+  }
+  return err;
+}
+
+// Start a non-blocking connection attempt. Returns the socket (or -1 on failure), and sets
+// is_connected if the connection was established immediately.
+int start_connect(const address_t& address,
+                  const socket_options_t& options,
+                  bool& is_connected,
+                  status_t::status_enum_t& status) {
+  is_connected = false;
+  const int fd = ::socket(address.family, SOCK_STREAM, IPPROTO_TCP);
+  if (fd == -1) {
+    status = errno_to_status();
+    return -1;
+  }
+  if (!set_non_blocking(fd)) {
+    status = errno_to_status();
+    ::close(fd);
+    return -1;
+  }
+  apply_options_before_connect(fd, options);
+  if (::connect(fd,
+                reinterpret_cast<const ::sockaddr*>(&address.storage[0]),
+                static_cast< ::socklen_t>(address.size)) == 0) {
+    is_connected = true;
+    return fd;
+  }
+  if (errno != EINPROGRESS && errno != EINTR) {
+    status = errno_to_status();
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Race connection attempts to the addresses in the style of RFC 8305 (Happy Eyeballs): a new
+// attempt is started every CONNECTION_ATTEMPT_DELAY (or as soon as an attempt fails), and the
+// first socket that connects wins. Returns the socket (or -1), the index of the address and the
+// time it took to establish the connection (an estimate of the round trip time).
+int connect_race(const address_list_t& addresses,
+                 const socket_options_t& options,
+                 const int64_t deadline,
+                 size_t& winner_index,
+                 int64_t& rtt,
+                 status_t::status_enum_t& status) {
+  std::vector< ::pollfd, std_allocator_t< ::pollfd> > pending;
+  std::vector<size_t, std_allocator_t<size_t> > pending_index;
+  std::vector<int64_t, std_allocator_t<int64_t> > pending_start;
+  int winner_fd = -1;
+  size_t next_index = 0;
+  int64_t next_attempt_time = 0;
+  status = status_t::UNREACHABLE;
+  rtt = 0;
+
+  while (winner_fd == -1) {
+    const int64_t now = get_monotonic_time_us();
+    if (deadline != 0 && now >= deadline) {
+      status = status_t::TIMEOUT;
+      break;
+    }
 
-  // Get address info for the host / port.
+    // Start a new connection attempt?
+    if (next_index < addresses.size() && (pending.empty() || now >= next_attempt_time)) {
+      bool is_connected;
+      const int fd = start_connect(addresses[next_index], options, is_connected, status);
+      if (is_connected) {
+        winner_fd = fd;
+        winner_index = next_index;
+      } else if (fd != -1) {
+        ::pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        pending.push_back(pfd);
+        pending_index.push_back(next_index);
+        pending_start.push_back(now);
+        next_attempt_time = now + CONNECTION_ATTEMPT_DELAY;
+      }
+      ++next_index;
+      continue;
+    }
+
+    // Have all attempts failed?
+    if (pending.empty()) {
+      break;
+    }
+
+    // Wait for a pending attempt to finish (or for the time to start the next attempt).
+    int64_t wait_until = deadline;
+    if (next_index < addresses.size() && (wait_until == 0 || next_attempt_time < wait_until)) {
+      wait_until = next_attempt_time;
+    }
+    const int timeout_ms =
+        (wait_until != 0) ? static_cast<int>((wait_until - now + 999) / 1000) : -1;
+    const int result = ::poll(&pending[0], static_cast< ::nfds_t>(pending.size()), timeout_ms);
+    if (result == -1 && errno != EINTR) {
+      status = errno_to_status();
+      break;
+    }
+
+    // Check the attempts that have finished.
+    for (size_t i = 0; result > 0 && i < pending.size();) {
+      if (pending[i].revents == 0) {
+        ++i;
+        continue;
+      }
+      const int err = get_socket_error(pending[i].fd);
+      if (err == 0) {
+        winner_fd = pending[i].fd;
+        winner_index = pending_index[i];
+        rtt = get_monotonic_time_us() - pending_start[i];
+      } else {
+        // The attempt failed: Start the next attempt right away.
+        status = errno_to_status(err);
+        ::close(pending[i].fd);
+        next_attempt_time = now;
+      }
+      pending.erase(pending.begin() + static_cast<std::ptrdiff_t>(i));
+      pending_index.erase(pending_index.begin() + static_cast<std::ptrdiff_t>(i));
+      pending_start.erase(pending_start.begin() + static_cast<std::ptrdiff_t>(i));
+      if (winner_fd != -1) {
+        break;
+      }
+    }
+  }
+
+  // Abandon the losing attempts.
+  for (size_t i = 0; i < pending.size(); ++i) {
+    ::close(pending[i].fd);
+  }
+
+  return winner_fd;
+}
+
+}  // namespace
+
+lookup_status_t lookup_host(const char* host, const int port, address_list_t& addresses) {
   ::addrinfo* info;
   {
     ::addrinfo hints = {};
-    hints.ai_family = AF_INET;
+    hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
     char port_str[30];
     std::snprintf(&port_str[0], sizeof(port_str), "%d", port);
-    if (::getaddrinfo(host, port_str, &hints, &info) != 0) {
-      return make_result(NULL_SOCKET_T, status_t::NO_HOST);
+    const int result = ::getaddrinfo(host, port_str, &hints, &info);
+    if (result == EAI_AGAIN) {
+      return LOOKUP_TEMPORARY_FAILURE;
+    }
+    if (result != 0) {
+      return LOOKUP_NO_HOST;
     }
   }
 
-  // Open the socket.
-  const int socket_fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-  if (socket_fd == -1) {
-    ::freeaddrinfo(info);
-    return make_result(NULL_SOCKET_T, errno_to_status());
+  // Copy the addresses (in the order given by the system, which follows RFC 6724).
+  addresses.clear();
+  for (const ::addrinfo* ai = info; ai != NULL; ai = ai->ai_next) {
+    address_t address;
+    if (static_cast<size_t>(ai->ai_addrlen) > sizeof(address.storage)) {
+      continue;
+    }
+    address.family = ai->ai_family;
+    address.size = static_cast<size_t>(ai->ai_addrlen);
+    std::memcpy(&address.storage[0], ai->ai_addr, address.size);
+    addresses.push_back(address);
+  }
+  ::freeaddrinfo(info);
+
+  return addresses.empty() ? LOOKUP_NO_HOST : LOOKUP_SUCCESS;
+}
+
+result_t<socket_t> connect(const char* host,
+                           const int port,
+                           const timeout_t connect_timeout,
+                           const timeout_t socket_timeout,
+                           const socket_options_t& options) {
+  // Resolve the host name (possibly cached).
+  // Note: The connect timeout does not include the time for resolving the host name.
+  const result_t<address_list_t> addresses = resolve(host, port);
+  if (addresses.is_error()) {
+    return make_result(NULL_SOCKET_T, addresses.status());
   }
+  const int64_t resolve_time = get_monotonic_time_us();
 
   // Connect to the host.
-  // TODO(m): Implement timeout. See e.g. https://stackoverflow.com/a/2597774/5778708
-  if (::connect(socket_fd, info->ai_addr, info->ai_addrlen) == -1) {
+  size_t winner_index = 0;
+  int64_t rtt;
+  status_t::status_enum_t connect_status;
+  const int socket_fd = connect_race(
+      *addresses, options, make_deadline(connect_timeout), winner_index, rtt, connect_status);
+  if (socket_fd == -1) {
+    return make_result(NULL_SOCKET_T, connect_status);
+  }
+  apply_options_after_connect(socket_fd, options, rtt);
+
+  // Remember the fastest address, so that it is tried first next time.
+  global_resolver().set_preferred_address(host, port, (*addresses)[winner_index]);
+
+  // Return the socket handle.
+  socket_t new_socket = new_socket_struct();
+  if (new_socket == NULL) {
     ::close(socket_fd);
-    ::freeaddrinfo(info);
+    return make_result(NULL_SOCKET_T, status_t::ERROR);
+  }
+  new_socket->fd = socket_fd;
+  new_socket->socket_timeout = socket_timeout;
+  new_socket->tcp_quickack = options.tcp_quickack;
+  new_socket->stats.resolve_time = resolve_time;
+  new_socket->stats.connect_time = get_monotonic_time_us();
+  return make_result(new_socket, status_t::SUCCESS);
+}
+
+result_t<socket_t> connect_unix(const char* path,
+                                const timeout_t connect_timeout,
+                                const timeout_t socket_timeout) {
+  ::sockaddr_un address = {};
+  if (std::strlen(path) >= sizeof(address.sun_path)) {
+    return make_result(NULL_SOCKET_T, status_t::INVALID_ARGUMENT);
+  }
+  address.sun_family = AF_UNIX;
+  std::strncpy(&address.sun_path[0], path, sizeof(address.sun_path) - 1);
+  const int64_t start_time = get_monotonic_time_us();
+
+  // Connect (non-blocking, so that the connect timeout can be honored).
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
     return make_result(NULL_SOCKET_T, errno_to_status());
   }
+  if (!set_non_blocking(fd)) {
+    const status_t::status_enum_t status = errno_to_status();
+    ::close(fd);
+    return make_result(NULL_SOCKET_T, status);
+  }
+  if (::connect(fd, reinterpret_cast<const ::sockaddr*>(&address), sizeof(address)) != 0) {
+    status_t::status_enum_t status = status_t::SUCCESS;
+    if (errno == EINPROGRESS || errno == EINTR || errno == EAGAIN) {
+      status = wait_for_socket(fd, POLLOUT, make_deadline(connect_timeout));
+      if (status == status_t::SUCCESS) {
+        const int err = get_socket_error(fd);
+        status = (err == 0) ? status_t::SUCCESS : errno_to_status(err);
+      }
+    } else {
+      status = (errno == ENOENT) ? status_t::REFUSED : errno_to_status();
+    }
+    if (status != status_t::SUCCESS) {
+      ::close(fd);
+      return make_result(NULL_SOCKET_T, status);
+    }
+  }
 
   // Return the socket handle.
-  socket_t new_socket = new socket_struct_t();
-  new_socket->fd = socket_fd;
+  socket_t new_socket = new_socket_struct();
+  if (new_socket == NULL) {
+    ::close(fd);
+    return make_result(NULL_SOCKET_T, status_t::ERROR);
+  }
+  new_socket->fd = fd;
+  new_socket->socket_timeout = socket_timeout;
+  new_socket->tcp_quickack = false;
+  new_socket->stats.resolve_time = start_time;
+  new_socket->stats.connect_time = get_monotonic_time_us();
   return make_result(new_socket, status_t::SUCCESS);
 }
 
 status_t disconnect(socket_t socket) {
   ::close(socket->fd);
-  delete socket;
+  delete_socket_struct(socket);
   return make_result(status_t::SUCCESS);
 }
 
 result_t<size_t> send(socket_t socket, const void* buf, const size_t count) {
-  const ssize_t actual_count = ::send(socket->fd, buf, count, 0);
-  if (actual_count == -1) {
-    return make_result<size_t>(0, errno_to_status());
+  const int64_t deadline = make_deadline(socket->socket_timeout);
+  while (true) {
+    const ssize_t actual_count = ::send(socket->fd, buf, count, SEND_FLAGS);
+    ++socket->stats.send_calls;
+    if (actual_count >= 0) {
+      socket->stats.bytes_sent += static_cast<uint64_t>(actual_count);
+      return make_result(static_cast<size_t>(actual_count), status_t::SUCCESS);
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      return make_result<size_t>(0, errno_to_status());
+    }
+    const status_t::status_enum_t wait_status = wait_for_socket(socket->fd, POLLOUT, deadline);
+    if (wait_status != status_t::SUCCESS) {
+      return make_result<size_t>(0, wait_status);
+    }
   }
-  return make_result(static_cast<size_t>(actual_count), status_t::SUCCESS);
 }
 
 result_t<size_t> recv(socket_t socket, void* buf, const size_t count) {
-  const ssize_t actual_count = ::recv(socket->fd, buf, count, 0);
-  if (actual_count == -1) {
-    return make_result<size_t>(0, errno_to_status());
+  const int64_t deadline = make_deadline(socket->socket_timeout);
+  while (true) {
+    if (socket->tcp_quickack) {
+      arm_quickack(socket->fd);
+    }
+    const ssize_t actual_count = ::recv(socket->fd, buf, count, 0);
+    ++socket->stats.recv_calls;
+    if (actual_count >= 0) {
+      socket->stats.bytes_received += static_cast<uint64_t>(actual_count);
+      return make_result(static_cast<size_t>(actual_count), status_t::SUCCESS);
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      return make_result<size_t>(0, errno_to_status());
+    }
+    const status_t::status_enum_t wait_status = wait_for_socket(socket->fd, POLLIN, deadline);
+    if (wait_status != status_t::SUCCESS) {
+      return make_result<size_t>(0, wait_status);
+    }
+  }
+}
+
+socket_stats_t get_socket_stats(socket_t socket) {
+  return socket->stats;
+}
+
+result_t<size_t> wait_readable(const socket_t* sockets,
+                               const size_t count,
+                               const timeout_t timeout) {
+  ::pollfd pfds[64];
+  if (count == 0 || count > 64) {
+    return make_result<size_t>(0, status_t::INVALID_ARGUMENT);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    pfds[i].fd = sockets[i]->fd;
+    pfds[i].events = POLLIN;
+    pfds[i].revents = 0;
+  }
+
+  const int64_t deadline = make_deadline(timeout);
+  while (true) {
+    int timeout_ms = -1;
+    if (deadline != 0) {
+      const int64_t time_left = deadline - get_monotonic_time_us();
+      if (time_left <= 0) {
+        return make_result<size_t>(0, status_t::TIMEOUT);
+      }
+      timeout_ms = static_cast<int>((time_left + 999) / 1000);
+    }
+    const int result = ::poll(&pfds[0], static_cast< ::nfds_t>(count), timeout_ms);
+    if (result > 0) {
+      for (size_t i = 0; i < count; ++i) {
+        if (pfds[i].revents != 0) {
+          return make_result(i, status_t::SUCCESS);
+        }
+      }
+    }
+    if (result == -1 && errno != EINTR) {
+      return make_result<size_t>(0, errno_to_status());
+    }
   }
-  return make_result(static_cast<size_t>(actual_count), status_t::SUCCESS);
 }
 
 }  // namespace net
@@ -0,0 +1,155 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "network_socket.hpp"
+
+#include <arpa/inet.h>
+#include <ctime>
+#include <doctest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+// A listening socket on the loopback interface that never accepts any connections.
+class listener_t {
+public:
+  explicit listener_t(const int backlog) : m_fd(::socket(AF_INET, SOCK_STREAM, 0)), m_port(0) {
+    ::sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(m_fd, reinterpret_cast< ::sockaddr*>(&addr), sizeof(addr));
+    ::listen(m_fd, backlog);
+    ::socklen_t addr_len = sizeof(addr);
+    ::getsockname(m_fd, reinterpret_cast< ::sockaddr*>(&addr), &addr_len);
+    m_port = ntohs(addr.sin_port);
+  }
+
+  ~listener_t() {
+    ::close(m_fd);
+  }
+
+  int port() const {
+    return m_port;
+  }
+
+private:
+  int m_fd;
+  int m_port;
+};
+
+double elapsed_seconds(const ::timespec& start) {
+  ::timespec now;
+  ::clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<double>(now.tv_sec - start.tv_sec) +
+         static_cast<double>(now.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+}  // namespace
+
+TEST_CASE("Receive times out") {
+  // GIVEN
+  listener_t listener(1);
+  us3::result_t<us3::net::socket_t> socket =
+      us3::net::connect("127.0.0.1", listener.port(), 1000000, 50000);
+  REQUIRE(socket.is_success());
+
+  // WHEN
+  ::timespec start;
+  ::clock_gettime(CLOCK_MONOTONIC, &start);
+  char buf[16];
+  const us3::result_t<size_t> result = us3::net::recv(*socket, buf, sizeof(buf));
+
+  // THEN
+  CHECK_EQ(result.status(), us3::status_t::TIMEOUT);
+  CHECK(elapsed_seconds(start) < 1.0);
+  us3::net::disconnect(*socket);
+}
+
+TEST_CASE("Connect to a closed port is refused") {
+  // GIVEN
+  int port;
+  {
+    listener_t listener(1);
+    port = listener.port();
+  }
+
+  // WHEN
+  const us3::result_t<us3::net::socket_t> socket =
+      us3::net::connect("127.0.0.1", port, 1000000, 1000000);
+
+  // THEN
+  CHECK_EQ(socket.status(), us3::status_t::REFUSED);
+}
+
+TEST_CASE("Connect falls back to the next address") {
+  // GIVEN (a listener on IPv4 only, while "localhost" may also resolve to ::1)
+  listener_t listener(4);
+
+  // WHEN
+  ::timespec start;
+  ::clock_gettime(CLOCK_MONOTONIC, &start);
+  const us3::result_t<us3::net::socket_t> socket =
+      us3::net::connect("localhost", listener.port(), 5000000, 1000000);
+
+  // THEN (a refused attempt does not wait for the connection attempt delay)
+  REQUIRE(socket.is_success());
+  CHECK(elapsed_seconds(start) < 0.2);
+  us3::net::disconnect(*socket);
+}
+
+TEST_CASE("Buffer size from the bandwidth-delay product") {
+  // 1 Gbit/s (the default) with a 10 ms round trip time.
+  CHECK_EQ(us3::net::bdp_buffer_size(0, 10000), 1250000);
+
+  // 100 MB/s with a 50 ms round trip time.
+  CHECK_EQ(us3::net::bdp_buffer_size(100000000, 50000), 5000000);
+
+  // Unknown round trip time.
+  CHECK_EQ(us3::net::bdp_buffer_size(100000000, 0), 0);
+
+  // The size is capped.
+  CHECK_EQ(us3::net::bdp_buffer_size(1000000000, 10000000), 64 * 1024 * 1024);
+}
+
+TEST_CASE("Connect with socket options") {
+  // GIVEN
+  listener_t listener(1);
+  us3::net::socket_options_t options;
+  options.send_buffer_size = 256 * 1024;
+  options.recv_buffer_size = us3::net::AUTO_BUFFER_SIZE;
+  options.tcp_quickack = true;
+  options.busy_poll = 50;
+  options.recv_lowat = 16;
+
+  // WHEN
+  us3::result_t<us3::net::socket_t> socket =
+      us3::net::connect("127.0.0.1", listener.port(), 1000000, 50000, options);
+
+  // THEN (options are best effort, and must not prevent the connection from working)
+  REQUIRE(socket.is_success());
+  char buf[16];
+  CHECK_EQ(us3::net::recv(*socket, buf, sizeof(buf)).status(), us3::status_t::TIMEOUT);
+  us3::net::disconnect(*socket);
+}
@@ -19,8 +19,15 @@
 
 #include "network_socket.hpp"
 
+#include "allocator.hpp"
+#include "fixed_pool.hpp"
+#include "platform.hpp"
+#include "resolver.hpp"
 #include <cstddef>
 #include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #undef ERROR
@@ -31,6 +38,8 @@ namespace net {
 // Platform specific type.
 struct socket_struct_t {
   SOCKET handle;
+  timeout_t socket_timeout;
+  socket_stats_t stats;
 };
 
 namespace {
@@ -41,6 +50,34 @@ const socket_t NULL_SOCKET_T(nullptr);
 const socket_t NULL_SOCKET_T(NULL);
 #endif
 
+#if US3_STATIC_SOCKETS > 0
+fixed_pool_t<socket_struct_t, US3_STATIC_SOCKETS> s_socket_pool;
+#endif
+
+// Allocate a socket struct (with the allocation hooks, or from the pool of static sockets), or
+// return NULL if that fails.
+socket_t new_socket_struct() {
+#if US3_STATIC_SOCKETS > 0
+  return s_socket_pool.allocate();
+#else
+  void* memory = heap_alloc(sizeof(socket_struct_t));
+  return (memory != NULL) ? new (memory) socket_struct_t() : NULL;
+#endif
+}
+
+void delete_socket_struct(socket_t socket) {
+#if US3_STATIC_SOCKETS > 0
+  s_socket_pool.release(socket);
+#else
+  socket->~socket_struct_t();
+  heap_free(socket);
+#endif
+}
+
+// The delay between starting connection attempts to different addresses (RFC 8305 recommends
+// 250 ms).
+const int64_t CONNECTION_ATTEMPT_DELAY = 250000;
+
 bool s_wsa_initialized = false;
 
 bool wsa_initialize() {
@@ -76,76 +113,416 @@ status_t::status_enum_t wsa_error_to_status() {
   return wsa_error_to_status(WSAGetLastError());
 }
 
-}  // namespace
+int64_t make_deadline(const timeout_t timeout) {
+  return (timeout > 0) ? get_monotonic_time_us() + static_cast<int64_t>(timeout) : 0;
+}
 
-result_t<socket_t> connect(const char* host,
-                           const int port,
-                           const timeout_t connect_timeout,
-                           const timeout_t socket_timeout) {
-  // TODO(m): Make use of these arguments.
-  (void)connect_timeout;
-  (void)socket_timeout;
+// Wait until the socket is ready for writing (or reading), or until the deadline has passed (a
+// deadline of zero means no deadline).
+status_t::status_enum_t wait_for_socket(const SOCKET handle,
+                                        const bool for_write,
+                                        const int64_t deadline) {
+  timeval tv;
+  timeval* tv_ptr = NULL;
+  if (deadline != 0) {
+    const int64_t time_left = deadline - get_monotonic_time_us();
+    if (time_left <= 0) {
+      return status_t::TIMEOUT;
+    }
+    tv.tv_sec = static_cast<long>(time_left / 1000000);
+    tv.tv_usec = static_cast<long>(time_left % 1000000);
+    tv_ptr = &tv;
+  }
 
-  if (!wsa_initialize()) {
-    return make_result(NULL_SOCKET_T, status_t::ERROR);
+  // Connection failures are reported through the except set.
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(handle, &fds);
+  fd_set except_fds;
+  FD_ZERO(&except_fds);
+  FD_SET(handle, &except_fds);
+  const int result =
+      ::select(0, for_write ? NULL : &fds, for_write ? &fds : NULL, &except_fds, tv_ptr);
+  if (result == 0) {
+    return status_t::TIMEOUT;
+  }
+  if (result == SOCKET_ERROR) {
+    return wsa_error_to_status();
+  }
+  return status_t::SUCCESS;
+}
+
+// Set an integer socket option. Failures are ignored, since the options are only hints.
+void set_int_option(const SOCKET handle, const int level, const int name, const int value) {
+  (void)::setsockopt(handle, level, name, reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+int get_int_option(const SOCKET handle, const int level, const int name) {
+  int value = 0;
+  int value_len = sizeof(value);
+  if (::getsockopt(handle, level, name, reinterpret_cast<char*>(&value), &value_len) != 0) {
+    return 0;
+  }
+  return value;
+}
+
+// Apply the socket options that must be set before connecting.
+// Note: TCP_QUICKACK, SO_BUSY_POLL and SO_RCVLOWAT are not supported on Windows.
+void apply_options_before_connect(const SOCKET handle, const socket_options_t& options) {
+  if (options.tcp_nodelay) {
+    set_int_option(handle, IPPROTO_TCP, TCP_NODELAY, 1);
+  }
+  if (options.send_buffer_size > 0) {
+    set_int_option(handle, SOL_SOCKET, SO_SNDBUF, options.send_buffer_size);
+  }
+  if (options.recv_buffer_size > 0) {
+    set_int_option(handle, SOL_SOCKET, SO_RCVBUF, options.recv_buffer_size);
+  }
+}
+
+// Apply the socket options that depend on the connection (rtt is the handshake time in μs).
+void apply_options_after_connect(const SOCKET handle,
+                                 const socket_options_t& options,
+                                 const int64_t rtt) {
+  const int buffer_size = bdp_buffer_size(options.link_bandwidth, rtt);
+  if (options.send_buffer_size == AUTO_BUFFER_SIZE &&
+      buffer_size > get_int_option(handle, SOL_SOCKET, SO_SNDBUF)) {
+    set_int_option(handle, SOL_SOCKET, SO_SNDBUF, buffer_size);
+  }
+  if (options.recv_buffer_size == AUTO_BUFFER_SIZE &&
+      buffer_size > get_int_option(handle, SOL_SOCKET, SO_RCVBUF)) {
+    set_int_option(handle, SOL_SOCKET, SO_RCVBUF, buffer_size);
+  }
+}
+
+// Get the pending error of a socket (e.g. the result of a non-blocking connect).
+int get_socket_error(const SOCKET handle) {
+  int err = 0;
+  int err_len = sizeof(err);
+  if (::getsockopt(handle, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &err_len) != 0) {
+    return WSAGetLastError();
+  }
+  return err;
+}
+
+// Start a non-blocking connection attempt. Returns the socket (or INVALID_SOCKET on failure), and
+// sets is_connected if the connection was established immediately.
+SOCKET start_connect(const address_t& address,
+                     const socket_options_t& options,
+                     bool& is_connected,
+                     status_t::status_enum_t& status) {
+  is_connected = false;
+  const SOCKET handle = ::socket(address.family, SOCK_STREAM, IPPROTO_TCP);
+  if (handle == INVALID_SOCKET) {
+    status = wsa_error_to_status();
+    return INVALID_SOCKET;
+  }
+  u_long non_blocking = 1;
+  if (::ioctlsocket(handle, FIONBIO, &non_blocking) != 0) {
+    status = wsa_error_to_status();
+    ::closesocket(handle);
+    return INVALID_SOCKET;
+  }
+  apply_options_before_connect(handle, options);
+  if (::connect(handle,
+                reinterpret_cast<const sockaddr*>(&address.storage[0]),
+                static_cast<int>(address.size)) == 0) {
+    is_connected = true;
+    return handle;
+  }
+  if (WSAGetLastError() != WSAEWOULDBLOCK) {
+    status = wsa_error_to_status();
+    ::closesocket(handle);
+    return INVALID_SOCKET;
+  }
+  return handle;
+}
+
+// Race connection attempts to the addresses in the style of RFC 8305 (Happy Eyeballs): a new
+// attempt is started every CONNECTION_ATTEMPT_DELAY (or as soon as an attempt fails), and the
+// first socket that connects wins. Returns the socket (or INVALID_SOCKET), the index of the address
+// and the time it took to establish the connection (an estimate of the round trip time).
+SOCKET connect_race(const address_list_t& addresses,
+                    const socket_options_t& options,
+                    const int64_t deadline,
+                    size_t& winner_index,
+                    int64_t& rtt,
+                    status_t::status_enum_t& status) {
+  std::vector<SOCKET, std_allocator_t<SOCKET> > pending;
+  std::vector<size_t, std_allocator_t<size_t> > pending_index;
+  std::vector<int64_t, std_allocator_t<int64_t> > pending_start;
+  SOCKET winner_handle = INVALID_SOCKET;
+  size_t next_index = 0;
+  int64_t next_attempt_time = 0;
+  status = status_t::UNREACHABLE;
+  rtt = 0;
+
+  while (winner_handle == INVALID_SOCKET) {
+    const int64_t now = get_monotonic_time_us();
+    if (deadline != 0 && now >= deadline) {
+      status = status_t::TIMEOUT;
+      break;
+    }
+
+    // Start a new connection attempt? (select() can wait for at most FD_SETSIZE sockets)
+    const bool can_start = next_index < addresses.size() && pending.size() < FD_SETSIZE;
+    if (can_start && (pending.empty() || now >= next_attempt_time)) {
+      bool is_connected;
+      const SOCKET handle = start_connect(addresses[next_index], options, is_connected, status);
+      if (is_connected) {
+        winner_handle = handle;
+        winner_index = next_index;
+      } else if (handle != INVALID_SOCKET) {
+        pending.push_back(handle);
+        pending_index.push_back(next_index);
+        pending_start.push_back(now);
+        next_attempt_time = now + CONNECTION_ATTEMPT_DELAY;
+      }
+      ++next_index;
+      continue;
+    }
+
+    // Have all attempts failed?
+    if (pending.empty()) {
+      break;
+    }
+
+    // Wait for a pending attempt to finish (or for the time to start the next attempt).
+    int64_t wait_until = deadline;
+    if (can_start && (wait_until == 0 || next_attempt_time < wait_until)) {
+      wait_until = next_attempt_time;
+    }
+    timeval tv;
+    timeval* tv_ptr = NULL;
+    if (wait_until != 0) {
+      const int64_t time_left = (wait_until > now) ? (wait_until - now) : 0;
+      tv.tv_sec = static_cast<long>(time_left / 1000000);
+      tv.tv_usec = static_cast<long>(time_left % 1000000);
+      tv_ptr = &tv;
+    }
+
+    // Connection failures are reported through the except set.
+    fd_set write_fds;
+    fd_set except_fds;
+    FD_ZERO(&write_fds);
+    FD_ZERO(&except_fds);
+    for (size_t i = 0; i < pending.size(); ++i) {
+      FD_SET(pending[i], &write_fds);
+      FD_SET(pending[i], &except_fds);
+    }
+    const int result = ::select(0, NULL, &write_fds, &except_fds, tv_ptr);
+    if (result == SOCKET_ERROR) {
+      status = wsa_error_to_status();
+      break;
+    }
+
+    // Check the attempts that have finished.
+    for (size_t i = 0; result > 0 && i < pending.size();) {
+      const bool is_writable = FD_ISSET(pending[i], &write_fds) != 0;
+      if (!is_writable && FD_ISSET(pending[i], &except_fds) == 0) {
+        ++i;
+        continue;
+      }
+      const int err = get_socket_error(pending[i]);
+      if (is_writable && err == 0) {
+        winner_handle = pending[i];
+        winner_index = pending_index[i];
+        rtt = get_monotonic_time_us() - pending_start[i];
+      } else {
+        // The attempt failed: Start the next attempt right away.
+        status = (err != 0) ? wsa_error_to_status(err) : status_t::ERROR;
+        ::closesocket(pending[i]);
+        next_attempt_time = now;
+      }
+      pending.erase(pending.begin() + static_cast<std::ptrdiff_t>(i));
+      pending_index.erase(pending_index.begin() + static_cast<std::ptrdiff_t>(i));
+      pending_start.erase(pending_start.begin() + static_cast<std::ptrdiff_t>(i));
+      if (winner_handle != INVALID_SOCKET) {
+        break;
+      }
+    }
   }
 
-  // Get address info for the host / port.
+  // Abandon the losing attempts.
+  for (size_t i = 0; i < pending.size(); ++i) {
+    ::closesocket(pending[i]);
+  }
+
+  return winner_handle;
+}
+
+}  // namespace
+
+lookup_status_t lookup_host(const char* host, const int port, address_list_t& addresses) {
   ::addrinfo* info;
   {
     ::addrinfo hints = {};
-    hints.ai_family = AF_INET;
+    hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
     char port_str[30];
     std::snprintf(&port_str[0], sizeof(port_str), "%d", port);
-    if (::getaddrinfo(host, port_str, &hints, &info) != 0) {
-      return make_result(NULL_SOCKET_T, status_t::NO_HOST);
+    const int result = ::getaddrinfo(host, port_str, &hints, &info);
+    if (result == EAI_AGAIN) {
+      return LOOKUP_TEMPORARY_FAILURE;
+    }
+    if (result != 0) {
+      return LOOKUP_NO_HOST;
     }
   }
 
-  // Open the socket.
-  const SOCKET socket_handle = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-  if (socket_handle == INVALID_SOCKET) {
-    ::freeaddrinfo(info);
-    return make_result(NULL_SOCKET_T, wsa_error_to_status());
+  // Copy the addresses (in the order given by the system, which follows RFC 6724).
+  addresses.clear();
+  for (const ::addrinfo* ai = info; ai != NULL; ai = ai->ai_next) {
+    address_t address;
+    if (static_cast<size_t>(ai->ai_addrlen) > sizeof(address.storage)) {
+      continue;
+    }
+    address.family = ai->ai_family;
+    address.size = static_cast<size_t>(ai->ai_addrlen);
+    std::memcpy(&address.storage[0], ai->ai_addr, address.size);
+    addresses.push_back(address);
   }
+  ::freeaddrinfo(info);
 
-  // Connect to the host.
-  // TODO(m): Implement timeout. See e.g. https://stackoverflow.com/a/2597774/5778708
-  if (::connect(socket_handle, info->ai_addr, static_cast<int>(info->ai_addrlen)) == -1) {
-    ::closesocket(socket_handle);
-    ::freeaddrinfo(info);
-    return make_result(NULL_SOCKET_T, wsa_error_to_status());
+  return addresses.empty() ? LOOKUP_NO_HOST : LOOKUP_SUCCESS;
+}
+
+result_t<socket_t> connect(const char* host,
+                           const int port,
+                           const timeout_t connect_timeout,
+                           const timeout_t socket_timeout,
+                           const socket_options_t& options) {
+  if (!wsa_initialize()) {
+    return make_result(NULL_SOCKET_T, status_t::ERROR);
   }
 
+  // Resolve the host name (possibly cached).
+  // Note: The connect timeout does not include the time for resolving the host name.
+  const result_t<address_list_t> addresses = resolve(host, port);
+  if (addresses.is_error()) {
+    return make_result(NULL_SOCKET_T, addresses.status());
+  }
+  const int64_t resolve_time = get_monotonic_time_us();
+
+  // Connect to the host. We use non-blocking sockets so that we can enforce the timeouts.
+  size_t winner_index = 0;
+  int64_t rtt;
+  status_t::status_enum_t connect_status;
+  const SOCKET socket_handle = connect_race(
+      *addresses, options, make_deadline(connect_timeout), winner_index, rtt, connect_status);
+  if (socket_handle == INVALID_SOCKET) {
+    return make_result(NULL_SOCKET_T, connect_status);
+  }
+  apply_options_after_connect(socket_handle, options, rtt);
+
+  // Remember the fastest address, so that it is tried first next time.
+  global_resolver().set_preferred_address(host, port, (*addresses)[winner_index]);
+
   // Return the socket handle.
-  socket_t new_socket = new socket_struct_t();
+  socket_t new_socket = new_socket_struct();
+  if (new_socket == NULL) {
+    ::closesocket(socket_handle);
+    return make_result(NULL_SOCKET_T, status_t::ERROR);
+  }
   new_socket->handle = socket_handle;
+  new_socket->socket_timeout = socket_timeout;
+  new_socket->stats.resolve_time = resolve_time;
+  new_socket->stats.connect_time = get_monotonic_time_us();
   return make_result(new_socket, status_t::SUCCESS);
 }
 
+result_t<socket_t> connect_unix(const char*, const timeout_t, const timeout_t) {
+  return make_result(NULL_SOCKET_T, status_t::UNSUPPORTED);
+}
+
 status_t disconnect(socket_t socket) {
   ::closesocket(socket->handle);
-  delete socket;
+  delete_socket_struct(socket);
   return make_result(status_t::SUCCESS);
 }
 
 result_t<size_t> send(socket_t socket, const void* buf, const size_t count) {
-  const int actual_count =
-      ::send(socket->handle, reinterpret_cast<const char*>(buf), static_cast<int>(count), 0);
-  if (actual_count == -1) {
-    return make_result<size_t>(0, wsa_error_to_status());
+  const int64_t deadline = make_deadline(socket->socket_timeout);
+  while (true) {
+    const int actual_count =
+        ::send(socket->handle, reinterpret_cast<const char*>(buf), static_cast<int>(count), 0);
+    ++socket->stats.send_calls;
+    if (actual_count != SOCKET_ERROR) {
+      socket->stats.bytes_sent += static_cast<uint64_t>(actual_count);
+      return make_result(static_cast<size_t>(actual_count), status_t::SUCCESS);
+    }
+    if (WSAGetLastError() != WSAEWOULDBLOCK) {
+      return make_result<size_t>(0, wsa_error_to_status());
+    }
+    const status_t::status_enum_t wait_status = wait_for_socket(socket->handle, true, deadline);
+    if (wait_status != status_t::SUCCESS) {
+      return make_result<size_t>(0, wait_status);
+    }
   }
-  return make_result(static_cast<size_t>(actual_count), status_t::SUCCESS);
 }
 
 result_t<size_t> recv(socket_t socket, void* buf, const size_t count) {
-  const int actual_count =
-      ::recv(socket->handle, reinterpret_cast<char*>(buf), static_cast<int>(count), 0);
-  if (actual_count == -1) {
+  const int64_t deadline = make_deadline(socket->socket_timeout);
+  while (true) {
+    const int actual_count =
+        ::recv(socket->handle, reinterpret_cast<char*>(buf), static_cast<int>(count), 0);
+    ++socket->stats.recv_calls;
+    if (actual_count != SOCKET_ERROR) {
+      socket->stats.bytes_received += static_cast<uint64_t>(actual_count);
+      return make_result(static_cast<size_t>(actual_count), status_t::SUCCESS);
+    }
+    if (WSAGetLastError() != WSAEWOULDBLOCK) {
+      return make_result<size_t>(0, wsa_error_to_status());
+    }
+    const status_t::status_enum_t wait_status = wait_for_socket(socket->handle, false, deadline);
+    if (wait_status != status_t::SUCCESS) {
+      return make_result<size_t>(0, wait_status);
+    }
+  }
+}
+
+socket_stats_t get_socket_stats(socket_t socket) {
+  return socket->stats;
+}
+
+result_t<size_t> wait_readable(const socket_t* sockets,
+                               const size_t count,
+                               const timeout_t timeout) {
+  if (count == 0 || count > 64 || count > FD_SETSIZE) {
+    return make_result<size_t>(0, status_t::INVALID_ARGUMENT);
+  }
+
+  timeval tv;
+  timeval* tv_ptr = NULL;
+  if (timeout > 0) {
+    tv.tv_sec = static_cast<long>(timeout / 1000000);
+    tv.tv_usec = static_cast<long>(timeout % 1000000);
+    tv_ptr = &tv;
+  }
+
+  // Closed connections are reported as readable, and failures through the except set.
+  fd_set read_fds;
+  fd_set except_fds;
+  FD_ZERO(&read_fds);
+  FD_ZERO(&except_fds);
+  for (size_t i = 0; i < count; ++i) {
+    FD_SET(sockets[i]->handle, &read_fds);
+    FD_SET(sockets[i]->handle, &except_fds);
+  }
+  const int result = ::select(0, &read_fds, NULL, &except_fds, tv_ptr);
+  if (result == 0) {
+    return make_result<size_t>(0, status_t::TIMEOUT);
+  }
+  if (result == SOCKET_ERROR) {
     return make_result<size_t>(0, wsa_error_to_status());
   }
-  return make_result(static_cast<size_t>(actual_count), status_t::SUCCESS);
+  for (size_t i = 0; i < count; ++i) {
+    if (FD_ISSET(sockets[i]->handle, &read_fds) || FD_ISSET(sockets[i]->handle, &except_fds)) {
+      return make_result(i, status_t::SUCCESS);
+    }
+  }
+  return make_result<size_t>(0, status_t::ERROR);
 }
 
 }  // namespace net
@@ -0,0 +1,130 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_PLATFORM_HPP_
+#define US3_PLATFORM_HPP_
+
+#include <cstddef>
+#include <cstdio>
+#include <stdint.h>
+
+namespace us3 {
+
+/// @brief A non-recursive mutex.
+///
+/// The platform mutex is stored in the object itself, so that creating a mutex does not allocate
+/// memory.
+class mutex_t {
+public:
+  mutex_t();
+  ~mutex_t();
+
+  void lock();
+  void unlock();
+
+private:
+  // Not copyable.
+  mutex_t(const mutex_t&);
+  mutex_t& operator=(const mutex_t&);
+
+  struct impl_t;
+
+  // Storage for the platform mutex (large enough for a pthread_mutex_t or a CRITICAL_SECTION).
+  static const size_t IMPL_SIZE = 64;
+  union impl_storage_t {
+    char bytes[IMPL_SIZE];
+    void* align_ptr;
+    uint64_t align_int;
+    long double align_float;
+  };
+
+  impl_storage_t m_storage;
+  impl_t* m_impl;
+};
+
+/// @brief Lock a mutex for the lifetime of the lock object.
+class lock_guard_t {
+public:
+  explicit lock_guard_t(mutex_t& mutex) : m_mutex(mutex) {
+    m_mutex.lock();
+  }
+
+  ~lock_guard_t() {
+    m_mutex.unlock();
+  }
+
+private:
+  // Not copyable.
+  lock_guard_t(const lock_guard_t&);
+  lock_guard_t& operator=(const lock_guard_t&);
+
+  mutex_t& m_mutex;
+};
+
+/// @brief Thread entry point.
+typedef void (*thread_fun_t)(void* arg);
+
+/// @brief Start a detached thread.
+/// @param fun The function to run in the new thread.
+/// @param arg The argument to pass to the function.
+/// @returns true if the thread was started.
+bool start_detached_thread(thread_fun_t fun, void* arg);
+
+/// @brief Get an identifier of the calling thread.
+uint64_t get_thread_id();
+
+/// @brief Atomically add a value to a counter.
+void atomic_add(volatile uint64_t& target, uint64_t value);
+
+/// @brief Atomically read a counter (with a full memory barrier).
+uint64_t atomic_load(volatile uint64_t& source);
+
+/// @brief Atomically read a value (with a full memory barrier).
+int32_t atomic_load(volatile int32_t& source);
+
+/// @brief Atomically write a value (with a full memory barrier).
+void atomic_store(volatile int32_t& target, int32_t value);
+
+/// @brief Atomically replace a value if it is equal to an expected value (full memory barrier).
+/// @returns true if the value was replaced.
+bool atomic_compare_and_swap(volatile int32_t& target, int32_t expected, int32_t desired);
+
+/// @brief Get the current time of a monotonic clock.
+/// @returns the time in microseconds, relative to an unspecified starting point.
+int64_t get_monotonic_time_us();
+
+/// @brief Suspend the calling thread.
+/// @param time_us The time to sleep, in microseconds (returns immediately if <= 0).
+void sleep_us(int64_t time_us);
+
+/// @brief Get the size of an open file (also for files larger than 2 GiB).
+/// @param file The file.
+/// @param[out] size The size of the file, in bytes.
+/// @returns true on success.
+bool get_file_size(std::FILE* file, uint64_t& size);
+
+/// @brief Set the position of an open file (also for files larger than 2 GiB).
+/// @param file The file.
+/// @param offset The new position, in bytes from the start of the file.
+/// @returns true on success.
+bool seek_file(std::FILE* file, uint64_t offset);
+
+}  // namespace us3
+
+#endif  // US3_PLATFORM_HPP_
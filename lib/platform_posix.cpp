@@ -0,0 +1,165 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+// Use 64-bit file offsets on 32-bit systems too.
+#define _FILE_OFFSET_BITS 64
+
+#include "platform.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+
+namespace us3 {
+
+struct mutex_t::impl_t {
+  pthread_mutex_t mutex;
+};
+
+mutex_t::mutex_t() : m_impl(new (&m_storage) impl_t) {
+  // The platform mutex must fit in the storage of the mutex object.
+  char impl_fits_storage[(sizeof(impl_t) <= sizeof(m_storage)) ? 1 : -1];
+  (void)impl_fits_storage;
+  pthread_mutex_init(&m_impl->mutex, NULL);
+}
+
+mutex_t::~mutex_t() {
+  pthread_mutex_destroy(&m_impl->mutex);
+  m_impl->~impl_t();
+}
+
+void mutex_t::lock() {
+  pthread_mutex_lock(&m_impl->mutex);
+}
+
+void mutex_t::unlock() {
+  pthread_mutex_unlock(&m_impl->mutex);
+}
+
+namespace {
+
+struct thread_start_t {
+  thread_fun_t fun;
+  void* arg;
+};
+
+void* thread_main(void* arg) {
+  thread_start_t* start = reinterpret_cast<thread_start_t*>(arg);
+  const thread_start_t start_copy = *start;
+  delete start;
+  start_copy.fun(start_copy.arg);
+  return NULL;
+}
+
+}  // namespace
+
+bool start_detached_thread(thread_fun_t fun, void* arg) {
+  thread_start_t* start = new thread_start_t;
+  start->fun = fun;
+  start->arg = arg;
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_t thread;
+  const int result = pthread_create(&thread, &attr, thread_main, start);
+  pthread_attr_destroy(&attr);
+  if (result != 0) {
+    delete start;
+    return false;
+  }
+  return true;
+}
+
+uint64_t get_thread_id() {
+  // Note: pthread_t is an opaque type (usually an integer or a pointer).
+  const pthread_t thread = pthread_self();
+  uint64_t id = 0;
+  std::memcpy(&id, &thread, (sizeof(thread) < sizeof(id)) ? sizeof(thread) : sizeof(id));
+  return id;
+}
+
+void atomic_add(volatile uint64_t& target, const uint64_t value) {
+  __sync_fetch_and_add(&target, value);
+}
+
+uint64_t atomic_load(volatile uint64_t& source) {
+  // Note: A plain 64-bit read is not atomic on 32-bit systems.
+  return __sync_fetch_and_add(&source, 0);
+}
+
+int32_t atomic_load(volatile int32_t& source) {
+  __sync_synchronize();
+  const int32_t value = source;
+  __sync_synchronize();
+  return value;
+}
+
+void atomic_store(volatile int32_t& target, const int32_t value) {
+  __sync_synchronize();
+  target = value;
+  __sync_synchronize();
+}
+
+bool atomic_compare_and_swap(volatile int32_t& target,
+                             const int32_t expected,
+                             const int32_t desired) {
+  return __sync_bool_compare_and_swap(&target, expected, desired);
+}
+
+int64_t get_monotonic_time_us() {
+  ::timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + static_cast<int64_t>(ts.tv_nsec / 1000);
+}
+
+void sleep_us(const int64_t time_us) {
+  if (time_us <= 0) {
+    return;
+  }
+  ::timespec ts;
+  ts.tv_sec = static_cast< ::time_t>(time_us / 1000000);
+  ts.tv_nsec = static_cast<long>((time_us % 1000000) * 1000);
+
+  // Continue sleeping for the remaining time when interrupted by a signal.
+  while (::nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
+
+bool get_file_size(std::FILE* file, uint64_t& size) {
+  if (::fseeko(file, 0, SEEK_END) != 0) {
+    return false;
+  }
+  const off_t end = ::ftello(file);
+  if (end < 0 || ::fseeko(file, 0, SEEK_SET) != 0) {
+    return false;
+  }
+  size = static_cast<uint64_t>(end);
+  return true;
+}
+
+bool seek_file(std::FILE* file, const uint64_t offset) {
+  return ::fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+}
+
+}  // namespace us3
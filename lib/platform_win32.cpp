@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "platform.hpp"
+
+#include <cstddef>
+#include <new>
+#include <process.h>
+#include <windows.h>
+
+namespace us3 {
+
+struct mutex_t::impl_t {
+  CRITICAL_SECTION critical_section;
+};
+
+mutex_t::mutex_t() : m_impl(new (&m_storage) impl_t) {
+  // The platform mutex must fit in the storage of the mutex object.
+  char impl_fits_storage[(sizeof(impl_t) <= sizeof(m_storage)) ? 1 : -1];
+  (void)impl_fits_storage;
+  InitializeCriticalSection(&m_impl->critical_section);
+}
+
+mutex_t::~mutex_t() {
+  DeleteCriticalSection(&m_impl->critical_section);
+  m_impl->~impl_t();
+}
+
+void mutex_t::lock() {
+  EnterCriticalSection(&m_impl->critical_section);
+}
+
+void mutex_t::unlock() {
+  LeaveCriticalSection(&m_impl->critical_section);
+}
+
+namespace {
+
+struct thread_start_t {
+  thread_fun_t fun;
+  void* arg;
+};
+
+unsigned __stdcall thread_main(void* arg) {
+  thread_start_t* start = reinterpret_cast<thread_start_t*>(arg);
+  const thread_start_t start_copy = *start;
+  delete start;
+  start_copy.fun(start_copy.arg);
+  return 0;
+}
+
+}  // namespace
+
+bool start_detached_thread(thread_fun_t fun, void* arg) {
+  thread_start_t* start = new thread_start_t;
+  start->fun = fun;
+  start->arg = arg;
+
+  const uintptr_t thread = _beginthreadex(NULL, 0, thread_main, start, 0, NULL);
+  if (thread == 0) {
+    delete start;
+    return false;
+  }
+
+  // Detach the thread.
+  CloseHandle(reinterpret_cast<HANDLE>(thread));
+  return true;
+}
+
+uint64_t get_thread_id() {
+  return static_cast<uint64_t>(GetCurrentThreadId());
+}
+
+void atomic_add(volatile uint64_t& target, const uint64_t value) {
+  InterlockedExchangeAdd64(reinterpret_cast<volatile LONG64*>(&target),
+                           static_cast<LONG64>(value));
+}
+
+uint64_t atomic_load(volatile uint64_t& source) {
+  return static_cast<uint64_t>(
+      InterlockedCompareExchange64(reinterpret_cast<volatile LONG64*>(&source), 0, 0));
+}
+
+int32_t atomic_load(volatile int32_t& source) {
+  return static_cast<int32_t>(
+      InterlockedCompareExchange(reinterpret_cast<volatile LONG*>(&source), 0, 0));
+}
+
+void atomic_store(volatile int32_t& target, const int32_t value) {
+  InterlockedExchange(reinterpret_cast<volatile LONG*>(&target), static_cast<LONG>(value));
+}
+
+bool atomic_compare_and_swap(volatile int32_t& target,
+                             const int32_t expected,
+                             const int32_t desired) {
+  return InterlockedCompareExchange(reinterpret_cast<volatile LONG*>(&target),
+                                    static_cast<LONG>(desired),
+                                    static_cast<LONG>(expected)) == static_cast<LONG>(expected);
+}
+
+int64_t get_monotonic_time_us() {
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return static_cast<int64_t>((counter.QuadPart / frequency.QuadPart) * 1000000 +
+                              ((counter.QuadPart % frequency.QuadPart) * 1000000) /
+                                  frequency.QuadPart);
+}
+
+void sleep_us(const int64_t time_us) {
+  if (time_us <= 0) {
+    return;
+  }
+  Sleep(static_cast<DWORD>((time_us + 999) / 1000));
+}
+
+bool get_file_size(std::FILE* file, uint64_t& size) {
+  if (_fseeki64(file, 0, SEEK_END) != 0) {
+    return false;
+  }
+  const __int64 end = _ftelli64(file);
+  if (end < 0 || _fseeki64(file, 0, SEEK_SET) != 0) {
+    return false;
+  }
+  size = static_cast<uint64_t>(end);
+  return true;
+}
+
+bool seek_file(std::FILE* file, const uint64_t offset) {
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+}
+
+}  // namespace us3
@@ -0,0 +1,495 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "recording.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+namespace us3 {
+namespace net {
+
+namespace {
+
+const char* const RECORDING_MAGIC = "us3-recording 1";
+const size_t MAX_SOCKETS = 64;
+
+// Serializes appending to recording files.
+mutex_t& recording_file_mutex() {
+  static mutex_t* s_mutex = new mutex_t();
+  return *s_mutex;
+}
+
+// Create the mutex during static initialization (before any threads are started).
+const mutex_t& s_recording_file_mutex = recording_file_mutex();
+
+// Read a complete (newline terminated) line, without the newline.
+bool read_line(std::FILE* file, std::string& line) {
+  line.clear();
+  char buf[256];
+  while (std::fgets(buf, sizeof(buf), file) != NULL) {
+    line += &buf[0];
+    if (!line.empty() && line[line.size() - 1] == '\n') {
+      line.erase(line.size() - 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool append_to_file(const char* path, const std::string& text) {
+  lock_guard_t lock(recording_file_mutex());
+  std::FILE* file = std::fopen(path, "ab");
+  if (file == NULL) {
+    return false;
+  }
+  bool success = std::fseek(file, 0, SEEK_END) == 0;
+  if (success && std::ftell(file) == 0) {
+    success = std::fprintf(file, "%s\n", RECORDING_MAGIC) > 0;
+  }
+  success = success && std::fwrite(text.data(), 1, text.size(), file) == text.size();
+  success = (std::fclose(file) == 0) && success;
+  return success;
+}
+
+void sleep_until(const int64_t time) {
+  const int64_t now = get_monotonic_time_us();
+  if (time > now) {
+    sleep_us(time - now);
+  }
+}
+
+// The longest header name that is matched when redacting credentials.
+const size_t MAX_HEADER_NAME_SIZE = 32;
+
+// A recorded connection: the underlying socket, and the log of the traffic.
+struct recording_socket_t {
+  const recording_config_t* config;
+  const transport_t* transport;
+  socket_t socket;
+  int64_t start_time;
+  std::string log;
+
+  // State for redacting the sent credentials, which may be split over several send calls: The
+  // (lower case) name of the current header line, and whether we are in a redacted value.
+  std::string header_name;
+  bool in_header_name;
+  bool is_redacting;
+};
+
+recording_socket_t* to_recording_socket(socket_t socket) {
+  return reinterpret_cast<recording_socket_t*>(socket);
+}
+
+void log_data(recording_socket_t* recording,
+              const char* type,
+              const void* buf,
+              const size_t count) {
+  std::ostringstream header;
+  header << type << ' ' << (get_monotonic_time_us() - recording->start_time) << ' ' << count
+         << '\n';
+  recording->log += header.str();
+  recording->log.append(static_cast<const char*>(buf), count);
+  recording->log += '\n';
+}
+
+bool is_secret_header(const std::string& name) {
+  return name == "authorization" || name == "x-amz-security-token";
+}
+
+// Replace the values of the credential headers in sent data with '*' (keeping the size, so that
+// the recorded segments keep their shapes).
+std::string redact_sent_data(recording_socket_t* recording, const void* buf, const size_t count) {
+  std::string data(static_cast<const char*>(buf), count);
+  for (size_t i = 0; i < data.size(); ++i) {
+    const char c = data[i];
+    if (c == '\r' || c == '\n') {
+      recording->header_name.clear();
+      recording->in_header_name = true;
+      recording->is_redacting = false;
+    } else if (recording->is_redacting) {
+      if (c != ' ') {
+        data[i] = '*';
+      }
+    } else if (recording->in_header_name) {
+      if (c == ':') {
+        recording->in_header_name = false;
+        recording->is_redacting = is_secret_header(recording->header_name);
+      } else if (recording->header_name.size() < MAX_HEADER_NAME_SIZE) {
+        recording->header_name +=
+            static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      } else {
+        recording->in_header_name = false;
+      }
+    }
+  }
+  return data;
+}
+
+result_t<socket_t> recording_connect(const void* data,
+                                     const char* host,
+                                     const int port,
+                                     const timeout_t connect_timeout,
+                                     const timeout_t socket_timeout,
+                                     const socket_options_t& options) {
+  const recording_config_t* config = static_cast<const recording_config_t*>(data);
+  if (config == NULL || config->path == NULL) {
+    return make_result<socket_t>(NULL, status_t::INVALID_ARGUMENT);
+  }
+  const transport_t& transport = (config->transport != NULL) ? *config->transport : tcp_transport();
+
+  const int64_t start_time = get_monotonic_time_us();
+  const result_t<socket_t> result = transport.connect(
+      config->transport_data, host, port, connect_timeout, socket_timeout, options);
+  std::ostringstream header;
+  header << "connection " << host << ' ' << port << ' ' << (get_monotonic_time_us() - start_time)
+         << ' ' << static_cast<int>(result.status()) << '\n';
+  if (result.is_error()) {
+    append_to_file(config->path, header.str() + "end\n");
+    return result;
+  }
+
+  recording_socket_t* recording = new recording_socket_t;
+  recording->config = config;
+  recording->transport = &transport;
+  recording->socket = *result;
+  recording->start_time = start_time;
+  recording->log = header.str();
+  recording->in_header_name = true;
+  recording->is_redacting = false;
+  return make_result(reinterpret_cast<socket_t>(recording), status_t::SUCCESS);
+}
+
+status_t recording_disconnect(socket_t socket) {
+  recording_socket_t* recording = to_recording_socket(socket);
+  const status_t status = recording->transport->disconnect(recording->socket);
+
+  // A recording that can not be written must not fail the request, so errors are ignored.
+  recording->log += "end\n";
+  append_to_file(recording->config->path, recording->log);
+  delete recording;
+  return status;
+}
+
+result_t<size_t> recording_send(socket_t socket, const void* buf, const size_t count) {
+  recording_socket_t* recording = to_recording_socket(socket);
+  const result_t<size_t> result = recording->transport->send(recording->socket, buf, count);
+  if (result.is_success() && *result > 0) {
+    const std::string data = redact_sent_data(recording, buf, *result);
+    log_data(recording, "send", data.data(), data.size());
+  }
+  return result;
+}
+
+result_t<size_t> recording_recv(socket_t socket, void* buf, const size_t count) {
+  recording_socket_t* recording = to_recording_socket(socket);
+  const result_t<size_t> result = recording->transport->recv(recording->socket, buf, count);
+  if (result.is_success()) {
+    if (*result > 0) {
+      log_data(recording, "recv", buf, *result);
+    }
+  } else {
+    std::ostringstream event;
+    event << "error " << (get_monotonic_time_us() - recording->start_time) << ' '
+          << static_cast<int>(result.status()) << '\n';
+    recording->log += event.str();
+  }
+  return result;
+}
+
+socket_stats_t recording_get_socket_stats(socket_t socket) {
+  recording_socket_t* recording = to_recording_socket(socket);
+  return recording->transport->get_socket_stats(recording->socket);
+}
+
+result_t<size_t> recording_wait_readable(const socket_t* sockets,
+                                         const size_t count,
+                                         const timeout_t timeout) {
+  if (count == 0 || count > MAX_SOCKETS) {
+    return make_result<size_t>(0, status_t::INVALID_ARGUMENT);
+  }
+  socket_t recorded_sockets[MAX_SOCKETS];
+  for (size_t i = 0; i < count; ++i) {
+    recorded_sockets[i] = to_recording_socket(sockets[i])->socket;
+  }
+  return to_recording_socket(sockets[0])
+      ->transport->wait_readable(recorded_sockets, count, timeout);
+}
+
+const transport_t RECORDING_TRANSPORT = {recording_connect,
+                                         recording_disconnect,
+                                         recording_send,
+                                         recording_recv,
+                                         recording_get_socket_stats,
+                                         recording_wait_readable};
+
+bool parse_status(const int value, status_t::status_enum_t& status) {
+  if (value < static_cast<int>(status_t::SUCCESS) ||
+      value > static_cast<int>(status_t::SERVER_ERROR)) {
+    return false;
+  }
+  status = static_cast<status_t::status_enum_t>(value);
+  return true;
+}
+
+}  // namespace
+
+const transport_t& recording_transport() {
+  return RECORDING_TRANSPORT;
+}
+
+// A replayed connection: the recorded connection, and the replay position.
+struct replay_t::socket_t {
+  const connection_t* connection;
+  bool real_time;
+  int64_t start_time;
+  size_t event_index;  // The next event to replay.
+  size_t data_pos;     // The position in the data of a partially received event.
+  socket_stats_t stats;
+};
+
+std::string replay_t::connection_t::sent_data() const {
+  std::string data;
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (events[i].type == event_t::SEND) {
+      data += events[i].data;
+    }
+  }
+  return data;
+}
+
+replay_t::replay_t(const bool real_time) : m_real_time(real_time), m_next_connection(0) {
+}
+
+status_t replay_t::load(const char* path) {
+  m_connections.clear();
+  seek(0);
+
+  std::FILE* file = std::fopen(path, "rb");
+  if (file == NULL) {
+    return make_result(status_t::NOT_FOUND);
+  }
+
+  std::string line;
+  bool is_valid = read_line(file, line) && line == RECORDING_MAGIC;
+  bool in_connection = false;
+  while (is_valid && read_line(file, line)) {
+    std::istringstream stream(line);
+    std::string type;
+    stream >> type;
+    if (type == "connection" && !in_connection) {
+      m_connections.push_back(connection_t());
+      connection_t& connection = m_connections.back();
+      int status = 0;
+      stream >> connection.host >> connection.port >> connection.connect_time >> status;
+      is_valid = !stream.fail() && parse_status(status, connection.status);
+      in_connection = true;
+    } else if ((type == "send" || type == "recv") && in_connection) {
+      event_t event;
+      event.type = (type == "send") ? event_t::SEND : event_t::RECV;
+      event.status = status_t::SUCCESS;
+      size_t size = 0;
+      stream >> event.time >> size;
+      is_valid = !stream.fail() && size > 0;
+      if (is_valid) {
+        event.data.resize(size);
+        is_valid = std::fread(&event.data[0], 1, size, file) == size && std::fgetc(file) == '\n';
+      }
+      m_connections.back().events.push_back(event);
+    } else if (type == "error" && in_connection) {
+      event_t event;
+      event.type = event_t::ERROR;
+      int status = 0;
+      stream >> event.time >> status;
+      is_valid = !stream.fail() && parse_status(status, event.status);
+      m_connections.back().events.push_back(event);
+    } else if (type == "end" && in_connection) {
+      in_connection = false;
+    } else {
+      is_valid = false;
+    }
+  }
+  std::fclose(file);
+
+  if (!is_valid || in_connection) {
+    m_connections.clear();
+    return make_result(status_t::ERROR);
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+size_t replay_t::next_connection() {
+  lock_guard_t lock(m_mutex);
+  return m_next_connection;
+}
+
+void replay_t::seek(const size_t index) {
+  lock_guard_t lock(m_mutex);
+  m_next_connection = index;
+}
+
+const transport_t& replay_t::transport() {
+  static const transport_t REPLAY_TRANSPORT = {replay_connect,
+                                               replay_disconnect,
+                                               replay_send,
+                                               replay_recv,
+                                               replay_get_socket_stats,
+                                               replay_wait_readable};
+  return REPLAY_TRANSPORT;
+}
+
+replay_t::socket_t* replay_t::to_replay_socket(const net::socket_t socket) {
+  return reinterpret_cast<socket_t*>(socket);
+}
+
+result_t<net::socket_t> replay_t::replay_connect(const void* data,
+                                                 const char*,
+                                                 const int,
+                                                 const timeout_t,
+                                                 const timeout_t,
+                                                 const socket_options_t&) {
+  replay_t* replay = const_cast<replay_t*>(static_cast<const replay_t*>(data));
+  if (replay == NULL || replay->m_connections.empty()) {
+    return make_result<net::socket_t>(NULL, status_t::INVALID_ARGUMENT);
+  }
+  const connection_t* connection;
+  {
+    lock_guard_t lock(replay->m_mutex);
+    connection = &replay->m_connections[replay->m_next_connection % replay->m_connections.size()];
+    ++replay->m_next_connection;
+  }
+
+  const int64_t start_time = get_monotonic_time_us();
+  if (replay->m_real_time) {
+    sleep_until(start_time + connection->connect_time);
+  }
+  if (connection->status != status_t::SUCCESS) {
+    return make_result<net::socket_t>(NULL, connection->status);
+  }
+
+  socket_t* socket = new socket_t;
+  socket->connection = connection;
+  socket->real_time = replay->m_real_time;
+  socket->start_time = start_time;
+  socket->event_index = 0;
+  socket->data_pos = 0;
+  std::memset(&socket->stats, 0, sizeof(socket->stats));
+  socket->stats.resolve_time = get_monotonic_time_us();
+  socket->stats.connect_time = socket->stats.resolve_time;
+  return make_result(reinterpret_cast<net::socket_t>(socket), status_t::SUCCESS);
+}
+
+status_t replay_t::replay_disconnect(net::socket_t socket) {
+  delete to_replay_socket(socket);
+  return make_result(status_t::SUCCESS);
+}
+
+result_t<size_t> replay_t::replay_send(net::socket_t socket, const void*, const size_t count) {
+  socket_t* replay = to_replay_socket(socket);
+  replay->stats.bytes_sent += count;
+  ++replay->stats.send_calls;
+  return make_result(count, status_t::SUCCESS);
+}
+
+result_t<size_t> replay_t::replay_recv(net::socket_t socket, void* buf, const size_t count) {
+  socket_t* replay = to_replay_socket(socket);
+  const std::vector<event_t>& events = replay->connection->events;
+  ++replay->stats.recv_calls;
+
+  // Sent data is discarded, so skip to the next receive event.
+  while (replay->event_index < events.size() &&
+         events[replay->event_index].type == event_t::SEND) {
+    ++replay->event_index;
+  }
+  if (replay->event_index >= events.size()) {
+    return make_result<size_t>(0, status_t::SUCCESS);
+  }
+  const event_t& event = events[replay->event_index];
+  if (replay->real_time) {
+    sleep_until(replay->start_time + event.time);
+  }
+  if (event.type == event_t::ERROR) {
+    ++replay->event_index;
+    return make_result<size_t>(0, event.status);
+  }
+
+  const size_t actual_count = std::min(count, event.data.size() - replay->data_pos);
+  std::memcpy(buf, &event.data[replay->data_pos], actual_count);
+  replay->data_pos += actual_count;
+  if (replay->data_pos == event.data.size()) {
+    ++replay->event_index;
+    replay->data_pos = 0;
+  }
+  replay->stats.bytes_received += actual_count;
+  return make_result(actual_count, status_t::SUCCESS);
+}
+
+socket_stats_t replay_t::replay_get_socket_stats(net::socket_t socket) {
+  return to_replay_socket(socket)->stats;
+}
+
+int64_t replay_t::next_recv_time(const socket_t* socket) {
+  if (!socket->real_time) {
+    return 0;
+  }
+  const std::vector<event_t>& events = socket->connection->events;
+  for (size_t i = socket->event_index; i < events.size(); ++i) {
+    if (events[i].type != event_t::SEND) {
+      return socket->start_time + events[i].time;
+    }
+  }
+
+  // The connection appears to be closed, which can be received immediately.
+  return 0;
+}
+
+result_t<size_t> replay_t::replay_wait_readable(const net::socket_t* sockets,
+                                                const size_t count,
+                                                const timeout_t timeout) {
+  if (count == 0 || count > MAX_SOCKETS) {
+    return make_result<size_t>(0, status_t::INVALID_ARGUMENT);
+  }
+
+  // Find the connection that receives data first.
+  size_t first = 0;
+  int64_t first_time = next_recv_time(to_replay_socket(sockets[0]));
+  for (size_t i = 1; i < count; ++i) {
+    const int64_t time = next_recv_time(to_replay_socket(sockets[i]));
+    if (time < first_time) {
+      first = i;
+      first_time = time;
+    }
+  }
+
+  if (timeout > 0) {
+    const int64_t deadline = get_monotonic_time_us() + timeout;
+    if (first_time > deadline) {
+      sleep_until(deadline);
+      return make_result<size_t>(0, status_t::TIMEOUT);
+    }
+  }
+  sleep_until(first_time);
+  return make_result(first, status_t::SUCCESS);
+}
+
+}  // namespace net
+}  // namespace us3
@@ -0,0 +1,172 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_RECORDING_HPP_
+#define US3_RECORDING_HPP_
+
+#include "network_socket.hpp"
+#include "platform.hpp"
+#include "return_value.hpp"
+#include "transport.hpp"
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace us3 {
+namespace net {
+
+/// @brief Configuration of the recording transport.
+struct recording_config_t {
+  recording_config_t() : path(NULL), transport(NULL), transport_data(NULL) {
+  }
+
+  const char* path;              ///< The recording file (new connections are appended).
+  const transport_t* transport;  ///< The recorded transport, or NULL for TCP.
+  const void* transport_data;    ///< The data of the recorded transport.
+};
+
+/// @brief The recording transport.
+///
+/// The transport data is a recording_config_t. All traffic is passed on to the recorded transport,
+/// and the exact byte streams that are sent and received by each connection (including the
+/// boundaries and timing of each send and receive call, and receive errors) are appended to the
+/// recording file when the connection is closed. The values of the Authorization and
+/// x-amz-security-token headers are redacted in the recorded data (keeping their sizes). Connections of different threads may share the
+/// same file. The recording can be replayed with replay_t.
+///
+/// The file starts with the line "us3-recording 1", followed by one block per connection:
+///
+/// @code
+///   connection HOST PORT CONNECT_TIME STATUS
+///   send TIME SIZE
+///   <SIZE bytes of data>
+///   recv TIME SIZE
+///   <SIZE bytes of data>
+///   error TIME STATUS
+///   end
+/// @endcode
+///
+/// Each data block is followed by a newline. Times are in μs, relative to when the connection was
+/// requested, and the status values are status_t::status_enum_t values (a failed connection has no
+/// events).
+const transport_t& recording_transport();
+
+/// @brief A recording that can be replayed (see recording_transport()).
+///
+/// Use transport() as the connection transport, and the replay object as the transport data. Each
+/// new connection replays the next recorded connection (starting over after the last one): the
+/// data that is sent is discarded, and each receive call returns the next recorded segment (or
+/// the remainder of it, if the caller asks for fewer bytes) or receive error. After the last
+/// event, the peer appears to have closed the connection. Failed connections are replayed as
+/// failures.
+///
+/// In real time mode, connections and received segments are delayed according to the recorded
+/// timing. Otherwise, the recording is replayed as fast as possible, which is useful for
+/// benchmarking the protocol handling deterministically.
+class replay_t {
+public:
+  /// @brief A recorded send, receive or receive error.
+  struct event_t {
+    enum type_t {
+      SEND,  ///< Data was sent.
+      RECV,  ///< Data was received.
+      ERROR  ///< A receive call failed.
+    };
+
+    type_t type;                     ///< The event type.
+    int64_t time;                    ///< When the event happened (μs).
+    std::string data;                ///< The sent or received data.
+    status_t::status_enum_t status;  ///< The status of a failed receive call.
+  };
+
+  /// @brief A recorded connection.
+  struct connection_t {
+    connection_t() : port(0), connect_time(0), status(status_t::SUCCESS) {
+    }
+
+    /// @brief Get all the data that was sent on the connection.
+    std::string sent_data() const;
+
+    std::string host;                ///< The host name.
+    int port;                        ///< The port.
+    int64_t connect_time;            ///< When the connection was established (μs).
+    status_t::status_enum_t status;  ///< The result of the connection attempt.
+    std::vector<event_t> events;     ///< The events, in order.
+  };
+
+  /// @brief Create an empty replay.
+  /// @param real_time Replay with the recorded timing.
+  explicit replay_t(bool real_time = false);
+
+  /// @brief Load a recording.
+  /// @param path The recording file.
+  /// @returns status_t::SUCCESS for success, status_t::NOT_FOUND if the file does not exist, or
+  /// status_t::ERROR if the file is not a valid recording.
+  status_t load(const char* path);
+
+  /// @brief The recorded connections.
+  const std::vector<connection_t>& connections() const {
+    return m_connections;
+  }
+
+  /// @brief Get the index of the recorded connection that the next connection replays.
+  size_t next_connection();
+
+  /// @brief Set the index of the recorded connection that the next connection replays.
+  void seek(size_t index);
+
+  /// @brief The replay transport (the transport data is a replay_t).
+  static const transport_t& transport();
+
+private:
+  struct socket_t;
+
+  // Not copyable.
+  replay_t(const replay_t&);
+  replay_t& operator=(const replay_t&);
+
+  static result_t<net::socket_t> replay_connect(const void* data,
+                                                const char* host,
+                                                int port,
+                                                timeout_t connect_timeout,
+                                                timeout_t socket_timeout,
+                                                const socket_options_t& options);
+  static status_t replay_disconnect(net::socket_t socket);
+  static result_t<size_t> replay_send(net::socket_t socket, const void* buf, size_t count);
+  static result_t<size_t> replay_recv(net::socket_t socket, void* buf, size_t count);
+  static socket_stats_t replay_get_socket_stats(net::socket_t socket);
+  static result_t<size_t> replay_wait_readable(const net::socket_t* sockets,
+                                               size_t count,
+                                               timeout_t timeout);
+  static socket_t* to_replay_socket(net::socket_t socket);
+  static int64_t next_recv_time(const socket_t* socket);
+
+  const bool m_real_time;
+  std::vector<connection_t> m_connections;
+
+  // Protects the replay position.
+  mutex_t m_mutex;
+  size_t m_next_connection;
+};
+
+}  // namespace net
+}  // namespace us3
+
+#endif  // US3_RECORDING_HPP_
@@ -0,0 +1,253 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "recording.hpp"
+
+#include "platform.hpp"
+#include <cstdio>
+#include <cstring>
+#include <doctest.h>
+#include <string>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+const char* const RECORDING_PATH = "recording_test.rec";
+
+us3::result_t<us3::net::socket_t> connect_with(const us3::net::transport_t& transport,
+                                                const void* data) {
+  return transport.connect(data, "example.com", 80, 1000000, 1000000, us3::net::socket_options_t());
+}
+
+void write_file(const char* path, const std::string& data) {
+  std::FILE* file = std::fopen(path, "wb");
+  REQUIRE(file != static_cast<std::FILE*>(NULL));
+  REQUIRE_EQ(std::fwrite(data.data(), 1, data.size(), file), data.size());
+  std::fclose(file);
+}
+
+// Receive until the peer closes the connection, in segments of at most max_segment_size bytes.
+std::string receive_all(const us3::net::transport_t& transport,
+                        const us3::net::socket_t socket,
+                        const size_t max_segment_size) {
+  std::string received;
+  char buf[256];
+  while (true) {
+    const us3::result_t<size_t> count = transport.recv(socket, buf, sizeof(buf));
+    REQUIRE(count.is_success());
+    CHECK_LE(*count, max_segment_size);
+    if (*count == 0) {
+      break;
+    }
+    received.append(buf, *count);
+  }
+  return received;
+}
+
+}  // namespace
+
+TEST_CASE("Record and replay") {
+  std::remove(RECORDING_PATH);
+
+  SUBCASE("Recorded segments are replayed") {
+    // GIVEN
+    const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+    us3::net::loopback_config_t loopback;
+    loopback.response = response.data();
+    loopback.response_size = response.size();
+    loopback.segment_size = 7;
+    us3::net::recording_config_t config;
+    config.path = RECORDING_PATH;
+    config.transport = &us3::net::loopback_transport();
+    config.transport_data = &loopback;
+    const us3::net::transport_t& recording = us3::net::recording_transport();
+    for (int i = 0; i < 2; ++i) {
+      us3::result_t<us3::net::socket_t> socket = connect_with(recording, &config);
+      REQUIRE(socket.is_success());
+      REQUIRE(recording.send(*socket, "GET / HTTP/1.1\r\n\r\n", 18).is_success());
+      CHECK_EQ(receive_all(recording, *socket, loopback.segment_size), response);
+      recording.disconnect(*socket);
+    }
+
+    // WHEN
+    us3::net::replay_t replay;
+    REQUIRE(replay.load(RECORDING_PATH).is_success());
+
+    // THEN
+    REQUIRE_EQ(replay.connections().size(), 2);
+    const us3::net::replay_t::connection_t& connection = replay.connections()[0];
+    CHECK_EQ(connection.host, "example.com");
+    CHECK_EQ(connection.port, 80);
+    CHECK_EQ(connection.status, us3::status_t::SUCCESS);
+    CHECK_EQ(connection.sent_data(), "GET / HTTP/1.1\r\n\r\n");
+
+    const us3::net::transport_t& transport = us3::net::replay_t::transport();
+    for (int i = 0; i < 3; ++i) {
+      us3::result_t<us3::net::socket_t> socket = connect_with(transport, &replay);
+      REQUIRE(socket.is_success());
+      CHECK(transport.send(*socket, "ignored", 7).is_success());
+      CHECK_EQ(receive_all(transport, *socket, loopback.segment_size), response);
+      transport.disconnect(*socket);
+    }
+    CHECK_EQ(replay.next_connection(), 3);
+  }
+
+  SUBCASE("Credentials are redacted") {
+    // GIVEN
+    const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    us3::net::loopback_config_t loopback;
+    loopback.response = response.data();
+    loopback.response_size = response.size();
+    us3::net::recording_config_t config;
+    config.path = RECORDING_PATH;
+    config.transport = &us3::net::loopback_transport();
+    config.transport_data = &loopback;
+    const us3::net::transport_t& recording = us3::net::recording_transport();
+    us3::result_t<us3::net::socket_t> socket = connect_with(recording, &config);
+    REQUIRE(socket.is_success());
+
+    // WHEN (the headers are split over several send calls)
+    const char* const segments[] = {"GET / HTTP/1.1\r\nAuthor",
+                                    "ization: AWS AK:sig=\r\nX-Amz-Security-Token: tok",
+                                    "en\r\nHost: example.com\r\n\r\n"};
+    for (size_t i = 0; i < sizeof(segments) / sizeof(segments[0]); ++i) {
+      REQUIRE(recording.send(*socket, segments[i], std::strlen(segments[i])).is_success());
+    }
+    recording.disconnect(*socket);
+    us3::net::replay_t replay;
+    REQUIRE(replay.load(RECORDING_PATH).is_success());
+
+    // THEN
+    REQUIRE_EQ(replay.connections().size(), 1);
+    const us3::net::replay_t::connection_t& connection = replay.connections()[0];
+    CHECK_EQ(connection.events.size(), 3);
+    CHECK_EQ(connection.sent_data(),
+             "GET / HTTP/1.1\r\nAuthorization: *** *******\r\n"
+             "X-Amz-Security-Token: *****\r\nHost: example.com\r\n\r\n");
+  }
+
+  SUBCASE("Segments can be received in smaller parts") {
+    // GIVEN
+    write_file(RECORDING_PATH,
+               "us3-recording 1\n"
+               "connection example.com 80 0 0\n"
+               "recv 0 10\n0123456789\n"
+               "end\n");
+    us3::net::replay_t replay;
+    REQUIRE(replay.load(RECORDING_PATH).is_success());
+    const us3::net::transport_t& transport = us3::net::replay_t::transport();
+    us3::result_t<us3::net::socket_t> socket = connect_with(transport, &replay);
+    REQUIRE(socket.is_success());
+
+    // WHEN
+    char buf[16];
+    const us3::result_t<size_t> first = transport.recv(*socket, buf, 4);
+    const us3::result_t<size_t> second = transport.recv(*socket, &buf[4], sizeof(buf) - 4);
+
+    // THEN
+    REQUIRE(first.is_success());
+    REQUIRE(second.is_success());
+    CHECK_EQ(*first, 4);
+    CHECK_EQ(*second, 6);
+    CHECK_EQ(std::string(buf, 10), "0123456789");
+    transport.disconnect(*socket);
+  }
+
+  SUBCASE("Errors and failed connections are replayed") {
+    // GIVEN
+    write_file(RECORDING_PATH,
+               "us3-recording 1\n"
+               "connection example.com 80 0 7\n"
+               "end\n"
+               "connection example.com 80 0 0\n"
+               "recv 0 3\nabc\n"
+               "error 0 9\n"
+               "end\n");
+    us3::net::replay_t replay;
+    REQUIRE(replay.load(RECORDING_PATH).is_success());
+    const us3::net::transport_t& transport = us3::net::replay_t::transport();
+
+    // WHEN
+    const us3::result_t<us3::net::socket_t> refused = connect_with(transport, &replay);
+    us3::result_t<us3::net::socket_t> socket = connect_with(transport, &replay);
+    REQUIRE(socket.is_success());
+    char buf[16];
+    const us3::result_t<size_t> data = transport.recv(*socket, buf, sizeof(buf));
+    const us3::result_t<size_t> reset = transport.recv(*socket, buf, sizeof(buf));
+
+    // THEN
+    CHECK_EQ(refused.status(), us3::status_t::REFUSED);
+    REQUIRE(data.is_success());
+    CHECK_EQ(*data, 3);
+    CHECK_EQ(reset.status(), us3::status_t::CONNECTION_RESET);
+    transport.disconnect(*socket);
+  }
+
+  SUBCASE("Real time replay follows the recorded timing") {
+    // GIVEN
+    write_file(RECORDING_PATH,
+               "us3-recording 1\n"
+               "connection example.com 80 10000 0\n"
+               "send 10000 3\nGET\n"
+               "recv 50000 2\nOK\n"
+               "end\n");
+    us3::net::replay_t replay(true);
+    REQUIRE(replay.load(RECORDING_PATH).is_success());
+    const us3::net::transport_t& transport = us3::net::replay_t::transport();
+    const int64_t start_time = us3::get_monotonic_time_us();
+
+    // WHEN
+    us3::result_t<us3::net::socket_t> socket = connect_with(transport, &replay);
+    REQUIRE(socket.is_success());
+    const int64_t connect_time = us3::get_monotonic_time_us();
+    const us3::result_t<size_t> timeout = transport.wait_readable(&*socket, 1, 5000);
+    const us3::result_t<size_t> ready = transport.wait_readable(&*socket, 1, 0);
+    const int64_t ready_time = us3::get_monotonic_time_us();
+
+    // THEN
+    CHECK_GE(connect_time - start_time, 10000);
+    CHECK_EQ(timeout.status(), us3::status_t::TIMEOUT);
+    CHECK(ready.is_success());
+    CHECK_GE(ready_time - start_time, 50000);
+    transport.disconnect(*socket);
+  }
+
+  SUBCASE("Invalid recordings are rejected") {
+    us3::net::replay_t replay;
+    CHECK_EQ(replay.load(RECORDING_PATH).status(), us3::status_t::NOT_FOUND);
+
+    write_file(RECORDING_PATH, "us3-recording 2\n");
+    CHECK_EQ(replay.load(RECORDING_PATH).status(), us3::status_t::ERROR);
+
+    write_file(RECORDING_PATH,
+               "us3-recording 1\n"
+               "connection example.com 80 0 0\n"
+               "recv 0 10\n0123\n");
+    CHECK_EQ(replay.load(RECORDING_PATH).status(), us3::status_t::ERROR);
+
+    write_file(RECORDING_PATH, "us3-recording 1\nrecv 0 1\nx\n");
+    CHECK_EQ(replay.load(RECORDING_PATH).status(), us3::status_t::ERROR);
+    CHECK(replay.connections().empty());
+  }
+
+  std::remove(RECORDING_PATH);
+}
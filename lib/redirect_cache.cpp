@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "redirect_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace us3 {
+
+namespace {
+
+// The maximum number of cached buckets.
+const size_t MAX_ENTRIES = 256;
+
+string_t make_key(const char* host, const int port, const char* path) {
+  // The bucket is the first path segment (excluding any query string).
+  const size_t bucket_size = (path[0] != 0) ? 1 + std::strcspn(&path[1], "/?") : 0;
+
+  char port_str[30];
+  std::snprintf(&port_str[0], sizeof(port_str), ":%d", port);
+  string_t key(host);
+  key += &port_str[0];
+  key.append(path, bucket_size);
+  return key;
+}
+
+}  // namespace
+
+redirect_cache_t::redirect_cache_t() {
+}
+
+bool redirect_cache_t::lookup(const char* host,
+                              const int port,
+                              const char* path,
+                              endpoint_t& endpoint) {
+  const string_t key = make_key(host, port, path);
+  lock_guard_t lock(m_mutex);
+  const entry_map_t::const_iterator it = m_entries.find(key);
+  if (it == m_entries.end()) {
+    return false;
+  }
+  endpoint = it->second;
+  return true;
+}
+
+void redirect_cache_t::store(const char* host,
+                             const int port,
+                             const char* path,
+                             const endpoint_t& endpoint) {
+  const string_t key = make_key(host, port, path);
+  lock_guard_t lock(m_mutex);
+  if (m_entries.find(key) == m_entries.end() && m_entries.size() >= MAX_ENTRIES) {
+    m_entries.erase(m_entries.begin());
+  }
+  m_entries[key] = endpoint;
+}
+
+void redirect_cache_t::flush() {
+  lock_guard_t lock(m_mutex);
+  m_entries.clear();
+}
+
+redirect_cache_t& global_redirect_cache() {
+  static redirect_cache_t* s_cache = new redirect_cache_t();
+  return *s_cache;
+}
+
+namespace {
+
+// Create the global cache during static initialization (before any threads are started).
+const redirect_cache_t& s_global_redirect_cache = global_redirect_cache();
+
+}  // namespace
+
+}  // namespace us3
@@ -0,0 +1,89 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_REDIRECT_CACHE_HPP_
+#define US3_REDIRECT_CACHE_HPP_
+
+#include "allocator.hpp"
+#include "platform.hpp"
+#include <map>
+
+namespace us3 {
+
+/// @brief The endpoint (and region) that serves a bucket.
+struct endpoint_t {
+  endpoint_t() : port(0) {
+  }
+
+  string_t host;    ///< Host name.
+  int port;         ///< Port number.
+  string_t region;  ///< SIGV4 region, or empty if unknown.
+};
+
+/// @brief A cache of permanent bucket redirects.
+///
+/// When a bucket lives in another region than the endpoint that a request was sent to, S3 responds
+/// with a permanent redirect. The cache remembers the endpoint that serves the bucket, so that
+/// later requests for the same bucket go straight to the right endpoint.
+///
+/// Entries are keyed by the requested host, port and bucket, where the bucket is the first segment
+/// of the path (path-style URLs). The cache is thread safe.
+class redirect_cache_t {
+public:
+  redirect_cache_t();
+
+  /// @brief Look up the endpoint for a request.
+  /// @param host The requested host name.
+  /// @param port The requested port number.
+  /// @param path The requested path.
+  /// @param[out] endpoint The endpoint that serves the bucket.
+  /// @returns true if the bucket has been redirected.
+  bool lookup(const char* host, int port, const char* path, endpoint_t& endpoint);
+
+  /// @brief Remember the endpoint for a bucket.
+  /// @param host The requested host name.
+  /// @param port The requested port number.
+  /// @param path The requested path.
+  /// @param endpoint The endpoint that serves the bucket.
+  void store(const char* host, int port, const char* path, const endpoint_t& endpoint);
+
+  /// @brief Remove all entries from the cache.
+  void flush();
+
+private:
+  typedef std::map<string_t,
+                   endpoint_t,
+                   std::less<string_t>,
+                   std_allocator_t<std::pair<const string_t, endpoint_t> > >
+      entry_map_t;
+
+  // Not copyable.
+  redirect_cache_t(const redirect_cache_t&);
+  redirect_cache_t& operator=(const redirect_cache_t&);
+
+  mutex_t m_mutex;
+  entry_map_t m_entries;
+};
+
+/// @brief Get the process wide redirect cache, which is shared by all connections.
+redirect_cache_t& global_redirect_cache();
+
+}  // namespace us3
+
+#endif  // US3_REDIRECT_CACHE_HPP_
@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "redirect_cache.hpp"
+
+#include <doctest.h>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+TEST_CASE("Redirect cache") {
+  // GIVEN
+  us3::redirect_cache_t cache;
+  us3::endpoint_t endpoint;
+  endpoint.host = "s3.eu-north-1.amazonaws.com";
+  endpoint.port = 80;
+  endpoint.region = "eu-north-1";
+
+  // WHEN
+  cache.store("s3.amazonaws.com", 80, "/mybucket/path/to/object", endpoint);
+
+  // THEN (the entry applies to all objects in the bucket)
+  us3::endpoint_t cached;
+  REQUIRE(cache.lookup("s3.amazonaws.com", 80, "/mybucket/other?versionId=1", cached));
+  CHECK(cached.host == "s3.eu-north-1.amazonaws.com");
+  CHECK(cached.port == 80);
+  CHECK(cached.region == "eu-north-1");
+  CHECK(cache.lookup("s3.amazonaws.com", 80, "/mybucket", cached));
+
+  // ...but not to other buckets, hosts or ports.
+  CHECK_FALSE(cache.lookup("s3.amazonaws.com", 80, "/mybucket2/object", cached));
+  CHECK_FALSE(cache.lookup("s3.amazonaws.com", 8080, "/mybucket/object", cached));
+  CHECK_FALSE(cache.lookup("example.com", 80, "/mybucket/object", cached));
+
+  SUBCASE("Flush") {
+    // WHEN
+    cache.flush();
+
+    // THEN
+    CHECK_FALSE(cache.lookup("s3.amazonaws.com", 80, "/mybucket/object", cached));
+  }
+}
@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "resolver.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace us3 {
+namespace net {
+
+namespace {
+
+// The maximum number of cached host names.
+const size_t MAX_ENTRIES = 256;
+
+string_t make_key(const char* host, const int port) {
+  char port_str[30];
+  std::snprintf(&port_str[0], sizeof(port_str), ":%d", port);
+  string_t key(host);
+  key += &port_str[0];
+  return key;
+}
+
+bool is_same_address(const address_t& a, const address_t& b) {
+  return a.family == b.family && a.size == b.size &&
+         std::memcmp(&a.storage[0], &b.storage[0], a.size) == 0;
+}
+
+// Interleave the address families, starting with the family of the first address, while keeping
+// the relative order within each family (RFC 8305, section 4).
+void interleave_families(address_list_t& addresses) {
+  if (addresses.size() < 3) {
+    return;
+  }
+  address_list_t first_family;
+  address_list_t other_families;
+  for (address_list_t::const_iterator it = addresses.begin(); it != addresses.end(); ++it) {
+    (it->family == addresses.front().family ? first_family : other_families).push_back(*it);
+  }
+  addresses.clear();
+  for (size_t i = 0; i < first_family.size() || i < other_families.size(); ++i) {
+    if (i < first_family.size()) {
+      addresses.push_back(first_family[i]);
+    }
+    if (i < other_families.size()) {
+      addresses.push_back(other_families[i]);
+    }
+  }
+}
+
+}  // namespace
+
+resolver_t::resolver_t(const lookup_fun_t lookup)
+    : m_lookup(lookup), m_ttl(0), m_negative_ttl(0) {
+}
+
+void resolver_t::configure(const timeout_t ttl, const timeout_t negative_ttl) {
+  lock_guard_t lock(m_mutex);
+  m_ttl = (ttl > 0) ? static_cast<int64_t>(ttl) : 0;
+  m_negative_ttl = (negative_ttl > 0) ? static_cast<int64_t>(negative_ttl) : 0;
+  m_entries.clear();
+  m_preferred.clear();
+}
+
+void resolver_t::flush() {
+  lock_guard_t lock(m_mutex);
+  m_entries.clear();
+  m_preferred.clear();
+}
+
+result_t<address_list_t> resolver_t::resolve(const char* host, const int port) {
+  const string_t key = make_key(host, port);
+
+  // Look for a cached entry.
+  {
+    lock_guard_t lock(m_mutex);
+    entry_map_t::iterator it = m_entries.find(key);
+    const int64_t now = get_monotonic_time_us();
+    if (it != m_entries.end() && now < it->second.expire_time) {
+      entry_t& entry = it->second;
+      if (!entry.is_valid) {
+        return make_result(address_list_t(), status_t::NO_HOST);
+      }
+
+      // Refresh the entry in the background if it is about to expire.
+      if (now >= entry.refresh_time && !entry.is_refreshing) {
+        refresh_request_t* request = heap_new<refresh_request_t>();
+        if (request != NULL) {
+          request->resolver = this;
+          request->key = key;
+          request->host = host;
+          request->port = port;
+          entry.is_refreshing = start_detached_thread(refresh_thread, request);
+          if (!entry.is_refreshing) {
+            heap_delete(request);
+          }
+        }
+      }
+
+      address_list_t addresses = entry.addresses;
+      order_addresses(key, addresses);
+      return make_result(addresses, status_t::SUCCESS);
+    }
+  }
+
+  // Cache miss: Look up the host name in the calling thread.
+  address_list_t addresses;
+  const lookup_status_t status = m_lookup(host, port, addresses);
+  store(key, status, addresses);
+  if (status != LOOKUP_SUCCESS) {
+    return make_result(address_list_t(), status_t::NO_HOST);
+  }
+  {
+    lock_guard_t lock(m_mutex);
+    order_addresses(key, addresses);
+  }
+  return make_result(addresses, status_t::SUCCESS);
+}
+
+void resolver_t::set_preferred_address(const char* host,
+                                       const int port,
+                                       const address_t& address) {
+  const string_t key = make_key(host, port);
+  lock_guard_t lock(m_mutex);
+  if (m_preferred.find(key) == m_preferred.end() && m_preferred.size() >= MAX_ENTRIES) {
+    m_preferred.erase(m_preferred.begin());
+  }
+  m_preferred[key] = address;
+}
+
+void resolver_t::order_addresses(const string_t& key, address_list_t& addresses) const {
+  // Move the preferred address (if any) to the front.
+  const preferred_map_t::const_iterator preferred = m_preferred.find(key);
+  if (preferred != m_preferred.end()) {
+    for (size_t i = 1; i < addresses.size(); ++i) {
+      if (is_same_address(addresses[i], preferred->second)) {
+        const address_t address = addresses[i];
+        addresses.erase(addresses.begin() + static_cast<std::ptrdiff_t>(i));
+        addresses.insert(addresses.begin(), address);
+        break;
+      }
+    }
+  }
+
+  interleave_families(addresses);
+}
+
+void resolver_t::store(const string_t& key,
+                       const lookup_status_t status,
+                       const address_list_t& addresses) {
+  lock_guard_t lock(m_mutex);
+  const int64_t now = get_monotonic_time_us();
+  entry_map_t::iterator it = m_entries.find(key);
+
+  // Temporary failures are not cached (nor is anything when the cache is disabled). A pending
+  // refresh is cancelled, and the old addresses (if any) are kept until they expire.
+  const int64_t ttl = (status == LOOKUP_SUCCESS) ? m_ttl : m_negative_ttl;
+  if (status == LOOKUP_TEMPORARY_FAILURE || m_ttl == 0 || ttl == 0) {
+    if (it != m_entries.end()) {
+      it->second.is_refreshing = false;
+    }
+    return;
+  }
+
+  // Make room for a new entry.
+  if (it == m_entries.end() && m_entries.size() >= MAX_ENTRIES) {
+    for (entry_map_t::iterator i = m_entries.begin(); i != m_entries.end();) {
+      if (now >= i->second.expire_time) {
+        m_entries.erase(i++);
+      } else {
+        ++i;
+      }
+    }
+    if (m_entries.size() >= MAX_ENTRIES) {
+      m_entries.erase(m_entries.begin());
+    }
+  }
+
+  entry_t& entry = m_entries[key];
+  entry.addresses = addresses;
+  entry.is_valid = (status == LOOKUP_SUCCESS);
+  entry.refresh_time = now + (ttl / 4) * 3;
+  entry.expire_time = now + ttl;
+  entry.is_refreshing = false;
+}
+
+void resolver_t::refresh_thread(void* arg) {
+  refresh_request_t* request = reinterpret_cast<refresh_request_t*>(arg);
+  address_list_t addresses;
+  lookup_status_t status =
+      request->resolver->m_lookup(request->host.c_str(), request->port, addresses);
+
+  // A refresh that finds no host is treated as a temporary failure (keep the old addresses).
+  if (status == LOOKUP_NO_HOST) {
+    status = LOOKUP_TEMPORARY_FAILURE;
+  }
+  request->resolver->store(request->key, status, addresses);
+  heap_delete(request);
+}
+
+resolver_t& global_resolver() {
+  // The global resolver is never destroyed, since refresh threads may still be running when the
+  // process exits.
+  static resolver_t* s_resolver = new resolver_t();
+  return *s_resolver;
+}
+
+namespace {
+
+// Create the global resolver during static initialization (before any threads are started).
+const resolver_t& s_global_resolver = global_resolver();
+
+}  // namespace
+
+}  // namespace net
+}  // namespace us3
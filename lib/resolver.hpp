@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_RESOLVER_HPP_
+#define US3_RESOLVER_HPP_
+
+#include "allocator.hpp"
+#include "network_socket.hpp"
+#include "platform.hpp"
+#include "return_value.hpp"
+#include <map>
+
+namespace us3 {
+namespace net {
+
+/// @brief A caching host name resolver.
+///
+/// Successful lookups are cached for a configurable time (TTL), and failed lookups (no such host)
+/// are cached for a separate, usually shorter, time. When a cached entry is used after 75% of its
+/// TTL has passed, a background thread refreshes the entry, so that frequently used host names
+/// never expire in the request path. Temporary lookup failures are never cached, and a failed
+/// refresh keeps the old addresses until they expire.
+///
+/// The returned addresses are ordered for connection racing (RFC 8305): address families are
+/// interleaved (starting with the family of the first address), and the address that most
+/// recently won a connection race for the host (see set_preferred_address()) is put first.
+///
+/// The resolver is thread safe.
+class resolver_t {
+public:
+  /// @brief Uncached lookup function (see lookup_host()).
+  typedef lookup_status_t (*lookup_fun_t)(const char* host, int port, address_list_t& addresses);
+
+  /// @brief Construct a resolver.
+  /// @param lookup The function for looking up host names.
+  explicit resolver_t(lookup_fun_t lookup = lookup_host);
+
+  /// @brief Configure the cache.
+  /// @param ttl The time that successful lookups are cached (μs), or 0 to disable the cache.
+  /// @param negative_ttl The time that failed lookups are cached (μs), or 0 to not cache them.
+  /// @note Changing the configuration flushes the cache.
+  void configure(timeout_t ttl, timeout_t negative_ttl);
+
+  /// @brief Remove all entries from the cache (including the preferred addresses).
+  void flush();
+
+  /// @brief Resolve a host name.
+  /// @param host The host name (or numeric address).
+  /// @param port The port number.
+  /// @returns a non-empty list of addresses, or NO_HOST.
+  result_t<address_list_t> resolve(const char* host, int port);
+
+  /// @brief Remember the fastest address for a host.
+  ///
+  /// The address will be put first in the lists that are returned by resolve() for the same host
+  /// and port (as long as it is still part of the list).
+  /// @param host The host name (or numeric address).
+  /// @param port The port number.
+  /// @param address The address that was connected to.
+  void set_preferred_address(const char* host, int port, const address_t& address);
+
+private:
+  struct entry_t {
+    address_list_t addresses;
+    bool is_valid;         // False for a cached failure.
+    int64_t refresh_time;  // When to start a background refresh.
+    int64_t expire_time;   // When the entry is no longer valid.
+    bool is_refreshing;
+  };
+  typedef std::map<string_t,
+                   entry_t,
+                   std::less<string_t>,
+                   std_allocator_t<std::pair<const string_t, entry_t> > >
+      entry_map_t;
+  typedef std::map<string_t,
+                   address_t,
+                   std::less<string_t>,
+                   std_allocator_t<std::pair<const string_t, address_t> > >
+      preferred_map_t;
+
+  struct refresh_request_t {
+    resolver_t* resolver;
+    string_t key;
+    string_t host;
+    int port;
+  };
+
+  // Not copyable.
+  resolver_t(const resolver_t&);
+  resolver_t& operator=(const resolver_t&);
+
+  void store(const string_t& key, lookup_status_t status, const address_list_t& addresses);
+  // Note: m_mutex must be held when calling order_addresses().
+  void order_addresses(const string_t& key, address_list_t& addresses) const;
+  static void refresh_thread(void* arg);
+
+  const lookup_fun_t m_lookup;
+  mutex_t m_mutex;
+  int64_t m_ttl;
+  int64_t m_negative_ttl;
+  entry_map_t m_entries;
+  preferred_map_t m_preferred;
+};
+
+/// @brief Get the process wide resolver, which is shared by all connections.
+resolver_t& global_resolver();
+
+/// @brief Resolve a host name using the process wide resolver.
+inline result_t<address_list_t> resolve(const char* host, const int port) {
+  return global_resolver().resolve(host, port);
+}
+
+}  // namespace net
+}  // namespace us3
+
+#endif  // US3_RESOLVER_HPP_
@@ -0,0 +1,230 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "resolver.hpp"
+
+#include <cstring>
+#include <doctest.h>
+#include <string>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+// A fake lookup function that counts the lookups (must be thread safe, since it is also called
+// from refresh threads).
+us3::mutex_t s_mutex;
+int s_lookup_count = 0;
+us3::net::lookup_status_t s_lookup_status = us3::net::LOOKUP_SUCCESS;
+
+us3::net::lookup_status_t fake_lookup(const char* host,
+                                      const int port,
+                                      us3::net::address_list_t& addresses) {
+  us3::lock_guard_t lock(s_mutex);
+  ++s_lookup_count;
+  addresses.clear();
+  if (s_lookup_status == us3::net::LOOKUP_SUCCESS) {
+    us3::net::address_t address;
+    std::memset(&address, 0, sizeof(address));
+    address.family = port;
+    address.size = std::strlen(host);
+    addresses.push_back(address);
+  }
+  return s_lookup_status;
+}
+
+void reset_fake_lookup(const us3::net::lookup_status_t status) {
+  us3::lock_guard_t lock(s_mutex);
+  s_lookup_count = 0;
+  s_lookup_status = status;
+}
+
+int lookup_count() {
+  us3::lock_guard_t lock(s_mutex);
+  return s_lookup_count;
+}
+
+}  // namespace
+
+TEST_CASE("Resolver without a cache") {
+  // GIVEN
+  reset_fake_lookup(us3::net::LOOKUP_SUCCESS);
+  us3::net::resolver_t resolver(fake_lookup);
+
+  // WHEN
+  const us3::result_t<us3::net::address_list_t> result1 = resolver.resolve("host", 80);
+  const us3::result_t<us3::net::address_list_t> result2 = resolver.resolve("host", 80);
+
+  // THEN
+  REQUIRE(result1.is_success());
+  REQUIRE(result2.is_success());
+  CHECK_EQ(result1->size(), 1U);
+  CHECK_EQ(lookup_count(), 2);
+}
+
+TEST_CASE("Resolver with a cache") {
+  // GIVEN
+  reset_fake_lookup(us3::net::LOOKUP_SUCCESS);
+  us3::net::resolver_t resolver(fake_lookup);
+  resolver.configure(10000000, 1000000);
+
+  SUBCASE("Entries are keyed by host and port") {
+    // WHEN
+    const us3::result_t<us3::net::address_list_t> result1 = resolver.resolve("host", 80);
+    const us3::result_t<us3::net::address_list_t> result2 = resolver.resolve("host", 80);
+    const us3::result_t<us3::net::address_list_t> result3 = resolver.resolve("host", 81);
+    const us3::result_t<us3::net::address_list_t> result4 = resolver.resolve("host2", 80);
+
+    // THEN
+    REQUIRE(result1.is_success());
+    REQUIRE(result2.is_success());
+    CHECK_EQ((*result2)[0].family, 80);
+    CHECK_EQ((*result3)[0].family, 81);
+    CHECK_EQ((*result4)[0].size, 5U);
+    CHECK_EQ(lookup_count(), 3);
+  }
+
+  SUBCASE("Flush") {
+    // WHEN
+    resolver.resolve("host", 80);
+    resolver.flush();
+    resolver.resolve("host", 80);
+
+    // THEN
+    CHECK_EQ(lookup_count(), 2);
+  }
+
+  SUBCASE("Negative caching") {
+    // GIVEN
+    reset_fake_lookup(us3::net::LOOKUP_NO_HOST);
+
+    // WHEN
+    const us3::result_t<us3::net::address_list_t> result1 = resolver.resolve("nohost", 80);
+    const us3::result_t<us3::net::address_list_t> result2 = resolver.resolve("nohost", 80);
+
+    // THEN
+    CHECK_EQ(result1.status(), us3::status_t::NO_HOST);
+    CHECK_EQ(result2.status(), us3::status_t::NO_HOST);
+    CHECK_EQ(lookup_count(), 1);
+  }
+
+  SUBCASE("Temporary failures are not cached") {
+    // GIVEN
+    reset_fake_lookup(us3::net::LOOKUP_TEMPORARY_FAILURE);
+
+    // WHEN
+    const us3::result_t<us3::net::address_list_t> result1 = resolver.resolve("flaky", 80);
+    const us3::result_t<us3::net::address_list_t> result2 = resolver.resolve("flaky", 80);
+
+    // THEN
+    CHECK_EQ(result1.status(), us3::status_t::NO_HOST);
+    CHECK_EQ(result2.status(), us3::status_t::NO_HOST);
+    CHECK_EQ(lookup_count(), 2);
+  }
+}
+
+TEST_CASE("Resolver entries expire and are refreshed ahead of expiry") {
+  // GIVEN
+  reset_fake_lookup(us3::net::LOOKUP_SUCCESS);
+  us3::net::resolver_t resolver(fake_lookup);
+  resolver.configure(400000, 0);
+  resolver.resolve("host", 80);
+
+  SUBCASE("Refresh ahead") {
+    // WHEN: The entry is used after 75% of its TTL.
+    us3::sleep_us(320000);
+    const us3::result_t<us3::net::address_list_t> result = resolver.resolve("host", 80);
+
+    // THEN: The cached entry is returned, and a background refresh is started.
+    CHECK(result.is_success());
+    for (int i = 0; i < 100 && lookup_count() < 2; ++i) {
+      us3::sleep_us(10000);
+    }
+    CHECK_EQ(lookup_count(), 2);
+  }
+
+  SUBCASE("Expiry") {
+    // WHEN: The entry is used after it has expired.
+    us3::sleep_us(420000);
+    const us3::result_t<us3::net::address_list_t> result = resolver.resolve("host", 80);
+
+    // THEN: The host is looked up in the calling thread.
+    CHECK(result.is_success());
+    CHECK_EQ(lookup_count(), 2);
+  }
+}
+
+namespace {
+
+// A lookup function that returns three addresses of family 6 followed by two of family 4 (numbered
+// 0-4 in the first storage word).
+us3::net::lookup_status_t mixed_lookup(const char*,
+                                       const int,
+                                       us3::net::address_list_t& addresses) {
+  addresses.clear();
+  for (int i = 0; i < 5; ++i) {
+    us3::net::address_t address;
+    std::memset(&address, 0, sizeof(address));
+    address.family = (i < 3) ? 6 : 4;
+    address.size = sizeof(address.storage);
+    address.storage[0] = static_cast<uint64_t>(i);
+    addresses.push_back(address);
+  }
+  return us3::net::LOOKUP_SUCCESS;
+}
+
+std::string address_order(const us3::net::address_list_t& addresses) {
+  std::string order;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    order += static_cast<char>('0' + addresses[i].storage[0]);
+  }
+  return order;
+}
+
+}  // namespace
+
+TEST_CASE("Resolver orders addresses for connection racing") {
+  // GIVEN
+  us3::net::resolver_t resolver(mixed_lookup);
+  resolver.configure(10000000, 0);
+
+  // WHEN
+  const us3::result_t<us3::net::address_list_t> result = resolver.resolve("host", 80);
+
+  // THEN (the address families are interleaved)
+  REQUIRE(result.is_success());
+  CHECK_EQ(address_order(*result), "03142");
+
+  SUBCASE("The preferred address is put first") {
+    // WHEN
+    resolver.set_preferred_address("host", 80, (*result)[3]);
+
+    // THEN
+    CHECK_EQ(address_order(*resolver.resolve("host", 80)), "40312");
+    CHECK_EQ(address_order(*resolver.resolve("host", 81)), "03142");
+
+    // WHEN
+    resolver.flush();
+
+    // THEN
+    CHECK_EQ(address_order(*resolver.resolve("host", 80)), "03142");
+  }
+}
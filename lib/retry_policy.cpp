@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "retry_policy.hpp"
+
+namespace us3 {
+
+bool retry_policy_t::is_retryable(const status_t::status_enum_t status) const {
+  switch (status) {
+    case status_t::REFUSED:
+    case status_t::UNREACHABLE:
+    case status_t::CONNECTION_RESET:
+      return (retry_on & RETRY_CONNECTION) != 0;
+    case status_t::TIMEOUT:
+      return (retry_on & RETRY_TIMEOUT) != 0;
+    case status_t::SERVER_ERROR:
+      return (retry_on & RETRY_SERVER_ERROR) != 0;
+    default:
+      return false;
+  }
+}
+
+net::timeout_t retry_policy_t::backoff_delay(const int retry, const uint32_t random) const {
+  // Exponential backoff, capped at max_delay (and careful not to overflow).
+  int64_t cap = (base_delay > 0) ? static_cast<int64_t>(base_delay) : 0;
+  const int64_t max = (max_delay > 0) ? static_cast<int64_t>(max_delay) : 0;
+  for (int i = 0; i < retry && cap < max; ++i) {
+    cap *= 2;
+  }
+  if (cap > max) {
+    cap = max;
+  }
+
+  // Full jitter.
+  return static_cast<net::timeout_t>(static_cast<double>(cap) *
+                                     (static_cast<double>(random) / 4294967296.0));
+}
+
+uint32_t next_random(uint64_t& state) {
+  state += (static_cast<uint64_t>(0x9E3779B9U) << 32) | 0x7F4A7C15U;
+  uint64_t z = state;
+  z = (z ^ (z >> 30)) * ((static_cast<uint64_t>(0xBF58476DU) << 32) | 0x1CE4E5B9U);
+  z = (z ^ (z >> 27)) * ((static_cast<uint64_t>(0x94D049BBU) << 32) | 0x133111EBU);
+  return static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+}  // namespace us3
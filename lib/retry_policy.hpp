@@ -0,0 +1,71 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_RETRY_POLICY_HPP_
+#define US3_RETRY_POLICY_HPP_
+
+#include "network_socket.hpp"
+#include "return_value.hpp"
+#include <stdint.h>
+
+namespace us3 {
+
+/// @brief A policy for retrying failed requests.
+///
+/// Retries are delayed with exponential backoff and "full jitter", i.e. the delay before retry n
+/// (counting from zero) is uniformly distributed in [0, min(max_delay, base_delay * 2^n)].
+struct retry_policy_t {
+  /// @brief Classes of failures that can be retried (bit mask).
+  enum retry_class_t {
+    RETRY_CONNECTION = 1,   ///< Refused, unreachable and reset connections.
+    RETRY_TIMEOUT = 2,      ///< Timed out operations.
+    RETRY_SERVER_ERROR = 4  ///< HTTP 500, 502, 503 (e.g. SlowDown) and 504 responses.
+  };
+
+  retry_policy_t()
+      : max_attempts(1),
+        base_delay(100000),
+        max_delay(20000000),
+        retry_on(RETRY_CONNECTION | RETRY_TIMEOUT | RETRY_SERVER_ERROR) {
+  }
+
+  int max_attempts;           ///< The maximum number of attempts (1 means no retries).
+  net::timeout_t base_delay;  ///< The delay before the first retry (before jitter), in μs.
+  net::timeout_t max_delay;   ///< The maximum delay before a retry, in μs.
+  unsigned retry_on;          ///< The classes of failures to retry (see retry_class_t).
+
+  /// @brief Check if a failure can be retried according to this policy.
+  /// @param status The status of the failed operation.
+  bool is_retryable(status_t::status_enum_t status) const;
+
+  /// @brief Calculate the delay before a retry.
+  /// @param retry The retry number (0 for the first retry).
+  /// @param random A uniformly distributed random number.
+  /// @returns the delay in μs.
+  net::timeout_t backoff_delay(int retry, uint32_t random) const;
+};
+
+/// @brief Generate a pseudo random number (SplitMix64).
+/// @param state The generator state, which is updated.
+/// @returns a uniformly distributed random number.
+uint32_t next_random(uint64_t& state);
+
+}  // namespace us3
+
+#endif  // US3_RETRY_POLICY_HPP_
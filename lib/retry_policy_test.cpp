@@ -0,0 +1,85 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "retry_policy.hpp"
+
+#include <doctest.h>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+TEST_CASE("Retryable failures") {
+  // GIVEN
+  us3::retry_policy_t policy;
+
+  // THEN
+  CHECK(policy.is_retryable(us3::status_t::CONNECTION_RESET));
+  CHECK(policy.is_retryable(us3::status_t::REFUSED));
+  CHECK(policy.is_retryable(us3::status_t::TIMEOUT));
+  CHECK(policy.is_retryable(us3::status_t::SERVER_ERROR));
+  CHECK_FALSE(policy.is_retryable(us3::status_t::SUCCESS));
+  CHECK_FALSE(policy.is_retryable(us3::status_t::FORBIDDEN));
+  CHECK_FALSE(policy.is_retryable(us3::status_t::NOT_FOUND));
+  CHECK_FALSE(policy.is_retryable(us3::status_t::CHECKSUM_MISMATCH));
+
+  SUBCASE("Only the selected classes are retried") {
+    // WHEN
+    policy.retry_on = us3::retry_policy_t::RETRY_SERVER_ERROR;
+
+    // THEN
+    CHECK_FALSE(policy.is_retryable(us3::status_t::CONNECTION_RESET));
+    CHECK_FALSE(policy.is_retryable(us3::status_t::TIMEOUT));
+    CHECK(policy.is_retryable(us3::status_t::SERVER_ERROR));
+  }
+}
+
+TEST_CASE("Backoff delay with full jitter") {
+  // GIVEN
+  us3::retry_policy_t policy;
+  policy.base_delay = 1000;
+  policy.max_delay = 50000;
+
+  // THEN (the delay is proportional to the random number)
+  CHECK_EQ(policy.backoff_delay(0, 0), 0);
+  CHECK_EQ(policy.backoff_delay(0, 0x80000000U), 500);
+  CHECK(policy.backoff_delay(0, 0xFFFFFFFFU) < 1000);
+
+  // THEN (exponential growth, capped at max_delay)
+  CHECK_EQ(policy.backoff_delay(3, 0x80000000U), 4000);
+  CHECK_EQ(policy.backoff_delay(10, 0x80000000U), 25000);
+  CHECK_EQ(policy.backoff_delay(1000, 0x80000000U), 25000);
+}
+
+TEST_CASE("Random numbers are well distributed") {
+  // GIVEN
+  uint64_t state = 42;
+  int buckets[4] = {0, 0, 0, 0};
+
+  // WHEN
+  for (int i = 0; i < 4000; ++i) {
+    ++buckets[us3::next_random(state) >> 30];
+  }
+
+  // THEN
+  for (int i = 0; i < 4; ++i) {
+    CHECK(buckets[i] > 800);
+    CHECK(buckets[i] < 1200);
+  }
+}
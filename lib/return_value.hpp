@@ -41,7 +41,9 @@ public:
     UNSUPPORTED,        ///< An unsupported protocol function was encountered.
     NO_SUCH_FIELD,      ///< The requested field was not found.
     FORBIDDEN,          ///< The server refused to authorize the request.
-    NOT_FOUND           ///< The object was not found.
+    NOT_FOUND,          ///< The object was not found.
+    CHECKSUM_MISMATCH,  ///< The checksum of the transferred data did not match.
+    SERVER_ERROR        ///< The server failed or was overloaded (HTTP 500, 502, 503 or 504).
   };
 
   explicit status_t(const status_enum_t s) : m_status(s) {
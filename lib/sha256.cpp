@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "sha256.hpp"
+
+#include <cstring>
+
+namespace us3 {
+
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U,
+    0xab1c5ed5U, 0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU,
+    0x9bdc06a7U, 0xc19bf174U, 0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU,
+    0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU, 0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U,
+    0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U, 0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU,
+    0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U, 0xa2bfe8a1U, 0xa81a664bU,
+    0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U, 0x19a4c116U,
+    0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+    0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U,
+    0xc67178f2U};
+
+// Read a big endian 32-bit word from a byte array.
+uint32_t get_uint32_be(const unsigned char* ptr) {
+  return (static_cast<uint32_t>(ptr[0]) << 24) | (static_cast<uint32_t>(ptr[1]) << 16) |
+         (static_cast<uint32_t>(ptr[2]) << 8) | static_cast<uint32_t>(ptr[3]);
+}
+
+// Write a big endian 32-bit word to a byte array.
+void set_uint32_be(const uint32_t x, unsigned char* ptr) {
+  ptr[0] = static_cast<unsigned char>(x >> 24);
+  ptr[1] = static_cast<unsigned char>(x >> 16);
+  ptr[2] = static_cast<unsigned char>(x >> 8);
+  ptr[3] = static_cast<unsigned char>(x);
+}
+
+uint32_t rotr(const uint32_t x, const int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+}  // namespace
+
+// Based on pseudocode from Wikipedia: https://en.wikipedia.org/wiki/SHA-2#Pseudocode
+sha256_t::sha256_t() : m_total_size(0), m_block_size(0) {
+  m_state[0] = 0x6a09e667U;
+  m_state[1] = 0xbb67ae85U;
+  m_state[2] = 0x3c6ef372U;
+  m_state[3] = 0xa54ff53aU;
+  m_state[4] = 0x510e527fU;
+  m_state[5] = 0x9b05688cU;
+  m_state[6] = 0x1f83d9abU;
+  m_state[7] = 0x5be0cd19U;
+}
+
+void sha256_t::update(const void* data, size_t size) {
+  const unsigned char* src = reinterpret_cast<const unsigned char*>(data);
+  m_total_size += static_cast<uint64_t>(size);
+
+  // Fill up a partial block first.
+  if (m_block_size > 0) {
+    const size_t count = (size < (64U - m_block_size)) ? size : (64U - m_block_size);
+    std::memcpy(&m_block[m_block_size], src, count);
+    m_block_size += count;
+    src += count;
+    size -= count;
+    if (m_block_size < 64U) {
+      return;
+    }
+    process_block(&m_block[0]);
+    m_block_size = 0;
+  }
+
+  // Process whole blocks directly from the source buffer.
+  while (size >= 64U) {
+    process_block(src);
+    src += 64;
+    size -= 64U;
+  }
+
+  // Keep the remainder for later.
+  if (size > 0) {
+    std::memcpy(&m_block[0], src, size);
+    m_block_size = size;
+  }
+}
+
+void sha256_t::finalize(unsigned char (&digest)[SHA256_RAW_SIZE]) {
+  const uint64_t total_size_bits = m_total_size * 8U;
+
+  // Append the 1-bit, pad with zeros and append the message size as a 64-bit big endian number.
+  unsigned char padding[72];
+  size_t padding_size = ((m_block_size < 56U) ? 56U : 120U) - m_block_size;
+  padding[0] = 0x80U;
+  std::memset(&padding[1], 0, padding_size - 1);
+  for (int i = 0; i < 8; ++i) {
+    padding[padding_size++] = static_cast<unsigned char>(total_size_bits >> (56 - 8 * i));
+  }
+  update(&padding[0], padding_size);
+
+  for (int i = 0; i < 8; ++i) {
+    set_uint32_be(m_state[i], &digest[i * 4]);
+  }
+}
+
+void sha256_t::finalize_hex(char (&digest)[SHA256_HEX_SIZE + 1]) {
+  unsigned char raw_digest[SHA256_RAW_SIZE];
+  finalize(raw_digest);
+  to_hex(&raw_digest[0], sizeof(raw_digest), &digest[0]);
+}
+
+void sha256_t::process_block(const unsigned char* block) {
+  // Extend the sixteen 32-bit words into sixty-four 32-bit words.
+  uint32_t w[64];
+  for (int i = 0; i < 16; ++i) {
+    w[i] = get_uint32_be(&block[i * 4]);
+  }
+  for (int i = 16; i < 64; ++i) {
+    const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = m_state[0];
+  uint32_t b = m_state[1];
+  uint32_t c = m_state[2];
+  uint32_t d = m_state[3];
+  uint32_t e = m_state[4];
+  uint32_t f = m_state[5];
+  uint32_t g = m_state[6];
+  uint32_t h = m_state[7];
+
+  // Main loop.
+  for (int i = 0; i < 64; ++i) {
+    const uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+    const uint32_t ch = (e & f) ^ ((~e) & g);
+    const uint32_t temp1 = h + s1 + ch + K[i] + w[i];
+    const uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+    const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+    const uint32_t temp2 = s0 + maj;
+    h = g;
+    g = f;
+    f = e;
+    e = d + temp1;
+    d = c;
+    c = b;
+    b = a;
+    a = temp1 + temp2;
+  }
+
+  // Add this block's hash to the result so far.
+  m_state[0] += a;
+  m_state[1] += b;
+  m_state[2] += c;
+  m_state[3] += d;
+  m_state[4] += e;
+  m_state[5] += f;
+  m_state[6] += g;
+  m_state[7] += h;
+}
+
+// Based on pseudocode from Wikipedia: https://en.wikipedia.org/wiki/HMAC#Implementation
+void hmac_sha256(const void* key,
+                 const size_t key_size,
+                 const void* data,
+                 const size_t data_size,
+                 unsigned char (&digest)[sha256_t::SHA256_RAW_SIZE]) {
+  // Prepare the key (make it exactly 64 bytes long).
+  unsigned char key_pad[64];
+  if (key_size > 64U) {
+    // Keys longer than 64 bytes are shortened by hashing them (it becomes 32 bytes long).
+    unsigned char hash[sha256_t::SHA256_RAW_SIZE];
+    sha256_t key_hash;
+    key_hash.update(key, key_size);
+    key_hash.finalize(hash);
+    std::memcpy(&key_pad[0], &hash[0], sizeof(hash));
+    std::memset(&key_pad[sizeof(hash)], 0, 64U - sizeof(hash));
+  } else {
+    std::memcpy(&key_pad[0], key, key_size);
+    std::memset(&key_pad[key_size], 0, 64U - key_size);
+  }
+
+  // Outer and inner keys, padded.
+  unsigned char outer_key_pad[64];
+  unsigned char inner_key_pad[64];
+  for (int i = 0; i < 64; ++i) {
+    outer_key_pad[i] = key_pad[i] ^ 0x5CU;
+    inner_key_pad[i] = key_pad[i] ^ 0x36U;
+  }
+
+  // Inner hash.
+  unsigned char inner_hash[sha256_t::SHA256_RAW_SIZE];
+  {
+    sha256_t hash;
+    hash.update(&inner_key_pad[0], sizeof(inner_key_pad));
+    hash.update(data, data_size);
+    hash.finalize(inner_hash);
+  }
+
+  // Outer hash (i.e. the result).
+  {
+    sha256_t hash;
+    hash.update(&outer_key_pad[0], sizeof(outer_key_pad));
+    hash.update(&inner_hash[0], sizeof(inner_hash));
+    hash.finalize(digest);
+  }
+}
+
+void to_hex(const unsigned char* data, const size_t size, char* hex) {
+  static const char* const HEX_CHARS = "0123456789abcdef";
+  for (size_t i = 0; i < size; ++i) {
+    hex[i * 2] = HEX_CHARS[data[i] >> 4];
+    hex[i * 2 + 1] = HEX_CHARS[data[i] & 15U];
+  }
+  hex[size * 2] = '\0';
+}
+
+}  // namespace us3
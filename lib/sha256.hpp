@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_SHA256_HPP_
+#define US3_SHA256_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace us3 {
+
+/// @brief An incremental SHA-256 hash calculator.
+class sha256_t {
+public:
+  // The raw SHA-256 digest size is 32 bytes.
+  static const size_t SHA256_RAW_SIZE = 32;
+
+  // The hex encoded SHA-256 digest size is 64 bytes (excluding the zero termination).
+  static const size_t SHA256_HEX_SIZE = 64;
+
+  sha256_t();
+
+  /// @brief Add data to the hash.
+  /// @param data The data to hash.
+  /// @param size The number of bytes to hash.
+  void update(const void* data, size_t size);
+
+  /// @brief Finish the hash calculation and get the raw digest.
+  /// @param digest The resulting digest.
+  /// @note After calling this method, the hash object must not be updated again.
+  void finalize(unsigned char (&digest)[SHA256_RAW_SIZE]);
+
+  /// @brief Finish the hash calculation and get the hex encoded digest.
+  /// @param digest The resulting zero terminated digest (lower case).
+  void finalize_hex(char (&digest)[SHA256_HEX_SIZE + 1]);
+
+private:
+  void process_block(const unsigned char* block);
+
+  uint32_t m_state[8];
+  uint64_t m_total_size;
+  unsigned char m_block[64];
+  size_t m_block_size;
+};
+
+/// @brief Generate the HMAC-SHA256 digest for a message.
+/// @param key The secret key.
+/// @param key_size The size of the secret key, in bytes.
+/// @param data The data to hash.
+/// @param data_size The size of the data, in bytes.
+/// @param digest The resulting raw digest.
+void hmac_sha256(const void* key,
+                 size_t key_size,
+                 const void* data,
+                 size_t data_size,
+                 unsigned char (&digest)[sha256_t::SHA256_RAW_SIZE]);
+
+/// @brief Convert binary data to a lower case hex string.
+/// @param data The data to convert.
+/// @param size The number of bytes to convert.
+/// @param hex The target buffer (must hold at least 2 * size + 1 chars).
+void to_hex(const unsigned char* data, size_t size, char* hex);
+
+}  // namespace us3
+
+#endif  // US3_SHA256_HPP_
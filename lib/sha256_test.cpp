@@ -0,0 +1,120 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "sha256.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <doctest.h>
+#include <string>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+std::string sha256_hex(const char* data, const size_t size) {
+  us3::sha256_t hash;
+  hash.update(data, size);
+  char digest[us3::sha256_t::SHA256_HEX_SIZE + 1];
+  hash.finalize_hex(digest);
+  return std::string(&digest[0]);
+}
+
+std::string hmac_sha256_hex(const char* key, const char* data) {
+  unsigned char digest[us3::sha256_t::SHA256_RAW_SIZE];
+  us3::hmac_sha256(key, std::strlen(key), data, std::strlen(data), digest);
+  char hex[us3::sha256_t::SHA256_HEX_SIZE + 1];
+  us3::to_hex(&digest[0], sizeof(digest), &hex[0]);
+  return std::string(&hex[0]);
+}
+
+}  // namespace
+
+TEST_CASE("SHA-256 of some strings") {
+  SUBCASE("Empty string") {
+    // WHEN
+    const std::string result = sha256_hex("", 0);
+
+    // THEN
+    CHECK_EQ(result, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  }
+
+  SUBCASE("abc") {
+    // WHEN
+    const std::string result = sha256_hex("abc", 3);
+
+    // THEN
+    CHECK_EQ(result, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  }
+
+  SUBCASE("Two blocks") {
+    // GIVEN
+    const char* data = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+    // WHEN
+    const std::string result = sha256_hex(data, std::strlen(data));
+
+    // THEN
+    CHECK_EQ(result, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  }
+
+  SUBCASE("Incremental updates") {
+    // GIVEN
+    const std::string data(1000, 'a');
+
+    // WHEN
+    us3::sha256_t hash;
+    for (size_t i = 0; i < 1000; i += 7) {
+      hash.update(&data[i], std::min<size_t>(7, 1000 - i));
+    }
+    char digest[us3::sha256_t::SHA256_HEX_SIZE + 1];
+    hash.finalize_hex(digest);
+
+    // THEN
+    CHECK_EQ(std::string(&digest[0]), sha256_hex(data.data(), data.size()));
+  }
+}
+
+TEST_CASE("HMAC-SHA256 of some strings") {
+  SUBCASE("RFC 4231 test case 2") {
+    // WHEN
+    const std::string result = hmac_sha256_hex("Jefe", "what do ya want for nothing?");
+
+    // THEN
+    CHECK_EQ(result, "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+  }
+
+  SUBCASE("Long key") {
+    // GIVEN
+    const std::string key(131, '\xaa');
+    const char* data = "Test Using Larger Than Block-Size Key - Hash Key First";
+
+    // WHEN
+    unsigned char digest[us3::sha256_t::SHA256_RAW_SIZE];
+    us3::hmac_sha256(key.data(), key.size(), data, std::strlen(data), digest);
+    char hex[us3::sha256_t::SHA256_HEX_SIZE + 1];
+    us3::to_hex(&digest[0], sizeof(digest), &hex[0]);
+
+    // THEN
+    CHECK_EQ(std::string(&hex[0]),
+             "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+  }
+}
@@ -0,0 +1,305 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "sigv4.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace us3 {
+
+const char* const SIGV4_STREAMING_PAYLOAD = "STREAMING-AWS4-HMAC-SHA256-PAYLOAD";
+const char* const SIGV4_STREAMING_PAYLOAD_TRAILER = "STREAMING-AWS4-HMAC-SHA256-PAYLOAD-TRAILER";
+const char* const SIGV4_EMPTY_PAYLOAD =
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+
+namespace {
+
+// Size of the chunk extension ";chunk-signature=" + signature + two CRLF pairs.
+const size_t CHUNK_OVERHEAD = 17U + sha256_t::SHA256_HEX_SIZE + 4U;
+
+string_t to_lower(const char* str) {
+  string_t result(str);
+  for (string_t::iterator it = result.begin(); it != result.end(); it++) {
+    if (*it >= 'A' && *it <= 'Z') {
+      *it = static_cast<string_t::value_type>(*it + ('a' - 'A'));
+    }
+  }
+  return result;
+}
+
+string_t trim(const char* str) {
+  const char* start = str;
+  while (*start == ' ' || *start == '\t') {
+    ++start;
+  }
+  const char* end = start + std::strlen(start);
+  while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+    --end;
+  }
+  return string_t(start, static_cast<size_t>(end - start));
+}
+
+void hash_string(sha256_t& hash, const char* str) {
+  hash.update(str, std::strlen(str));
+}
+
+void hash_string(sha256_t& hash, const string_t& str) {
+  hash.update(str.data(), str.size());
+}
+
+void hmac(const unsigned char* key,
+          const size_t key_size,
+          const char* data,
+          const size_t data_size,
+          unsigned char (&digest)[sha256_t::SHA256_RAW_SIZE]) {
+  hmac_sha256(key, key_size, data, data_size, digest);
+}
+
+string_t canonical_query_string(const string_t& query) {
+  // Split the query string into parameters.
+  std::vector<string_t, std_allocator_t<string_t> > params;
+  string_t::size_type start_pos = 0;
+  while (start_pos <= query.size()) {
+    string_t::size_type end_pos = query.find('&', start_pos);
+    if (end_pos == string_t::npos) {
+      end_pos = query.size();
+    }
+    if (end_pos > start_pos) {
+      string_t param = query.substr(start_pos, end_pos - start_pos);
+      if (param.find('=') == string_t::npos) {
+        // Parameters without a value are signed with an empty value (e.g. "uploads=").
+        param += '=';
+      }
+      params.push_back(param);
+    }
+    start_pos = end_pos + 1;
+  }
+
+  // Sort the parameters by name and join them.
+  std::sort(params.begin(), params.end());
+  string_t result;
+  for (size_t i = 0; i < params.size(); ++i) {
+    if (i > 0) {
+      result += '&';
+    }
+    result += params[i];
+  }
+  return result;
+}
+
+size_t hex_digits(size_t x) {
+  size_t digits = 1;
+  while (x >= 16U) {
+    x >>= 4;
+    ++digits;
+  }
+  return digits;
+}
+
+}  // namespace
+
+sigv4_signer_t::sigv4_signer_t() : m_signing_key(), m_signature() {
+}
+
+sigv4_signer_t::sigv4_signer_t(const char* access_key,
+                               const char* secret_key,
+                               const char* region,
+                               const char* amz_date)
+    : m_access_key(access_key), m_amz_date(amz_date), m_signature() {
+  // The scope is <date>/<region>/<service>/aws4_request.
+  const size_t date_size = std::min(m_amz_date.size(), static_cast<size_t>(8));
+  m_scope.assign(m_amz_date, 0, date_size).append("/").append(region).append("/s3/aws4_request");
+
+  // Derive the signing key.
+  string_t secret("AWS4");
+  secret.append(secret_key);
+  unsigned char date_key[sha256_t::SHA256_RAW_SIZE];
+  hmac(reinterpret_cast<const unsigned char*>(secret.data()),
+       secret.size(),
+       m_amz_date.data(),
+       date_size,
+       date_key);
+  unsigned char region_key[sha256_t::SHA256_RAW_SIZE];
+  hmac(&date_key[0], sizeof(date_key), region, std::strlen(region), region_key);
+  unsigned char service_key[sha256_t::SHA256_RAW_SIZE];
+  hmac(&region_key[0], sizeof(region_key), "s3", 2, service_key);
+  hmac(&service_key[0], sizeof(service_key), "aws4_request", 12, m_signing_key);
+}
+
+void sigv4_signer_t::add_header(const char* name, const char* value) {
+  m_headers.push_back(header_t(to_lower(name), trim(value)));
+}
+
+string_t sigv4_signer_t::sign_request(const char* method,
+                                      const char* path,
+                                      const char* payload_hash) {
+  // Split the path into the URI and the query string.
+  const char* query_start = std::strchr(path, '?');
+  const size_t uri_size = (query_start != NULL) ? static_cast<size_t>(query_start - path)
+                                                : std::strlen(path);
+  const string_t query = (query_start != NULL) ? string_t(query_start + 1) : string_t();
+
+  // Headers must be sorted by name.
+  std::sort(m_headers.begin(), m_headers.end());
+  string_t signed_headers;
+  for (size_t i = 0; i < m_headers.size(); ++i) {
+    if (i > 0) {
+      signed_headers += ';';
+    }
+    signed_headers += m_headers[i].first;
+  }
+
+  // Hash the canonical request (it is not needed as a string).
+  sha256_t hash;
+  hash_string(hash, method);
+  hash_string(hash, "\n");
+  hash.update(path, uri_size);
+  hash_string(hash, "\n");
+  hash_string(hash, canonical_query_string(query));
+  hash_string(hash, "\n");
+  for (size_t i = 0; i < m_headers.size(); ++i) {
+    hash_string(hash, m_headers[i].first);
+    hash_string(hash, ":");
+    hash_string(hash, m_headers[i].second);
+    hash_string(hash, "\n");
+  }
+  hash_string(hash, "\n");
+  hash_string(hash, signed_headers);
+  hash_string(hash, "\n");
+  hash_string(hash, payload_hash);
+  char canonical_request_hash[sha256_t::SHA256_HEX_SIZE + 1];
+  hash.finalize_hex(canonical_request_hash);
+
+  // Sign the request.
+  m_string_to_sign.assign("AWS4-HMAC-SHA256\n")
+      .append(m_amz_date)
+      .append("\n")
+      .append(m_scope)
+      .append("\n")
+      .append(&canonical_request_hash[0]);
+  sign_string(m_string_to_sign);
+
+  string_t authorization;
+  authorization.assign("AWS4-HMAC-SHA256 Credential=")
+      .append(m_access_key)
+      .append("/")
+      .append(m_scope)
+      .append(",SignedHeaders=")
+      .append(signed_headers)
+      .append(",Signature=")
+      .append(signature());
+  return authorization;
+}
+
+const char* sigv4_signer_t::sign_chunk(const char* chunk_hash) {
+  // The chunk signature is chained with the previous signature.
+  start_string_to_sign("AWS4-HMAC-SHA256-PAYLOAD");
+  m_string_to_sign.append(SIGV4_EMPTY_PAYLOAD).append("\n").append(chunk_hash);
+  sign_string(m_string_to_sign);
+  return signature();
+}
+
+const char* sigv4_signer_t::sign_trailer(const char* trailer) {
+  // The trailer signature is chained with the signature of the final chunk.
+  sha256_t hash;
+  hash.update(trailer, std::strlen(trailer));
+  char trailer_hash[sha256_t::SHA256_HEX_SIZE + 1];
+  hash.finalize_hex(trailer_hash);
+  start_string_to_sign("AWS4-HMAC-SHA256-TRAILER");
+  m_string_to_sign.append(&trailer_hash[0]);
+  sign_string(m_string_to_sign);
+  return signature();
+}
+
+void sigv4_signer_t::start_string_to_sign(const char* algorithm) {
+  // The buffer is reused (and keeps its capacity), so that signing chunks does not allocate memory.
+  m_string_to_sign.assign(algorithm)
+      .append("\n")
+      .append(m_amz_date)
+      .append("\n")
+      .append(m_scope)
+      .append("\n")
+      .append(signature())
+      .append("\n");
+}
+
+void sigv4_signer_t::sign_string(const string_t& string_to_sign) {
+  unsigned char raw_signature[sha256_t::SHA256_RAW_SIZE];
+  hmac(&m_signing_key[0],
+       sizeof(m_signing_key),
+       string_to_sign.data(),
+       string_to_sign.size(),
+       raw_signature);
+  to_hex(&raw_signature[0], sizeof(raw_signature), &m_signature[0]);
+}
+
+string_t sigv4_region_from_host(const char* host) {
+  static const char* const DEFAULT_REGION = "us-east-1";
+  static const char* const AWS_DOMAIN = ".amazonaws.com";
+
+  // Only AWS host names carry a region.
+  const string_t host_str = to_lower(host);
+  const size_t domain_len = std::strlen(AWS_DOMAIN);
+  if (host_str.size() <= domain_len ||
+      host_str.compare(host_str.size() - domain_len, domain_len, AWS_DOMAIN) != 0) {
+    return DEFAULT_REGION;
+  }
+
+  // Scan the labels for "s3" or "s3-<region>". The region follows the "s3" label, possibly after
+  // a "dualstack" label (e.g. "bucket.s3.dualstack.eu-west-1.amazonaws.com").
+  const string_t labels = host_str.substr(0, host_str.size() - domain_len);
+  string_t::size_type start_pos = 0;
+  bool next_is_region = false;
+  while (start_pos < labels.size()) {
+    string_t::size_type end_pos = labels.find('.', start_pos);
+    if (end_pos == string_t::npos) {
+      end_pos = labels.size();
+    }
+    const string_t label = labels.substr(start_pos, end_pos - start_pos);
+    if (next_is_region) {
+      if (label != "dualstack") {
+        return label;
+      }
+    } else if (label == "s3") {
+      next_is_region = true;
+    } else if (label.compare(0, 3, "s3-") == 0 && label != "s3-external-1") {
+      return label.substr(3);
+    }
+    start_pos = end_pos + 1;
+  }
+
+  return DEFAULT_REGION;
+}
+
+size_t sigv4_chunked_size(const size_t size, const size_t chunk_size, const size_t trailer_size) {
+  const size_t num_full_chunks = size / chunk_size;
+  const size_t last_chunk_size = size % chunk_size;
+  size_t result = num_full_chunks * (hex_digits(chunk_size) + CHUNK_OVERHEAD + chunk_size);
+  if (last_chunk_size > 0) {
+    result += hex_digits(last_chunk_size) + CHUNK_OVERHEAD + last_chunk_size;
+  }
+
+  // The terminating zero-sized chunk (any trailer goes between the chunk header and the last CRLF).
+  result += hex_digits(0) + CHUNK_OVERHEAD + trailer_size;
+
+  return result;
+}
+
+}  // namespace us3
@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_SIGV4_HPP_
+#define US3_SIGV4_HPP_
+
+#include "allocator.hpp"
+#include "sha256.hpp"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace us3 {
+
+/// @brief Payload hash value for a streaming (aws-chunked) signed upload.
+extern const char* const SIGV4_STREAMING_PAYLOAD;
+
+/// @brief Payload hash value for a streaming (aws-chunked) signed upload with a signed trailer.
+extern const char* const SIGV4_STREAMING_PAYLOAD_TRAILER;
+
+/// @brief Payload hash value for an empty payload (the SHA-256 of an empty string).
+extern const char* const SIGV4_EMPTY_PAYLOAD;
+
+/// @brief Request signer for AWS signature version 4.
+///
+/// The signer first produces the seed signature for the HTTP request headers (see
+/// sign_request()). For streaming uploads (STREAMING-AWS4-HMAC-SHA256-PAYLOAD), every subsequent
+/// chunk is signed with sign_chunk(), which chains the signature of the previous chunk. All memory
+/// is allocated with the allocation hooks (see allocator.hpp).
+class sigv4_signer_t {
+public:
+  sigv4_signer_t();
+
+  /// @brief Construct a signer.
+  /// @param access_key The S3 access key.
+  /// @param secret_key The S3 secret key.
+  /// @param region The AWS region (e.g. "us-east-1").
+  /// @param amz_date The request date & time in ISO 8601 basic format (e.g. "20130524T000000Z").
+  sigv4_signer_t(const char* access_key,
+                 const char* secret_key,
+                 const char* region,
+                 const char* amz_date);
+
+  /// @brief Add a header that is to be included in the signature.
+  /// @param name The header name (case insensitive).
+  /// @param value The header value.
+  void add_header(const char* name, const char* value);
+
+  /// @brief Sign the HTTP request.
+  /// @param method The HTTP method (e.g. "PUT").
+  /// @param path The request path, including the query string (if any).
+  /// @param payload_hash The hex encoded payload hash, or one of the SIGV4_STREAMING_* values.
+  /// @returns the value of the Authorization header.
+  string_t sign_request(const char* method, const char* path, const char* payload_hash);
+
+  /// @brief Sign a chunk of a streaming upload.
+  /// @param chunk_hash The hex encoded SHA-256 hash of the chunk data.
+  /// @returns the hex encoded chunk signature.
+  const char* sign_chunk(const char* chunk_hash);
+
+  /// @brief Sign the trailer of a streaming upload.
+  /// @param trailer The trailing headers, each terminated by a newline (e.g.
+  /// "x-amz-checksum-crc32c:sOO8/Q==\n").
+  /// @returns the hex encoded trailer signature.
+  const char* sign_trailer(const char* trailer);
+
+  /// @brief Get the most recent signature (hex encoded).
+  const char* signature() const {
+    return &m_signature[0];
+  }
+
+private:
+  typedef std::pair<string_t, string_t> header_t;
+
+  void start_string_to_sign(const char* algorithm);
+  void sign_string(const string_t& string_to_sign);
+
+  string_t m_access_key;
+  string_t m_amz_date;
+  string_t m_scope;
+  unsigned char m_signing_key[sha256_t::SHA256_RAW_SIZE];
+  std::vector<header_t, std_allocator_t<header_t> > m_headers;
+  char m_signature[sha256_t::SHA256_HEX_SIZE + 1];
+  string_t m_string_to_sign;
+};
+
+/// @brief Derive the AWS region from an S3 host name.
+/// @param host The host name (e.g. "s3.eu-west-1.amazonaws.com").
+/// @returns the region, or "us-east-1" if no region could be derived from the host name.
+string_t sigv4_region_from_host(const char* host);
+
+/// @brief Calculate the size of an aws-chunked encoded payload.
+/// @param size The size of the decoded payload.
+/// @param chunk_size The size of each chunk.
+/// @param trailer_size The size of the trailing header lines, if any (including CRLF).
+/// @returns the size of the encoded payload, including chunk headers and the final chunk.
+size_t sigv4_chunked_size(size_t size, size_t chunk_size, size_t trailer_size = 0);
+
+}  // namespace us3
+
+#endif  // US3_SIGV4_HPP_
@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "tracing.hpp"
+
+#include "platform.hpp"
+
+namespace us3 {
+
+namespace {
+
+mutex_t& global_hooks_mutex() {
+  static mutex_t* s_mutex = new mutex_t();
+  return *s_mutex;
+}
+
+trace_hooks_t s_global_hooks;
+
+// Create the mutex during static initialization (before any threads are started).
+const mutex_t& s_global_hooks_mutex = global_hooks_mutex();
+
+}  // namespace
+
+void set_global_trace_hooks(const trace_hooks_t& hooks) {
+  lock_guard_t lock(global_hooks_mutex());
+  s_global_hooks = hooks;
+}
+
+trace_hooks_t get_global_trace_hooks() {
+  lock_guard_t lock(global_hooks_mutex());
+  return s_global_hooks;
+}
+
+}  // namespace us3
@@ -0,0 +1,85 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_TRACING_HPP_
+#define US3_TRACING_HPP_
+
+#include "return_value.hpp"
+#include <cstddef>
+#include <stdint.h>
+
+namespace us3 {
+
+/// @brief A connection lifecycle event.
+struct trace_event_t {
+  /// @brief Event type.
+  enum type_t {
+    OPEN_START = 0,    ///< open() was called.
+    HEADERS_SENT = 1,  ///< The HTTP request headers were sent (once per attempt).
+    RESPONSE = 2,      ///< The HTTP response headers were received and parsed.
+    OPEN_END = 3,      ///< open() returned.
+    READ = 4,          ///< read() returned.
+    WRITE = 5,         ///< write() returned.
+    CLOSE = 6          ///< The connection was closed.
+  };
+
+  type_t type;                     ///< The event type.
+  const void* stream;              ///< Identifies the stream (the same for all of its events).
+  int64_t time;                    ///< Time since open() was called (μs).
+  const char* host;                ///< The host of the request.
+  int status_code;                 ///< The HTTP status code, or 0 if no response was received.
+  size_t bytes;                    ///< The number of bytes (depends on the event type).
+  status_t::status_enum_t status;  ///< The result of the operation.
+};
+
+/// @brief Tracing hooks.
+///
+/// The hooks are called synchronously, from the thread that uses the stream.
+struct trace_hooks_t {
+  trace_hooks_t() : on_event(NULL), get_request_headers(NULL), user_data(NULL) {
+  }
+
+  /// @brief Called for each event, or NULL.
+  void (*on_event)(const trace_event_t& event, void* user_data);
+
+  /// @brief Called before each request is sent, or NULL.
+  ///
+  /// Returns extra HTTP header lines (separated by CRLF, without a trailing CRLF) to add to the
+  /// request, e.g. a trace context, or NULL for none.
+  const char* (*get_request_headers)(const void* stream, void* user_data);
+
+  /// @brief User data that is passed to the hooks.
+  void* user_data;
+
+  /// @brief Check if any hook is installed.
+  bool is_enabled() const {
+    return on_event != NULL || get_request_headers != NULL;
+  }
+};
+
+/// @brief Set the process wide tracing hooks, which are used by streams that have no hooks.
+/// @note Streams pick up the global hooks when they are opened.
+void set_global_trace_hooks(const trace_hooks_t& hooks);
+
+/// @brief Get the process wide tracing hooks.
+trace_hooks_t get_global_trace_hooks();
+
+}  // namespace us3
+
+#endif  // US3_TRACING_HPP_
@@ -0,0 +1,154 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "transport.hpp"
+
+#include "allocator.hpp"
+#include "platform.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace us3 {
+namespace net {
+
+namespace {
+
+result_t<socket_t> tcp_connect(const void*,
+                               const char* host,
+                               const int port,
+                               const timeout_t connect_timeout,
+                               const timeout_t socket_timeout,
+                               const socket_options_t& options) {
+  return connect(host, port, connect_timeout, socket_timeout, options);
+}
+
+result_t<socket_t> unix_socket_connect(const void* data,
+                                       const char*,
+                                       const int,
+                                       const timeout_t connect_timeout,
+                                       const timeout_t socket_timeout,
+                                       const socket_options_t&) {
+  if (data == NULL) {
+    return make_result<socket_t>(NULL, status_t::INVALID_ARGUMENT);
+  }
+  return connect_unix(static_cast<const char*>(data), connect_timeout, socket_timeout);
+}
+
+// A loopback connection: the position in the canned response, and the I/O counters.
+struct loopback_socket_t {
+  const loopback_config_t* config;
+  size_t response_pos;
+  socket_stats_t stats;
+};
+
+loopback_socket_t* to_loopback_socket(socket_t socket) {
+  return reinterpret_cast<loopback_socket_t*>(socket);
+}
+
+result_t<socket_t> loopback_connect(const void* data,
+                                    const char*,
+                                    const int,
+                                    const timeout_t,
+                                    const timeout_t,
+                                    const socket_options_t&) {
+  if (data == NULL) {
+    return make_result<socket_t>(NULL, status_t::INVALID_ARGUMENT);
+  }
+  loopback_socket_t* socket =
+      static_cast<loopback_socket_t*>(heap_alloc(sizeof(loopback_socket_t)));
+  if (socket == NULL) {
+    return make_result<socket_t>(NULL, status_t::ERROR);
+  }
+  socket->config = static_cast<const loopback_config_t*>(data);
+  socket->response_pos = 0;
+  std::memset(&socket->stats, 0, sizeof(socket->stats));
+  socket->stats.resolve_time = get_monotonic_time_us();
+  socket->stats.connect_time = socket->stats.resolve_time;
+  return make_result(reinterpret_cast<socket_t>(socket), status_t::SUCCESS);
+}
+
+status_t loopback_disconnect(socket_t socket) {
+  heap_free(to_loopback_socket(socket));
+  return make_result(status_t::SUCCESS);
+}
+
+result_t<size_t> loopback_send(socket_t socket, const void*, const size_t count) {
+  loopback_socket_t* loopback = to_loopback_socket(socket);
+  loopback->stats.bytes_sent += count;
+  ++loopback->stats.send_calls;
+  return make_result(count, status_t::SUCCESS);
+}
+
+result_t<size_t> loopback_recv(socket_t socket, void* buf, const size_t count) {
+  loopback_socket_t* loopback = to_loopback_socket(socket);
+  const loopback_config_t& config = *loopback->config;
+  size_t actual_count = std::min(count, config.response_size - loopback->response_pos);
+  if (config.segment_size > 0) {
+    actual_count = std::min(actual_count, config.segment_size);
+  }
+  if (actual_count > 0) {
+    std::memcpy(buf, &config.response[loopback->response_pos], actual_count);
+  }
+  loopback->response_pos += actual_count;
+  loopback->stats.bytes_received += actual_count;
+  ++loopback->stats.recv_calls;
+  return make_result(actual_count, status_t::SUCCESS);
+}
+
+socket_stats_t loopback_get_socket_stats(socket_t socket) {
+  return to_loopback_socket(socket)->stats;
+}
+
+// Loopback connections always have data to receive (or have been closed by the peer).
+result_t<size_t> loopback_wait_readable(const socket_t*, const size_t count, const timeout_t) {
+  if (count == 0 || count > 64) {
+    return make_result<size_t>(0, status_t::INVALID_ARGUMENT);
+  }
+  return make_result<size_t>(0, status_t::SUCCESS);
+}
+
+const transport_t TCP_TRANSPORT = {
+    tcp_connect, disconnect, send, recv, get_socket_stats, wait_readable};
+
+const transport_t UNIX_SOCKET_TRANSPORT = {
+    unix_socket_connect, disconnect, send, recv, get_socket_stats, wait_readable};
+
+const transport_t LOOPBACK_TRANSPORT = {loopback_connect,
+                                        loopback_disconnect,
+                                        loopback_send,
+                                        loopback_recv,
+                                        loopback_get_socket_stats,
+                                        loopback_wait_readable};
+
+}  // namespace
+
+const transport_t& tcp_transport() {
+  return TCP_TRANSPORT;
+}
+
+const transport_t& unix_socket_transport() {
+  return UNIX_SOCKET_TRANSPORT;
+}
+
+const transport_t& loopback_transport() {
+  return LOOPBACK_TRANSPORT;
+}
+
+}  // namespace net
+}  // namespace us3
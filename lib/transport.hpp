@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_TRANSPORT_HPP_
+#define US3_TRANSPORT_HPP_
+
+#include "network_socket.hpp"
+#include "return_value.hpp"
+#include <cstddef>
+
+namespace us3 {
+namespace net {
+
+/// @brief A transport: the socket operations that a connection uses to talk to the server.
+///
+/// Socket handles are opaque to the connection, so a transport may use its own socket type (the
+/// functions are only ever given sockets that were created by the same transport).
+struct transport_t {
+  /// @brief Establish a connection (see net::connect()).
+  /// @param data Transport specific data (see connection_t::options_t::transport_data).
+  result_t<socket_t> (*connect)(const void* data,
+                                const char* host,
+                                int port,
+                                timeout_t connect_timeout,
+                                timeout_t socket_timeout,
+                                const socket_options_t& options);
+
+  /// @brief Close a connection (see net::disconnect()).
+  status_t (*disconnect)(socket_t socket);
+
+  /// @brief Send data (see net::send()).
+  result_t<size_t> (*send)(socket_t socket, const void* buf, size_t count);
+
+  /// @brief Receive data (see net::recv()).
+  result_t<size_t> (*recv)(socket_t socket, void* buf, size_t count);
+
+  /// @brief Get the timing and I/O counters of a connection (see net::get_socket_stats()).
+  socket_stats_t (*get_socket_stats)(socket_t socket);
+
+  /// @brief Wait until one of several connections has data to receive (see net::wait_readable()).
+  result_t<size_t> (*wait_readable)(const socket_t* sockets, size_t count, timeout_t timeout);
+};
+
+/// @brief The TCP transport (the default). The transport data is not used.
+const transport_t& tcp_transport();
+
+/// @brief The Unix domain socket transport.
+///
+/// The transport data is the path of the socket (a C string). The host and port are still used in
+/// the HTTP request, but not for connecting.
+const transport_t& unix_socket_transport();
+
+/// @brief Configuration of the loopback transport.
+struct loopback_config_t {
+  loopback_config_t() : response(NULL), response_size(0), segment_size(0) {
+  }
+
+  const char* response;  ///< The data that is received by every connection.
+  size_t response_size;  ///< The size of the response, in bytes.
+  size_t segment_size;   ///< The maximum number of bytes per receive call, or 0 for no limit.
+};
+
+/// @brief The in-memory loopback transport.
+///
+/// The transport data is a loopback_config_t. Connections succeed immediately, sent data is
+/// discarded (but counted), and every connection receives the canned response, after which the
+/// peer appears to have closed the connection. This is useful for measuring the protocol handling
+/// of the library without any kernel networking.
+const transport_t& loopback_transport();
+
+}  // namespace net
+}  // namespace us3
+
+#endif  // US3_TRANSPORT_HPP_
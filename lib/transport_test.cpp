@@ -0,0 +1,188 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "transport.hpp"
+
+#include <cstring>
+#include <doctest.h>
+#include <string>
+
+#if !defined(_WIN32)
+#include <cstdio>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+us3::result_t<us3::net::socket_t> connect_with(const us3::net::transport_t& transport,
+                                                const void* data) {
+  return transport.connect(data, "example.com", 80, 1000000, 1000000, us3::net::socket_options_t());
+}
+
+}  // namespace
+
+TEST_CASE("Loopback transport") {
+  const us3::net::transport_t& transport = us3::net::loopback_transport();
+
+  SUBCASE("Every connection receives the response") {
+    // GIVEN
+    const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+    us3::net::loopback_config_t config;
+    config.response = response.data();
+    config.response_size = response.size();
+
+    for (int i = 0; i < 2; ++i) {
+      // WHEN
+      us3::result_t<us3::net::socket_t> socket = connect_with(transport, &config);
+      REQUIRE(socket.is_success());
+      char buf[256];
+      const us3::result_t<size_t> count = transport.recv(*socket, buf, sizeof(buf));
+      const us3::result_t<size_t> end = transport.recv(*socket, buf, sizeof(buf));
+
+      // THEN
+      REQUIRE(count.is_success());
+      CHECK_EQ(std::string(buf, *count), response);
+      CHECK(end.is_success());
+      CHECK_EQ(*end, 0);
+      transport.disconnect(*socket);
+    }
+  }
+
+  SUBCASE("The response is delivered in segments") {
+    // GIVEN
+    const std::string response = "0123456789";
+    us3::net::loopback_config_t config;
+    config.response = response.data();
+    config.response_size = response.size();
+    config.segment_size = 4;
+    us3::result_t<us3::net::socket_t> socket = connect_with(transport, &config);
+    REQUIRE(socket.is_success());
+
+    // WHEN
+    std::string received;
+    size_t calls = 0;
+    while (true) {
+      char buf[256];
+      const us3::result_t<size_t> count = transport.recv(*socket, buf, sizeof(buf));
+      REQUIRE(count.is_success());
+      CHECK(*count <= 4);
+      ++calls;
+      if (*count == 0) {
+        break;
+      }
+      received.append(buf, *count);
+    }
+
+    // THEN
+    CHECK_EQ(received, response);
+    CHECK_EQ(calls, 4);
+    CHECK_EQ(transport.get_socket_stats(*socket).bytes_received, response.size());
+    transport.disconnect(*socket);
+  }
+
+  SUBCASE("Sent data is discarded but counted") {
+    // GIVEN
+    us3::net::loopback_config_t config;
+    us3::result_t<us3::net::socket_t> socket = connect_with(transport, &config);
+    REQUIRE(socket.is_success());
+
+    // WHEN
+    const us3::result_t<size_t> count = transport.send(*socket, "GET / HTTP/1.1\r\n", 16);
+
+    // THEN
+    CHECK(count.is_success());
+    CHECK_EQ(*count, 16);
+    const us3::net::socket_stats_t stats = transport.get_socket_stats(*socket);
+    CHECK_EQ(stats.bytes_sent, 16);
+    CHECK_EQ(stats.send_calls, 1);
+    transport.disconnect(*socket);
+  }
+
+  SUBCASE("A configuration is required") {
+    // WHEN
+    const us3::result_t<us3::net::socket_t> socket = connect_with(transport, NULL);
+
+    // THEN
+    CHECK_EQ(socket.status(), us3::status_t::INVALID_ARGUMENT);
+  }
+}
+
+#if !defined(_WIN32)
+TEST_CASE("Unix domain socket transport") {
+  const us3::net::transport_t& transport = us3::net::unix_socket_transport();
+  char path[64];
+  std::snprintf(path, sizeof(path), "/tmp/us3_transport_test_%d.sock", static_cast<int>(getpid()));
+  ::unlink(path);
+
+  SUBCASE("Data is exchanged with the server") {
+    // GIVEN
+    const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(&addr.sun_path[0], path, sizeof(addr.sun_path) - 1);
+    REQUIRE_EQ(::bind(listen_fd, reinterpret_cast< ::sockaddr*>(&addr), sizeof(addr)), 0);
+    REQUIRE_EQ(::listen(listen_fd, 1), 0);
+
+    // WHEN
+    us3::result_t<us3::net::socket_t> socket = connect_with(transport, path);
+    REQUIRE(socket.is_success());
+    const int server_fd = ::accept(listen_fd, NULL, NULL);
+    REQUIRE(server_fd != -1);
+    const us3::result_t<size_t> sent = transport.send(*socket, "ping", 4);
+    char server_buf[16];
+    const ssize_t server_count = ::recv(server_fd, server_buf, sizeof(server_buf), 0);
+    CHECK_EQ(::send(server_fd, "pong", 4, 0), 4);
+    char buf[16];
+    const us3::result_t<size_t> received = transport.recv(*socket, buf, sizeof(buf));
+
+    // THEN
+    CHECK(sent.is_success());
+    REQUIRE_EQ(server_count, 4);
+    CHECK_EQ(std::string(server_buf, 4), "ping");
+    REQUIRE(received.is_success());
+    CHECK_EQ(std::string(buf, *received), "pong");
+    transport.disconnect(*socket);
+    ::close(server_fd);
+    ::close(listen_fd);
+    ::unlink(path);
+  }
+
+  SUBCASE("A missing socket is refused") {
+    // WHEN
+    const us3::result_t<us3::net::socket_t> socket = connect_with(transport, path);
+
+    // THEN
+    CHECK_EQ(socket.status(), us3::status_t::REFUSED);
+  }
+
+  SUBCASE("A path is required") {
+    // WHEN
+    const us3::result_t<us3::net::socket_t> socket = connect_with(transport, NULL);
+
+    // THEN
+    CHECK_EQ(socket.status(), us3::status_t::INVALID_ARGUMENT);
+  }
+}
+#endif
@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "upload_journal.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+namespace us3 {
+
+namespace {
+
+const char* const JOURNAL_MAGIC = "us3-journal 1";
+
+// Read a complete (newline terminated) line, without the newline.
+bool read_line(std::FILE* file, std::string& line) {
+  line.clear();
+  char buf[256];
+  while (std::fgets(buf, sizeof(buf), file) != NULL) {
+    line += &buf[0];
+    if (!line.empty() && line[line.size() - 1] == '\n') {
+      line.erase(line.size() - 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parse_uint64(const std::string& str, uint64_t& value) {
+  if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  std::istringstream stream(str);
+  stream >> value;
+  return !stream.fail();
+}
+
+}  // namespace
+
+upload_journal_t::upload_journal_t() : m_file_size(0), m_part_size(0) {
+}
+
+status_t upload_journal_t::load(const char* path) {
+  m_path = path;
+  m_url.clear();
+  m_file_size = 0;
+  m_part_size = 0;
+  m_upload_id.clear();
+  m_parts.clear();
+
+  std::FILE* file = std::fopen(path, "rb");
+  if (file == NULL) {
+    return make_result(status_t::NOT_FOUND);
+  }
+
+  std::string line;
+  bool is_valid = read_line(file, line) && line == JOURNAL_MAGIC;
+  while (is_valid && read_line(file, line)) {
+    const std::string::size_type space = line.find(' ');
+    const std::string key = line.substr(0, space);
+    const std::string value = (space != std::string::npos) ? line.substr(space + 1) : "";
+    if (key == "url") {
+      m_url = value;
+    } else if (key == "file_size") {
+      is_valid = parse_uint64(value, m_file_size);
+    } else if (key == "part_size") {
+      is_valid = parse_uint64(value, m_part_size);
+    } else if (key == "upload_id") {
+      m_upload_id = value;
+    } else if (key == "part") {
+      const std::string::size_type etag_pos = value.find(' ');
+      uint64_t number;
+      is_valid = etag_pos != std::string::npos && parse_uint64(value.substr(0, etag_pos), number) &&
+                 number >= 1 && number <= 10000;
+      if (is_valid) {
+        m_parts[static_cast<int>(number)] = value.substr(etag_pos + 1);
+      }
+    } else {
+      is_valid = false;
+    }
+  }
+  std::fclose(file);
+
+  if (!is_valid || m_url.empty() || m_upload_id.empty() || m_part_size == 0) {
+    return make_result(status_t::ERROR);
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+status_t upload_journal_t::create(const char* path,
+                                  const std::string& url,
+                                  const uint64_t file_size,
+                                  const uint64_t part_size,
+                                  const std::string& upload_id) {
+  m_path = path;
+  m_url = url;
+  m_file_size = file_size;
+  m_part_size = part_size;
+  m_upload_id = upload_id;
+  m_parts.clear();
+
+  std::ostringstream text;
+  text << JOURNAL_MAGIC << "\n";
+  text << "url " << url << "\n";
+  text << "file_size " << file_size << "\n";
+  text << "part_size " << part_size << "\n";
+  text << "upload_id " << upload_id << "\n";
+  return append(text.str(), "wb");
+}
+
+status_t upload_journal_t::add_part(const int number, const std::string& etag) {
+  std::ostringstream text;
+  text << "part " << number << " " << etag << "\n";
+  const status_t result = append(text.str(), "ab");
+  if (result.is_success()) {
+    m_parts[number] = etag;
+  }
+  return result;
+}
+
+status_t upload_journal_t::remove(const char* path) {
+  if (std::remove(path) != 0) {
+    return make_result(status_t::ERROR);
+  }
+  return make_result(status_t::SUCCESS);
+}
+
+status_t upload_journal_t::append(const std::string& text, const char* mode) {
+  std::FILE* file = std::fopen(m_path.c_str(), mode);
+  if (file == NULL) {
+    return make_result(status_t::ERROR);
+  }
+
+  // Flush before closing, so that the record survives a crash of this process.
+  bool success = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+  success = (std::fflush(file) == 0) && success;
+  success = (std::fclose(file) == 0) && success;
+  return make_result(success ? status_t::SUCCESS : status_t::ERROR);
+}
+
+}  // namespace us3
@@ -0,0 +1,103 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef US3_UPLOAD_JOURNAL_HPP_
+#define US3_UPLOAD_JOURNAL_HPP_
+
+#include "return_value.hpp"
+#include <map>
+#include <stdint.h>
+#include <string>
+
+namespace us3 {
+
+/// @brief A checkpoint journal for a resumable multipart upload.
+///
+/// The journal is a small text file that records the upload ID, the part size and the ETags of
+/// the completed parts. Each completed part is appended (and flushed) as a separate line, so a
+/// process that crashes loses at most the part that was in flight. An incomplete last line (from
+/// a crash during a write) is ignored when the journal is loaded.
+class upload_journal_t {
+public:
+  /// @brief Part number -> ETag.
+  typedef std::map<int, std::string> part_map_t;
+
+  upload_journal_t();
+
+  /// @brief Load a journal from a file.
+  /// @param path The path to the journal file.
+  /// @returns status_t::NOT_FOUND if there is no journal file, or status_t::ERROR if the file is
+  /// not a valid journal.
+  status_t load(const char* path);
+
+  /// @brief Create a new journal file (any existing file is replaced).
+  /// @param path The path to the journal file.
+  /// @param url The URL of the object that is being uploaded.
+  /// @param file_size The size of the file that is being uploaded.
+  /// @param part_size The size of each part (except the last one).
+  /// @param upload_id The upload ID of the multipart upload.
+  status_t create(const char* path,
+                  const std::string& url,
+                  uint64_t file_size,
+                  uint64_t part_size,
+                  const std::string& upload_id);
+
+  /// @brief Record a completed part.
+  /// @param number The part number.
+  /// @param etag The ETag of the part.
+  status_t add_part(int number, const std::string& etag);
+
+  /// @brief Remove a journal file.
+  /// @param path The path to the journal file.
+  static status_t remove(const char* path);
+
+  const std::string& url() const {
+    return m_url;
+  }
+
+  uint64_t file_size() const {
+    return m_file_size;
+  }
+
+  uint64_t part_size() const {
+    return m_part_size;
+  }
+
+  const std::string& upload_id() const {
+    return m_upload_id;
+  }
+
+  const part_map_t& parts() const {
+    return m_parts;
+  }
+
+private:
+  status_t append(const std::string& text, const char* mode);
+
+  std::string m_path;
+  std::string m_url;
+  uint64_t m_file_size;
+  uint64_t m_part_size;
+  std::string m_upload_id;
+  part_map_t m_parts;
+};
+
+}  // namespace us3
+
+#endif  // US3_UPLOAD_JOURNAL_HPP_
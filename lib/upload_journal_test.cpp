@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2019 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "upload_journal.hpp"
+
+#include <cstdio>
+#include <doctest.h>
+#include <stdint.h>
+
+// Workaround for macOS build errors.
+// See: https://github.com/onqtam/doctest/issues/126
+#include <iostream>
+
+namespace {
+
+const uint64_t FILE_SIZE = static_cast<uint64_t>(20000) * 1000000;
+const char* const JOURNAL_PATH = "upload_journal_test.journal";
+
+void append_to_file(const char* path, const char* text) {
+  std::FILE* file = std::fopen(path, "ab");
+  REQUIRE(file != static_cast<std::FILE*>(NULL));
+  std::fputs(text, file);
+  std::fclose(file);
+}
+
+}  // namespace
+
+TEST_CASE("Journal round trip") {
+  // GIVEN
+  us3::upload_journal_t journal;
+  REQUIRE(journal
+              .create(JOURNAL_PATH,
+                      "http://myhost:80/bucket/object",
+                      FILE_SIZE,
+                      8388608,
+                      "VXBsb2FkIElE.x_y-z")
+              .is_success());
+
+  // WHEN
+  REQUIRE(journal.add_part(2, "\"b1946ac92492d2347c6235b4d2611184\"").is_success());
+  REQUIRE(journal.add_part(1, "\"591785b794601e212b260e25925636fd\"").is_success());
+
+  // THEN
+  us3::upload_journal_t loaded;
+  REQUIRE(loaded.load(JOURNAL_PATH).is_success());
+  CHECK(loaded.url() == "http://myhost:80/bucket/object");
+  CHECK(loaded.file_size() == FILE_SIZE);
+  CHECK(loaded.part_size() == 8388608);
+  CHECK(loaded.upload_id() == "VXBsb2FkIElE.x_y-z");
+  REQUIRE(loaded.parts().size() == 2);
+  CHECK(loaded.parts().find(1)->second == "\"591785b794601e212b260e25925636fd\"");
+  CHECK(loaded.parts().find(2)->second == "\"b1946ac92492d2347c6235b4d2611184\"");
+
+  SUBCASE("Parts are appended to a loaded journal") {
+    // WHEN
+    REQUIRE(loaded.add_part(3, "\"d41d8cd98f00b204e9800998ecf8427e\"").is_success());
+
+    // THEN
+    us3::upload_journal_t reloaded;
+    REQUIRE(reloaded.load(JOURNAL_PATH).is_success());
+    CHECK(reloaded.parts().size() == 3);
+  }
+
+  SUBCASE("An incomplete last line is ignored") {
+    // WHEN
+    append_to_file(JOURNAL_PATH, "part 3 \"d41d8cd98f");
+
+    // THEN
+    us3::upload_journal_t reloaded;
+    REQUIRE(reloaded.load(JOURNAL_PATH).is_success());
+    CHECK(reloaded.parts().size() == 2);
+  }
+
+  SUBCASE("Invalid lines are rejected") {
+    // WHEN
+    append_to_file(JOURNAL_PATH, "part x \"d41d8cd98f00b204e9800998ecf8427e\"\n");
+
+    // THEN
+    us3::upload_journal_t reloaded;
+    CHECK(reloaded.load(JOURNAL_PATH).status() == us3::status_t::ERROR);
+  }
+
+  REQUIRE(us3::upload_journal_t::remove(JOURNAL_PATH).is_success());
+}
+
+TEST_CASE("Missing and invalid journals") {
+  us3::upload_journal_t journal;
+  CHECK(journal.load("no_such_file.journal").status() == us3::status_t::NOT_FOUND);
+
+  // An incomplete header (e.g. from a crash while creating the journal) is not valid.
+  append_to_file(JOURNAL_PATH, "us3-journal 1\nurl http://myhost:80/bucket/object\n");
+  CHECK(journal.load(JOURNAL_PATH).status() == us3::status_t::ERROR);
+  REQUIRE(us3::upload_journal_t::remove(JOURNAL_PATH).is_success());
+}
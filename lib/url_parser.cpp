@@ -34,7 +34,7 @@ result_t<url_parts_t> parse_url(const char* url) {
   if ((url[k] != ':') || (url[k + 1] != '/') || (url[k + 2] != '/')) {
     return make_result(parts, status_t::INVALID_URL);
   }
-  parts.scheme = std::string(&url[part_start], static_cast<size_t>(k - part_start));
+  parts.scheme = string_t(&url[part_start], static_cast<size_t>(k - part_start));
   part_start = k + 3;
 
   // Extract the host.
@@ -45,7 +45,7 @@ result_t<url_parts_t> parse_url(const char* url) {
     return make_result(parts, status_t::INVALID_URL);
   }
   const bool has_port = (url[k] == ':');
-  parts.host = std::string(&url[part_start], static_cast<size_t>(k - part_start));
+  parts.host = string_t(&url[part_start], static_cast<size_t>(k - part_start));
   part_start = k + (has_port ? 1 : 0);
 
   // Extract the port.
@@ -67,7 +67,7 @@ result_t<url_parts_t> parse_url(const char* url) {
   }
 
   // The rest is the path (we include query & fragment in the path).
-  parts.path = std::string(&url[part_start]);
+  parts.path = string_t(&url[part_start]);
 
   return make_result(parts);
 }
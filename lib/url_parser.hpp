@@ -20,8 +20,8 @@
 #ifndef US3_URL_PARSER_HPP_
 #define US3_URL_PARSER_HPP_
 
+#include "allocator.hpp"
 #include "return_value.hpp"
-#include <string>
 
 namespace us3 {
 
@@ -30,10 +30,10 @@ struct url_parts_t {
   url_parts_t() : port(0) {
   }
 
-  std::string scheme;  ///< Scheme (e.g. "http" or "https").
-  std::string host;    ///< Host name (e.g. "myhost" or "192.168.0.1").
-  std::string path;    ///< Path including leading slash (e.g. "/path/to/object").
-  int port;            ///< Port number (e.g. 80).
+  string_t scheme;  ///< Scheme (e.g. "http" or "https").
+  string_t host;    ///< Host name (e.g. "myhost" or "192.168.0.1").
+  string_t path;    ///< Path including leading slash (e.g. "/path/to/object").
+  int port;         ///< Port number (e.g. 80).
 };
 
 /// @brief Parse the given URL.
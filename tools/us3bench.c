@@ -0,0 +1,960 @@
+/*--------------------------------------------------------------------------------------------------
+ * Copyright (c) 2019 Marcus Geelnard
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will the
+ * authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+ *     the original software. If you use this software in a product, an acknowledgment in the
+ *     product documentation would be appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *     being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *------------------------------------------------------------------------------------------------*/
+
+#if !defined(_WIN32)
+/* Needed for pthreads and clock_gettime() in strict C90 mode. */
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <us3/us3.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define BUFFER_SIZE 65536
+#define MAX_CONCURRENCY_LEVELS 32
+#define MAX_CONCURRENCY 1024
+#define MAX_OBJECT_SIZE 4294967295.0
+
+/* Operation types. */
+#define OP_GET 0
+#define OP_PUT 1
+#define NUM_OPS 2
+
+/* Request phases (latencies are measured from the start of the request). */
+#define PHASE_CONNECT 0
+#define PHASE_FIRST_BYTE 1
+#define PHASE_TOTAL 2
+#define NUM_PHASES 3
+
+/* Object size distributions. */
+#define SIZE_FIXED 0
+#define SIZE_LOGNORMAL 1
+#define SIZE_FILE 2
+
+static const char* OP_NAMES[NUM_OPS] = {"GET", "PUT"};
+static const char* PHASE_NAMES[NUM_PHASES] = {"connect", "first_byte", "total"};
+
+/* Data that is sent by PUT requests (the contents do not matter). */
+static char s_put_data[BUFFER_SIZE];
+
+typedef struct {
+  int type;
+  double fixed_size;
+  double median;
+  double sigma;
+  double* sizes;
+  size_t num_sizes;
+} size_dist_t;
+
+typedef struct {
+  const char* url_prefix;
+  const char* access_key;
+  const char* secret_key;
+  us3_options_t options;
+  size_dist_t size_dist;
+  const char* size_spec;
+  double duration;
+  int get_percent;
+  unsigned long num_objects;
+  unsigned long seed;
+} config_t;
+
+typedef struct {
+  double* values;
+  size_t count;
+  size_t capacity;
+} samples_t;
+
+typedef struct {
+  unsigned long requests;
+  unsigned long errors;
+  double bytes;
+  samples_t latencies[NUM_PHASES];
+} op_stats_t;
+
+typedef struct {
+  const config_t* config;
+  unsigned long rng_state;
+  double stop_time;
+  char* url;
+  char* buffer;
+  op_stats_t ops[NUM_OPS];
+  us3_status_t first_error;
+} worker_t;
+
+/*-------------------------------------------------------------------------------------------------
+ * Platform abstraction.
+ *-----------------------------------------------------------------------------------------------*/
+
+#if defined(_WIN32)
+typedef HANDLE thread_t;
+
+static DWORD WINAPI worker_thread_entry(LPVOID arg);
+
+static int start_thread(thread_t* thread, worker_t* worker) {
+  *thread = CreateThread(NULL, 0, worker_thread_entry, worker, 0, NULL);
+  return *thread != NULL;
+}
+
+static void join_thread(thread_t thread) {
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+static double get_time(void) {
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+#else
+typedef pthread_t thread_t;
+
+static void* worker_thread_entry(void* arg);
+
+static int start_thread(thread_t* thread, worker_t* worker) {
+  return pthread_create(thread, NULL, worker_thread_entry, worker) == 0;
+}
+
+static void join_thread(thread_t thread) {
+  pthread_join(thread, NULL);
+}
+
+static double get_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif
+
+/*-------------------------------------------------------------------------------------------------
+ * Random numbers and object sizes.
+ *-----------------------------------------------------------------------------------------------*/
+
+/* A 32-bit xorshift generator (unsigned long is at least 32 bits wide). */
+static unsigned long random_u32(unsigned long* state) {
+  unsigned long x = *state;
+  x ^= (x << 13) & 0xffffffffUL;
+  x ^= x >> 17;
+  x ^= (x << 5) & 0xffffffffUL;
+  *state = x;
+  return x;
+}
+
+/* Returns a uniformly distributed number in the range (0, 1). */
+static double random_uniform(unsigned long* state) {
+  return ((double)random_u32(state) + 1.0) / 4294967297.0;
+}
+
+static void seed_random(unsigned long* state, const unsigned long seed) {
+  *state = ((seed * 2654435761UL) ^ 0x9e3779b9UL) & 0xffffffffUL;
+  if (*state == 0UL) {
+    *state = 1UL;
+  }
+}
+
+static double sample_size(const size_dist_t* dist, unsigned long* rng_state) {
+  double size;
+  switch (dist->type) {
+    case SIZE_LOGNORMAL: {
+      /* Box-Muller transform. */
+      const double u1 = random_uniform(rng_state);
+      const double u2 = random_uniform(rng_state);
+      const double z = sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+      size = floor(dist->median * exp(dist->sigma * z) + 0.5);
+      break;
+    }
+    case SIZE_FILE:
+      size = dist->sizes[random_u32(rng_state) % dist->num_sizes];
+      break;
+    default:
+      size = dist->fixed_size;
+  }
+  if (size < 0.0) {
+    size = 0.0;
+  } else if (size > MAX_OBJECT_SIZE) {
+    size = MAX_OBJECT_SIZE;
+  }
+  return size;
+}
+
+/* Parse a size with an optional K, M or G suffix (powers of 1024). */
+static int parse_size(const char* str, double* size) {
+  char* end;
+  double value = strtod(str, &end);
+  if (end == str || value < 0.0) {
+    return 0;
+  }
+  if (*end == 'k' || *end == 'K') {
+    value *= 1024.0;
+    ++end;
+  } else if (*end == 'm' || *end == 'M') {
+    value *= 1024.0 * 1024.0;
+    ++end;
+  } else if (*end == 'g' || *end == 'G') {
+    value *= 1024.0 * 1024.0 * 1024.0;
+    ++end;
+  }
+  *size = floor(value);
+  return *end == '\0';
+}
+
+static int load_sizes(const char* file_name, size_dist_t* dist) {
+  FILE* file;
+  char line[256];
+  size_t capacity = 0;
+
+  file = fopen(file_name, "r");
+  if (file == NULL) {
+    fprintf(stderr, "*** Unable to open %s for input\n", file_name);
+    return 0;
+  }
+  while (fgets(line, (int)sizeof(line), file) != NULL) {
+    double size;
+    char* end = line + strlen(line);
+    while (end > line && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ')) {
+      *--end = '\0';
+    }
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    if (!parse_size(line, &size)) {
+      fprintf(stderr, "*** Invalid object size in %s: %s\n", file_name, line);
+      fclose(file);
+      return 0;
+    }
+    if (dist->num_sizes == capacity) {
+      double* sizes;
+      capacity = (capacity == 0) ? 64 : capacity * 2;
+      sizes = (double*)realloc(dist->sizes, capacity * sizeof(double));
+      if (sizes == NULL) {
+        fclose(file);
+        return 0;
+      }
+      dist->sizes = sizes;
+    }
+    dist->sizes[dist->num_sizes++] = size;
+  }
+  fclose(file);
+  if (dist->num_sizes == 0) {
+    fprintf(stderr, "*** No object sizes in %s\n", file_name);
+    return 0;
+  }
+  return 1;
+}
+
+/* Parse an object size distribution: fixed:SIZE, lognormal:MEDIAN:SIGMA or file:PATH. */
+static int parse_size_dist(const char* spec, size_dist_t* dist) {
+  if (strncmp(spec, "fixed:", 6) == 0) {
+    dist->type = SIZE_FIXED;
+    return parse_size(spec + 6, &dist->fixed_size);
+  } else if (strncmp(spec, "lognormal:", 10) == 0) {
+    const char* sigma = strchr(spec + 10, ':');
+    char* end;
+    dist->type = SIZE_LOGNORMAL;
+    if (sigma == NULL) {
+      return 0;
+    }
+    {
+      /* Copy the median part, since parse_size() requires the string to end after the suffix. */
+      char median[64];
+      const size_t len = (size_t)(sigma - (spec + 10));
+      if (len == 0 || len >= sizeof(median)) {
+        return 0;
+      }
+      memcpy(median, spec + 10, len);
+      median[len] = '\0';
+      if (!parse_size(median, &dist->median) || dist->median < 1.0) {
+        return 0;
+      }
+    }
+    dist->sigma = strtod(sigma + 1, &end);
+    return end != sigma + 1 && *end == '\0' && dist->sigma >= 0.0;
+  } else if (strncmp(spec, "file:", 5) == 0) {
+    dist->type = SIZE_FILE;
+    return load_sizes(spec + 5, dist);
+  }
+  return parse_size(spec, &dist->fixed_size);
+}
+
+/*-------------------------------------------------------------------------------------------------
+ * Latency samples.
+ *-----------------------------------------------------------------------------------------------*/
+
+static void add_sample(samples_t* samples, const double value) {
+  if (samples->count == samples->capacity) {
+    const size_t capacity = (samples->capacity == 0) ? 1024 : samples->capacity * 2;
+    double* values = (double*)realloc(samples->values, capacity * sizeof(double));
+    if (values == NULL) {
+      return;
+    }
+    samples->values = values;
+    samples->capacity = capacity;
+  }
+  samples->values[samples->count++] = value;
+}
+
+static void append_samples(samples_t* dst, const samples_t* src) {
+  size_t i;
+  for (i = 0; i < src->count; ++i) {
+    add_sample(dst, src->values[i]);
+  }
+}
+
+static void free_samples(samples_t* samples) {
+  free(samples->values);
+  samples->values = NULL;
+  samples->count = 0;
+  samples->capacity = 0;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  const double x = *(const double*)a;
+  const double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples (0 if there are no samples). */
+static double percentile(const samples_t* samples, const double p) {
+  double rank;
+  size_t index;
+  if (samples->count == 0) {
+    return 0.0;
+  }
+  rank = ceil(p * (double)samples->count);
+  index = (rank < 1.0) ? 0 : (size_t)rank - 1;
+  if (index >= samples->count) {
+    index = samples->count - 1;
+  }
+  return samples->values[index];
+}
+
+/*-------------------------------------------------------------------------------------------------
+ * Requests.
+ *-----------------------------------------------------------------------------------------------*/
+
+static void make_object_url(char* url, const config_t* config, const unsigned long object) {
+  sprintf(url, "%sus3bench-%lu", config->url_prefix, object);
+}
+
+/* Record the phase latencies of a successful request. */
+static void record_request(op_stats_t* stats, const us3_stats_t* s3_stats, const double elapsed) {
+  if (s3_stats->connect_time >= 0) {
+    add_sample(&stats->latencies[PHASE_CONNECT], (double)s3_stats->connect_time * 1e-6);
+  }
+  if (s3_stats->first_byte_time >= 0) {
+    add_sample(&stats->latencies[PHASE_FIRST_BYTE], (double)s3_stats->first_byte_time * 1e-6);
+  }
+  add_sample(&stats->latencies[PHASE_TOTAL], elapsed);
+}
+
+static us3_status_t do_get(worker_t* worker, const unsigned long object) {
+  const config_t* config = worker->config;
+  op_stats_t* stats = &worker->ops[OP_GET];
+  us3_handle_t handle;
+  us3_stats_t s3_stats;
+  us3_status_t status;
+  double bytes = 0.0;
+  const double start_time = get_time();
+
+  make_object_url(worker->url, config, object);
+  status = us3_open_with_options(worker->url,
+                                 config->access_key,
+                                 config->secret_key,
+                                 US3_READ,
+                                 0,
+                                 &config->options,
+                                 &handle);
+  if (status != US3_SUCCESS) {
+    return status;
+  }
+  while (status == US3_SUCCESS) {
+    size_t actual_size;
+    status = us3_read(handle, worker->buffer, BUFFER_SIZE, &actual_size);
+    if (status == US3_SUCCESS && actual_size == 0) {
+      break;
+    }
+    bytes += (double)actual_size;
+  }
+  if (us3_get_stats(handle, &s3_stats) != US3_SUCCESS) {
+    memset(&s3_stats, 0xff, sizeof(s3_stats));
+  }
+  if (status == US3_SUCCESS) {
+    status = us3_close(handle);
+  } else {
+    (void)us3_close(handle);
+  }
+  if (status == US3_SUCCESS) {
+    record_request(stats, &s3_stats, get_time() - start_time);
+    stats->bytes += bytes;
+  }
+  return status;
+}
+
+static us3_status_t do_put(worker_t* worker, const unsigned long object, const double size) {
+  const config_t* config = worker->config;
+  op_stats_t* stats = &worker->ops[OP_PUT];
+  us3_handle_t handle;
+  us3_stats_t s3_stats;
+  us3_status_t status;
+  double left = size;
+  const double start_time = get_time();
+
+  make_object_url(worker->url, config, object);
+  status = us3_open_with_options(worker->url,
+                                 config->access_key,
+                                 config->secret_key,
+                                 US3_WRITE,
+                                 (size_t)size,
+                                 &config->options,
+                                 &handle);
+  if (status != US3_SUCCESS) {
+    return status;
+  }
+  while (status == US3_SUCCESS && left > 0.0) {
+    const size_t bytes_to_write = (left < (double)BUFFER_SIZE) ? (size_t)left : BUFFER_SIZE;
+    size_t actual_size;
+    status = us3_write(handle, s_put_data, bytes_to_write, &actual_size);
+    left -= (double)actual_size;
+  }
+  if (us3_get_stats(handle, &s3_stats) != US3_SUCCESS) {
+    memset(&s3_stats, 0xff, sizeof(s3_stats));
+  }
+  if (status == US3_SUCCESS) {
+    status = us3_close(handle);
+  } else {
+    (void)us3_close(handle);
+  }
+  if (status == US3_SUCCESS) {
+    record_request(stats, &s3_stats, get_time() - start_time);
+    stats->bytes += size;
+  }
+  return status;
+}
+
+static void run_worker(worker_t* worker) {
+  const config_t* config = worker->config;
+  while (get_time() < worker->stop_time) {
+    const unsigned long object = random_u32(&worker->rng_state) % config->num_objects;
+    const int op = ((int)(random_u32(&worker->rng_state) % 100UL) < config->get_percent)
+                       ? OP_GET
+                       : OP_PUT;
+    us3_status_t status;
+    if (op == OP_GET) {
+      status = do_get(worker, object);
+    } else {
+      status = do_put(worker, object, sample_size(&config->size_dist, &worker->rng_state));
+    }
+    ++worker->ops[op].requests;
+    if (status != US3_SUCCESS) {
+      ++worker->ops[op].errors;
+      if (worker->first_error == US3_SUCCESS) {
+        worker->first_error = status;
+      }
+    }
+  }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI worker_thread_entry(LPVOID arg) {
+  run_worker((worker_t*)arg);
+  return 0;
+}
+#else
+static void* worker_thread_entry(void* arg) {
+  run_worker((worker_t*)arg);
+  return NULL;
+}
+#endif
+
+/*-------------------------------------------------------------------------------------------------
+ * Benchmark runs.
+ *-----------------------------------------------------------------------------------------------*/
+
+typedef struct {
+  int concurrency;
+  double elapsed;
+  op_stats_t ops[NUM_OPS];
+} run_result_t;
+
+/* Upload the objects that are read by GET requests. */
+static int prepare_objects(const config_t* config, const int verbose) {
+  worker_t worker;
+  unsigned long i;
+  int result = 1;
+
+  memset(&worker, 0, sizeof(worker));
+  worker.config = config;
+  seed_random(&worker.rng_state, config->seed);
+  worker.url = (char*)malloc(strlen(config->url_prefix) + 32);
+  if (worker.url == NULL) {
+    return 0;
+  }
+  if (verbose) {
+    fprintf(stderr, "Uploading %lu objects...\n", config->num_objects);
+  }
+  for (i = 0; i < config->num_objects; ++i) {
+    const us3_status_t status =
+        do_put(&worker, i, sample_size(&config->size_dist, &worker.rng_state));
+    if (status != US3_SUCCESS) {
+      make_object_url(worker.url, config, i);
+      fprintf(stderr, "*** Unable to upload %s: %s\n", worker.url, us3_status_str(status));
+      result = 0;
+      break;
+    }
+  }
+  for (i = 0; i < NUM_PHASES; ++i) {
+    free_samples(&worker.ops[OP_PUT].latencies[i]);
+  }
+  free(worker.url);
+  return result;
+}
+
+static int run_benchmark(const config_t* config,
+                         const int concurrency,
+                         run_result_t* result,
+                         const int verbose) {
+  worker_t* workers;
+  thread_t* threads;
+  int num_started = 0;
+  int i;
+  int op;
+  int phase;
+  double start_time;
+
+  memset(result, 0, sizeof(*result));
+  result->concurrency = concurrency;
+
+  workers = (worker_t*)calloc((size_t)concurrency, sizeof(worker_t));
+  threads = (thread_t*)calloc((size_t)concurrency, sizeof(thread_t));
+  if (workers == NULL || threads == NULL) {
+    free(workers);
+    free(threads);
+    fprintf(stderr, "*** Out of memory\n");
+    return 0;
+  }
+
+  if (verbose) {
+    fprintf(stderr, "Running with concurrency %d for %g s...\n", concurrency, config->duration);
+  }
+
+  /* Start the workers. */
+  start_time = get_time();
+  for (i = 0; i < concurrency; ++i) {
+    worker_t* worker = &workers[i];
+    worker->config = config;
+    seed_random(&worker->rng_state, config->seed + 1000003UL * (unsigned long)(i + 1));
+    worker->stop_time = start_time + config->duration;
+    worker->url = (char*)malloc(strlen(config->url_prefix) + 32);
+    worker->buffer = (char*)malloc(BUFFER_SIZE);
+    if (worker->url == NULL || worker->buffer == NULL ||
+        !start_thread(&threads[num_started], worker)) {
+      fprintf(stderr, "*** Unable to start worker thread %d\n", i);
+      free(worker->url);
+      free(worker->buffer);
+      break;
+    }
+    ++num_started;
+  }
+
+  /* Wait for the workers to finish and collect the results. */
+  for (i = 0; i < num_started; ++i) {
+    join_thread(threads[i]);
+  }
+  result->elapsed = get_time() - start_time;
+  for (i = 0; i < num_started; ++i) {
+    worker_t* worker = &workers[i];
+    if (worker->first_error != US3_SUCCESS && verbose) {
+      fprintf(stderr, "Worker %d: %s\n", i, us3_status_str(worker->first_error));
+    }
+    for (op = 0; op < NUM_OPS; ++op) {
+      result->ops[op].requests += worker->ops[op].requests;
+      result->ops[op].errors += worker->ops[op].errors;
+      result->ops[op].bytes += worker->ops[op].bytes;
+      for (phase = 0; phase < NUM_PHASES; ++phase) {
+        append_samples(&result->ops[op].latencies[phase], &worker->ops[op].latencies[phase]);
+        free_samples(&worker->ops[op].latencies[phase]);
+      }
+    }
+    free(worker->url);
+    free(worker->buffer);
+  }
+  for (op = 0; op < NUM_OPS; ++op) {
+    for (phase = 0; phase < NUM_PHASES; ++phase) {
+      samples_t* samples = &result->ops[op].latencies[phase];
+      qsort(samples->values, samples->count, sizeof(double), compare_doubles);
+    }
+  }
+
+  free(workers);
+  free(threads);
+  return num_started == concurrency;
+}
+
+static void free_result(run_result_t* result) {
+  int op;
+  int phase;
+  for (op = 0; op < NUM_OPS; ++op) {
+    for (phase = 0; phase < NUM_PHASES; ++phase) {
+      free_samples(&result->ops[op].latencies[phase]);
+    }
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+ * Reports.
+ *-----------------------------------------------------------------------------------------------*/
+
+static const double PERCENTILES[4] = {0.5, 0.9, 0.99, 0.999};
+static const char* PERCENTILE_NAMES[4] = {"p50", "p90", "p99", "p999"};
+
+static void print_text_report(const run_result_t* result) {
+  unsigned long requests = 0;
+  unsigned long errors = 0;
+  double bytes = 0.0;
+  int op;
+  int phase;
+  int i;
+
+  for (op = 0; op < NUM_OPS; ++op) {
+    requests += result->ops[op].requests;
+    errors += result->ops[op].errors;
+    bytes += result->ops[op].bytes;
+  }
+  printf("Concurrency %d: %lu requests (%lu errors) in %.2f s\n",
+         result->concurrency,
+         requests,
+         errors,
+         result->elapsed);
+  printf("  %.1f requests/s, %.2f MiB/s\n",
+         (double)requests / result->elapsed,
+         bytes / (1024.0 * 1024.0) / result->elapsed);
+  printf("  %-4s %-11s %10s %10s %10s %10s   (latency in ms)\n", "op", "phase", "p50", "p90",
+         "p99", "p999");
+  for (op = 0; op < NUM_OPS; ++op) {
+    if (result->ops[op].requests == 0) {
+      continue;
+    }
+    for (phase = 0; phase < NUM_PHASES; ++phase) {
+      const samples_t* samples = &result->ops[op].latencies[phase];
+      printf("  %-4s %-11s", OP_NAMES[op], PHASE_NAMES[phase]);
+      for (i = 0; i < 4; ++i) {
+        printf(" %10.3f", percentile(samples, PERCENTILES[i]) * 1000.0);
+      }
+      printf("\n");
+    }
+    printf("  %-4s %lu requests (%lu errors), %.1f requests/s, %.2f MiB/s\n",
+           OP_NAMES[op],
+           result->ops[op].requests,
+           result->ops[op].errors,
+           (double)result->ops[op].requests / result->elapsed,
+           result->ops[op].bytes / (1024.0 * 1024.0) / result->elapsed);
+  }
+  printf("\n");
+}
+
+static void print_json_string(const char* str) {
+  putchar('"');
+  for (; *str != '\0'; ++str) {
+    const unsigned char c = (unsigned char)*str;
+    if (c == '"' || c == '\\') {
+      printf("\\%c", c);
+    } else if (c < 0x20) {
+      printf("\\u%04x", (unsigned)c);
+    } else {
+      putchar(c);
+    }
+  }
+  putchar('"');
+}
+
+static void print_json_report(const config_t* config,
+                              const run_result_t* results,
+                              const int num_results) {
+  int r;
+  int op;
+  int phase;
+  int i;
+
+  printf("{\n  \"url_prefix\": ");
+  print_json_string(config->url_prefix);
+  printf(",\n  \"size\": ");
+  print_json_string(config->size_spec);
+  printf(",\n  \"duration\": %g,\n  \"get_percent\": %d,\n  \"objects\": %lu,\n  \"runs\": [",
+         config->duration,
+         config->get_percent,
+         config->num_objects);
+  for (r = 0; r < num_results; ++r) {
+    const run_result_t* result = &results[r];
+    unsigned long requests = 0;
+    unsigned long errors = 0;
+    double bytes = 0.0;
+    for (op = 0; op < NUM_OPS; ++op) {
+      requests += result->ops[op].requests;
+      errors += result->ops[op].errors;
+      bytes += result->ops[op].bytes;
+    }
+    printf("%s\n    {\n", r > 0 ? "," : "");
+    printf("      \"concurrency\": %d,\n", result->concurrency);
+    printf("      \"elapsed_seconds\": %.6f,\n", result->elapsed);
+    printf("      \"requests\": %lu,\n", requests);
+    printf("      \"errors\": %lu,\n", errors);
+    printf("      \"requests_per_second\": %.3f,\n", (double)requests / result->elapsed);
+    printf("      \"bytes_per_second\": %.1f,\n", bytes / result->elapsed);
+    printf("      \"operations\": {");
+    for (op = 0; op < NUM_OPS; ++op) {
+      const op_stats_t* stats = &result->ops[op];
+      printf("%s\n        \"%s\": {\n", op > 0 ? "," : "", OP_NAMES[op]);
+      printf("          \"requests\": %lu,\n", stats->requests);
+      printf("          \"errors\": %lu,\n", stats->errors);
+      printf("          \"bytes\": %.0f,\n", stats->bytes);
+      printf("          \"requests_per_second\": %.3f,\n",
+             (double)stats->requests / result->elapsed);
+      printf("          \"bytes_per_second\": %.1f,\n", stats->bytes / result->elapsed);
+      printf("          \"latency_seconds\": {");
+      for (phase = 0; phase < NUM_PHASES; ++phase) {
+        const samples_t* samples = &stats->latencies[phase];
+        printf("%s\n            \"%s\": {", phase > 0 ? "," : "", PHASE_NAMES[phase]);
+        for (i = 0; i < 4; ++i) {
+          printf("%s\"%s\": %.6f",
+                 i > 0 ? ", " : "",
+                 PERCENTILE_NAMES[i],
+                 percentile(samples, PERCENTILES[i]));
+        }
+        printf("}");
+      }
+      printf("\n          }\n        }");
+    }
+    printf("\n      }\n    }");
+  }
+  printf("\n  ]\n}\n");
+}
+
+/*-------------------------------------------------------------------------------------------------
+ * Main program.
+ *-----------------------------------------------------------------------------------------------*/
+
+static int parse_concurrency(const char* str, int* levels, int* num_levels) {
+  *num_levels = 0;
+  while (*str != '\0') {
+    char* end;
+    const long level = strtol(str, &end, 10);
+    if (end == str || level < 1 || level > MAX_CONCURRENCY ||
+        *num_levels >= MAX_CONCURRENCY_LEVELS) {
+      return 0;
+    }
+    levels[(*num_levels)++] = (int)level;
+    if (*end == ',') {
+      ++end;
+    } else if (*end != '\0') {
+      return 0;
+    }
+    str = end;
+  }
+  return *num_levels > 0;
+}
+
+static void show_usage(const char* program) {
+  fprintf(stderr, "Usage: %s [options] URL_PREFIX\n\n", program);
+  fprintf(stderr, "  URL_PREFIX  Prefix of the benchmark object URLs (e.g. a bucket URL\n");
+  fprintf(stderr, "              ending with /). Objects are named us3bench-N.\n\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  -a, --access-key KEY      The S3 access key\n");
+  fprintf(stderr, "  -A, --access-key-env ENV  Name of an environment variable holding the\n");
+  fprintf(stderr, "                            S3 access key\n");
+  fprintf(stderr, "  -s, --secret-key KEY      The S3 secret key\n");
+  fprintf(stderr, "  -S, --secret-key-env ENV  Name of an environment variable holding the\n");
+  fprintf(stderr, "                            S3 secret key\n");
+  fprintf(stderr, "  -c, --concurrency LIST    Comma separated concurrency levels to sweep\n");
+  fprintf(stderr, "                            (default: 1)\n");
+  fprintf(stderr, "  -d, --duration SECONDS    Duration of each run (default: 10)\n");
+  fprintf(stderr, "  -z, --size DIST           Object size distribution (default: fixed:1M):\n");
+  fprintf(stderr, "                              fixed:SIZE\n");
+  fprintf(stderr, "                              lognormal:MEDIAN:SIGMA\n");
+  fprintf(stderr, "                              file:PATH (one size per line)\n");
+  fprintf(stderr, "                            Sizes may have a K, M or G suffix.\n");
+  fprintf(stderr, "  -g, --get-percent PERCENT Percentage of GET requests, the rest are PUT\n");
+  fprintf(stderr, "                            requests (default: 100)\n");
+  fprintf(stderr, "  -n, --objects N           Number of objects (default: 16)\n");
+  fprintf(stderr, "      --no-prepare          Do not upload the objects before the first run\n");
+  fprintf(stderr, "      --signature V2|V4     Request signature version (default: V2)\n");
+  fprintf(stderr, "      --region REGION       The AWS region for V4 signatures\n");
+  fprintf(stderr, "      --seed N              Random seed (default: 1)\n");
+  fprintf(stderr, "  -j, --json                Print the report as JSON\n\n");
+  fprintf(stderr, "  -v, --verbose             Be verbose\n");
+}
+
+int main(const int argc, const char** argv) {
+  const char* program = argv[0];
+  config_t config;
+  int levels[MAX_CONCURRENCY_LEVELS];
+  int num_levels = 1;
+  int prepare = 1;
+  int json = 0;
+  int verbose = 0;
+  int bad_args = 0;
+  int i;
+  run_result_t* results;
+  int exit_status = EXIT_SUCCESS;
+
+  memset(&config, 0, sizeof(config));
+  us3_init_options(&config.options);
+  config.size_spec = "fixed:1M";
+  config.duration = 10.0;
+  config.get_percent = 100;
+  config.num_objects = 16;
+  config.seed = 1;
+  levels[0] = 1;
+
+  /* Parse arguments. */
+  for (i = 1; i < argc; ++i) {
+    const int has_value = i < (argc - 1);
+    if ((strcmp(argv[i], "--help") == 0) || (strcmp(argv[i], "-h") == 0)) {
+      show_usage(program);
+      exit(EXIT_SUCCESS);
+    } else if ((strcmp(argv[i], "--verbose") == 0) || (strcmp(argv[i], "-v") == 0)) {
+      verbose = 1;
+    } else if ((strcmp(argv[i], "--json") == 0) || (strcmp(argv[i], "-j") == 0)) {
+      json = 1;
+    } else if (strcmp(argv[i], "--no-prepare") == 0) {
+      prepare = 0;
+    } else if (!has_value) {
+      if (argv[i][0] == '-' || config.url_prefix != NULL) {
+        bad_args = 1;
+        break;
+      }
+      config.url_prefix = argv[i];
+    } else if ((strcmp(argv[i], "--access-key") == 0) || (strcmp(argv[i], "-a") == 0)) {
+      config.access_key = argv[++i];
+    } else if ((strcmp(argv[i], "--access-key-env") == 0) || (strcmp(argv[i], "-A") == 0)) {
+      config.access_key = getenv(argv[++i]);
+      if (config.access_key == NULL) {
+        fprintf(stderr, "*** No such environment variable: %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((strcmp(argv[i], "--secret-key") == 0) || (strcmp(argv[i], "-s") == 0)) {
+      config.secret_key = argv[++i];
+    } else if ((strcmp(argv[i], "--secret-key-env") == 0) || (strcmp(argv[i], "-S") == 0)) {
+      config.secret_key = getenv(argv[++i]);
+      if (config.secret_key == NULL) {
+        fprintf(stderr, "*** No such environment variable: %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((strcmp(argv[i], "--concurrency") == 0) || (strcmp(argv[i], "-c") == 0)) {
+      if (!parse_concurrency(argv[++i], levels, &num_levels)) {
+        fprintf(stderr, "*** Invalid concurrency: %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((strcmp(argv[i], "--duration") == 0) || (strcmp(argv[i], "-d") == 0)) {
+      config.duration = atof(argv[++i]);
+      if (config.duration <= 0.0) {
+        fprintf(stderr, "*** Invalid duration: %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((strcmp(argv[i], "--size") == 0) || (strcmp(argv[i], "-z") == 0)) {
+      config.size_spec = argv[++i];
+    } else if ((strcmp(argv[i], "--get-percent") == 0) || (strcmp(argv[i], "-g") == 0)) {
+      config.get_percent = atoi(argv[++i]);
+      if (config.get_percent < 0 || config.get_percent > 100) {
+        fprintf(stderr, "*** Invalid GET percentage: %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((strcmp(argv[i], "--objects") == 0) || (strcmp(argv[i], "-n") == 0)) {
+      const long num_objects = atol(argv[++i]);
+      if (num_objects < 1) {
+        fprintf(stderr, "*** Invalid number of objects: %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      config.num_objects = (unsigned long)num_objects;
+    } else if (strcmp(argv[i], "--signature") == 0) {
+      ++i;
+      if (strcmp(argv[i], "V2") == 0 || strcmp(argv[i], "v2") == 0) {
+        config.options.signature = US3_SIGNATURE_V2;
+      } else if (strcmp(argv[i], "V4") == 0 || strcmp(argv[i], "v4") == 0) {
+        config.options.signature = US3_SIGNATURE_V4;
+      } else {
+        fprintf(stderr, "*** Invalid signature version: %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+    } else if (strcmp(argv[i], "--region") == 0) {
+      config.options.region = argv[++i];
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      config.seed = (unsigned long)atol(argv[++i]);
+    } else if (argv[i][0] != '-' && config.url_prefix == NULL) {
+      config.url_prefix = argv[i];
+    } else {
+      bad_args = 1;
+      break;
+    }
+  }
+  if (bad_args || (config.url_prefix == NULL) || (config.access_key == NULL) ||
+      (config.secret_key == NULL)) {
+    show_usage(program);
+    exit(EXIT_FAILURE);
+  }
+  if (!parse_size_dist(config.size_spec, &config.size_dist)) {
+    fprintf(stderr, "*** Invalid size distribution: %s\n", config.size_spec);
+    exit(EXIT_FAILURE);
+  }
+
+  /* The objects must exist before they can be read. */
+  if (prepare && config.get_percent > 0) {
+    if (!prepare_objects(&config, verbose)) {
+      free(config.size_dist.sizes);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* Run the concurrency sweep. */
+  results = (run_result_t*)calloc((size_t)num_levels, sizeof(run_result_t));
+  if (results == NULL) {
+    fprintf(stderr, "*** Out of memory\n");
+    free(config.size_dist.sizes);
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < num_levels; ++i) {
+    if (!run_benchmark(&config, levels[i], &results[i], verbose)) {
+      exit_status = EXIT_FAILURE;
+    }
+    if (!json) {
+      print_text_report(&results[i]);
+      fflush(stdout);
+    }
+  }
+  if (json) {
+    print_json_report(&config, results, num_levels);
+  }
+
+  for (i = 0; i < num_levels; ++i) {
+    free_result(&results[i]);
+  }
+  free(results);
+  free(config.size_dist.sizes);
+  return exit_status;
+}